@@ -0,0 +1,153 @@
+# vim: sts=4 sw=4 et
+"""
+record layouts and record files of the recorder, samplerv2 and
+streamerv2 components - see src/hal/components/hal_record.h
+
+A record is a sequence number (u64), an rtapi_get_time() timestamp (s64)
+and the values, 64-bit ones first, then 32-bit ones, then bits.  The
+component publishes the layout as text in its ring scratchpad:
+
+    recorder 1 <record size> <entries>
+    <offset> <type> <name>              one line per entry
+
+A record file, as written by 'halrecord -o', is a memory-mapped circular
+buffer behind a header of whole pages: the header size (u64), the count
+of records ever written (u64), then the layout text, NUL terminated and
+padded; slots * record size bytes follow the header.
+"""
+
+import mmap
+import os
+import struct
+
+PAGE = 4096
+U64 = struct.Struct('=Q')
+SIZE_OFFSET = 0                 # header size, a multiple of PAGE
+COUNT_OFFSET = 8                # records ever written
+TEXT_OFFSET = 16                # layout text
+HDR = struct.Struct('=Qq')      # sequence, timestamp
+FMT = {'bit': 'B', 'float': 'd', 's32': 'i', 'u32': 'I',
+       's64': 'q', 'u64': 'Q'}
+MAGIC = b'recorder 1 '
+
+
+class Layout:
+    def __init__(self, text):
+        lines = text.split('\n')
+        head = lines[0].split()
+        if len(head) != 4 or head[0] != 'recorder' or head[1] != '1':
+            raise ValueError('not a recorder layout: %r' % lines[0])
+        self.text = text
+        self.size = int(head[2])
+        self.fields = []        # (offset, type) in entry order
+        self.names = []
+        for line in lines[1:int(head[3]) + 1]:
+            offset, type, name = line.split()
+            if type not in FMT:
+                raise ValueError('unknown type %r in layout' % type)
+            self.fields.append((int(offset), type))
+            self.names.append(name)
+        # sequence and timestamp, then the values in record order
+        self.order = sorted(range(len(self.fields)),
+                            key=lambda i: self.fields[i][0])
+        self.struct = struct.Struct(
+            '=Qq' + ''.join(FMT[self.fields[i][1]] for i in self.order))
+        if self.struct.size != self.size:
+            raise ValueError('layout has holes, size %d != %d'
+                             % (self.struct.size, self.size))
+
+    @classmethod
+    def from_ring(cls, ring):
+        return cls(bytes(ring.scratchpad).split(b'\0', 1)[0].decode())
+
+    def same(self, other):
+        """ same record format - the names do not matter """
+        return self.size == other.size and self.fields == other.fields
+
+    def decode(self, record):
+        """ (sequence, timestamp, [values in entry order]) """
+        v = self.struct.unpack_from(record)
+        values = [None] * len(self.fields)
+        for n, i in enumerate(self.order):
+            values[i] = v[n + 2]
+        return v[0], v[1], values
+
+    def parse(self, seq, line):
+        """ a record from whitespace separated values in entry order """
+        words = line.split()
+        if len(words) != len(self.fields):
+            raise ValueError('expected %d values, got %d'
+                             % (len(self.fields), len(words)))
+        values = []
+        for i in self.order:
+            type, word = self.fields[i][1], words[i]
+            if type == 'float':
+                values.append(float(word))
+            elif type == 'bit':
+                values.append(1 if word.lower() in ('1', 'true') else 0)
+            else:
+                values.append(int(word, 0))
+        return self.struct.pack(seq, 0, *values)
+
+
+def header_size(text):
+    """ whole pages for the fixed fields and the NUL terminated text """
+    n = TEXT_OFFSET + len(text) + 1
+    return (n + PAGE - 1) // PAGE * PAGE
+
+
+class RecordFile:
+    """ writer side of a record file """
+    def __init__(self, path, layout, slots):
+        self.layout = layout
+        self.slots = slots
+        text = layout.text.encode()
+        self.header = header_size(text)
+        size = self.header + slots * layout.size
+        fd = os.open(path, os.O_RDWR | os.O_CREAT | os.O_TRUNC, 0o644)
+        os.ftruncate(fd, size)
+        self.map = mmap.mmap(fd, size)
+        os.close(fd)
+        U64.pack_into(self.map, SIZE_OFFSET, self.header)
+        self.map[TEXT_OFFSET:TEXT_OFFSET + len(text)] = text
+        self.count = 0
+
+    def write(self, record):
+        offset = self.header + (self.count % self.slots) * self.layout.size
+        self.map[offset:offset + len(record)] = record
+        self.count += 1
+        # the count goes last, so a reader never sees a torn record
+        U64.pack_into(self.map, COUNT_OFFSET, self.count)
+
+    def close(self):
+        self.map.flush()
+        self.map.close()
+
+
+def is_record_file(m):
+    return (len(m) >= PAGE and
+            m[TEXT_OFFSET:TEXT_OFFSET + len(MAGIC)] == MAGIC)
+
+
+def file_header_size(m):
+    size, = U64.unpack_from(m, SIZE_OFFSET)
+    if size < PAGE or size % PAGE or size > len(m):
+        raise ValueError('bad record file header size %d' % size)
+    return size
+
+
+def file_layout(m):
+    end = file_header_size(m)
+    return Layout(m[TEXT_OFFSET:end].split(b'\0', 1)[0].decode())
+
+
+def file_records(m, layout):
+    """ the records of a mapped record file, oldest first """
+    header = file_header_size(m)
+    count, = U64.unpack_from(m, COUNT_OFFSET)
+    slots = (len(m) - header) // layout.size
+    if slots == 0:
+        return
+    for i in range(max(0, count - slots), count):
+        offset = header + (i % slots) * layout.size
+        yield m[offset:offset + layout.size]
@@ -0,0 +1,90 @@
+#!/usr/bin/env python3
+
+
+import pytest
+from rtapilog import Log
+from machinekit import hal,rtapi
+
+l = Log(level=rtapi.MSG_INFO,tag="nosetest")
+
+
+@pytest.mark.usefixtures("realtime")
+class Tests(object):
+    def test_component_creation(self):
+        l.log()
+        global c1,c2
+        c1 = hal.Component("b1")
+        c1.newpin("s32out", hal.HAL_S32, hal.HAL_OUT, init=42)
+        c1.newpin("floatout", hal.HAL_FLOAT, hal.HAL_OUT, init=1.5)
+        c1.newpin("floatin", hal.HAL_FLOAT, hal.HAL_IN)
+        c1.ready()
+
+        c2 = hal.Component("b2")
+        c2.newpin("s32in", hal.HAL_S32, hal.HAL_IN)
+        c2.newpin("floatin", hal.HAL_FLOAT, hal.HAL_IN)
+        c2.newpin("bitin", hal.HAL_BIT, hal.HAL_IN)
+        c2.newpin("s32out", hal.HAL_S32, hal.HAL_OUT)
+        c2.ready()
+
+
+    def test_bulk_commit(self):
+        l.log()
+        with hal.Bulk() as b:
+            b.net("bs32", "b1.s32out", "b2.s32in")
+            b.net("bfloat", "b2.floatin")
+            b.sets("bfloat", 2.25)
+            b.setp("b2.bitin", True)
+            assert len(b) == 5
+
+        assert hal.pins["b2.s32in"].linked is True
+        assert hal.signals["bs32"].writers == 1
+        assert hal.signals["bs32"].readers == 1
+        assert hal.signals["bs32"].get() == 42
+        assert hal.signals["bfloat"].get() == 2.25
+        assert hal.pins["b2.bitin"].get()
+
+
+    def test_bulk_all_or_nothing(self):
+        l.log()
+        b = hal.Bulk()
+        b.net("bnew", "b1.floatin")
+        b.net("bs32", "b2.s32out")   # second writer
+        try:
+            b.commit()
+            raise "should not happen"
+        except RuntimeError:
+            pass
+        # the first item was checked, but not applied
+        assert "bnew" not in hal.signals
+        assert hal.pins["b1.floatin"].linked is False
+
+
+    def test_bulk_checks_in_order(self):
+        l.log()
+        # a pin linked earlier in the batch is no longer settable
+        b = hal.Bulk()
+        b.net("bfloat2", "b1.floatout", "b1.floatin")
+        b.setp("b1.floatin", 1.0)
+        try:
+            b.commit()
+            raise "should not happen"
+        except RuntimeError:
+            pass
+        assert "bfloat2" not in hal.signals
+
+        # the other way round is fine, and the signal inherits the writer
+        with hal.Bulk() as b:
+            b.setp("b1.floatin", 3.0)
+            b.net("bfloat2", "b1.floatout", "b1.floatin")
+        assert hal.signals["bfloat2"].get() == 1.5
+
+
+    def test_bulk_abandoned(self):
+        l.log()
+        try:
+            with hal.Bulk() as b:
+                b.net("babandoned", "b2.s32out")
+                raise KeyError("oops")
+        except KeyError:
+            pass
+        assert "babandoned" not in hal.signals
@@ -0,0 +1,194 @@
+/********************************************************************
+* Description:  benchmon.c
+*               Per-cycle timing capture for HAL threads.
+*
+* License: GPL Version 2
+*
+********************************************************************/
+/** benchmon records the execution time of every funct of a thread,
+    once per thread cycle, into a HAL record ring.  It is the RT half
+    of the 'halbench' tool, but can be used standalone.
+
+    usage:
+
+	loadrt benchmon
+	newinst benchmon bm.servo [ringsize=1048576]
+	addf bm.servo.sample servo
+
+    The instance creates a record ring with the instance name.  Its
+    funct must be added last to the thread it measures - it walks the
+    thread's funct list up to itself and writes one record per cycle:
+
+	hal_s32_t period;	  current invocation period (curr-period pin)
+	hal_s32_t elapsed;	  thread start to benchmon start
+	hal_s32_t nfuncts;	  number of funct times which follow
+	hal_s32_t time[nfuncts]; the '<funct>.time' pins, in thread order
+
+    All times are in rtapi_get_time() units (nS).  'elapsed' minus the
+    sum of the funct times is the thread dispatch overhead of that cycle.
+    If the ring is full the record is dropped and 'overruns' counts up.
+*/
+
+/** This program is free software; you can redistribute it and/or
+    modify it under the terms of version 2 of the GNU General
+    Public License as published by the Free Software Foundation.
+    This library is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public
+    License along with this library; if not, write to the Free Software
+    Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111 USA
+
+    This code is part of the Machinekit HAL project.  For more
+    information, go to https://github.com/machinekit.
+*/
+
+#include "rtapi.h"
+#include "rtapi_app.h"
+#include "hal.h"
+#include "hal_priv.h"
+#include "hal_ring.h"
+#include "hal_logging.h"
+
+MODULE_DESCRIPTION("per-cycle funct timing capture into a HAL ring");
+MODULE_LICENSE("GPL");
+RTAPI_TAG(HAL, HC_INSTANTIABLE);
+
+static int ringsize = 1048576;
+RTAPI_IP_INT(ringsize, "size of the record ring in bytes");
+
+#define BM_MAX_FUNCTS 256	/* functs per thread recorded */
+
+struct bm_record {
+    hal_s32_t period;
+    hal_s32_t elapsed;
+    hal_s32_t nfuncts;
+    hal_s32_t time[];
+};
+
+struct inst_data {
+    ringbuffer_t rb;		// attached in rtapi_app, RT side only
+    hal_u32_t *records;		// pin: records written
+    hal_u32_t *overruns;	// pin: records dropped, ring full
+    char name[HAL_NAME_LEN + 1];
+    int ring_created;		// set once instantiate() made the ring
+    int ring_attached;		// set once instantiate() attached it
+};
+
+static int comp_id;
+static char *compname = "benchmon";
+
+static int sample(void *arg, const hal_funct_args_t *fa)
+{
+    struct inst_data *ip = arg;
+    hal_thread_t *thread = fa->thread;
+    hal_list_t *root, *entry;
+    hal_funct_entry_t *fentry;
+    hal_funct_t *funct;
+    struct bm_record *rec;
+    void *ptr;
+    size_t size;
+    long long now = rtapi_get_time();
+    int n;
+
+    if (thread == NULL)		// callfunc, no thread to measure
+	return 0;
+
+    // size the record: functs ahead of us in the thread
+    root = &thread->funct_list;
+    n = 0;
+    for (entry = dlist_next(root); entry != root; entry = dlist_next(entry)) {
+	fentry = (hal_funct_entry_t *) entry;
+	if (SHMPTR(fentry->funct_ptr) == fa->funct)
+	    break;
+	n++;
+    }
+    if (n > BM_MAX_FUNCTS)
+	n = BM_MAX_FUNCTS;
+    size = sizeof(struct bm_record) + n * sizeof(hal_s32_t);
+
+    if (record_write_begin(&ip->rb, &ptr, size)) {
+	*(ip->overruns) += 1;
+	return 0;
+    }
+    rec = ptr;
+    rec->period = get_s32_pin(thread->curr_period);
+    rec->elapsed = now - fa_thread_start_time(fa);
+    rec->nfuncts = n;
+    entry = dlist_next(root);
+    for (n = 0; n < rec->nfuncts; n++) {
+	fentry = (hal_funct_entry_t *) entry;
+	funct = SHMPTR(fentry->funct_ptr);
+	rec->time[n] = get_s32_pin(funct->f_runtime);
+	entry = dlist_next(entry);
+    }
+    record_write_end(&ip->rb, ptr, size);
+    *(ip->records) += 1;
+    return 0;
+}
+
+static int instantiate(const int argc, char* const *argv)
+{
+    const char *name = argv[1];
+    struct inst_data *ip;
+    int inst_id, retval;
+
+    if ((inst_id = hal_inst_create(name, comp_id,
+				   sizeof(struct inst_data),
+				   (void **)&ip)) < 0)
+	return inst_id;
+
+    rtapi_snprintf(ip->name, sizeof(ip->name), "%s", name);
+
+    if ((retval = hal_ring_newf(ringsize, 0, RINGTYPE_RECORD, "%s", name)) < 0)
+	HALFAIL_RC(-retval, "%s: failed to create ring '%s'", compname, name);
+    ip->ring_created = 1;
+    if ((retval = hal_ring_attachf(&ip->rb, NULL, "%s", name)) < 0)
+	HALFAIL_RC(-retval, "%s: failed to attach ring '%s'", compname, name);
+    ip->ring_attached = 1;
+
+    if (((retval = hal_pin_u32_newf(HAL_OUT, &ip->records, inst_id,
+				    "%s.records", name)) < 0) ||
+	((retval = hal_pin_u32_newf(HAL_OUT, &ip->overruns, inst_id,
+				    "%s.overruns", name)) < 0))
+	return retval;
+
+    hal_export_xfunct_args_t xfunct_args = {
+        .type = FS_XTHREADFUNC,
+        .funct.x = sample,
+        .arg = ip,
+        .uses_fp = 0,
+        .reentrant = 0,
+        .owner_id = inst_id
+    };
+    return hal_export_xfunctf(&xfunct_args, "%s.sample", name);
+}
+
+// the ring is not owned by the instance, release it here - but only
+// if this instance created it, a failed instantiate() lands here too
+static int delete(const char *name, void *inst, const int inst_size)
+{
+    struct inst_data *ip = inst;
+
+    if (ip->ring_attached)
+	hal_ring_detach(&ip->rb);
+    if (ip->ring_created)
+	hal_ring_deletef("%s", ip->name);
+    return 0;
+}
+
+int rtapi_app_main(void)
+{
+    comp_id = hal_xinit(TYPE_RT, 0, 0, instantiate, delete, compname);
+    if (comp_id < 0)
+	return comp_id;
+    hal_ready(comp_id);
+    return 0;
+}
+
+void rtapi_app_exit(void)
+{
+    hal_exit(comp_id);
+}
@@ -17,7 +17,7 @@
     1KHz for even the slowest computers, and may reach 10KHz on fast
     ones.  It is a realtime component.
 
-    It supports up to eight counters, with optional index pulses.
+    It supports up to 32 counters, with optional index pulses.
     The number of counters is set by the module parameter 'num_chan='
     when the component is insmod'ed.  Alternatively, use the
     names= specifier and a list of unique names separated by commas.
@@ -28,6 +28,14 @@
     called in a high speed thread, at least twice the maximum desired
     count rate.  "encoder.capture-position" can be called at a much
     slower rate, and updates the output variables.
+
+    With 'bitslice=1', "encoder.update-counters" decodes all channels
+    in parallel: the A, B, Z and latch inputs of every channel are
+    gathered into one bit per channel in packed words, the state
+    machines of the lookup tables below are evaluated as boolean
+    word operations, and only channels which actually counted, saw
+    an index or latch edge are visited afterwards.  Results are
+    identical to the table driven decoder.
 */
 
 /** Copyright (C) 2003 John Kasunich
@@ -73,8 +81,10 @@ static int num_chan;
 static int default_num_chan=3;
 static int howmany;
 RTAPI_MP_INT(num_chan, "number of encoder channels");
+static int bitslice = 0;
+RTAPI_MP_INT(bitslice, "decode all channels in parallel (bit-sliced)");
 
-#define MAX_CHAN 8
+#define MAX_CHAN 32
 char *names[MAX_CHAN] = {0,};
 RTAPI_MP_ARRAY_STRING(names, MAX_CHAN, "names of encoder");
 
@@ -137,6 +147,14 @@ typedef struct {
 
 static __u32 timebase;		/* master timestamp for all counters */
 
+/* bit-sliced decoder state, bit n belongs to channel n */
+static struct {
+    __u32 oldA;			/* state machine phase A bit */
+    __u32 oldB;			/* state machine phase B bit */
+    __u32 oldZ;			/* previous value of phase Z */
+    __u32 old_latch;		/* previous value of latch-input */
+} bs;
+
 /* pointer to array of counter_t structs in shmem, 1 per counter */
 static counter_t *counter_array;
 
@@ -183,6 +201,7 @@ static int comp_id;		/* component ID */
 
 static int export_encoder(counter_t * addr,char * prefix);
 static void update(void *arg, long period);
+static void update_bitsliced(void *arg, long period);
 static void capture(void *arg, long period);
 
 /***********************************************************************
@@ -283,8 +302,8 @@ int rtapi_app_main(void)
 	cntr->counts_since_timeout = 0;
     }
     /* export functions */
-    retval = hal_export_funct("encoder.update-counters", update,
-	counter_array, 0, 0, comp_id);
+    retval = hal_export_funct("encoder.update-counters",
+	bitslice ? update_bitsliced : update, counter_array, 0, 0, comp_id);
     if (retval != 0) {
 	rtapi_print_msg(RTAPI_MSG_ERR,
 	    "ENCODER: ERROR: count funct export failed\n");
@@ -390,6 +409,92 @@ static void update(void *arg, long period)
     /* done */
 }
 
+/* update_bitsliced() is the bit-parallel equivalent of update().  The
+   boolean expressions below are derived from lut_x4, lut_x1 and
+   lut_ctr, the two state bits correspond to bits 2 and 3 of 'state'.
+*/
+static void update_bitsliced(void *arg, long period)
+{
+    counter_t *cntr;
+    atomic *buf;
+    int n;
+    __u32 A, B, Z, latch, x4, ctr, x1, zena, rising, falling;
+    __u32 one, dir, up, dn, index, latched, events, bit;
+
+    /* gather inputs of all channels, one bit per channel */
+    A = B = Z = latch = x4 = ctr = zena = rising = falling = 0;
+    cntr = arg;
+    for (n = 0; n < howmany; n++) {
+	A |= (__u32)(*(cntr->phaseA) != 0) << n;
+	B |= (__u32)(*(cntr->phaseB) != 0) << n;
+	Z |= (__u32)(*(cntr->phaseZ) != 0) << n;
+	latch |= (__u32)(*(cntr->latch_in) != 0) << n;
+	x4 |= (__u32)(*(cntr->x4_mode) != 0) << n;
+	ctr |= (__u32)(*(cntr->counter_mode) != 0) << n;
+	zena |= (__u32)(cntr->Zmask != 0) << n;
+	rising |= (__u32)(*(cntr->latch_rising) != 0) << n;
+	falling |= (__u32)(*(cntr->latch_falling) != 0) << n;
+	cntr++;
+    }
+    /* counter mode overrides x4 mode, x1 is neither */
+    x4 &= ~ctr;
+    x1 = ~(x4 | ctr);
+
+    /* x4: count if exactly one phase changed, direction is A vs old B */
+    one = A ^ B ^ bs.oldA ^ bs.oldB;
+    dir = A ^ bs.oldB;
+    up = (x4 & one & dir) |
+	(x1 & A & ~B & ~bs.oldA & ~bs.oldB) |
+	(ctr & A & ~bs.oldA & ~bs.oldB);
+    dn = (x4 & one & ~dir) |
+	(x1 & ~A & ~B & bs.oldA & ~bs.oldB);
+    /* counter mode keeps the previous phase A in the B state bit */
+    bs.oldB = (ctr & A & ~bs.oldA) | (~ctr & B);
+    bs.oldA = ~ctr & A;
+
+    /* rising edge on phase Z with index enabled */
+    index = Z & ~bs.oldZ & zena;
+    bs.oldZ = Z;
+    /* desired edge on latch-in */
+    latched = (latch & ~bs.old_latch & rising) |
+	(~latch & bs.old_latch & falling);
+    bs.old_latch = latch;
+
+    /* visit only the channels which have something to report */
+    events = up | dn | index | latched;
+    if (howmany < 32)
+	events &= (1U << howmany) - 1;
+    cntr = arg;
+    while (events) {
+	n = __builtin_ctz(events);
+	bit = 1U << n;
+	events &= ~bit;
+	buf = (atomic *) cntr[n].bp;
+	if (up & bit) {
+	    (*cntr[n].raw_counts)++;
+	    buf->raw_count = *(cntr[n].raw_counts);
+	    buf->timestamp = timebase;
+	    buf->count_detected = 1;
+	} else if (dn & bit) {
+	    (*cntr[n].raw_counts)--;
+	    buf->raw_count = *(cntr[n].raw_counts);
+	    buf->timestamp = timebase;
+	    buf->count_detected = 1;
+	}
+	if (index & bit) {
+	    buf->index_count = *(cntr[n].raw_counts);
+	    buf->index_detected = 1;
+	    cntr[n].Zmask = 0;
+	}
+	if (latched & bit) {
+	    buf->latch_detected = 1;
+	    buf->latch_count = *(cntr[n].raw_counts);
+	}
+    }
+    /* increment main timestamp counter */
+    timebase += period;
+}
+
 
 static void capture(void *arg, long period)
 {
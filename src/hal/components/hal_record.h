@@ -0,0 +1,172 @@
+/********************************************************************
+* Description:  hal_record.h
+*               The record format shared by the "recorder",
+*               "samplerv2" and "streamerv2" HAL components, and
+*               read by halrecord/halstream (machinekit.recordfile).
+*
+* License: GPL Version 2
+********************************************************************/
+#ifndef HAL_RECORD_H
+#define HAL_RECORD_H
+
+// a record in a HAL record ring is
+//
+//   u64 sequence, s64 rtapi_get_time() timestamp,
+//   the 64-bit values, the 32-bit values, the bit values (one byte each)
+//
+// so every value is naturally aligned. The layout is published as text
+// in the ring scratchpad, one line per value:
+//
+//   recorder 1 <record size> <entries>
+//   <offset> <type> <name>
+
+#define REC_HDR_SIZE	16	/* sequence + timestamp */
+#define REC_LINE_LEN	(HAL_NAME_LEN + 24)	/* per scratchpad line */
+
+// a record file (halrecord -o, halscope data files) is a header of
+// whole REC_PAGE pages, then a circular buffer of records:
+//
+//   u64 header size in bytes, where the records start
+//   u64 count of records ever written, updated after each record
+//   the layout text, NUL terminated and padded to the header size
+
+#define REC_PAGE		4096
+#define REC_FILE_SIZE_OFFSET	0
+#define REC_FILE_COUNT_OFFSET	8
+#define REC_FILE_TEXT_OFFSET	16
+
+// header size of a record file with a layout text of 'textlen' bytes
+static inline size_t rec_file_header_size(size_t textlen)
+{
+    size_t n = REC_FILE_TEXT_OFFSET + textlen + 1;
+    return (n + REC_PAGE - 1) / REC_PAGE * REC_PAGE;
+}
+
+typedef struct {
+    int n64, n32, n8;		// values of each size
+    int payload;		// record size minus REC_HDR_SIZE
+} rec_layout_t;
+
+static inline int rec_value_size(const hal_type_t type)
+{
+    switch (type) {
+    case HAL_FLOAT:
+    case HAL_S64:
+    case HAL_U64:
+	return 8;
+    case HAL_S32:
+    case HAL_U32:
+	return 4;
+    case HAL_BIT:
+	return 1;
+    default:
+	return 0;
+    }
+}
+
+static inline const char *rec_type_name(const hal_type_t type)
+{
+    switch (type) {
+    case HAL_BIT:   return "bit";
+    case HAL_FLOAT: return "float";
+    case HAL_S32:   return "s32";
+    case HAL_U32:   return "u32";
+    case HAL_S64:   return "s64";
+    case HAL_U64:   return "u64";
+    default:	    return "unknown";
+    }
+}
+
+// account one value of 'type', and the record size
+static inline void rec_layout_add(rec_layout_t *l, const hal_type_t type)
+{
+    switch (rec_value_size(type)) {
+    case 8: l->n64++; break;
+    case 4: l->n32++; break;
+    case 1: l->n8++;  break;
+    }
+    l->payload = l->n64 * 8 + l->n32 * 4 + l->n8;
+}
+
+static inline int rec_size(const rec_layout_t *l)
+{
+    return REC_HDR_SIZE + l->payload;
+}
+
+// offset of the value in record order position 'slot'
+static inline int rec_slot_offset(const rec_layout_t *l, int slot)
+{
+    if (slot < l->n64)
+	return REC_HDR_SIZE + slot * 8;
+    slot -= l->n64;
+    if (slot < l->n32)
+	return REC_HDR_SIZE + l->n64 * 8 + slot * 4;
+    slot -= l->n32;
+    return REC_HDR_SIZE + l->n64 * 8 + l->n32 * 4 + slot;
+}
+
+// scratchpad layout text: the head line, then one rec_layout_entry()
+// per value; both return the new length, >= spsize if it did not fit
+static inline size_t rec_layout_head(char *sp, size_t spsize,
+				     const rec_layout_t *l)
+{
+    return rtapi_snprintf(sp, spsize, "recorder 1 %d %d\n", rec_size(l),
+			  l->n64 + l->n32 + l->n8);
+}
+
+static inline size_t rec_layout_entry(char *sp, size_t spsize, size_t len,
+				      int offset, const hal_type_t type,
+				      const char *name)
+{
+    if (len >= spsize)
+	return len;
+    return len + rtapi_snprintf(sp + len, spsize - len, "%d %s %s\n",
+				offset, rec_type_name(type), name);
+}
+
+// samplerv2/streamerv2 cfg strings: one character per pin
+static inline hal_type_t rec_cfg_type(const char c)
+{
+    switch (c) {
+    case 'f': case 'F': return HAL_FLOAT;
+    case 'b': case 'B': return HAL_BIT;
+    case 's': case 'S': return HAL_S32;
+    case 'u': case 'U': return HAL_U32;
+    default:		return HAL_TYPE_UNSPECIFIED;
+    }
+}
+
+// record order position of cfg pin 'n'
+static inline int rec_cfg_slot(const rec_layout_t *l, const char *cfg, int n)
+{
+    int size = rec_value_size(rec_cfg_type(cfg[n]));
+    int slot = 0, i;
+
+    if (size < 8)
+	slot += l->n64;
+    if (size < 4)
+	slot += l->n32;
+    for (i = 0; i < n; i++)
+	if (rec_value_size(rec_cfg_type(cfg[i])) == size)
+	    slot++;
+    return slot;
+}
+
+// the layout text of a cfg string, pins named <name>.pin.<n>
+static inline int rec_cfg_layout(const rec_layout_t *l, const char *cfg,
+				 const char *name, char *sp, size_t spsize)
+{
+    char pin[HAL_NAME_LEN + 1];
+    int i, n = strlen(cfg);
+    size_t len = rec_layout_head(sp, spsize, l);
+
+    for (i = 0; i < n; i++) {
+	rtapi_snprintf(pin, sizeof(pin), "%s.pin.%d", name, i);
+	len = rec_layout_entry(sp, spsize, len,
+			       rec_slot_offset(l, rec_cfg_slot(l, cfg, i)),
+			       rec_cfg_type(cfg[i]), pin);
+    }
+    return (len < spsize) ? 0 : -ENOSPC;
+}
+
+#endif // HAL_RECORD_H
@@ -0,0 +1,330 @@
+/********************************************************************
+* Description:  recorder.c
+*               Cycle-consistent capture of a signal group into a ring.
+*
+* License: GPL Version 2
+*
+********************************************************************/
+/** recorder copies the current values of all signals in a HAL group
+    into one packed binary record per invocation, and writes it to a
+    HAL record ring.  All values of a record are taken in the same
+    funct call, so they are consistent with respect to the thread the
+    funct runs in - add it last to that thread.
+
+    usage:
+
+	newg crashlog
+	newm crashlog x-pos-cmd
+	newm crashlog x-pos-fb
+	...
+	newinst recorder rec.servo group=crashlog [ringsize=4194304]
+		[decimate=N] [onchange=1]
+	addf rec.servo.sample servo
+
+    The instance creates a record ring with the instance name.  The
+    group is compiled once at newinst time into three lists - 8, 4 and
+    1 byte values - so a record is naturally aligned and there is no
+    per-signal type dispatch in the RT path.  A record is:
+
+	hal_u64_t sequence;	  invocation count, counts decimated calls too
+	hal_s64_t timestamp;	  rtapi_get_time() at sample time
+	<values>		  64bit values, then 32bit, then bits (1 byte)
+
+    The layout is published as text in the ring scratchpad, one header
+    line and one line per signal:
+
+	recorder 1 <record size> <number of signals>
+	<offset> <bit|float|s32|u32|s64|u64> <signal name>
+
+    'decimate=N' records every N-th invocation.  'onchange=1' drops a
+    record whose values are identical to the previous record written;
+    the sequence number shows the gap.  The group is referenced while
+    the instance exists, so it cannot be changed under the recorder.
+
+    The userland companion 'halrecord' streams the records to a
+    memory-mapped file or a zeroMQ socket.
+
+    pins:
+	<name>.enable	  bit in, default 1
+	<name>.records	  u32 out, records written
+	<name>.overruns	  u32 out, records dropped because the ring was full
+*/
+
+/** This program is free software; you can redistribute it and/or
+    modify it under the terms of version 2 of the GNU General
+    Public License as published by the Free Software Foundation.
+    This library is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public
+    License along with this library; if not, write to the Free Software
+    Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111 USA
+
+    This code is part of the Machinekit HAL project.  For more
+    information, go to https://github.com/machinekit.
+*/
+
+#include "rtapi.h"
+#include "rtapi_app.h"
+#include "rtapi_string.h"
+#include "hal.h"
+#include "hal_priv.h"
+#include "hal_group.h"
+#include "hal_ring.h"
+#include "hal_logging.h"
+#include "hal_record.h"
+
+MODULE_DESCRIPTION("cycle-consistent capture of a signal group into a HAL ring");
+MODULE_LICENSE("GPL");
+RTAPI_TAG(HAL, HC_INSTANTIABLE);
+
+static char *group = "";
+RTAPI_IP_STRING(group, "name of the signal group to record");
+
+static int ringsize = 4194304;
+RTAPI_IP_INT(ringsize, "size of the record ring in bytes");
+
+static int decimate = 1;
+RTAPI_IP_INT(decimate, "record every N-th invocation");
+
+static int onchange = 0;
+RTAPI_IP_INT(onchange, "skip records identical to the previous one");
+
+struct inst_data {
+    ringbuffer_t rb;		// attached in rtapi_app, RT side only
+    hal_bit_t *enable;
+    hal_u32_t *records;
+    hal_u32_t *overruns;
+
+    // the compiled group
+    rec_layout_t layout;
+    hal_sig_t **sig;		// one entry per value, in record order
+    void *last;			// previous payload, onchange only
+
+    int decimate;
+    int onchange;
+    int dcount;
+    hal_u64_t sequence;
+    char name[HAL_NAME_LEN + 1];
+    char group[HAL_NAME_LEN + 1];
+
+    // the steps instantiate() completed, undone by delete() - a failed
+    // instantiate() leaves the instance to be deleted
+    int group_ref;
+    int ring_created;
+    int ring_attached;
+};
+
+static int comp_id;
+static char *compname = "recorder";
+
+static int sample(void *arg, const hal_funct_args_t *fa)
+{
+    struct inst_data *ip = arg;
+    hal_sig_t **sig = ip->sig;
+    hal_u64_t *p64;
+    hal_u32_t *p32;
+    hal_u8_t *p8;
+    void *ptr;
+    int i, size = rec_size(&ip->layout);
+
+    ip->sequence++;
+    if (!*(ip->enable))
+	return 0;
+    if (++ip->dcount < ip->decimate)
+	return 0;
+    ip->dcount = 0;
+
+    if (record_write_begin(&ip->rb, &ptr, size)) {
+	*(ip->overruns) += 1;
+	return 0;
+    }
+    p64 = ptr;
+    *p64++ = ip->sequence;
+    *p64++ = (hal_u64_t) rtapi_get_time();
+    for (i = 0; i < ip->layout.n64; i++)
+	*p64++ = rtapi_load_u64(&(*sig++)->value.lu);
+    p32 = (hal_u32_t *) p64;
+    for (i = 0; i < ip->layout.n32; i++)
+	*p32++ = rtapi_load_u32(&(*sig++)->value.u);
+    p8 = (hal_u8_t *) p32;
+    for (i = 0; i < ip->layout.n8; i++)
+	*p8++ = (*sig++)->value.b;
+
+    if (ip->onchange) {
+	char *payload = (char *) ptr + REC_HDR_SIZE;
+	// the first record always goes out
+	if ((*(ip->records) > 0) &&
+	    (memcmp(payload, ip->last, ip->layout.payload) == 0))
+	    return 0;	// no commit - the ring is left unchanged
+	memcpy(ip->last, payload, ip->layout.payload);
+    }
+    record_write_end(&ip->rb, ptr, size);
+    *(ip->records) += 1;
+    return 0;
+}
+
+// count members of each value size; user_arg1 selects a size to
+// collect into the sig array (0: count only)
+static int member_cb(hal_object_ptr o, foreach_args_t *args)
+{
+    struct inst_data *ip = args->user_ptr1;
+    hal_sig_t *sig = SHMPTR(o.member->sig_ptr);
+    int size = rec_value_size(sig->type);
+
+    switch (args->user_arg1) {
+    case 0:
+	rec_layout_add(&ip->layout, sig->type);
+	break;
+    default:
+	if (size == args->user_arg1)
+	    ip->sig[args->user_arg2++] = sig;
+    }
+    return 0;
+}
+
+static int compile_group(struct inst_data *ip)
+{
+    hal_group_t *grp;
+    foreach_args_t args = {
+	.type = HAL_MEMBER,
+	.user_ptr1 = ip,
+    };
+    int n;
+
+    {
+	WITH_HAL_MUTEX();
+	if ((grp = halpr_find_group_by_name(ip->group)) == NULL)
+	    HALFAIL_RC(ENOENT, "%s: %s: no such group '%s'",
+		       compname, ip->name, ip->group);
+	args.owner_id = ho_id(grp);
+	halg_foreach(0, &args, member_cb);
+	n = ip->layout.n64 + ip->layout.n32 + ip->layout.n8;
+	if (n == 0)
+	    HALFAIL_RC(EINVAL, "%s: %s: group '%s' has no members",
+		       compname, ip->name, ip->group);
+	if ((ip->sig = halg_malloc(0, n * sizeof(hal_sig_t *))) == NULL)
+	    HALFAIL_RC(ENOMEM, "%s: %s: cannot allocate %d signals",
+		       compname, ip->name, n);
+	// three passes, so the record comes out aligned
+	args.user_arg2 = 0;
+	args.user_arg1 = 8;
+	halg_foreach(0, &args, member_cb);
+	args.user_arg1 = 4;
+	halg_foreach(0, &args, member_cb);
+	args.user_arg1 = 1;
+	halg_foreach(0, &args, member_cb);
+    }
+    return n;
+}
+
+// publish the record layout in the ring scratchpad
+static int write_layout(struct inst_data *ip, char *sp, size_t spsize)
+{
+    int i, n = ip->layout.n64 + ip->layout.n32 + ip->layout.n8;
+    size_t len = rec_layout_head(sp, spsize, &ip->layout);
+
+    for (i = 0; i < n; i++)
+	len = rec_layout_entry(sp, spsize, len,
+			       rec_slot_offset(&ip->layout, i),
+			       ip->sig[i]->type, ho_name(ip->sig[i]));
+    return (len < spsize) ? 0 : -ENOSPC;
+}
+
+static int instantiate(const int argc, char* const *argv)
+{
+    const char *name = argv[1];
+    struct inst_data *ip;
+    int inst_id, retval, n;
+
+    if ((group == NULL) || (strlen(group) == 0))
+	HALFAIL_RC(EINVAL, "%s: %s: missing group= parameter",
+		   compname, name);
+    if (decimate < 1)
+	HALFAIL_RC(EINVAL, "%s: %s: decimate must be >= 1",
+		   compname, name);
+
+    if ((inst_id = hal_inst_create(name, comp_id,
+				   sizeof(struct inst_data),
+				   (void **)&ip)) < 0)
+	return inst_id;
+
+    rtapi_snprintf(ip->name, sizeof(ip->name), "%s", name);
+    rtapi_snprintf(ip->group, sizeof(ip->group), "%s", group);
+    ip->decimate = decimate;
+    ip->onchange = onchange;
+
+    if ((n = compile_group(ip)) < 0)
+	return n;
+    if ((retval = hal_ref_group(ip->group)) < 0)
+	return retval;
+    ip->group_ref = 1;
+    if (ip->onchange &&
+	((ip->last = halg_malloc(1, ip->layout.payload)) == NULL))
+	HALFAIL_RC(ENOMEM, "%s: %s: out of memory", compname, name);
+
+    if ((retval = hal_ring_newf(ringsize, n * REC_LINE_LEN + 64,
+				RINGTYPE_RECORD, "%s", name)) < 0)
+	HALFAIL_RC(-retval, "%s: failed to create ring '%s'", compname, name);
+    ip->ring_created = 1;
+    if ((retval = hal_ring_attachf(&ip->rb, NULL, "%s", name)) < 0)
+	HALFAIL_RC(-retval, "%s: failed to attach ring '%s'", compname, name);
+    ip->ring_attached = 1;
+    if ((retval = write_layout(ip, ip->rb.scratchpad,
+			       ring_scratchpad_size(&ip->rb))) < 0)
+	HALFAIL_RC(-retval, "%s: %s: layout does not fit scratchpad",
+		   compname, name);
+
+    if (((retval = hal_pin_bit_newf(HAL_IN, &ip->enable, inst_id,
+				    "%s.enable", name)) < 0) ||
+	((retval = hal_pin_u32_newf(HAL_OUT, &ip->records, inst_id,
+				    "%s.records", name)) < 0) ||
+	((retval = hal_pin_u32_newf(HAL_OUT, &ip->overruns, inst_id,
+				    "%s.overruns", name)) < 0))
+	return retval;
+    *(ip->enable) = 1;
+
+    hal_export_xfunct_args_t xfunct_args = {
+        .type = FS_XTHREADFUNC,
+        .funct.x = sample,
+        .arg = ip,
+        .uses_fp = 0,
+        .reentrant = 0,
+        .owner_id = inst_id
+    };
+    if ((retval = hal_export_xfunctf(&xfunct_args, "%s.sample", name)) < 0)
+	return retval;
+
+    HALDBG("%s: recording %d signals of group '%s', %d bytes/record",
+	   name, n, ip->group, rec_size(&ip->layout));
+    return 0;
+}
+
+static int delete(const char *name, void *inst, const int inst_size)
+{
+    struct inst_data *ip = inst;
+
+    if (ip->group_ref)
+	hal_unref_group(ip->group);
+    if (ip->ring_attached)
+	hal_ring_detach(&ip->rb);
+    if (ip->ring_created)
+	hal_ring_deletef("%s", ip->name);
+    return 0;
+}
+
+int rtapi_app_main(void)
+{
+    comp_id = hal_xinit(TYPE_RT, 0, 0, instantiate, delete, compname);
+    if (comp_id < 0)
+	return comp_id;
+    hal_ready(comp_id);
+    return 0;
+}
+
+void rtapi_app_exit(void)
+{
+    hal_exit(comp_id);
+}
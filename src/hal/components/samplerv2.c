@@ -0,0 +1,226 @@
+/********************************************************************
+* Description:  samplerv2.c
+*               Sample HAL pins into a HAL record ring.
+*
+* License: GPL Version 2
+*
+********************************************************************/
+/** samplerv2 copies the values of its pins into one packed binary
+    record per invocation and writes it to a HAL record ring.  It
+    replaces the fixed size fifo of 'sampler' with a ring, has no limit
+    on the number of pins, and leaves formatting to userland.
+
+    usage:
+
+	newinst samplerv2 smp cfg=ffbs [ringsize=1048576]
+	addf smp.sample servo
+
+    'cfg' has one character per pin, as for sampler: f (float),
+    b (bit), s (s32) or u (u32), in either case.
+
+    The instance creates a record ring with the instance name.  Records
+    use the recorder layout (see recorder.c): a u64 sequence number and
+    an s64 timestamp, then the 64bit values, the 32bit values and the
+    bits, so a record is naturally aligned.  The layout is published in
+    the ring scratchpad, with the pins listed in cfg order:
+
+	recorder 1 <record size> <number of pins>
+	<offset> <bit|float|s32|u32> <pin name>
+
+    'halrecord' streams the records to a memory-mapped or plain binary
+    file or a zeroMQ socket, and decodes them to CSV.  A file recorded
+    from a samplerv2 can be played back through a streamerv2 with the
+    same cfg.
+
+    pins:
+	<name>.pin.N	  in, one per cfg character
+	<name>.enable	  bit in, default 1
+	<name>.records	  u32 out, records written
+	<name>.overruns	  u32 out, records dropped because the ring was full
+*/
+
+/** This program is free software; you can redistribute it and/or
+    modify it under the terms of version 2 of the GNU General
+    Public License as published by the Free Software Foundation.
+    This library is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public
+    License along with this library; if not, write to the Free Software
+    Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111 USA
+
+    This code is part of the Machinekit HAL project.  For more
+    information, go to https://github.com/machinekit.
+*/
+
+#include "rtapi.h"
+#include "rtapi_app.h"
+#include "rtapi_string.h"
+#include "hal.h"
+#include "hal_priv.h"
+#include "hal_ring.h"
+#include "hal_logging.h"
+#include "hal_record.h"
+
+MODULE_DESCRIPTION("sample HAL pins into a HAL record ring");
+MODULE_LICENSE("GPL");
+RTAPI_TAG(HAL, HC_INSTANTIABLE);
+
+static char *cfg = "";
+RTAPI_IP_STRING(cfg, "pin types, one of f b s u per pin");
+
+static int ringsize = 1048576;
+RTAPI_IP_INT(ringsize, "size of the record ring in bytes");
+
+struct inst_data {
+    ringbuffer_t rb;		// attached in rtapi_app, RT side only
+    hal_bit_t *enable;
+    hal_u32_t *records;
+    hal_u32_t *overruns;
+
+    rec_layout_t layout;
+    void **pin;			// one pin pointer per value, in record order
+
+    hal_u64_t sequence;
+    char name[HAL_NAME_LEN + 1];
+
+    // the ring steps instantiate() completed, undone by delete() - a
+    // failed instantiate() leaves the instance to be deleted
+    int ring_created;
+    int ring_attached;
+};
+
+static int comp_id;
+static char *compname = "samplerv2";
+
+static int sample(void *arg, const hal_funct_args_t *fa)
+{
+    struct inst_data *ip = arg;
+    void **pin = ip->pin;
+    hal_u64_t *p64;
+    hal_u32_t *p32;
+    hal_u8_t *p8;
+    void *ptr;
+    int i, size = rec_size(&ip->layout);
+
+    ip->sequence++;
+    if (!*(ip->enable))
+	return 0;
+
+    if (record_write_begin(&ip->rb, &ptr, size)) {
+	*(ip->overruns) += 1;
+	return 0;
+    }
+    p64 = ptr;
+    *p64++ = ip->sequence;
+    *p64++ = (hal_u64_t) rtapi_get_time();
+    for (i = 0; i < ip->layout.n64; i++)
+	*(hal_float_t *) p64++ = *(hal_float_t *) *pin++;
+    p32 = (hal_u32_t *) p64;
+    for (i = 0; i < ip->layout.n32; i++)
+	*p32++ = *(hal_u32_t *) *pin++;
+    p8 = (hal_u8_t *) p32;
+    for (i = 0; i < ip->layout.n8; i++)
+	*p8++ = *(hal_bit_t *) *pin++;
+
+    record_write_end(&ip->rb, ptr, size);
+    *(ip->records) += 1;
+    return 0;
+}
+
+static int instantiate(const int argc, char* const *argv)
+{
+    const char *name = argv[1];
+    struct inst_data *ip;
+    int inst_id, retval, i, n;
+
+    n = (cfg == NULL) ? 0 : strlen(cfg);
+    if (n == 0)
+	HALFAIL_RC(EINVAL, "%s: %s: missing cfg= parameter", compname, name);
+    for (i = 0; i < n; i++)
+	if (rec_cfg_type(cfg[i]) == HAL_TYPE_UNSPECIFIED)
+	    HALFAIL_RC(EINVAL, "%s: %s: bad type '%c' in cfg '%s'",
+		       compname, name, cfg[i], cfg);
+
+    if ((inst_id = hal_inst_create(name, comp_id,
+				   sizeof(struct inst_data),
+				   (void **)&ip)) < 0)
+	return inst_id;
+
+    rtapi_snprintf(ip->name, sizeof(ip->name), "%s", name);
+    for (i = 0; i < n; i++)
+	rec_layout_add(&ip->layout, rec_cfg_type(cfg[i]));
+    if ((ip->pin = halg_malloc(1, n * sizeof(void *))) == NULL)
+	HALFAIL_RC(ENOMEM, "%s: %s: cannot allocate %d pins",
+		   compname, name, n);
+
+    // the pointer of pin i sits at its record slot
+    for (i = 0; i < n; i++)
+	if ((retval = hal_pin_newf(rec_cfg_type(cfg[i]), HAL_IN,
+				   &ip->pin[rec_cfg_slot(&ip->layout, cfg, i)],
+				   inst_id, "%s.pin.%d", name, i)) < 0)
+	    return retval;
+
+    if ((retval = hal_ring_newf(ringsize, n * REC_LINE_LEN + 64,
+				RINGTYPE_RECORD, "%s", name)) < 0)
+	HALFAIL_RC(-retval, "%s: failed to create ring '%s'", compname, name);
+    ip->ring_created = 1;
+    if ((retval = hal_ring_attachf(&ip->rb, NULL, "%s", name)) < 0)
+	HALFAIL_RC(-retval, "%s: failed to attach ring '%s'", compname, name);
+    ip->ring_attached = 1;
+    if ((retval = rec_cfg_layout(&ip->layout, cfg, name, ip->rb.scratchpad,
+				 ring_scratchpad_size(&ip->rb))) < 0)
+	HALFAIL_RC(-retval, "%s: %s: layout does not fit scratchpad",
+		   compname, name);
+
+    if (((retval = hal_pin_bit_newf(HAL_IN, &ip->enable, inst_id,
+				    "%s.enable", name)) < 0) ||
+	((retval = hal_pin_u32_newf(HAL_OUT, &ip->records, inst_id,
+				    "%s.records", name)) < 0) ||
+	((retval = hal_pin_u32_newf(HAL_OUT, &ip->overruns, inst_id,
+				    "%s.overruns", name)) < 0))
+	return retval;
+    *(ip->enable) = 1;
+
+    hal_export_xfunct_args_t xfunct_args = {
+        .type = FS_XTHREADFUNC,
+        .funct.x = sample,
+        .arg = ip,
+        .uses_fp = 0,
+        .reentrant = 0,
+        .owner_id = inst_id
+    };
+    if ((retval = hal_export_xfunctf(&xfunct_args, "%s.sample", name)) < 0)
+	return retval;
+
+    HALDBG("%s: sampling %d pins, %d bytes/record",
+	   name, n, rec_size(&ip->layout));
+    return 0;
+}
+
+static int delete(const char *name, void *inst, const int inst_size)
+{
+    struct inst_data *ip = inst;
+
+    if (ip->ring_attached)
+	hal_ring_detach(&ip->rb);
+    if (ip->ring_created)
+	hal_ring_deletef("%s", ip->name);
+    return 0;
+}
+
+int rtapi_app_main(void)
+{
+    comp_id = hal_xinit(TYPE_RT, 0, 0, instantiate, delete, compname);
+    if (comp_id < 0)
+	return comp_id;
+    hal_ready(comp_id);
+    return 0;
+}
+
+void rtapi_app_exit(void)
+{
+    hal_exit(comp_id);
+}
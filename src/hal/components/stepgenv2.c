@@ -53,6 +53,19 @@
     values of the position feedback counters.  Both 'update-freq' and
     'capture-position' use floating point, 'make-pulses' does not.
 
+    Batched make-pulses kernel:
+
+    When loaded with 'soa=1' (loadrt stepgenv2 soa=1), 'make-pulses'
+    is replaced by a batched kernel.  The hot make-pulses state of all
+    instances (timers, hold flag, direction, state, accumulator) is
+    kept in structure-of-arrays form, and the timer/ramp/DDS logic is
+    evaluated branch-free on SG_VLEN channels at a time using the
+    compiler's generic vector extensions, which map to SSE2/AVX2 on
+    x86 and NEON on ARM.  Pin and triple-buffer access stays scalar.
+    The step/dir output is identical to the scalar kernel, see
+    tests/stepgen-v2.3.  At most SG_MAX_LANES instances are supported
+    in this mode.
+
     Polarity:
 
     All signals from this module have fixed polarity (active high
@@ -333,6 +346,9 @@ int user_step_type[] = { [0 ... MAX_CYCLE-1] = -1 };
 RTAPI_IP_ARRAY_INT(user_step_type, MAX_CYCLE,
 		   "lookup table for user-defined step type for this instance");
 
+static int soa = 0;
+RTAPI_MP_INT(soa, "use the batched (SoA/SIMD) make-pulses kernel");
+
 RTAPI_TAG(HAL,HC_INSTANTIABLE);
 RTAPI_TAG(HAL,HC_SMP_SAFE);
 
@@ -438,6 +454,7 @@ typedef struct {
     } ro;
 
     int printed_error;		/* flag to avoid repeated printing */
+    int lane;			/* slot in the SoA kernel state, -1 if none */
 } stepgen_t;
 
 /* lookup tables for stepping types 2 and higher - phase A is the LSB */
@@ -474,6 +491,65 @@ static unsigned char num_phases_lut[] =
 
 #define PICKOFF		28	/* bit location in DDS accum */
 
+/* batched make-pulses kernel (soa=1)
+ *
+ * channels are packed into lanes of SG_VLEN 32bit elements; the
+ * 64bit accumulator is split into a low and a high word so the
+ * whole kernel runs on 32bit lanes. the generic vector extensions
+ * degrade to scalar code on targets without SIMD units.
+ */
+#if defined(__AVX2__)
+#define SG_VLEN		8
+#else
+#define SG_VLEN		4	/* SSE2, NEON, or generic */
+#endif
+#define SG_MAX_LANES	64
+#define SG_BLOCKS	(SG_MAX_LANES / SG_VLEN)
+
+typedef int32_t  sg_vs __attribute__((vector_size(SG_VLEN * 4)));
+typedef uint32_t sg_vu __attribute__((vector_size(SG_VLEN * 4)));
+
+// lane l lives in element [l / SG_VLEN][l % SG_VLEN] of each array
+struct mp_soa {
+    int nlanes;
+    stepgen_t *inst[SG_MAX_LANES];
+
+    // make-pulses private state, only touched by make_pulses_soa()
+    sg_vu timer1[SG_BLOCKS];
+    sg_vu timer2[SG_BLOCKS];
+    sg_vu timer3[SG_BLOCKS];
+    sg_vs hold[SG_BLOCKS];	// mask: DDS on hold
+    sg_vs dir[SG_BLOCKS];	// -1, 0, 1
+    sg_vs state[SG_BLOCKS];
+    sg_vu acc_lo[SG_BLOCKS];	// accum bits 0..31
+    sg_vs acc_hi[SG_BLOCKS];	// accum bits 32..63
+
+    // setup-time constants
+    sg_vs stated[SG_BLOCKS];	// mask: step type >= 2
+    sg_vs updown[SG_BLOCKS];	// mask: step type 1
+    sg_vs cycle_max[SG_BLOCKS];
+    const unsigned char *lut[SG_MAX_LANES];
+    int num_phases[SG_MAX_LANES];
+
+    // parameters, refreshed on triple buffer snapshot
+    sg_vs target_addval[SG_BLOCKS];
+    sg_vs deltalim[SG_BLOCKS];
+    sg_vu step_len[SG_BLOCKS];
+    sg_vu dir_hold_dly[SG_BLOCKS];
+    sg_vu dir_setup[SG_BLOCKS];
+
+    // gathered per cycle
+    sg_vs addval[SG_BLOCKS];
+    sg_vs enable[SG_BLOCKS];	// mask
+    sg_vu delay[SG_BLOCKS];
+
+    // kernel results for the scatter pass
+    sg_vs active[SG_BLOCKS];	// mask: accum was updated
+    sg_vs outbits[SG_BLOCKS];	// step types 0 and 1 only
+};
+
+#define SG_LANE(field, l) (sg.field[(l) / SG_VLEN][(l) % SG_VLEN])
+
 
 
 /* other globals */
@@ -488,6 +564,7 @@ static double accelscale;	/* conv. Hz/sec to addval cnts/period */
 static long old_dtns;		/* update_freq funct period in nsec */
 static double dt;		/* update_freq period in seconds */
 static double recip_dt;		/* recprocal of period, avoids divides */
+static struct mp_soa sg;	/* batched kernel state, soa=1 */
 
 static const char *compname = "stepgenv2";
 static const char *prefix = "stepgenv2";
@@ -500,6 +577,9 @@ typedef enum CONTROL { POSITION, VELOCITY, INVALID } CONTROL;
 static int export_stepgen(const char *name,  stepgen_t *addr,
 			  const int step_type, const int pos_mode);
 static int make_pulses(void *arg, const hal_funct_args_t *fa);
+static int make_pulses_soa(void *arg, const hal_funct_args_t *fa);
+static int soa_add_lane(stepgen_t *self);
+static void soa_remove_lane(stepgen_t *self);
 static int update_freq(void *arg, const hal_funct_args_t *fa);
 static int update_pos(void *arg,  const hal_funct_args_t *fa);
 static int setup_user_step_type(void);
@@ -551,7 +631,7 @@ int rtapi_app_main(void)
 	return retval;
     hal_export_xfunct_args_t mp = {
         .type = FS_XTHREADFUNC,
-        .funct.x = make_pulses,
+        .funct.x = soa ? make_pulses_soa : make_pulses,
         .arg = &head,
         .uses_fp = 0,
         .reentrant = 0,
@@ -604,18 +684,29 @@ static int instantiate_stepgen(const int argc, char* const *argv)
 	return -1;
     }
 
+    // a lane is needed before anything is created; delete_stepgen()
+    // runs on a failed instance too
+    if (soa && (sg.nlanes >= SG_MAX_LANES))
+	HALFAIL_RC(ENOSPC, "STEPGEN: ERROR: %s: more than %d instances"
+		   " with soa=1", name, SG_MAX_LANES);
+
     stepgen_t *p;
     if ((retval = hal_inst_create(name, comp_id, sizeof(stepgen_t), (void **)&p)) < 0)
 	return retval;
 
     p->inst_id = retval;
+    p->lane = -1;
+    dlist_init_entry(&p->list);
     if ((retval = export_stepgen(name, p, step_type, ctype == POSITION)) != 0)
 	HALFAIL_RC(retval, "STEPGEN: ERROR: export_stepgen(%s, %s) failed", compname, name);
 
     p->iname = halg_strdup(1, name);
 
+    if (soa && ((retval = soa_add_lane(p)) < 0))
+	HALFAIL_RC(-retval, "STEPGEN: ERROR: %s: more than %d instances"
+		   " with soa=1", name, SG_MAX_LANES);
+
     // append to instance list
-    dlist_init_entry(&p->list);
     dlist_add_after(&p->list, &head);
     return 0;
 }
@@ -630,6 +721,8 @@ static int delete_stepgen(const char *name, void *inst, const int inst_size)
 
     // delete from instance list
     dlist_remove_entry(&p->list);
+    if (p->lane >= 0)
+	soa_remove_lane(p);
     return 0;
 }
 
@@ -842,6 +935,241 @@ static int make_pulses(void *arg, const hal_funct_args_t *fa)
     return 0;
 }
 
+/** make_pulses_soa() is the batched equivalent of make_pulses().
+    It runs in three passes: gather pins and triple buffer parameters
+    into the lane arrays, run the timer/ramp/DDS logic branch-free on
+    SG_VLEN lanes at a time, then scatter the results to the pins and
+    the state shared with update_freq() and update_pos().  The kernel
+    mirrors make_pulses() block by block - keep the two in sync.
+*/
+
+static inline sg_vs sg_select(const sg_vs mask, const sg_vs a, const sg_vs b)
+{
+    return (mask & a) | (~mask & b);
+}
+
+static inline sg_vu sg_selectu(const sg_vs mask, const sg_vu a, const sg_vu b)
+{
+    return ((sg_vu)mask & a) | (~(sg_vu)mask & b);
+}
+
+static int make_pulses_soa(void *arg, const hal_funct_args_t *fa)
+{
+    const sg_vs zero = {}, one = zero + 1, minus_one = zero - 1;
+    int l, b, p, nblocks;
+    unsigned char outbits;
+
+    // gather
+    for (l = 0; l < sg.nlanes; l++) {
+	stepgen_t *self = sg.inst[l];
+	struct shared *shared = &self->shared;
+
+	if (rtapi_tb_snapshot(&shared->tb)) {
+	    // new parameter set available, fetch it
+	    struct mp_params *mpp =
+		&shared->tb_state[rtapi_tb_snap_idx(&shared->tb)];
+
+	    SG_LANE(target_addval, l) = mpp->target_addval;
+	    SG_LANE(deltalim, l) = mpp->deltalim;
+	    SG_LANE(step_len, l) = mpp->step_len;
+	    SG_LANE(dir_hold_dly, l) = mpp->dir_hold_dly;
+	    SG_LANE(dir_setup, l) = mpp->dir_setup;
+
+	    /* store period so scaling constants can be (re)calculated */
+	    periodns = fa_period(fa);
+	}
+	SG_LANE(delay, l) = *(self->mp.jitter_correct) ?
+	    fa_current_period(fa) : periodns;
+	SG_LANE(addval, l) = rtapi_load_s32(&shared->addval);
+	SG_LANE(enable, l) = *(self->ro.enable) ? -1 : 0;
+    }
+
+    // kernel - lanes past nlanes in the last block compute garbage
+    // which is never scattered
+    nblocks = (sg.nlanes + SG_VLEN - 1) / SG_VLEN;
+    for (b = 0; b < nblocks; b++) {
+	const sg_vu delay = sg.delay[b];
+	const sg_vs enable = sg.enable[b];
+	const sg_vs old_addval = sg.addval[b];
+	sg_vu t1 = sg.timer1[b], t2 = sg.timer2[b], t3 = sg.timer3[b];
+	sg_vu lo, carry;
+	sg_vs hold = sg.hold[b], dir = sg.dir[b], state = sg.state[b];
+	sg_vs addval, limited, active, step_now, pulse, updown, updir, m;
+
+	/* decrement "timing constraint" timers */
+	t1 = (sg_vu)(t1 > delay) & (t1 - delay);
+	t2 = (sg_vu)(t2 > delay) & (t2 - delay);
+	m = t3 > delay;
+	/* last timer timed out, cancel hold */
+	hold &= ~((t3 != 0) & ~m);
+	t3 = (sg_vu)m & (t3 - delay);
+
+	/* update addval (ramping). |addval| and deltalim never exceed
+	   1 << PICKOFF, so the sums cannot overflow 32bit lanes */
+	active = ~hold & enable;
+	limited = sg.target_addval[b];
+	m = limited < old_addval - sg.deltalim[b];
+	limited = sg_select(m, old_addval - sg.deltalim[b], limited);
+	m = sg.target_addval[b] > old_addval + sg.deltalim[b];
+	limited = sg_select(m, old_addval + sg.deltalim[b], limited);
+	limited = sg_select(sg.deltalim[b] != 0, limited,
+			    sg.target_addval[b]);
+	addval = sg_select(active, limited, old_addval);
+	/* reversal required, hold everything until delays time out */
+	hold |= active & ((addval ^ old_addval) < 0) & (t3 != 0);
+
+	/* update DDS */
+	active = ~hold & enable;
+	lo = sg.acc_lo[b] + (sg_vu)addval;
+	carry = (sg_vu)(lo < sg.acc_lo[b]);
+	step_now = active & ((sg_vs)((lo ^ sg.acc_lo[b]) &
+				     (1U << PICKOFF)) != 0);
+	sg.acc_hi[b] = sg_select(active,
+				 sg.acc_hi[b] + (addval >> 31) - (sg_vs)carry,
+				 sg.acc_hi[b]);
+	sg.acc_lo[b] = sg_selectu(active, lo, sg.acc_lo[b]);
+
+	/* update direction - do not change if addval = 0.  make_pulses()
+	   tests shared->addval for the negative case, which still holds
+	   the value loaded before ramping */
+	m = t2 == 0;
+	dir = sg_select(m & (old_addval < 0), minus_one, dir);
+	dir = sg_select(m & (addval > 0), one, dir);
+
+	/* (re)start various timers */
+	t1 = sg_selectu(step_now, sg.step_len[b], t1);
+	t2 = sg_selectu(step_now, t1 + sg.dir_hold_dly[b], t2);
+	t3 = sg_selectu(step_now, t2 + sg.dir_setup[b], t3);
+
+	/* update state for step types 2 and up */
+	state += step_now & sg.stated[b] & dir;
+	state = sg_select(state < 0, sg.cycle_max[b], state);
+	state = sg_select(state > sg.cycle_max[b], zero, state);
+
+	/* output bits for step/dir and up/down */
+	pulse = t1 != 0;
+	updir = dir < 0;
+	updown = (pulse & ~updir & 1) | (pulse & updir & 2);
+	sg.outbits[b] = sg_select(sg.updown[b], updown,
+				  (pulse & 1) | (updir & 2));
+
+	sg.timer1[b] = t1;
+	sg.timer2[b] = t2;
+	sg.timer3[b] = t3;
+	sg.hold[b] = hold;
+	sg.dir[b] = dir;
+	sg.state[b] = state;
+	sg.addval[b] = addval;
+	sg.active[b] = active;
+    }
+
+    // scatter
+    for (l = 0; l < sg.nlanes; l++) {
+	stepgen_t *self = sg.inst[l];
+	struct shared *shared = &self->shared;
+
+	if (SG_LANE(active, l)) {
+	    hal_s64_t accum = (hal_s64_t)
+		(((hal_u64_t)(uint32_t)SG_LANE(acc_hi, l) << 32) |
+		 SG_LANE(acc_lo, l));
+	    *(self->mp.rawcount) = accum >> PICKOFF;
+	    rtapi_store_s64(&shared->accum, accum);
+	}
+	rtapi_store_s32(&shared->addval, SG_LANE(addval, l));
+
+	if (sg.lut[l])
+	    outbits = sg.lut[l][SG_LANE(state, l)];
+	else
+	    outbits = SG_LANE(outbits, l);
+	for (p = 0; p < sg.num_phases[l]; p++) {
+	    *(self->mp.phase[p]) = outbits & 1;
+	    outbits >>= 1;
+	}
+    }
+    return 0;
+}
+
+// assign the next free lane to a fully exported instance
+static int soa_add_lane(stepgen_t *self)
+{
+    int l = sg.nlanes;
+
+    if (l >= SG_MAX_LANES)
+	return -ENOSPC;
+
+    SG_LANE(timer1, l) = 0;
+    SG_LANE(timer2, l) = 0;
+    SG_LANE(timer3, l) = 0;
+    SG_LANE(hold, l) = 0;
+    SG_LANE(dir, l) = 0;
+    SG_LANE(state, l) = 0;
+    SG_LANE(acc_lo, l) = (uint32_t)self->shared.accum;
+    SG_LANE(acc_hi, l) = (int32_t)(self->shared.accum >> 32);
+
+    SG_LANE(stated, l) = (self->ro.step_type >= 2) ? -1 : 0;
+    SG_LANE(updown, l) = (self->ro.step_type == 1) ? -1 : 0;
+    if (self->ro.step_type >= 2) {
+	SG_LANE(cycle_max, l) = self->mp.cycle_max;
+	sg.lut[l] = self->mp.lut;
+	sg.num_phases[l] = self->mp.num_phases;
+    } else {
+	SG_LANE(cycle_max, l) = 0;
+	sg.lut[l] = NULL;
+	sg.num_phases[l] = 2;
+    }
+
+    // parameters arrive with the first snapshot
+    SG_LANE(target_addval, l) = 0;
+    SG_LANE(deltalim, l) = 0;
+    SG_LANE(step_len, l) = 0;
+    SG_LANE(dir_hold_dly, l) = 0;
+    SG_LANE(dir_setup, l) = 0;
+
+    sg.inst[l] = self;
+    self->lane = l;
+
+    // lane must be complete before make_pulses_soa() sees it
+    rtapi_smp_wmb();
+    sg.nlanes++;
+    return 0;
+}
+
+#define SG_MOVE(field) SG_LANE(field, l) = SG_LANE(field, last)
+
+// release a lane by moving the last lane into its slot
+// like the instance list, this assumes make-pulses is not
+// running concurrently
+static void soa_remove_lane(stepgen_t *self)
+{
+    int l = self->lane;
+    int last = sg.nlanes - 1;
+
+    sg.nlanes = last;
+    if (l == last)
+	return;
+
+    SG_MOVE(timer1);
+    SG_MOVE(timer2);
+    SG_MOVE(timer3);
+    SG_MOVE(hold);
+    SG_MOVE(dir);
+    SG_MOVE(state);
+    SG_MOVE(acc_lo);
+    SG_MOVE(acc_hi);
+    SG_MOVE(stated);
+    SG_MOVE(updown);
+    SG_MOVE(cycle_max);
+    SG_MOVE(target_addval);
+    SG_MOVE(deltalim);
+    SG_MOVE(step_len);
+    SG_MOVE(dir_hold_dly);
+    SG_MOVE(dir_setup);
+    sg.lut[l] = sg.lut[last];
+    sg.num_phases[l] = sg.num_phases[last];
+    sg.inst[l] = sg.inst[last];
+    sg.inst[l]->lane = l;
+}
+
 static int update_pos(void *arg, const hal_funct_args_t *fa)
 {
     hal_list_t *insts = arg;
@@ -49,6 +49,21 @@ cdef extern from "hal.h":
 
     int hal_unlink(const char *pin)
 
+    ctypedef enum hal_bulk_op_t:
+        HAL_BULK_NET
+        HAL_BULK_SETP
+        HAL_BULK_SETS
+
+    ctypedef struct hal_bulk_item_t:
+        hal_bulk_op_t op
+        const char *name
+        const char *arg
+
+    int halg_bulk(const int use_hal_mutex,
+                  const hal_bulk_item_t *items,
+                  const int count,
+                  int *failed)
+
     int hal_pin_new(const char *name, int type, int dir,
         void **data_ptr_addr, int comp_id)
 
@@ -94,6 +94,7 @@ include "hal_threads.pyx"
 include "hal_funct.pyx"
 include "hal_epsilon.pyx"
 include "hal_net.pyx"
+include "hal_bulk.pyx"
 include "hal_ring.pyx"
 include "hal_group.pyx"
 include "hal_loadusr.pyx"
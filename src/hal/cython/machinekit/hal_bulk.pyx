@@ -0,0 +1,87 @@
+# bulk - net, setp and sets applied as one transaction, see halg_bulk()
+from libc.stdlib cimport malloc, free
+
+cdef _bulk_name(o):
+    # pins and signals by wrapper or name
+    return o.name if isinstance(o, (Pin, Signal)) else o
+
+cdef _bulk_value(v):
+    if v is True or v is False:
+        return "1" if v else "0"
+    return repr(v) if isinstance(v, float) else str(v)
+
+cdef class Bulk:
+    """collects net, setp and sets operations, and applies them on
+    commit() - all names looked up and all operations checked before
+    the first is applied, under one hold of the HAL mutex. If one
+    fails, RuntimeError is raised and nothing is changed.
+
+    Leaving a 'with' block commits, unless by an exception:
+
+        with hal.Bulk() as b:
+            b.net("enable", "c1.out", "c2.in")
+            b.setp("c2.gain", 2.5)
+    """
+    cdef list _items
+
+    def __cinit__(self):
+        self._items = []
+
+    def net(self, sig, *pins):
+        if len(pins) == 0:
+            raise RuntimeError("net: at least one pin name expected")
+        for p in pins:
+            self._items.append((HAL_BULK_NET, _bulk_name(p), _bulk_name(sig)))
+        return self
+
+    def setp(self, name, value):
+        self._items.append((HAL_BULK_SETP, _bulk_name(name), _bulk_value(value)))
+        return self
+
+    def sets(self, name, value):
+        self._items.append((HAL_BULK_SETS, _bulk_name(name), _bulk_value(value)))
+        return self
+
+    def __len__(self):
+        return len(self._items)
+
+    def commit(self):
+        cdef hal_bulk_item_t *items
+        cdef int i, r, failed = -1
+        cdef int n = len(self._items)
+
+        hal_required()
+        if n == 0:
+            return
+        # the encoded strings must outlive halg_bulk()
+        encoded = [(op, name.encode(), arg.encode())
+                   for op, name, arg in self._items]
+        items = <hal_bulk_item_t *>malloc(n * sizeof(hal_bulk_item_t))
+        if items == NULL:
+            raise MemoryError()
+        try:
+            for i in range(n):
+                op, name, arg = encoded[i]
+                items[i].op = op
+                items[i].name = name
+                items[i].arg = arg
+            r = halg_bulk(1, items, n, &failed)
+        finally:
+            free(items)
+        pending = self._items
+        self._items = []
+        if r:
+            if 0 <= failed < n:
+                op, name, arg = pending[failed]
+                raise RuntimeError(f"bulk: '{name}' '{arg}': {hal_lasterror()}")
+            raise RuntimeError(f"bulk: {hal_lasterror()}")
+
+    def __enter__(self):
+        return self
+
+    def __exit__(self, exc_type, exc_value, traceback):
+        if exc_type is None:
+            self.commit()
+        else:
+            self._items = []
+        return False
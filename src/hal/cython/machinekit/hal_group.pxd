@@ -1,10 +1,12 @@
 from hal_priv cimport hal_shmem_base, hal_data_u, hal_data, hal_sig_t,halhdr_t
+from hal cimport hal_u32_t, hal_s64_t
 from rtapi cimport rtapi_atomic_type
 from libc.stdint cimport uint8_t
 
 cdef extern from "hal_group.h" :
 
     int GROUP_REPORT_ON_CHANGE
+    int GROUP_PUBLISH_SNAPSHOT
 
     ctypedef struct hal_member_t:
         halhdr_t hdr
@@ -64,3 +66,25 @@ cdef extern from "hal_group.h" :
                              void *cb_data, int flags)
 
     hal_group_t *halpr_find_group_by_name(const char *name)
+
+    ctypedef struct hal_snapshot_entry_t:
+        int handle
+        int type
+
+    ctypedef struct hal_snapshot_t:
+        int magic
+        int n_members
+        int writer
+        hal_s64_t scanned
+        hal_snapshot_entry_t *entry   # flexible array member
+
+    hal_data_u *hal_snapshot_values(const hal_snapshot_t *s)
+    hal_u32_t hal_snapshot_version(const hal_snapshot_t *s)
+    int hal_snapshot_read(const hal_snapshot_t *s, hal_data_u *values, hal_u32_t *version)
+    int hal_snapshot_get(const hal_snapshot_t *s, int index, hal_data_u *value, hal_u32_t *version)
+    hal_snapshot_t *hal_snapshot_open(const char *group)
+    int hal_snapshot_close(const char *group)
+    int hal_snapshot_index(const hal_snapshot_t *s, int handle)
+    int hal_snapshot_lookup(const hal_snapshot_t *s, const char *signal)
+    int hal_cgroup_publish(hal_compiled_group_t *cgroup)
+    int hal_cgroup_snapshot(hal_compiled_group_t *cgroup)
@@ -4,9 +4,17 @@ from hal_objectops cimport halg_find_object_by_id
 from hal_group cimport (
     hal_compiled_group_t, hal_group_t, halg_group_new, hal_cgroup_match,
     hal_cgroup_free, halpr_group_compile, halg_member_new, halg_member_delete,
-    hal_unref_group,
+    hal_unref_group, hal_snapshot_t, hal_snapshot_open, hal_snapshot_close,
+    hal_snapshot_index, hal_snapshot_lookup, hal_snapshot_read,
+    hal_snapshot_get, hal_snapshot_version, hal_snapshot_values,
+    hal_cgroup_publish, hal_cgroup_snapshot,
+    GROUP_REPORT_ON_CHANGE as _GROUP_REPORT_ON_CHANGE,
+    GROUP_PUBLISH_SNAPSHOT as _GROUP_PUBLISH_SNAPSHOT,
     )
+from hal_util cimport hal2py
+from hal cimport hal_u32_t
 from rtapi cimport  RTAPI_BIT_TEST
+from libc.stdlib cimport malloc, free
 
 
 cdef class Group(HALObject):
@@ -72,6 +80,23 @@ cdef class Group(HALObject):
                 raise RuntimeError(f"hal_group_compile({self.name}) failed: {hal_lasterror()}")
         hal_unref_group(self.name.encode())
 
+    def publish(self):
+        # become the writer of the group's shared memory snapshot
+        if self._cg == NULL:
+            self.compile()
+        rc = hal_cgroup_publish(self._cg)
+        if rc < 0:
+            raise RuntimeError(f"cannot publish snapshot of group '{self.name}': {hal_lasterror()}")
+
+    def snapshot(self):
+        # scan the members into the published snapshot, True if any changed
+        if self._cg == NULL:
+            raise RuntimeError(f"snapshot of group '{self.name}' not published")
+        rc = hal_cgroup_snapshot(self._cg)
+        if rc < 0:
+            raise RuntimeError(f"snapshot of group '{self.name}' failed: {hal_lasterror()}")
+        return rc > 0
+
     def member_add(self, member, int arg1=0, int eps_index=0): 
         if isinstance(member, Signal):
             member = member.name
@@ -150,6 +175,108 @@ cdef class Member(HALObject):
     def __repr__(self):
         return f"<hal.Member {self.name} of {self.group.name}>"
 
+cdef class Snapshot:
+    # reader of the shared memory snapshot of a group created with the
+    # 'snapshot' flag, as published by haltalk - no zeroMQ involved
+    cdef hal_snapshot_t *_s
+    cdef hal_data_u *_values
+    cdef bytes _name
+
+    def __cinit__(self, str name):
+        hal_required()
+        self._name = name.encode()
+        self._values = NULL
+        self._s = hal_snapshot_open(self._name)
+        if self._s == NULL:
+            raise RuntimeError(f"cannot open snapshot of group '{name}': {hal_lasterror()}")
+        self._values = <hal_data_u *>malloc(max(self._s.n_members, 1) * sizeof(hal_data_u))
+        if self._values == NULL:
+            self.close()
+            raise MemoryError()
+
+    def __dealloc__(self):
+        self.close()
+
+    def close(self):
+        free(self._values)
+        self._values = NULL
+        if self._s != NULL:
+            hal_snapshot_close(self._name)
+            self._s = NULL
+
+    cdef _check(self):
+        if self._s == NULL:
+            raise RuntimeError("snapshot closed")
+
+    def index(self, handle):
+        self._check()
+        if isinstance(handle, Signal):
+            handle = handle.id
+        rc = hal_snapshot_index(self._s, handle)
+        if rc < 0:
+            raise KeyError(handle)
+        return rc
+
+    def lookup(self, signal):
+        self._check()
+        if isinstance(signal, Signal):
+            signal = signal.name
+        rc = hal_snapshot_lookup(self._s, signal.encode())
+        if rc < 0:
+            raise KeyError(signal)
+        return rc
+
+    def read(self):
+        # (version, [values]) - all values of the same scan
+        cdef hal_u32_t version
+        self._check()
+        if hal_snapshot_read(self._s, self._values, &version) < 0:
+            raise RuntimeError(f"snapshot of group '{self._name.decode()}': writer stalled")
+        return version, [hal2py(self._s.entry[i].type, &self._values[i])
+                         for i in range(self._s.n_members)]
+
+    def get(self, int index):
+        # (version, value) of one entry
+        cdef hal_u32_t version
+        cdef hal_data_u v
+        self._check()
+        if (index < 0) or (index >= self._s.n_members):
+            raise IndexError(index)
+        if hal_snapshot_get(self._s, index, &v, &version) < 0:
+            raise RuntimeError(f"snapshot of group '{self._name.decode()}': writer stalled")
+        return version, hal2py(self._s.entry[index].type, &v)
+
+    property version:
+        def __get__(self):
+            self._check()
+            return hal_snapshot_version(self._s)
+
+    property handles:
+        def __get__(self):
+            self._check()
+            return [self._s.entry[i].handle for i in range(self._s.n_members)]
+
+    property scanned:
+        # rtapi_get_time() of the last writer scan, 0 if never scanned
+        def __get__(self):
+            self._check()
+            return self._s.scanned
+
+    property writer:
+        def __get__(self):
+            self._check()
+            return self._s.writer
+
+    def __len__(self):
+        self._check()
+        return self._s.n_members
+
+    def __repr__(self):
+        return f"<hal.Snapshot {self._name.decode()}>"
+
+GROUP_REPORT_ON_CHANGE = _GROUP_REPORT_ON_CHANGE
+GROUP_PUBLISH_SNAPSHOT = _GROUP_PUBLISH_SNAPSHOT
+
 _wrapdict[hal_const.HAL_GROUP] = Group
 groups = HALObjectDict(hal_const.HAL_GROUP)
 
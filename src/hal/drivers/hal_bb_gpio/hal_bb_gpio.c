@@ -24,25 +24,40 @@
 
 #include "beaglebone_gpio.h"
 
-#if !defined(TARGET_PLATFORM_BEAGLEBONE)
-#error "This driver is for the BeagleBone platform only"
-#endif
-
 #define MODNAME "hal_bb_gpio"
 
+// fake_regs= layout: the control module, then GPIO ports 0-3
+#define FAKE_PORT_OFFSET(n)	((n + 1) * GPIO_SIZE)
+#define FAKE_REGS_SIZE		FAKE_PORT_OFFSET(4)
+
 MODULE_AUTHOR("Ian McMahon");
 MODULE_DESCRIPTION("Driver for BeagleBone GPIO pins");
 MODULE_LICENSE("GPL");
 
+typedef struct {
+    hal_bit_t *pin;
+    hal_bit_t *inv;
+    unsigned int mask;
+    int port;
+} bb_gpio_io_t;
+
 typedef struct {
     hal_bit_t* led_pins[4];
-    // array of pointers to bivts
-    hal_bit_t* input_pins[MAX_PINS_PER_HEADER * HEADERS];
+    // array of pointers to bivts, indexed by pin + header*PINS_PER_HEADER
+    hal_bit_t* input_pins[(MAX_PINS_PER_HEADER + 1) * HEADERS];
     // array of pointers to bits
-    hal_bit_t* output_pins[MAX_PINS_PER_HEADER * HEADERS];
+    hal_bit_t* output_pins[(MAX_PINS_PER_HEADER + 1) * HEADERS];
     hal_bit_t  *led_inv[4];
-    hal_bit_t  *input_inv[MAX_PINS_PER_HEADER * HEADERS];
-    hal_bit_t  *output_inv[MAX_PINS_PER_HEADER * HEADERS];
+    hal_bit_t  *input_inv[(MAX_PINS_PER_HEADER + 1) * HEADERS];
+    hal_bit_t  *output_inv[(MAX_PINS_PER_HEADER + 1) * HEADERS];
+    // the claimed pins, grouped at load time so that the functs touch
+    // each port's set, clear and data-in register at most once per cycle
+    bb_gpio_io_t outputs[4 + MAX_PINS_PER_HEADER * HEADERS];
+    bb_gpio_io_t inputs[MAX_PINS_PER_HEADER * HEADERS];
+    int num_outputs;
+    int num_inputs;
+    unsigned int out_mask[4];
+    unsigned int in_mask[4];
 } port_data_t;
 
 static port_data_t *port_data;
@@ -54,6 +69,8 @@ static void read_port(void *arg, long period);
 
 static off_t start_addr_for_port(int port);
 static void configure_pin(bb_gpio_pin *pin, char mode);
+static void add_io(bb_gpio_io_t *io, int *count, unsigned int *masks,
+		   hal_bit_t *pin, hal_bit_t *inv, bb_gpio_pin *bbpin);
 
 static int comp_id; 
 static int num_ports;
@@ -83,11 +100,31 @@ int board_id;
 
 RTAPI_MP_STRING(board, "board name.  BeagleBone (default), PocketBeagle");
 
+// map a file instead of the control module and GPIO ports, so the
+// driver can be exercised and benchmarked on any Linux box
+static char *fake_regs;
+RTAPI_MP_STRING(fake_regs, "file to map instead of the GPIO registers, for testing");
+
+static int open_regs(void) {
+    int fd;
+
+    if (!fake_regs)
+	return open("/dev/mem", O_RDWR);
+
+    fd = open(fake_regs, O_RDWR | O_CREAT, 0644);
+    if (fd >= 0 && ftruncate(fd, FAKE_REGS_SIZE) < 0) {
+	close(fd);
+	return -1;
+    }
+    return fd;
+}
+
 void configure_control_module() {
-    int fd = open("/dev/mem", O_RDWR);
+    int fd = open_regs();
 
     control_module = mmap(0, CONTROL_MODULE_SIZE, PROT_READ | PROT_WRITE,
-			  MAP_SHARED, fd, CONTROL_MODULE_START_ADDR);
+			  MAP_SHARED, fd,
+			  fake_regs ? 0 : CONTROL_MODULE_START_ADDR);
 
     if (control_module == MAP_FAILED) {
 	rtapi_print_msg(
@@ -105,13 +142,13 @@ void configure_gpio_port(int n) {
     volatile unsigned int *regptr;
     unsigned int regvalue;
 
-    int fd = open("/dev/mem", O_RDWR);
+    int fd = open_regs();
 
     gpio_ports[n] = hal_malloc(sizeof(bb_gpio_port));
 
     // need to verify that port is enabled and clocked before accessing it
     // port 0 is always mapped, the others need checked
-    if ( n > 0 ) {
+    if ( n > 0 && !fake_regs ) {
 	cm_per = mmap(0,CM_PER_LEN, PROT_READ | PROT_WRITE, MAP_SHARED,
 		      fd, CM_PER_ADDR);
 	if (cm_per == MAP_FAILED) {
@@ -260,6 +297,9 @@ int rtapi_app_main(void) {
 	    user_led_gpio_pins[led].port = gpio_ports[gpio_num];
 
 	    configure_pin(&user_led_gpio_pins[led], 'O');
+	    add_io(port_data->outputs, &port_data->num_outputs,
+		   port_data->out_mask, port_data->led_pins[led],
+		   port_data->led_inv[led], &user_led_gpio_pins[led]);
 	}
     }
 
@@ -352,6 +392,10 @@ int rtapi_app_main(void) {
 	    bbpin->port = gpio_ports[gpio_num];
 
 	    configure_pin(bbpin, 'U');
+	    add_io(port_data->inputs, &port_data->num_inputs,
+		   port_data->in_mask,
+		   port_data->input_pins[pin + header*PINS_PER_HEADER],
+		   port_data->input_inv[pin + header*PINS_PER_HEADER], bbpin);
 	    rtapi_print_msg(
 	    	RTAPI_MSG_DBG, "pin %d maps to pin %d-%d, mode %d\n", pin, bbpin->port_num,
 		bbpin->pin_num, bbpin->claimed);
@@ -448,6 +492,10 @@ int rtapi_app_main(void) {
 	    bbpin->port = gpio_ports[gpio_num];
 
 	    configure_pin(bbpin, 'O');
+	    add_io(port_data->outputs, &port_data->num_outputs,
+		   port_data->out_mask,
+		   port_data->output_pins[pin + header*PINS_PER_HEADER],
+		   port_data->output_inv[pin + header*PINS_PER_HEADER], bbpin);
 	}
     }
 
@@ -488,44 +536,21 @@ void rtapi_app_exit(void) {
 static void write_port(void *arg, long period) {
     int i;
     port_data_t *port = (port_data_t *)arg;
+    unsigned int set[4] = { 0, 0, 0, 0 };
 
-    // set userled states
-    for (i=0; i<4; i++) {
-	// short circuit if hal hasn't malloc'd a bit at this location
-	if (port->led_pins[i] == NULL) continue;
-
-	bb_gpio_pin pin = user_led_gpio_pins[i];
-
-	// if we somehow get here but the pin isn't claimed as output,
-	// short circuit
-	if (pin.claimed != 'O') continue;
-
-	if ((*port->led_pins[i] ^ *(port->led_inv[i])) == 0)
-	    *(pin.port->clrdataout_reg) = (1 << pin.pin_num);
-	else
-	    *(pin.port->setdataout_reg) = (1 << pin.pin_num);
+    for (i = 0; i < port->num_outputs; i++) {
+	bb_gpio_io_t *io = &port->outputs[i];
+	if (*io->pin ^ *io->inv)
+	    set[io->port] |= io->mask;
     }
 
-    // set output states
-    for (i=1; i<=HEADERS*PINS_PER_HEADER; i++) {
-	// short circuit if hal hasn't malloc'd a bit at this location
-	if (port->output_pins[i] == NULL) continue;
-
-	bb_gpio_pin pin;
-
-	if (i<PINS_PER_HEADER)
-	    pin = HLO_PINS[i];
-	else 
-	    pin = HHI_PINS[i - PINS_PER_HEADER];
-
-	// if we somehow get here but the pin isn't claimed as output,
-	// short circuit
-	if (pin.claimed != 'O') continue;
-
-	if ((*port->output_pins[i] ^ *(port->output_inv[i])) == 0)
-	    *(pin.port->clrdataout_reg) = (1 << pin.pin_num);
-	else
-	    *(pin.port->setdataout_reg) = (1 << pin.pin_num);
+    // one store per port and register
+    for (i = 0; i < 4; i++) {
+	if (port->out_mask[i] == 0) continue;
+	if (port->out_mask[i] & ~set[i])
+	    *(gpio_ports[i]->clrdataout_reg) = port->out_mask[i] & ~set[i];
+	if (set[i])
+	    *(gpio_ports[i]->setdataout_reg) = set[i];
     }
 }
 
@@ -533,34 +558,35 @@ static void write_port(void *arg, long period) {
 static void read_port(void *arg, long period) {
     int i;
     port_data_t *port = (port_data_t *)arg;
+    unsigned int datain[4] = { 0, 0, 0, 0 };
 
-    // read input states
-    for (i=1; i<=HEADERS*PINS_PER_HEADER; i++) {
-	// short circuit if hal hasn't malloc'd a bit at this location
-	if (port->input_pins[i] == NULL) continue;
-
-	bb_gpio_pin pin;
-
-	if (i<PINS_PER_HEADER) {
-	    pin = HLO_PINS[i];
-	} else {
-	    pin = HHI_PINS[i - PINS_PER_HEADER];
-	}
+    // one load per port
+    for (i = 0; i < 4; i++)
+	if (port->in_mask[i])
+	    datain[i] = *(gpio_ports[i]->datain_reg);
 
+    for (i = 0; i < port->num_inputs; i++) {
+	bb_gpio_io_t *io = &port->inputs[i];
+	*io->pin = ((datain[io->port] & io->mask) != 0) ^ *io->inv;
+    }
+}
 
-	// if we get here but the pin isn't claimed as input, short circuit
-	if (!(pin.claimed == 'I' || pin.claimed == 'U' || pin.claimed == 'D'))
-	    continue;
 
-	*port->input_pins[i] =
-	    ((*(pin.port->datain_reg) & (1 << pin.pin_num)) >> pin.pin_num)
-	    ^ *(port->input_inv[i]);
-    }
+static void add_io(bb_gpio_io_t *io, int *count, unsigned int *masks,
+		   hal_bit_t *pin, hal_bit_t *inv, bb_gpio_pin *bbpin) {
+    io += (*count)++;
+    io->pin = pin;
+    io->inv = inv;
+    io->port = bbpin->port_num;
+    io->mask = 1U << bbpin->pin_num;
+    masks[io->port] |= io->mask;
 }
 
 
 
 off_t start_addr_for_port(int port) {
+    if (fake_regs)
+	return (port >= 0 && port < 4) ? FAKE_PORT_OFFSET(port) : -1;
     switch(port) {
     case 0:
 	return GPIO0_START_ADDR;
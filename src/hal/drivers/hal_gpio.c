@@ -31,9 +31,7 @@ s********************************************************************/
 #define BCM2709_PERI_BASE   0x3F000000
 #define BCM2709_GPIO_BASE   (BCM2709_PERI_BASE + 0x200000)
 
-#if !defined(TARGET_PLATFORM_RASPBERRY)
-#error "This driver is for the Raspberry and Raspberry2 platforms only"
-#endif
+#define NBANKS 2 // GPIO 0-31 and 32-53 in the set/clear/level registers
 
 #include <stdio.h>
 #include <stdlib.h>
@@ -76,10 +74,27 @@ static char *exclude = "0"; // all used
 RTAPI_MP_STRING(exclude, "exclude pins, 1=dont use");
 static unsigned exclude_map;
 
+// map a file instead of the GPIO block, so the driver can be exercised
+// and benchmarked on any Linux box
+static char *fake_regs;
+RTAPI_MP_STRING(fake_regs, "file to map instead of the GPIO registers, for testing");
+
 static int comp_id;		/* component ID */
 static unsigned char *pins, *gpios;
 hal_bit_t **port_data;
 
+// the used pins, grouped at load time so that the functs touch each
+// set, clear and level register at most once per cycle
+typedef struct {
+    hal_bit_t *pin;
+    uint32_t mask;
+    int bank;
+} gpio_io_t;
+
+static gpio_io_t *outputs, *inputs;
+static int noutputs, ninputs;
+static uint32_t out_mask[NBANKS], in_mask[NBANKS];
+
 static void write_port(void *arg, long period);
 static void read_port(void *arg, long period);
 
@@ -91,15 +106,6 @@ static __inline__ uint32_t bcm2835_peri_read(volatile uint32_t* paddr)
   return ret;
 }
 
-// Read input pin
-static __inline__ uint8_t bcm2835_gpio_lev(uint8_t pin)
-{
-  volatile uint32_t* paddr = gpio + BCM2835_GPLEV0/4 + pin/32;
-  uint8_t shift = pin % 32;
-  uint32_t value = bcm2835_peri_read(paddr);
-  return (value & (1 << shift)) ? HIGH : LOW;
-}
-
 static __inline__ void bcm2835_peri_write(volatile uint32_t* paddr, uint32_t value)
 {
   // Make sure we don't rely on the first write, which may get
@@ -108,20 +114,10 @@ static __inline__ void bcm2835_peri_write(volatile uint32_t* paddr, uint32_t val
   *paddr = value;
 }
 
-// Set output pin
-static __inline__ void bcm2835_gpio_set(uint8_t pin)
-{
-  volatile uint32_t* paddr = gpio + BCM2835_GPSET0/4 + pin/32;
-  uint8_t shift = pin % 32;
-  bcm2835_peri_write(paddr, 1 << shift);
-}
-
-// Clear output pin
-static __inline__ void bcm2835_gpio_clr(uint8_t pin)
+// Write without the repeat, for accesses following one to the same peripheral
+static __inline__ void bcm2835_peri_write_nb(volatile uint32_t* paddr, uint32_t value)
 {
-  volatile uint32_t* paddr = gpio + BCM2835_GPCLR0/4 + pin/32;
-  uint8_t shift = pin % 32;
-  bcm2835_peri_write(paddr, 1 << shift);
+  *paddr = value;
 }
 
 // Set/clear only the bits in value covered by the mask
@@ -178,6 +174,29 @@ static int setup_gpiomem_access(void)
   return 0;
 }
 
+static int setup_fake_access(void)
+{
+  if ((mem_fd = open(fake_regs, O_RDWR|O_CREAT, 0644)) < 0) {
+    rtapi_print_msg(RTAPI_MSG_ERR,"HAL_GPIO: can't open %s:  %d - %s",
+		    fake_regs, errno, strerror(errno));
+    return -1;
+  }
+  if (ftruncate(mem_fd, BCM2835_BLOCK_SIZE) < 0) {
+    rtapi_print_msg(RTAPI_MSG_ERR,"HAL_GPIO: can't size %s:  %d - %s",
+		    fake_regs, errno, strerror(errno));
+    return -1;
+  }
+
+  gpio = mmap(NULL, BCM2835_BLOCK_SIZE, PROT_READ|PROT_WRITE, MAP_SHARED, mem_fd, 0);
+
+  if (gpio == MAP_FAILED) {
+    rtapi_print_msg(RTAPI_MSG_ERR, "HAL_GPIO: mmap failed: %d - %s\n", errno, strerror(errno));
+    return -1;
+  }
+  rtapi_print_msg(RTAPI_MSG_INFO, "HAL_GPIO: using fake registers in %s\n", fake_regs);
+  return 0;
+}
+
 static int  setup_gpio_access(int rev, int ncores)
 {
   // open /dev/mem
@@ -226,12 +245,16 @@ int rtapi_app_main(void)
     int rev, ncores, pinno;
     char *endptr;
 
-    if ((rev = get_rpi_revision()) < 0) {
+    if (fake_regs) {
+      rev = 3; // Raspberry2/3 pinout
+      ncores = 4;
+    } else if ((rev = get_rpi_revision()) < 0) {
       rtapi_print_msg(RTAPI_MSG_ERR,
 		      "unrecognized Raspberry revision, see /proc/cpuinfo\n");
       return -EINVAL;
+    } else {
+      ncores = number_of_cores();
     }
-    ncores = number_of_cores();
     rtapi_print_msg(RTAPI_MSG_INFO, "%d cores rev %d", ncores, rev);
 
     switch (rev) {
@@ -269,7 +292,9 @@ int rtapi_app_main(void)
 	return -EINVAL;
     }
     port_data = hal_malloc(npins * sizeof(void *));
-    if (port_data == 0) {
+    outputs = hal_malloc(npins * sizeof(gpio_io_t));
+    inputs = hal_malloc(npins * sizeof(gpio_io_t));
+    if (port_data == 0 || outputs == 0 || inputs == 0) {
 	rtapi_print_msg(RTAPI_MSG_ERR,
 	    "HAL_GPIO: ERROR: hal_malloc() failed\n");
 	hal_exit(comp_id);
@@ -300,7 +325,10 @@ int rtapi_app_main(void)
 	return -1;
     }
 
-    if (setup_gpiomem_access()) {
+    if (fake_regs) {
+      if (setup_fake_access())
+        return -1;
+    } else if (setup_gpiomem_access()) {
       if (setup_gpio_access(rev, ncores))
         return -1;
     }
@@ -321,11 +349,21 @@ int rtapi_app_main(void)
 	if ((retval = hal_pin_bit_newf(HAL_IN, &port_data[n],
 				       comp_id, "hal_gpio.pin-%02d-out", pinno)) < 0)
 	  break;
+	outputs[noutputs].pin = port_data[n];
+	outputs[noutputs].bank = gpios[n] / 32;
+	outputs[noutputs].mask = 1 << (gpios[n] % 32);
+	out_mask[outputs[noutputs].bank] |= outputs[noutputs].mask;
+	noutputs++;
       } else {
 	bcm2835_gpio_fsel(gpios[n], BCM2835_GPIO_FSEL_INPT);
 	if ((retval = hal_pin_bit_newf(HAL_OUT, &port_data[n],
 				       comp_id, "hal_gpio.pin-%02d-in", pinno)) < 0)
 	  break;
+	inputs[ninputs].pin = port_data[n];
+	inputs[ninputs].bank = gpios[n] / 32;
+	inputs[ninputs].mask = 1 << (gpios[n] % 32);
+	in_mask[inputs[ninputs].bank] |= inputs[ninputs].mask;
+	ninputs++;
       }
     }
     if (retval < 0) {
@@ -370,27 +408,46 @@ void rtapi_app_exit(void)
 
 static void write_port(void *arg, long period)
 {
-  int n;
-
-  for (n = 0; n < npins; n++) {
-    if (exclude_map & RTAPI_BIT(n))
+  uint32_t set[NBANKS] = { 0 };
+  uint32_t clr;
+  int n, b, first = 1;
+
+  for (n = 0; n < noutputs; n++)
+    if (*(outputs[n].pin))
+      set[outputs[n].bank] |= outputs[n].mask;
+
+  // one store per register and bank; only the first access of the
+  // cycle needs the repeat for a peripheral switch
+  for (b = 0; b < NBANKS; b++) {
+    if (!out_mask[b])
       continue;
-    if (dir_map & RTAPI_BIT(n)) {
-      if (*(port_data[n])) {
-	bcm2835_gpio_set(gpios[n]);
-      } else {
-	bcm2835_gpio_clr(gpios[n]);
-      }
+    clr = out_mask[b] & ~set[b];
+    if (clr) {
+      if (first)
+	bcm2835_peri_write(gpio + BCM2835_GPCLR0/4 + b, clr);
+      else
+	bcm2835_peri_write_nb(gpio + BCM2835_GPCLR0/4 + b, clr);
+      first = 0;
+    }
+    if (set[b]) {
+      if (first)
+	bcm2835_peri_write(gpio + BCM2835_GPSET0/4 + b, set[b]);
+      else
+	bcm2835_peri_write_nb(gpio + BCM2835_GPSET0/4 + b, set[b]);
+      first = 0;
     }
   }
 }
 
 static void read_port(void *arg, long period)
 {
-  int n;
+  uint32_t lev[NBANKS] = { 0 };
+  int n, b;
 
-  for (n = 0; n < npins; n++) {
-    if ((~dir_map & RTAPI_BIT(n)) && (~exclude_map & RTAPI_BIT(n)))
-      *port_data[n] = bcm2835_gpio_lev(gpios[n]);
-  }
+  for (b = 0; b < NBANKS; b++)
+    if (in_mask[b])
+      lev[b] = bcm2835_peri_read(gpio + BCM2835_GPLEV0/4 + b);
+
+  for (n = 0; n < ninputs; n++)
+    *(inputs[n].pin) = (lev[inputs[n].bank] & inputs[n].mask) != 0;
 }
@@ -0,0 +1,177 @@
+//----------------------------------------------------------------------//
+// Description: emulator.c                                              //
+// Host-side model of the PRU task list, running against an ordinary   //
+// block of memory instead of the PRU data RAM                          //
+//                                                                      //
+// License: GNU GPL Version 2.0 or (at your option) any later version.  //
+//----------------------------------------------------------------------//
+// This file is part of Machinekit HAL                                  //
+//                                                                      //
+// This program is free software; you can redistribute it and/or        //
+// modify it under the terms of the GNU General Public License          //
+// as published by the Free Software Foundation; either version 2       //
+// of the License, or (at your option) any later version.               //
+//                                                                      //
+// This program is distributed in the hope that it will be useful,      //
+// but WITHOUT ANY WARRANTY; without even the implied warranty of       //
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the        //
+// GNU General Public License for more details.                         //
+//                                                                      //
+// You should have received a copy of the GNU General Public License    //
+// along with this program; if not, write to the Free Software          //
+// Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA        //
+// 02110-1301, USA.                                                     //
+//----------------------------------------------------------------------//
+
+// The emulator walks the same linked task list the PRU firmware walks
+// (see pru_generic.p), so the driver can be exercised without a PRU:
+//
+//  - wait tasks end a timer tick and raise the host event exactly like
+//    pru_wait.p does
+//  - step/dir tasks are a line-by-line model of pru_stepdir.p, minus
+//    the pin writes
+//  - every other task is skipped, leaving its feedback untouched
+//
+// It is deliberately free of anything platform specific; the driver
+// supplies the timing (emulate=1) and tests can call hpg_emu_run()
+// directly.
+
+#include "config_module.h"
+#include "rtapi.h"
+#include "hal.h"
+
+#include "hal/drivers/hal_pru_generic/hal_pru_generic.h"
+
+// Upper bound on tasks visited per tick, in case the list has no wait task
+#define EMU_MAX_TASKS 256
+
+// pru_stepdir.p state, as the PRU lays it out after the task header
+typedef struct {
+    PRU_task_header_t task;
+
+    s32     rate;
+    u16     steplen;
+    u16     dirhold;
+    u16     stepspace;
+    u16     dirsetup;
+    u32     accum;
+    u32     pos;
+    u16     t_pulse;
+    u16     t_dir;
+    u8      stepq;
+    u8      rateq;
+    u8      reserved1;
+    u8      stepinv;
+} emu_stepdir_t;
+
+#define DirHoldBit      31
+#define DirChgBit       30
+#define PulseHoldBit    29
+#define StepBit         27
+
+#define HoldMask        0x1F
+#define DirHoldMask     0x3F
+
+static void *emu_ptr(hpg_emu_t *emu, pru_addr_t addr) {
+    return (char *) emu->ram + addr;
+}
+
+static void emu_stepdir(hpg_emu_t *emu, pru_addr_t addr) {
+    emu_stepdir_t *s = emu_ptr(emu, addr);
+    u32 accum = s->accum;
+
+    if (!(accum & (1u << StepBit)))
+        accum += s->rate;
+
+    if ((((u32) s->rate >> 24) ^ s->rateq) & 0x80)
+        accum |= 1u << DirChgBit;
+    s->rateq = (u32) s->rate >> 24;
+
+    if (accum & (1u << PulseHoldBit)) {
+        if (--s->t_pulse == 0) {
+            if (s->stepq) {
+                s->stepq = 0;
+                s->t_pulse = s->stepspace;
+            } else {
+                accum &= ~(1u << PulseHoldBit);
+            }
+        }
+    }
+
+    if (s->t_dir)
+        s->t_dir--;
+
+    if ((accum >> 24) > DirHoldMask && s->t_dir == 0) {
+        if (accum & (1u << DirChgBit)) {
+            accum &= ~(1u << DirChgBit);
+            accum |= 1u << DirHoldBit;
+            s->t_pulse = s->dirsetup;
+        } else {
+            accum &= ~(1u << DirHoldBit);
+        }
+    }
+
+    if ((accum & (1u << StepBit)) && (accum >> 24) <= HoldMask) {
+        accum &= ~(1u << StepBit);
+        accum |= 0x30u << 24;
+        s->pos += (s->rate < 0) ? -1 : 1;
+        s->stepq = 1;
+        s->t_pulse = s->steplen;
+        s->t_dir = s->dirhold;
+    }
+
+    s->accum = accum;
+}
+
+// Returns 1 if the host event was raised
+static int emu_wait(hpg_emu_t *emu, pru_addr_t addr) {
+    PRU_task_wait_t *w = emu_ptr(emu, addr);
+    int raised = 0;
+
+    if (w->event_period) {
+        if (--w->event_count == 0) {
+            raised = 1;
+            w->event_count = w->event_period;
+        }
+    }
+    emu->ticks++;
+    return raised;
+}
+
+int hpg_emu_run(hpg_emu_t *emu, int ticks) {
+    int events = 0;
+    int visited = 0;
+
+    if (emu->task == 0) {
+        PRU_statics_t *stat = emu_ptr(emu, PRU_DATA_START);
+
+        // The PRU spins until the host has finished the task list
+        if (!(stat->ready & 1) || stat->task.hdr.addr == 0)
+            return 0;
+        emu->task = stat->task.hdr.addr;
+    }
+
+    while (ticks > 0) {
+        PRU_task_header_t *hdr = emu_ptr(emu, emu->task);
+
+        switch (hdr->hdr.mode) {
+        case eMODE_WAIT:
+        case eMODE_WAIT_ECAP:
+            events += emu_wait(emu, emu->task);
+            ticks--;
+            visited = 0;
+            break;
+        case eMODE_STEP_DIR:
+            emu_stepdir(emu, emu->task);
+            break;
+        default:
+            break;
+        }
+
+        emu->task = hdr->hdr.addr;
+        if (++visited > EMU_MAX_TASKS)
+            break;
+    }
+
+    return events;
+}
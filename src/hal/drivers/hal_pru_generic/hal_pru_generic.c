@@ -80,6 +80,8 @@
 #include <unistd.h>
 #include <sys/types.h>
 #include <sys/stat.h>
+#include <sys/eventfd.h>
+#include <time.h>
 
 #include "hal/drivers/hal_pru_generic/hal_pru_generic.h"
 #include "hal/drivers/hal_pru_generic/beaglebone_pinmap.h"
@@ -148,6 +150,12 @@ RTAPI_IP_INT(disabled, "start the PRU in disabled state for debugging (0=enabled
 static int event = -1;
 RTAPI_IP_INT(event, "PRU event number to listen for (0..7, default: none)");
 
+static int event_period = 0;
+RTAPI_IP_INT(event_period, "PRU periods between host events releasing the wait-event funct (default: 0, free running)");
+
+static int emulate = 0;
+RTAPI_MP_INT(emulate, "run the task list on a host-side PRU emulator instead of the PRU (default: 0)");
+
 static hpg_board_t board_id = BBB;
 
 /***********************************************************************
@@ -169,6 +177,17 @@ char *fw_path = "/lib/firmware/pru/";
 static unsigned long *pru_data_ram;     // points to PRU data RAM
 static tpruss_intc_initdata pruss_intc_initdata = PRUSS_INTC_INITDATA;
 
+// host-side PRU emulation, one per PRU
+static struct {
+    hpg_emu_t emu;
+    pthread_t thread;
+    int running;
+    int fd;                 // eventfd standing in for the PRU host event
+    long period_ns;         // emulated PRU period
+    int batch;              // ticks emulated per wakeup
+} emus[4];
+static u32 emu_ram[4][8192/4];
+
 
 /***********************************************************************
 *                  LOCAL FUNCTION DECLARATIONS                         *
@@ -182,6 +201,8 @@ int pru_init_hpg(int pru, char *filename, int disabled, hal_pru_generic_t *hpg);
 int setup_pru(int pru, char *filename, int disabled, hal_pru_generic_t *hpg);
 void pru_shutdown(int pru);
 static void *pruevent_thread(void *arg);
+static void *emulator_thread(void *arg);
+static int hpg_wait_event(void *hpg, const hal_funct_args_t *fa);
 
 int remoteproc_stop(int pru);
 int remoteproc_start(int pru);
@@ -212,6 +233,7 @@ static int instantiate_hal_pru_generic(const int argc, char* const *argv) {
     HPG_DBG("static var pru_period %d", pru_period);
     HPG_DBG("static var disabled %d", disabled);
     HPG_DBG("static var event %d", event);
+    HPG_DBG("static var event_period %d", event_period);
     HPG_DBG("static var board_id %d", board_id);
 
     if((inst_id = hal_inst_create(argv[1], comp_id, sizeof(hal_pru_generic_t), (void**)&hpg)) < 0) {
@@ -230,8 +252,25 @@ static int instantiate_hal_pru_generic(const int argc, char* const *argv) {
     hpg->config.inst_id      = inst_id;
     hpg->config.pru_period   = pru_period;
     hpg->config.pruNumber = pru;
+    hpg->config.event        = event;
+    hpg->config.event_period = event_period;
     strncpy(hpg->config.halname, argv[1], 10);
 
+    // PRU timed host: the PRU raises PRUx_ARM_INTERRUPT, which the
+    // default INTC mapping routes to EVTOUT0 for PRU0 and EVTOUT1 for PRU1
+    if (event_period) {
+        if ((event_period < 0) || (event_period > 65535)) {
+            HPG_ERR("ERROR: event_period %d out of range (1..65535)\n", event_period);
+            return -1;
+        }
+        if ((board_id == BBAI) && !emulate) {
+            HPG_ERR("ERROR: event_period is not supported on the Beaglebone AI\n");
+            return -1;
+        }
+        if (hpg->config.event < 0)
+            hpg->config.event = pru % 2;
+    }
+
     // Initialize PRU and map PRU data memory
 
     if ((retval = pru_init_hpg(pru, prucode, disabled, hpg))) {
@@ -312,6 +351,12 @@ int rtapi_app_main(void) {
   if(comp_id < 0)
     return comp_id;
 
+  if (emulate) {
+      HPG_INFO("using the host-side PRU emulator\n");
+      hal_ready(comp_id);
+      return 0;
+  }
+
   board_id = check_board();
 
   // Initialize PRU and map PRU data memory
@@ -347,6 +392,36 @@ static int hpg_read(void *void_hpg, const hal_funct_args_t *fa) {
     return 0;
 }
 
+// Blocks until the PRU has finished event_period periods of work, so
+// the rest of the thread runs while the PRU waits for its next tick.
+// Use as the first funct of a 'nowait' thread.
+static int hpg_wait_event(void *void_hpg, const hal_funct_args_t *fa) {
+    hal_pru_generic_t *hpg = void_hpg;
+
+    if (emulate) {
+        uint64_t n;
+
+        if (read(emus[hpg->config.pruNumber].fd, &n, sizeof(n)) != sizeof(n)) {
+            *(hpg->hal.pin.event_errors) += 1;
+            return 0;
+        }
+        hpg->event_total += n;
+    } else {
+        int count;
+
+        if (prussdrv_pru_wait_event(hpg->config.event, &count) < 0) {
+            *(hpg->hal.pin.event_errors) += 1;
+            return 0;
+        }
+        prussdrv_pru_clear_event(hpg->config.pruNumber % 2 ? PRU1_ARM_INTERRUPT : PRU0_ARM_INTERRUPT);
+        hpg->event_total = count;
+    }
+    *(hpg->hal.pin.event_count) += 1;
+    *(hpg->hal.pin.event_missed) = hpg->event_total - *(hpg->hal.pin.event_count);
+
+    return 0;
+}
+
 u16 ns2periods(hal_pru_generic_t *hpg, hal_u32_t ns) {
     u16 p = rtapi_ceil((double)ns / (double)hpg->config.pru_period);
     return p;
@@ -423,6 +498,22 @@ int export_pru(hal_pru_generic_t *hpg)
         return -1;
     }
 
+    if (hpg->config.event_period) {
+        hal_export_xfunct_args_t waitArgs = {
+          .type = FS_XTHREADFUNC,
+          .funct.x = hpg_wait_event,
+          .arg = hpg,
+          .uses_fp = 0,
+          .reentrant = 0,
+          .owner_id = hpg->config.inst_id
+        };
+        r = hal_export_xfunctf(&waitArgs, "%s.wait-event", hpg->config.halname);
+        if (r != 0) {
+            HPG_ERR("ERROR: function export failed: %s\n", hpg->config.halname);
+            return -1;
+        }
+    }
+
     return 0;
 }
 
@@ -544,7 +635,9 @@ rtapi_print_msg(RTAPI_MSG_DBG, "prussdrv_map_prumem, %d\n", pru);
       default:
         return -1;
     }
-    if (prussdrv_map_prumem(prumem, (void **) &pru_data_ram) < 0)
+    if (emulate) {
+      pru_data_ram = (unsigned long *) emu_ram[pru];
+    } else if (prussdrv_map_prumem(prumem, (void **) &pru_data_ram) < 0)
       return -1;
 
 rtapi_print_msg(RTAPI_MSG_DBG, "PRU data ram mapped\n");
@@ -690,7 +783,35 @@ int setup_pru(int pru, char *filename, int disabled, hal_pru_generic_t *hpg) {
 
     int retval;
 
-    if (event > -1) {
+    if (emulate) {
+      // No PRU code to load, the emulator walks the task list itself
+      emus[pru].emu.ram = emu_ram[pru];
+      emus[pru].emu.task = 0;
+      emus[pru].period_ns = hpg->config.pru_period;
+      emus[pru].batch = hpg->config.event_period;
+      if (emus[pru].batch == 0)
+        emus[pru].batch = 1000000 / hpg->config.pru_period + 1;
+      if ((emus[pru].fd = eventfd(0, 0)) < 0) {
+        HPG_ERR("ERROR: eventfd failed: %s\n", strerror(errno));
+        return -1;
+      }
+      emus[pru].running = 1;
+      if (pthread_create(&emus[pru].thread, NULL, emulator_thread, (void *) (long) pru)) {
+        HPG_ERR("ERROR: failed to start PRU emulator\n");
+        emus[pru].running = 0;
+        return -1;
+      }
+      return 0;
+    }
+
+    if (hpg->config.event_period) {
+      // The wait-event funct reads the event itself
+      if (!pruss->fd[hpg->config.event] &&
+          (prussdrv_open(hpg->config.event, 0, 0) < 0)) {
+        HPG_ERR("ERROR: cannot open PRU event %d\n", hpg->config.event);
+        return -1;
+      }
+    } else if (event > -1) {
     prussdrv_start_irqthread (event, sched_get_priority_max(SCHED_FIFO) - 2,
                   pruevent_thread, (void *) event);
     HPG_ERR("PRU event %d listener started\n",event);
@@ -808,6 +929,28 @@ static void *pruevent_thread(void *arg)
     return NULL; // silence compiler warning
 }
 
+// Stand-in for the PRU: run a batch of emulated periods per wakeup,
+// posting the host events they raised to the eventfd
+static void *emulator_thread(void *arg)
+{
+    int n = (long) arg;
+    struct timespec next;
+    long long step = (long long) emus[n].period_ns * emus[n].batch;
+
+    clock_gettime(CLOCK_MONOTONIC, &next);
+    while (emus[n].running) {
+        next.tv_nsec += step % 1000000000;
+        next.tv_sec  += step / 1000000000 + next.tv_nsec / 1000000000;
+        next.tv_nsec %= 1000000000;
+        clock_nanosleep(CLOCK_MONOTONIC, TIMER_ABSTIME, &next, NULL);
+
+        uint64_t events = hpg_emu_run(&emus[n].emu, emus[n].batch);
+        if (events && (write(emus[n].fd, &events, sizeof(events)) != sizeof(events)))
+            HPG_ERR("PRU emulator: eventfd write failed\n");
+    }
+    return NULL;
+}
+
 int remoteproc_stop(int pru) {
   char remoteproc_path[MAX_PATH_LEN];
   rtapi_snprintf(remoteproc_path, sizeof(remoteproc_path), "/sys/class/remoteproc/remoteproc%d/state", pru2remoteproc(pru));
@@ -838,6 +981,13 @@ int remoteproc_start(int pru) {
 
 void pru_shutdown(int pru)
 {
+    if (emulate) {
+      emus[pru].running = 0;
+      pthread_join(emus[pru].thread, NULL);
+      close(emus[pru].fd);
+      return;
+    }
+
     // Disable PRU and close memory mappings
     if(board_id == BBAI) {
       remoteproc_stop(pru);
@@ -861,6 +1011,13 @@ int hpg_wait_init(hal_pru_generic_t *hpg) {
 
     *(hpg->hal.pin.pru_busy_pin) = 0x80;
 
+    if (hpg->config.event_period) {
+        r = hal_pin_u32_newf(HAL_OUT, &(hpg->hal.pin.event_count), hpg->config.inst_id, "%s.event.count", hpg->config.halname);
+        r += hal_pin_u32_newf(HAL_OUT, &(hpg->hal.pin.event_missed), hpg->config.inst_id, "%s.event.missed", hpg->config.halname);
+        r += hal_pin_u32_newf(HAL_OUT, &(hpg->hal.pin.event_errors), hpg->config.inst_id, "%s.event.errors", hpg->config.halname);
+        if (r != 0) { return r; }
+    }
+
     return 0;
 }
 
@@ -877,24 +1034,36 @@ void hpg_wait_force_write(hal_pru_generic_t *hpg) {
     hpg->wait.pru.task.hdr.addr = hpg->wait.task.next;
     hpg->wait_init.pru.task.hdr.addr = hpg->wait_init.task.next;
 
+    // r31 value raising PRUx_ARM_INTERRUPT: strobe bit plus system event - 16
+    hpg->wait.pru.event_period = hpg->config.event_period;
+    hpg->wait.pru.event_count  = hpg->config.event_period;
+    hpg->wait.pru.event_out    = 0x20 |
+        ((hpg->config.pruNumber % 2 ? PRU1_ARM_INTERRUPT : PRU0_ARM_INTERRUPT) - 16);
+    hpg->wait.written_busy_pin = *(hpg->hal.pin.pru_busy_pin);
+
     hpg->pru_stat.ready = 1;
 
-    PRU_task_basic_t *pru = (PRU_task_basic_t *) ((u32) hpg->pru_data + (u32) hpg->wait.task.addr);
-    *pru = hpg->wait.pru;
+    PRU_task_wait_t *wait = (PRU_task_wait_t *) ((u32) hpg->pru_data + (u32) hpg->wait.task.addr);
+    *wait = hpg->wait.pru;
 
-    pru = (PRU_task_basic_t *) ((u32) hpg->pru_data + (u32) hpg->wait_init.task.addr);
+    PRU_task_basic_t *pru = (PRU_task_basic_t *) ((u32) hpg->pru_data + (u32) hpg->wait_init.task.addr);
     *pru = hpg->wait_init.pru;
 
     PRU_statics_t *stat = (PRU_statics_t *) ((u32) hpg->pru_data + (u32) hpg->pru_stat_addr);
     *stat = hpg->pru_stat;
 }
 
+// Only dataX (the busy pin) is host owned once the PRU runs: dataY
+// (overrun flag) and event_count are written back by the PRU every period
 void hpg_wait_update(hal_pru_generic_t *hpg) {
-    if (hpg->wait.pru.task.hdr.dataX != *(hpg->hal.pin.pru_busy_pin))
+    if (hpg->wait.written_busy_pin != *(hpg->hal.pin.pru_busy_pin)) {
         hpg->wait.pru.task.hdr.dataX = *(hpg->hal.pin.pru_busy_pin);
 
-    PRU_task_basic_t *pru = (PRU_task_basic_t *) ((u32) hpg->pru_data + (u32) hpg->wait.task.addr);
-    *pru = hpg->wait.pru;
+        PRU_task_wait_t *pru = (PRU_task_wait_t *) ((u32) hpg->pru_data + (u32) hpg->wait.task.addr);
+        // a byte store: dataY next to it belongs to the PRU
+        pru->task.hdr.dataX = hpg->wait.pru.task.hdr.dataX;
+        hpg->wait.written_busy_pin = *(hpg->hal.pin.pru_busy_pin);
+    }
 }
 
 int fixup_pin(u32 hal_pin) {
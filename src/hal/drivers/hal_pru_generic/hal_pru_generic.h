@@ -325,6 +325,20 @@ typedef struct {
     pru_task_t          task;
 } hpg_basic_t;
 
+typedef struct {
+    PRU_task_wait_t     pru;
+    pru_task_t          task;
+
+    u32 written_busy_pin;
+} hpg_wait_t;
+
+// host-side PRU emulator, see emulator.c
+typedef struct {
+    u32         *ram;       // stands in for the PRU data RAM
+    pru_addr_t  task;       // next task to run, 0 until the task list is ready
+    u32         ticks;      // timer ticks since the task list started
+} hpg_emu_t;
+
 typedef struct {
 
     struct {
@@ -337,14 +351,21 @@ typedef struct {
         int inst_id;
         char halname[10];
         int pruNumber;
+        int event;              // host event (EVTOUT) the PRU raises, -1 = none
+        int event_period;       // PRU periods between host events, 0 = free running
     } config;
 
     struct {
         struct {
             hal_u32_t  * pru_busy_pin;
+            hal_u32_t  * event_count;
+            hal_u32_t  * event_missed;
+            hal_u32_t  * event_errors;
         } pin;
     } hal;
 
+    u32 event_total;            // host events raised by the PRU so far
+
     u32 *pru_data;              // ARM pointer to mapped PRU data memory
     pru_addr_t pru_data_free;   // Offset to first free data
 
@@ -369,7 +390,7 @@ typedef struct {
     hpg_encoder_t   encoder;
     hpg_pwmread_t   pwmread;
 
-    hpg_basic_t      wait;
+    hpg_wait_t       wait;
     hpg_basic_t      wait_init;
 
 } hal_pru_generic_t;
@@ -418,4 +439,11 @@ void hpg_encoder_force_write(hal_pru_generic_t *hpg);
 void hpg_encoder_update(hal_pru_generic_t *hpg);
 void hpg_encoder_read(hal_pru_generic_t *hpg, long l_period_ns);
 
+
+//
+// emulator functions
+//
+
+int hpg_emu_run(hpg_emu_t *emu, int ticks);
+
 #endif
@@ -338,11 +338,26 @@
 //
 
 #ifndef _hal_pru_generic_H_
-
+    .struct wait_event
+        .u16    EventPeriod     // Raise host event every EventPeriod ticks, 0 = never
+        .u16    EventCount      // Ticks left until the next host event
+        .u8     EventOut        // Value written to r31 to raise the event
+        .u8     Reserved1
+        .u16    Reserved2
+    .ends
 #else
     typedef struct {
         PRU_task_header_t task;
     } PRU_task_basic_t;
+
+    typedef struct {
+        PRU_task_header_t task;
+
+        u16     event_period;   // host owned
+        u16     event_count;    // PRU owned after start
+        u8      event_out;      // host owned
+        u8      reserved[3];
+    } PRU_task_wait_t;
 #endif
 
 //
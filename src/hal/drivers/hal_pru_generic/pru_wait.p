@@ -82,6 +82,7 @@ MODE_WAIT:
 .ends
 
 .assign wait_state, GState.State_Reg0, *, State
+.assign wait_event, GState.Scratch2, GState.Scratch3, Event
 
 
     XIN     10, State, SIZE( State)          // Pull the GPIO addresses from first scratchpad
@@ -154,10 +155,24 @@ MODE_WAIT:
     // begins executing after a timer tick, and clear it once all work
     // is complete and we are waiting for the next timer tick
 BUSY_CHECK:
-    QBBC    WAITLOOP, GTask.dataX, 7        // If MSB is set, we should twiddle the busy bit
+    QBBC    HOST_EVENT, GTask.dataX, 7      // If MSB is set, we should twiddle the busy bit
     CLR     r30, GTask.dataX                // Clear busy bit
     SET     GState.PRU_Out, GTask.dataX     // Set busy bit with all other outputs after we wait for a timer tick
 
+    // PRU timed host:
+    // All work for this period is done, so every EventPeriod ticks raise
+    // the host event.  The HAL thread blocked in the wait-event funct
+    // runs while we sit in WAITLOOP below.
+HOST_EVENT:
+    LBBO    Event, GTask.addr, SIZE(task_header), SIZE(Event)
+    QBEQ    WAITLOOP, Event.EventPeriod, 0
+    SUB     Event.EventCount, Event.EventCount, 1
+    QBNE    HOST_EVENT_SAVE, Event.EventCount, 0
+    MOV     r31.b0, Event.EventOut
+    MOV     Event.EventCount, Event.EventPeriod
+HOST_EVENT_SAVE:
+    SBBO    Event.EventCount, GTask.addr, SIZE(task_header) + OFFSET(Event.EventCount), SIZE(Event.EventCount)
+
 WAITLOOP:
     // Wait until the next timer tick...
     // FIXME:
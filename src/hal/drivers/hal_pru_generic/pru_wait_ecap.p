@@ -84,6 +84,7 @@ MODE_WAIT_ECAP:
 .ends
 
 .assign wait_state_ecap, GState.State_Reg0, *, State
+.assign wait_event, GState.Scratch2, GState.Scratch3, Event
 
 
     XIN     10, State, SIZE( State)          // Pull the GPIO addresses from first scratchpad
@@ -152,10 +153,21 @@ MODE_WAIT_ECAP:
     // begins executing after a timer tick, and clear it once all work
     // is complete and we are waiting for the next timer tick
 BUSY_CHECK_ECAP:
-    QBBC    WAITLOOP_ECAP, GTask.dataX, 7        // If MSB is set, we should twiddle the busy bit
+    QBBC    HOST_EVENT_ECAP, GTask.dataX, 7      // If MSB is set, we should twiddle the busy bit
     CLR     r30, GTask.dataX                // Clear busy bit
     SET     GState.PRU_Out, GTask.dataX     // Set busy bit with all other outputs after we wait for a timer tick
 
+    // PRU timed host, see pru_wait.p
+HOST_EVENT_ECAP:
+    LBBO    Event, GTask.addr, SIZE(task_header), SIZE(Event)
+    QBEQ    WAITLOOP_ECAP, Event.EventPeriod, 0
+    SUB     Event.EventCount, Event.EventCount, 1
+    QBNE    HOST_EVENT_SAVE_ECAP, Event.EventCount, 0
+    MOV     r31.b0, Event.EventOut
+    MOV     Event.EventCount, Event.EventPeriod
+HOST_EVENT_SAVE_ECAP:
+    SBBO    Event.EventCount, GTask.addr, SIZE(task_header) + OFFSET(Event.EventCount), SIZE(Event.EventCount)
+
 WAITLOOP_ECAP:
     // Wait until the next timer tick...
     // FIXME:
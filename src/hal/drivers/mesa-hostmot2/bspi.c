@@ -133,7 +133,7 @@ int hm2_tram_add_bspi_frame(char *name, int chan, u32 **wbuff, u32 **rbuff)
         return -1;
     }
     if (wbuff != NULL) {
-        r = hm2_register_tram_write_region(hm2,hm2->bspi.instance[i].addr[chan], sizeof(u32),wbuff);
+        r = hm2_register_tram_write_strobe_region(hm2,hm2->bspi.instance[i].addr[chan], sizeof(u32),wbuff);
         if (r < 0) {
             HM2_ERR("Failed to add TRAM write entry for %s.\n", name);
             return -1;
@@ -145,7 +145,7 @@ int hm2_tram_add_bspi_frame(char *name, int chan, u32 **wbuff, u32 **rbuff)
     if (rbuff != NULL){
         // Don't add a read entry for a no-echo channel
         if(!(hm2->bspi.instance[i].cd[chan] & 0x80000000)) {
-            r = hm2_register_tram_read_region(hm2,hm2->bspi.instance[i].addr[0], sizeof(u32),rbuff);
+            r = hm2_register_tram_read_strobe_region(hm2,hm2->bspi.instance[i].addr[0], sizeof(u32),rbuff);
             if (r < 0) {
                 HM2_ERR( "Failed to add TRAM read entry for %s\n", name);
                 return -1;
@@ -395,6 +395,14 @@ int hm2_encoder_parse_md(hostmot2_t *hm2, hm2_encoder_t *encoder, int md_index,
         goto fail0;
     }
 
+    encoder->batch_count = (u16 *)kmalloc(encoder->num_instances * sizeof(u16), GFP_KERNEL);
+    encoder->batch_busy = (int *)kmalloc(encoder->num_instances * sizeof(int), GFP_KERNEL);
+    if ((encoder->batch_count == NULL) || (encoder->batch_busy == NULL)) {
+        HM2_ERR("out of memory!\n");
+        r = -ENOMEM;
+        goto fail1;
+    }
+
 
     // export the encoders to HAL
     // FIXME: r hides the r in enclosing function, and it returns the wrong thing
@@ -431,6 +439,17 @@ int hm2_encoder_parse_md(hostmot2_t *hm2, hm2_encoder_t *encoder, int md_index,
             }
             *(hm2->encoder.hal->pin.dpll_timer_num) = -1;
         }
+        if (md->gtag == HM2_GTAG_MUXED_ENCODER) {
+            rtapi_snprintf(name, sizeof(name), "%s.encoder.muxed-batch", hm2->llio->name);
+        } else {
+            rtapi_snprintf(name, sizeof(name), "%s.encoder.batch", hm2->llio->name);
+        }
+        r = hal_pin_bit_new(name, HAL_IN, &(encoder->hal->pin.batch), hm2->llio->comp_id);
+        if (r < 0) {
+            HM2_ERR("error adding pin %s, aborting\n", name);
+            goto fail1;
+        }
+        *encoder->hal->pin.batch = 1;
 
         for (i = 0; i < encoder->num_instances; i ++) {
             // pins
@@ -678,6 +697,8 @@ int hm2_encoder_parse_md(hostmot2_t *hm2, hm2_encoder_t *encoder, int md_index,
     return encoder->num_instances;
 
 fail1:
+    kfree(encoder->batch_busy);
+    kfree(encoder->batch_count);
     kfree(encoder->control_reg);
 
 fail0:
@@ -714,6 +735,9 @@ void hm2_encoder_tram_init(hostmot2_t *hm2, hm2_encoder_t *encoder) {
 
         encoder->instance[i].prev_reg_count = count;
 
+        // no position computed yet, so the first read does the full update
+        encoder->instance[i].prev_scale = 0.0;
+
         encoder->instance[i].state = HM2_ENCODER_STOPPED;
 
         // Note: we dont initialize the other internal state variables,
@@ -876,6 +900,8 @@ static void hm2_encoder_instance_update_position(hostmot2_t *hm2,
 
     *e->hal.pin.position = *e->hal.pin.count / *e->hal.pin.scale;
     *e->hal.pin.position_latch = *e->hal.pin.count_latch / *e->hal.pin.scale;
+
+    e->prev_scale = *e->hal.pin.scale;
 }
 
 
@@ -897,8 +923,6 @@ static void hm2_encoder_instance_process_tram_read(hostmot2_t *hm2,
         *(e->hal.pin.scale) = 1.0;
     }
 
-    hm2_encoder_read_control_register(hm2, encoder);
-
     switch (e->state) {
 
         case HM2_ENCODER_STOPPED: {
@@ -1062,6 +1086,51 @@ static void hm2_encoder_instance_process_tram_read(hostmot2_t *hm2,
 
 
 
+//
+// The batch path finds the instances whose outputs can change this
+// cycle and runs the per-instance code above on those only.
+//
+// An instance that is Stopped, whose count register has not moved, that
+// is not waiting for an index or probe event, whose .reset is false and
+// whose .scale is the one its position pins were computed with, would
+// only recompute .count, .position and their latched versions from
+// unchanged inputs, so it is skipped.  Everything else goes through
+// hm2_encoder_instance_process_tram_read() unchanged, so the pins come
+// out bit-for-bit the same as with .batch off.
+//
+// The first two passes are plain loops over arrays without branches on
+// the data, which the compiler can vectorize: the count half of each
+// counter register is unpacked into batch_count[], then the busy
+// instances are compacted into batch_busy[].
+//
+
+static int hm2_encoder_batch_select(hm2_encoder_t *encoder) {
+    int i, n = 0;
+
+    for (i = 0; i < encoder->num_instances; i ++) {
+        encoder->batch_count[i] = hm2_encoder_get_reg_count(encoder, i);
+    }
+
+    for (i = 0; i < encoder->num_instances; i ++) {
+        hm2_encoder_instance_t *e = &encoder->instance[i];
+        hal_float_t scale = *e->hal.pin.scale;
+        int busy;
+
+        busy = (e->state != HM2_ENCODER_STOPPED)
+            | (encoder->batch_count[i] != e->prev_reg_count)
+            | ((e->prev_control & (HM2_ENCODER_LATCH_ON_INDEX | HM2_ENCODER_LATCH_ON_PROBE)) != 0)
+            | (*e->hal.pin.reset != 0)
+            | (scale != e->prev_scale)
+            | (scale == 0.0);
+
+        encoder->batch_busy[n] = i;
+        n += busy;
+    }
+
+    return n;
+}
+
+
 void hm2_encoder_process_tram_read(hostmot2_t *hm2,
 				   hm2_encoder_t *encoder,
 				   long l_period_ns) {
@@ -1069,6 +1138,19 @@ void hm2_encoder_process_tram_read(hostmot2_t *hm2,
 
     if (encoder->num_instances <= 0) return;
 
+    // the latch/control register feeds the quad-error and input pins of
+    // every instance, whether or not it moved
+    hm2_encoder_read_control_register(hm2, encoder);
+
+    if (*encoder->hal->pin.batch) {
+        int n = hm2_encoder_batch_select(encoder);
+
+        for (i = 0; i < n; i ++) {
+            hm2_encoder_instance_process_tram_read(hm2, encoder, encoder->batch_busy[i]);
+        }
+        return;
+    }
+
     // process each encoder instance independently
     for (i = 0; i < encoder->num_instances; i ++) {
         hm2_encoder_instance_process_tram_read(hm2, encoder, i);
@@ -1078,6 +1160,8 @@ void hm2_encoder_process_tram_read(hostmot2_t *hm2,
 
 void hm2_encoder_cleanup(hostmot2_t *hm2, hm2_encoder_t *encoder) {
     if (encoder->num_instances <= 0) return;
+    kfree(encoder->batch_busy);
+    kfree(encoder->batch_count);
     kfree(encoder->control_reg);
 }
 
@@ -26,6 +26,7 @@
 #include <sys/fcntl.h>
 #include <sys/ioctl.h>
 #include <sys/socket.h>
+#include <poll.h>
 #include <linux/sockios.h>
 #include <net/if_arp.h>
 #include <netinet/in.h>
@@ -44,6 +45,7 @@
 #include "rtapi_string.h"
 
 #include "hal.h"
+#include "hal_priv.h"
 
 #include "hostmot2-lowlevel.h"
 #include "hostmot2.h"
@@ -94,6 +96,15 @@ RTAPI_MP_ARRAY_STRING(board_ip, MAX_ETH_BOARDS, "ip address of ethernet board(s)
 static char *config[MAX_ETH_BOARDS];
 RTAPI_MP_ARRAY_STRING(config, MAX_ETH_BOARDS, "config string for the AnyIO boards (see hostmot2(9) manpage)")
 
+static char *transport[MAX_ETH_BOARDS];
+RTAPI_MP_ARRAY_STRING(transport, MAX_ETH_BOARDS, "packet path for each board: udp (default) or packet");
+
+static int busy_poll = 0;
+RTAPI_MP_INT(busy_poll, "SO_BUSY_POLL time in uS for udp transport sockets, 0 to disable");
+
+static int gang = 0;
+RTAPI_MP_INT(gang, "1 to cycle all boards from the hm2_eth.read and hm2_eth.write functs; the per-board functs are not exported");
+
 int debug = 0;
 RTAPI_MP_INT(debug, "Developer/debug use only!  Enable debug logging.");
 
@@ -110,10 +121,13 @@ static int comp_id;
 
 static hm2_eth_t boards[MAX_ETH_BOARDS];
 
+// in gang mode, the one unconnected socket all boards are cycled over
+static int gang_sockfd = -1;
+
 /// ethernet io functions
 
-static int eth_socket_send(int sockfd, const void *buffer, int len, int flags);
-static int eth_socket_recv(int sockfd, void *buffer, int len, int flags);
+static int eth_socket_send(hm2_eth_t *board, const void *buffer, int len, int flags);
+static int eth_socket_recv(hm2_eth_t *board, void *buffer, int len, int flags);
 
 #define IPTABLES "/sbin/iptables"
 #define CHAIN "hm2-eth-rules-output"
@@ -246,9 +260,19 @@ static int install_iptables_rule(const char *fmt, ...) {
     return -EINVAL;
 }
 
+static int install_iptables_pair(struct sockaddr_in *srcaddr, struct sockaddr_in *dstaddr) {
+    char srchost[16], dsthost[16]; // enough for 255.255.255.255\0
+
+    return install_iptables_rule(
+        "-p udp -m udp -d %s --dport %d -s %s --sport %d -j ACCEPT",
+        inet_ntoa_buf(dstaddr->sin_addr, dsthost, sizeof(dsthost)),
+        ntohs(dstaddr->sin_port),
+        inet_ntoa_buf(srcaddr->sin_addr, srchost, sizeof(srchost)),
+        ntohs(srcaddr->sin_port));
+}
+
 static int install_iptables_board(int sockfd) {
     struct sockaddr_in srcaddr, dstaddr;
-    char srchost[16], dsthost[16]; // enough for 255.255.255.255\0
 
     socklen_t addrlen = sizeof(srcaddr);
     int res = getsockname(sockfd, &srcaddr, &addrlen);
@@ -258,13 +282,7 @@ static int install_iptables_board(int sockfd) {
     res = getpeername(sockfd, &dstaddr, &addrlen);
     if (res < 0) return -errno;
 
-    res = install_iptables_rule(
-        "-p udp -m udp -d %s --dport %d -s %s --sport %d -j ACCEPT",
-        inet_ntoa_buf(dstaddr.sin_addr, dsthost, sizeof(dsthost)),
-        ntohs(dstaddr.sin_port),
-        inet_ntoa_buf(srcaddr.sin_addr, srchost, sizeof(srchost)),
-        ntohs(srcaddr.sin_port));
-    return res;
+    return install_iptables_pair(&srcaddr, &dstaddr);
 }
 
 static int install_iptables_perinterface(const char *ifbuf) {
@@ -289,16 +307,16 @@ static int install_iptables_perinterface(const char *ifbuf) {
     return 0;
 }
 
-static int fetch_hwaddr(const char *board_ip, int sockfd, unsigned char buf[6]) {
+static int fetch_hwaddr(const char *board_ip, hm2_eth_t *board, unsigned char buf[6]) {
     lbp16_cmd_addr packet;
     unsigned char response[6];
     LBP16_INIT_PACKET4(packet, 0x4983, 0x0002);
-    int res = eth_socket_send(sockfd, &packet, sizeof(packet), 0);
+    int res = eth_socket_send(board, &packet, sizeof(packet), 0);
     if (res < 0) return -errno;
 
     int i=0;
     do {
-        res = eth_socket_recv(sockfd, &response, sizeof(response), 0);
+        res = eth_socket_recv(board, &response, sizeof(response), 0);
     } while (++i < 10 && res < 0 && errno == EAGAIN);
     if (res < 0) return -errno;
 
@@ -370,9 +388,21 @@ static void decrement_soft_error(hm2_eth_t *board) {
     *board->hal->packet_error_exceeded = 0;
 }
 
+static bool board_is_loopback(hm2_eth_t *board) {
+    return (ntohl(board->server_addr.sin_addr.s_addr) >> 24) == IN_LOOPBACKNET;
+}
+
 static int init_board(hm2_eth_t *board, const char *board_ip) {
+    const char *tp = transport[board - boards];
     int ret;
 
+    if (tp && *tp && strcmp(tp, "udp") != 0 && strcmp(tp, "packet") != 0) {
+        LL_PRINT("ERROR: %s: unknown transport '%s'\n", board_ip, tp);
+        return -EINVAL;
+    }
+    // everything up to the MAC address fetch needs the UDP socket anyway
+    board->transport = HM2_ETH_TRANSPORT_UDP;
+
     board->sockfd = socket(PF_INET, SOCK_DGRAM, IPPROTO_IP);
     if (board->sockfd < 0) {
         LL_PRINT("ERROR: can't open socket: %s\n", strerror(errno));
@@ -415,6 +445,13 @@ static int init_board(hm2_eth_t *board, const char *board_ip) {
         return -errno;
     }
 
+    // poll the NIC queue from recv() instead of waiting for the interrupt
+    if (busy_poll > 0) {
+        ret = setsockopt(board->sockfd, SOL_SOCKET, SO_BUSY_POLL, &busy_poll, sizeof(busy_poll));
+        if (ret < 0)
+            LL_PRINT("WARNING: %s: can't set SO_BUSY_POLL: %s\n", board_ip, strerror(errno));
+    }
+
     // Manually create an ARP entry over to the mesa board so the IP stack doesn't need to
     // figure that out.
 
@@ -427,17 +464,23 @@ static int init_board(hm2_eth_t *board, const char *board_ip) {
 
     board->req.arp_ha.sa_family = AF_LOCAL;
     board->req.arp_flags = ATF_PERM | ATF_COM;
-    ret = fetch_hwaddr( board_ip, board->sockfd, (void*)&board->req.arp_ha.sa_data );
+    ret = fetch_hwaddr( board_ip, board, (void*)&board->req.arp_ha.sa_data );
     if (ret < 0) {
         LL_PRINT("ERROR: %s: Could not retrieve mac address\n", board_ip);
         return ret;
     }
 
-    ret = ioctl(board->sockfd, SIOCSARP, &board->req);
-    if (ret < 0) {
-        LL_PRINT("ERROR: ioctl SIOCSARP failed: %s\n", strerror(errno));
+    // there is no ARP on the loopback interface, where the board is
+    // usually a hm2_eth_emu stand-in
+    if (board_is_loopback(board)) {
         board->req.arp_flags &= ~ATF_PERM;
-        return -errno;
+    } else {
+        ret = ioctl(board->sockfd, SIOCSARP, &board->req);
+        if (ret < 0) {
+            LL_PRINT("ERROR: ioctl SIOCSARP failed: %s\n", strerror(errno));
+            board->req.arp_flags &= ~ATF_PERM;
+            return -errno;
+        }
     }
 
     // Setup firewall rules
@@ -448,6 +491,17 @@ static int init_board(hm2_eth_t *board, const char *board_ip) {
         if (ret < 0) return ret;
     }
 
+    if (tp && strcmp(tp, "packet") == 0 && gang) {
+        LL_PRINT("WARNING: %s: packet transport is not used in gang mode\n", board_ip);
+    } else if (tp && strcmp(tp, "packet") == 0) {
+        char ifbuf[64];
+        char *ifptr = fetch_ifname(board->sockfd, ifbuf, sizeof(ifbuf));
+        if (ifptr && hm2_eth_packet_open(board, ifptr, (void*)&board->req.arp_ha.sa_data) == 0)
+            board->transport = HM2_ETH_TRANSPORT_PACKET;
+        else
+            LL_PRINT("WARNING: %s: packet transport unavailable, using udp\n", board_ip);
+    }
+
     board->write_packet_ptr = board->write_packet;
     board->read_packet_ptr = board->read_packet;
 
@@ -459,6 +513,10 @@ static int close_board(hm2_eth_t *board) {
     if (board->sockfd != -1) {
         if (use_iptables()) clear_iptables();
 
+        if (board->transport == HM2_ETH_TRANSPORT_PACKET)
+            hm2_eth_packet_close(board);
+        board->transport = HM2_ETH_TRANSPORT_UDP;
+
         if (board->req.arp_flags & ATF_PERM) {
             ret = ioctl(board->sockfd, SIOCDARP, &board->req);
             if (ret < 0) perror("ioctl SIOCDARP");
@@ -477,22 +535,34 @@ static int close_board(hm2_eth_t *board) {
     return ret;
 }
 
-static int eth_socket_send(int sockfd, const void *buffer, int len, int flags) {
-    return send(sockfd, buffer, len, flags);
+static int eth_socket_send(hm2_eth_t *board, const void *buffer, int len, int flags) {
+    int result;
+    if (board->transport == HM2_ETH_TRANSPORT_PACKET)
+        result = hm2_eth_packet_send(board, buffer, len);
+    else
+        result = send(board->sockfd, buffer, len, flags);
+    RTAPI_TRACE3(hm2_eth_send, board->sockfd, len, result);
+    return result;
 }
 
-static int eth_socket_recv(int sockfd, void *buffer, int len, int flags) {
-    return recv(sockfd, buffer, len, flags);
+static int eth_socket_recv(hm2_eth_t *board, void *buffer, int len, int flags) {
+    int result;
+    if (board->transport == HM2_ETH_TRANSPORT_PACKET)
+        result = hm2_eth_packet_recv(board, buffer, len, RECV_TIMEOUT_US * 1000);
+    else
+        result = recv(board->sockfd, buffer, len, flags);
+    RTAPI_TRACE3(hm2_eth_recv, board->sockfd, len, result);
+    return result;
 }
 
-static int eth_socket_recv_loop(int sockfd, void *buffer, int len, int flags, long timeout_ns) {
+static int eth_socket_recv_loop(hm2_eth_t *board, void *buffer, int len, int flags, long timeout_ns) {
     // Seems like this should be using rtapi_get_time() and not rtapi_get_clocks()
     // since the timeout is specified in nanos.
     // Changed it.
     long long end = rtapi_get_time() + timeout_ns;
     int result;
     do {
-        result = eth_socket_recv(sockfd, buffer, len, flags);
+        result = eth_socket_recv(board, buffer, len, flags);
     } while (result < 0 && rtapi_get_time() < end);
     return result;
 }
@@ -527,7 +597,7 @@ static int hm2_eth_read(hm2_lowlevel_io_t *this, u32 addr, void *buffer, int siz
 
     LBP16_INIT_PACKET4(read_packet, CMD_READ_HOSTMOT2_ADDR32_INCR(size/4), addr & 0xFFFF);
 
-    send = eth_socket_send(board->sockfd, (void*) &read_packet, sizeof(read_packet), 0);
+    send = eth_socket_send(board, (void*) &read_packet, sizeof(read_packet), 0);
     if (send < 0) {
         LL_PRINT("ERROR: sending packet: %s\n", strerror(errno));
         if (record_soft_error(board))
@@ -546,7 +616,7 @@ static int hm2_eth_read(hm2_lowlevel_io_t *this, u32 addr, void *buffer, int siz
         // This will block for up to RECV_TIMEOUT_US - which is 100,000 nanoseconds.
         // The hard coded timeout deadline below is 200,000,000 nanoseconds or 200 milliseconds.
         // An immense amount of time, not sure why that was picked...
-        recv = eth_socket_recv(board->sockfd, (void*) &tmp_buffer, size, 0);
+        recv = eth_socket_recv(board, (void*) &tmp_buffer, size, 0);
 
         t2 = rtapi_get_time();
 
@@ -624,7 +694,14 @@ static int hm2_eth_send_queued_reads(hm2_lowlevel_io_t *this) {
         board->read_entry_count++;
         board->total_read_buffer_size += 8;
 
-        send = eth_socket_send(board->sockfd, (void*) &board->read_packet, board->read_packet_ptr - board->read_packet, 0);
+        if (gang_sockfd >= 0) {
+            // hm2_eth_gang_read() sends it along with the other boards'
+            board->gang_read_len = board->read_packet_ptr - board->read_packet;
+            board->gang_received = false;
+            return 1;
+        }
+
+        send = eth_socket_send(board, (void*) &board->read_packet, board->read_packet_ptr - board->read_packet, 0);
         if (send < 0) {
             LL_PRINT("ERROR: sending packet: %s\n", strerror(errno));
             if (record_soft_error(board))
@@ -641,23 +718,7 @@ static int hm2_eth_send_queued_reads(hm2_lowlevel_io_t *this) {
 }
 
 
-// Returns 0 on failure, !0 on success
-static int hm2_eth_receive_queued_reads(hm2_lowlevel_io_t *this) {
-    hm2_eth_t *board = this->private;
-    int recv, attempts = 0;
-    u8 tmp_buffer[board->total_read_buffer_size];
-    long long t1, t2, before_recv_time;
-    long int deltat;
-    t1 = rtapi_get_time();
-
-    // an error occurred in the past but the user has reset the io_error
-    // pin (or they did something else like fiddle with the error limit
-    // during a run, in which case we don't care if we reset the counter
-    // or not)
-    if(board->hal && board->comm_error_counter == *board->hal->packet_error_limit && !*board->llio.io_error) {
-        board->comm_error_counter = 0;
-    }
-
+static long read_timeout_ns(hm2_eth_t *board) {
     // So llio.period is documented to be the period (in ns) of the last read-request invocation
     // unsigned long period;
     // It is really the period argument passed into the .read function on the servo thread.
@@ -677,6 +738,71 @@ static int hm2_eth_receive_queued_reads(hm2_lowlevel_io_t *this) {
     if (read_timeout < 100000)
         read_timeout = 100000;
 
+    return read_timeout;
+}
+
+// Now that we have the data, copy it from the receive buffer to the final destinations that we tracked using
+// the array of hm2_read_entry_t structs.
+static void scatter_reply(hm2_eth_t *board, const u8 *reply) {
+    int ii;
+    for (ii = 0; ii < board->read_entry_count; ii++) {
+        memcpy(board->read_entries[ii].buffer, &reply[board->read_entries[ii].received_data_offset], board->read_entries[ii].size);
+    }
+}
+
+// empty the read queue and account for the outcome of the cycle
+static int finish_queued_reads(hm2_eth_t *board, bool received) {
+    board->read_packet_ptr = board->read_packet;
+    board->read_entry_count = 0;
+    board->total_read_buffer_size = 0;
+
+    if (!received) {
+        if (record_soft_error(board))
+            return -EAGAIN;
+        else
+            return 0;
+    }
+
+    int result = 1;
+
+    if (board->hal) {
+        // (this means that one in 2^32 lost writes will not be diagnosed,
+        // each time board->write_cnt overflows)
+        if (board->write_cnt && board->write_cnt != board->confirm_write_cnt) {
+            LL_PRINT("write_cnt: %x   confirm_write_cnt: %x\n", board->write_cnt, board->confirm_write_cnt)
+            if (record_soft_error(board))
+                result = -EAGAIN;
+            else
+                result = 0;
+        } else {
+            decrement_soft_error(board);
+        }
+    }
+    return result;
+}
+
+// Returns 0 on failure, !0 on success
+static int hm2_eth_receive_queued_reads(hm2_lowlevel_io_t *this) {
+    hm2_eth_t *board = this->private;
+    int recv, attempts = 0;
+    long long t1, t2, before_recv_time;
+    long int deltat;
+    t1 = rtapi_get_time();
+
+    // an error occurred in the past but the user has reset the io_error
+    // pin (or they did something else like fiddle with the error limit
+    // during a run, in which case we don't care if we reset the counter
+    // or not)
+    if(board->hal && board->comm_error_counter == *board->hal->packet_error_limit && !*board->llio.io_error) {
+        board->comm_error_counter = 0;
+    }
+
+    // the reply, if any, was already collected by hm2_eth_gang_read()
+    if (gang_sockfd >= 0)
+        return finish_queued_reads(board, board->gang_received);
+
+    u8 tmp_buffer[board->total_read_buffer_size];
+    long read_timeout = read_timeout_ns(board);
     LL_PRINT_IF(debug, "read timeout %li\n", read_timeout);
 
     if (!board->hal) this->read_time = t1;
@@ -688,7 +814,7 @@ do_recv_packet:
         // of the timeout above anyway.  And we pulled out the rtapi_delay thing which was really just
         // a busy wait since it had no discernable benefit.
         errno = 0;
-        recv = eth_socket_recv(board->sockfd, (void*) &tmp_buffer, board->total_read_buffer_size, 0);
+        recv = eth_socket_recv(board, (void*) &tmp_buffer, board->total_read_buffer_size, 0);
         t2 = rtapi_get_time();
 
         // Capture the max time we are ever stuck inside recv calls
@@ -706,23 +832,12 @@ do_recv_packet:
 
     if (recv != board->total_read_buffer_size) {
         // We must have timed out
-        board->read_packet_ptr = board->read_packet;
-        board->read_entry_count = 0;
-        board->total_read_buffer_size = 0;
-        if (record_soft_error(board))
-            return -EAGAIN;
-        else
-            return 0;
+        return finish_queued_reads(board, false);
     }
 
     LL_PRINT_IF(debug, "enqueue_read(%d) : PACKET RECV [SIZE: %d | TRIES: %d | TIME: %llu]\n", board->read_cnt, recv, attempts, t2 - t1);
 
-    // Now that we have the data, copy it from the local stack buffer to the final destinations that we tracked using
-    // the array of hm2_read_entry_t structs.
-    int ii;
-    for (ii = 0; ii < board->read_entry_count; ii++) {
-        memcpy(board->read_entries[ii].buffer, &tmp_buffer[board->read_entries[ii].received_data_offset], board->read_entries[ii].size);
-    }
+    scatter_reply(board, tmp_buffer);
 
     // This appears to be a "do-over" because the UDP packet "sequence" number wasn't what we wanted
     // and there is more time left to read.
@@ -733,25 +848,7 @@ do_recv_packet:
         goto do_recv_packet;
     }
 
-    board->read_packet_ptr = board->read_packet;
-    board->read_entry_count = 0;
-    board->total_read_buffer_size = 0;
-
-    int result = 1;
-
-    if (board->hal) {
-        // (this means that one in 2^32 lost writes will not be diagnosed,
-        // each time board->write_cnt overflows)
-        if (board->write_cnt && board->write_cnt != board->confirm_write_cnt) {
-            LL_PRINT("write_cnt: %x   confirm_write_cnt: %x\n", board->write_cnt, board->confirm_write_cnt)
-            if (record_soft_error(board))
-                result = -EAGAIN;
-            else
-                result = 0;
-        } else {
-            decrement_soft_error(board);
-        }
-    }
+    int result = finish_queued_reads(board, true);
 
     // Capture the max time we ever spend inside hm2_eth_receive_queued_reads()
     deltat = (long int) (rtapi_get_time() - t1);
@@ -810,7 +907,7 @@ static int hm2_eth_write(hm2_lowlevel_io_t *this, u32 addr, const void *buffer,
     memcpy(packet.tmp_buffer, buffer, size);
     LBP16_INIT_PACKET4(packet.wr_packet, CMD_WRITE_HOSTMOT2_ADDR32_INCR(size/4), addr & 0xFFFF);
 
-    send = eth_socket_send(board->sockfd, (void*) &packet, sizeof(lbp16_cmd_addr) + size, 0);
+    send = eth_socket_send(board, (void*) &packet, sizeof(lbp16_cmd_addr) + size, 0);
     if (send < 0) {
         LL_PRINT("ERROR: sending packet: %s\n", strerror(errno));
         record_soft_error(board);
@@ -843,8 +940,16 @@ static int hm2_eth_send_queued_writes(hm2_lowlevel_io_t *this) {
         board->write_packet_ptr += 4;
         board->write_packet_size += (sizeof(*packet) + 4);
 
+        if (gang_sockfd >= 0) {
+            // hm2_eth_gang_write() sends it along with the other boards'
+            board->gang_write_len = board->write_packet_size;
+            board->write_packet_ptr = board->write_packet;
+            board->write_packet_size = 0;
+            return 1;
+        }
+
         t0 = rtapi_get_time();
-        send = eth_socket_send(board->sockfd, (void*) &board->write_packet, board->write_packet_size, 0);
+        send = eth_socket_send(board, (void*) &board->write_packet, board->write_packet_size, 0);
         if (send < 0) {
             LL_PRINT("ERROR: sending packet: %s\n", strerror(errno));
             record_soft_error(board);
@@ -921,12 +1026,12 @@ static int hm2_eth_probe(hm2_eth_t *board) {
     char llio_name[16] = {0, };
 
     LBP16_INIT_PACKET4(read_packet, CMD_READ_BOARD_INFO_ADDR16_INCR(16/2), 0);
-    send = eth_socket_send(board->sockfd, (void*) &read_packet, sizeof(read_packet), 0);
+    send = eth_socket_send(board, (void*) &read_packet, sizeof(read_packet), 0);
     if (send < 0) {
         LL_PRINT("ERROR: sending packet: %s\n", strerror(errno));
         return -errno;
     }
-    recv = eth_socket_recv_loop(board->sockfd, (void*) &board_name, 16, 0,
+    recv = eth_socket_recv_loop(board, (void*) &board_name, 16, 0,
                 200 * 1000 * 1000);
     if (recv < 0) {
         LL_PRINT("ERROR: receiving packet: %s\n", strerror(errno));
@@ -936,6 +1041,8 @@ static int hm2_eth_probe(hm2_eth_t *board) {
     board = &boards[boards_count];
     board->llio.private = board;
     board->llio.split_read = true;
+    // gang mode: the board only takes part in the hm2_eth.read/write cycle
+    board->llio.no_functs = gang;
 
     if (strncmp(board_name, "7I80DB-16", 9) == 0) {
         strncpy(llio_name, board_name, 4);
@@ -1167,6 +1274,233 @@ static int hm2_eth_items(hm2_eth_t *board) {
     return 0;
 }
 
+//
+// gang mode: one read and one write funct for all boards, so the packets
+// of all boards are on the wire at the same time and the thread waits for
+// the slowest reply only once instead of once per board
+//
+
+#define GANG_VLEN (2 * MAX_ETH_BOARDS)     // room for stale replies
+
+static hm2_eth_t *gang_board(const struct sockaddr_in *from) {
+    int i;
+    for (i = 0; i < boards_count; i++) {
+        if (boards[i].server_addr.sin_addr.s_addr == from->sin_addr.s_addr &&
+            boards[i].server_addr.sin_port == from->sin_port)
+            return &boards[i];
+    }
+    return NULL;
+}
+
+static int hm2_eth_gang_read(void *arg, const hal_funct_args_t *fa) {
+    static struct mmsghdr msgs[GANG_VLEN];
+    static struct iovec iovs[GANG_VLEN];
+    static struct sockaddr_in from[GANG_VLEN];
+    static u8 replies[GANG_VLEN][1400];
+    long long t1, t2, deadline = 0;
+    int i, n = 0, sent, pending, attempts = 0;
+
+    for (i = 0; i < boards_count; i++) {
+        hm2_eth_t *board = &boards[i];
+        board->gang_read_len = 0;
+        board->gang_received = false;
+        hm2_llio_read_request(&board->llio, fa);
+        if (board->gang_read_len == 0) continue;   // in io_error
+
+        iovs[n].iov_base = board->read_packet;
+        iovs[n].iov_len = board->gang_read_len;
+        memset(&msgs[n].msg_hdr, 0, sizeof(msgs[n].msg_hdr));
+        msgs[n].msg_hdr.msg_name = &board->server_addr;
+        msgs[n].msg_hdr.msg_namelen = sizeof(board->server_addr);
+        msgs[n].msg_hdr.msg_iov = &iovs[n];
+        msgs[n].msg_hdr.msg_iovlen = 1;
+        n++;
+    }
+
+    sent = n ? sendmmsg(gang_sockfd, msgs, n, 0) : 0;
+    RTAPI_TRACE3(hm2_eth_send, gang_sockfd, n, sent);
+    if (sent < 0) {
+        LL_PRINT("ERROR: sending packets: %s\n", strerror(errno));
+        sent = 0;
+    }
+
+    // the boards whose request did not go out are left unreceived, which
+    // their read funct counts as a soft error
+    for (i = 0, n = 0, pending = 0; i < boards_count; i++) {
+        hm2_eth_t *board = &boards[i];
+        if (board->gang_read_len == 0) continue;
+        if (n++ >= sent) {
+            board->gang_read_len = 0;
+            continue;
+        }
+        long long board_deadline = board->llio.read_time + read_timeout_ns(board);
+        if (board_deadline > deadline) deadline = board_deadline;
+        pending++;
+    }
+
+    for (i = 0; i < GANG_VLEN; i++) {
+        iovs[i].iov_base = replies[i];
+        iovs[i].iov_len = sizeof(replies[i]);
+        msgs[i].msg_hdr.msg_name = &from[i];
+        msgs[i].msg_hdr.msg_iov = &iovs[i];
+        msgs[i].msg_hdr.msg_iovlen = 1;
+    }
+
+    t1 = t2 = rtapi_get_time();
+    while (pending && t2 < deadline) {
+        for (i = 0; i < GANG_VLEN; i++)
+            msgs[i].msg_hdr.msg_namelen = sizeof(from[i]);
+        n = recvmmsg(gang_sockfd, msgs, GANG_VLEN, MSG_DONTWAIT, NULL);
+        RTAPI_TRACE3(hm2_eth_recv, gang_sockfd, GANG_VLEN, n);
+        attempts++;
+
+        for (i = 0; i < n; i++) {
+            hm2_eth_t *board = gang_board(&from[i]);
+            if (!board || board->gang_read_len == 0 || board->gang_received) continue;
+            if ((int)msgs[i].msg_len != board->total_read_buffer_size) continue;
+
+            scatter_reply(board, replies[i]);
+            // a late reply to an earlier request, keep waiting
+            if (board->confirm_read_cnt != board->read_cnt) {
+                *board->hal->packet_wrong_seq += 1;
+                continue;
+            }
+            board->gang_received = true;
+            pending--;
+        }
+
+        t2 = rtapi_get_time();
+        if (pending && n <= 0 && t2 < deadline) {
+            long long wait = deadline - t2;
+            if (wait > RECV_TIMEOUT_US * 1000) wait = RECV_TIMEOUT_US * 1000;
+            struct timespec ts = { 0, wait };
+            struct pollfd pfd = { gang_sockfd, POLLIN, 0 };
+            ppoll(&pfd, 1, &ts, NULL);
+            t2 = rtapi_get_time();
+        }
+    }
+
+    for (i = 0; i < boards_count; i++) {
+        hm2_eth_t *board = &boards[i];
+        if (board->gang_read_len) {
+            long int deltat = (long int)(t2 - t1);
+            if (*board->hal->packet_recv_tmax < deltat)
+                *board->hal->packet_recv_tmax = deltat;
+            if (*board->hal->packet_recv_attempts < attempts)
+                *board->hal->packet_recv_attempts = attempts;
+            if (*board->hal->packet_read_tmax < (long int)(t2 - board->llio.read_time))
+                *board->hal->packet_read_tmax = (long int)(t2 - board->llio.read_time);
+        }
+        hm2_llio_read(&board->llio, fa);
+    }
+    return 0;
+}
+
+static int hm2_eth_gang_write(void *arg, const hal_funct_args_t *fa) {
+    static struct mmsghdr msgs[MAX_ETH_BOARDS];
+    static struct iovec iovs[MAX_ETH_BOARDS];
+    int i, n = 0, sent;
+
+    for (i = 0; i < boards_count; i++) {
+        hm2_eth_t *board = &boards[i];
+        board->gang_write_len = 0;
+        hm2_llio_write(&board->llio, fa);
+        if (board->gang_write_len == 0) continue;
+
+        iovs[n].iov_base = board->write_packet;
+        iovs[n].iov_len = board->gang_write_len;
+        memset(&msgs[n].msg_hdr, 0, sizeof(msgs[n].msg_hdr));
+        msgs[n].msg_hdr.msg_name = &board->server_addr;
+        msgs[n].msg_hdr.msg_namelen = sizeof(board->server_addr);
+        msgs[n].msg_hdr.msg_iov = &iovs[n];
+        msgs[n].msg_hdr.msg_iovlen = 1;
+        n++;
+    }
+    if (n == 0) return 0;
+
+    sent = sendmmsg(gang_sockfd, msgs, n, 0);
+    RTAPI_TRACE3(hm2_eth_send, gang_sockfd, n, sent);
+    if (sent < 0) {
+        LL_PRINT("ERROR: sending packets: %s\n", strerror(errno));
+        sent = 0;
+    }
+    for (i = 0, n = 0; i < boards_count; i++) {
+        if (boards[i].gang_write_len && n++ >= sent)
+            record_soft_error(&boards[i]);
+    }
+    return 0;
+}
+
+static int init_gang(void) {
+    struct sockaddr_in gang_addr;
+    socklen_t addrlen = sizeof(gang_addr);
+    int i, ret;
+
+    int fd = socket(PF_INET, SOCK_DGRAM, IPPROTO_IP);
+    if (fd < 0) {
+        LL_PRINT("ERROR: can't open gang socket: %s\n", strerror(errno));
+        return -errno;
+    }
+    memset(&gang_addr, 0, sizeof(gang_addr));
+    gang_addr.sin_family = AF_INET;
+    gang_addr.sin_addr.s_addr = INADDR_ANY;
+    if (bind(fd, (struct sockaddr *) &gang_addr, sizeof(gang_addr)) < 0 ||
+        getsockname(fd, (struct sockaddr *) &gang_addr, &addrlen) < 0) {
+        LL_PRINT("ERROR: can't bind gang socket: %s\n", strerror(errno));
+        close(fd);
+        return -errno;
+    }
+
+    struct timeval timeout;
+    timeout.tv_sec = 0;
+    timeout.tv_usec = SEND_TIMEOUT_US;
+    setsockopt(fd, SOL_SOCKET, SO_SNDTIMEO, (char *)&timeout, sizeof(timeout));
+    if (busy_poll > 0 &&
+        setsockopt(fd, SOL_SOCKET, SO_BUSY_POLL, &busy_poll, sizeof(busy_poll)) < 0)
+        LL_PRINT("WARNING: can't set SO_BUSY_POLL on gang socket: %s\n", strerror(errno));
+
+    // same firewall hole as each board's own socket, from the gang port
+    for (i = 0; use_iptables() && i < boards_count; i++) {
+        struct sockaddr_in srcaddr;
+        addrlen = sizeof(srcaddr);
+        if (getsockname(boards[i].sockfd, (struct sockaddr *) &srcaddr, &addrlen) < 0) {
+            ret = -errno;
+            close(fd);
+            return ret;
+        }
+        srcaddr.sin_port = gang_addr.sin_port;
+        ret = install_iptables_pair(&srcaddr, &boards[i].server_addr);
+        if (ret < 0) {
+            close(fd);
+            return ret;
+        }
+    }
+
+    hal_export_xfunct_args_t read_args = {
+        .type = FS_XTHREADFUNC,
+        .funct.x = hm2_eth_gang_read,
+        .arg = NULL,
+        .uses_fp = 1,
+        .reentrant = 0,
+        .owner_id = comp_id
+    };
+    hal_export_xfunct_args_t write_args = read_args;
+    write_args.funct.x = hm2_eth_gang_write;
+
+    if ((ret = hal_export_xfunctf(&read_args, HM2_LLIO_NAME ".read")) != 0 ||
+        (ret = hal_export_xfunctf(&write_args, HM2_LLIO_NAME ".write")) != 0) {
+        LL_PRINT("ERROR: can't export gang functs: %d\n", ret);
+        close(fd);
+        return ret;
+    }
+
+    gang_sockfd = fd;
+    LL_PRINT("gang mode: %d boards on port %d, use the "
+             HM2_LLIO_NAME ".read and " HM2_LLIO_NAME ".write functs\n",
+             boards_count, ntohs(gang_addr.sin_port));
+    return 0;
+}
+
 int rtapi_app_main(void) {
     INIT_LIST_HEAD(&ifnames);
     INIT_LIST_HEAD(&board_num);
@@ -1206,6 +1540,13 @@ int rtapi_app_main(void) {
             goto error1;
     }
 
+    // before the per-interface REJECT rules, which would shadow its ACCEPTs
+    if (gang) {
+        ret = init_gang();
+        if (ret < 0)
+            goto error1;
+    }
+
     for (i = 0; i<num_boards; i++) {
         char ifbuf[64]; // more than enough for eth0
         char *ifptr = fetch_ifname(boards[i].sockfd, ifbuf, sizeof(ifbuf));
@@ -1214,6 +1555,8 @@ int rtapi_app_main(void) {
             continue;
         }
         boards[i].read_cnt = boards[i].write_cnt = 0;
+        // rejecting all other traffic on 'lo' would break the host
+        if (board_is_loopback(&boards[i])) continue;
         int *added = kvlist_lookup(&ifnames, ifptr);
         if (*added) continue;
         install_iptables_perinterface(ifptr);
@@ -1246,6 +1589,10 @@ error0:
 void rtapi_app_exit(void) {
     int i;
     comm_active = 0;
+    if (gang_sockfd >= 0) {
+        close(gang_sockfd);
+        gang_sockfd = -1;
+    }
     for (i = 0; i<MAX_ETH_BOARDS && board_ip[i] && board_ip[i][0]; i++)
         close_board(&boards[i]);
 
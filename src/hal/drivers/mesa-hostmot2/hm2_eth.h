@@ -29,6 +29,14 @@
 
 #define MAX_ETH_READS 64
 
+// how LBP16 packets reach the board, selected per board with the
+// 'transport' module parameter
+#define HM2_ETH_TRANSPORT_UDP       0   // connected UDP socket
+#define HM2_ETH_TRANSPORT_PACKET    1   // AF_PACKET, see hm2_eth_packet.c
+
+// Ethernet + IPv4 + UDP headers in front of the LBP16 payload
+#define HM2_ETH_PACKET_HDR_SIZE (14 + 20 + 8)
+
 // These are descriptors that keep track of the outstanding async read.
 typedef struct {
     void *buffer;
@@ -50,9 +58,22 @@ typedef struct {
   hal_s32_t *packet_recv_attempts;
 } hm2_eth_global_t;
 
+typedef struct {
+    int fd;
+    u8 *ring;               // mmap()ed TPACKET_V2 receive ring
+    size_t ring_size;
+    unsigned frame_size, frame_nr, frame;
+    u16 ip_id;
+    // prebuilt headers, only lengths, IP id and checksum change per packet
+    u8 tx[HM2_ETH_PACKET_HDR_SIZE + 1400 + 128];
+} hm2_eth_packet_t;
+
 typedef struct {
     hm2_lowlevel_io_t llio;
 
+    int transport;
+    hm2_eth_packet_t packet;
+
     int sockfd;
     struct sockaddr_in local_addr;
     struct sockaddr_in server_addr;
@@ -73,6 +94,11 @@ typedef struct {
     // read-request
     uint32_t confirm_read_cnt, confirm_write_cnt;
 
+    // gang mode (the 'gang' module parameter): queued packets are only
+    // staged here, hm2_eth.read and hm2_eth.write move them for all boards
+    int gang_read_len, gang_write_len;
+    bool gang_received;
+
     int comm_error_counter;
     uint16_t old_rxudpcount, rxudpcount;
     struct arpreq req;
@@ -80,4 +106,9 @@ typedef struct {
     hm2_eth_global_t *hal;
 } hm2_eth_t;
 
+int hm2_eth_packet_open(hm2_eth_t *board, const char *ifname, const unsigned char board_hwaddr[6]);
+void hm2_eth_packet_close(hm2_eth_t *board);
+int hm2_eth_packet_send(hm2_eth_t *board, const void *buffer, int len);
+int hm2_eth_packet_recv(hm2_eth_t *board, void *buffer, int len, long timeout_ns);
+
 #endif
@@ -0,0 +1,543 @@
+/*    This is a component of Machinekit
+ *    Copyright 2026 Machinekit HAL developers
+ *
+ *    This program is free software; you can redistribute it and/or modify
+ *    it under the terms of the GNU General Public License as published by
+ *    the Free Software Foundation; either version 2 of the License, or
+ *    (at your option) any later version.
+ *
+ *    This program is distributed in the hope that it will be useful,
+ *    but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *    GNU General Public License for more details.
+ *
+ *    You should have received a copy of the GNU General Public License
+ *    along with this program; if not, write to the Free Software
+ *    Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ */
+
+// hm2_eth_emu - userspace stand-in for a Mesa ethernet AnyIO board
+//
+// Answers LBP16 over UDP like the board firmware does, so hm2_eth can be
+// loaded, exercised and benchmarked without hardware:
+//
+//     hm2_eth_emu -a 127.0.0.1 -m encoder=4,stepgen=4,pwmgen=2 &
+//     halcmd loadrt hostmot2
+//     halcmd loadrt hm2_eth board_ip=127.0.0.1
+//
+// or, to go through a network device (and to use hm2_eth's packet
+// transport), on one end of a veth pair whose other end is in a separate
+// network namespace, so the traffic does not take the local route:
+//
+//     ip netns add hm2
+//     ip link add hm2a type veth peer name hm2b netns hm2
+//     ip addr add 10.10.10.1/24 dev hm2a; ip link set hm2a up
+//     ip netns exec hm2 ip addr add 10.10.10.10/24 dev hm2b
+//     ip netns exec hm2 ip link set hm2b up
+//     ip netns exec hm2 hm2_eth_emu -a 10.10.10.10
+//     ... board_ip=10.10.10.10
+//
+// The HostMot2 register space holds an IDROM describing the board's
+// IOPorts, a watchdog and the modules given with -m; all registers
+// behave as plain memory.  The memory spaces hm2_eth uses besides that
+// (ethernet EEPROM MAC address, board name, timer scratch registers and
+// the received packet count in the communication control space) are
+// filled in as the firmware does.
+//
+// Replies can be delayed (-l, -j), dropped (-L, -T) and reordered (-r)
+// to exercise hm2_eth's timeout, retry and sequence checking paths.
+
+#define _GNU_SOURCE     // ppoll()
+#include <errno.h>
+#include <getopt.h>
+#include <poll.h>
+#include <signal.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+#include <arpa/inet.h>
+#include <ifaddrs.h>
+#include <net/if.h>
+#include <netinet/in.h>
+#include <sys/ioctl.h>
+#include <sys/prctl.h>
+#include <sys/socket.h>
+
+typedef uint8_t u8;
+typedef uint16_t u16;
+typedef uint32_t u32;
+#include "lbp16.h"
+
+// see hostmot2.h
+#define HM2_ADDR_IOCOOKIE       0x0100
+#define HM2_ADDR_CONFIGNAME     0x0104
+#define HM2_ADDR_IDROM_OFFSET   0x010C
+#define HM2_IOCOOKIE            0x55AACAFE
+
+#define IDROM_ADDR      0x0400
+#define MD_ADDR         (IDROM_ADDR + 0x40)
+#define PD_ADDR         (IDROM_ADDR + 0x200)
+#define MAX_MDS         32
+
+#define SPACE_SIZE      0x10000
+#define MAX_PACKET      1500
+#define MAX_PENDING     256
+
+typedef struct {
+    const char *name;
+    u8 gtag;
+    u8 version;
+    u8 clock_tag;       // 1 = ClockLow, 2 = ClockHigh
+    u8 num_registers;
+    uint16_t base;
+    uint32_t multiple_registers;
+    int max_instances;
+} module_t;
+
+// only versions hostmot2 accepts without complaint, all with
+// InstanceStride0 (4) and RegisterStride0 (0x100)
+static const module_t modules[] = {
+    { "watchdog",   2,   0, 1,  3, 0x0C00, 0x0000,   1 },
+    { "ioport",     3,   0, 1,  5, 0x1000, 0x001F,  -1 },
+    { "stepgen",    5,   2, 1, 10, 0x2000, 0x01FF,  32 },
+    { "encoder",    4,   2, 1,  5, 0x3000, 0x0003,  32 },
+    { "pwmgen",     6,   0, 2,  5, 0x4000, 0x0003,  32 },
+    { "led",      128,   0, 1,  1, 0x0200, 0x0000,   1 },
+    { NULL },
+};
+
+typedef struct {
+    const char *name;
+    int io_ports;
+    int port_width;
+} board_t;
+
+// names hm2_eth_probe() knows the connector layout of
+static const board_t boards[] = {
+    { "7I92",       2, 17 },
+    { "7I80DB-16",  4, 17 },
+    { "7I80DB-25",  4, 17 },
+    { "7I80HD-16",  3, 24 },
+    { "7I80HD-25",  3, 24 },
+    { "7I76E-16",   3, 17 },
+    { "ECM1",       5, 13 },
+    { NULL },
+};
+
+typedef struct {
+    long long due;
+    struct sockaddr_in peer;
+    int len;
+    u8 data[MAX_PACKET];
+} pending_t;
+
+static u8 space[LBP16_MEM_SPACE_COUNT][SPACE_SIZE];
+static uint16_t space_addr[LBP16_MEM_SPACE_COUNT];
+
+static pending_t pending[MAX_PENDING];
+static int num_pending;
+
+static struct {
+    long latency_us, jitter_us, reorder_us;
+    double loss_rx, loss_tx, reorder;
+    int verbose;
+} opt = { .reorder_us = 500 };
+
+static struct {
+    unsigned long rx, tx, dropped_rx, dropped_tx, reordered, bad, overflow;
+    long long busy_ns;
+} stats;
+
+static volatile sig_atomic_t done;
+
+static void quit(int sig) {
+    done = 1;
+}
+
+static long long now_ns(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec * 1000000000LL + ts.tv_nsec;
+}
+
+static int chance(double pct) {
+    return pct > 0 && drand48() * 100.0 < pct;
+}
+
+static void put32(int sp, unsigned addr, uint32_t v) {
+    int i;
+    for (i = 0; i < 4; i++)
+        space[sp][(addr + i) & 0xFFFF] = v >> (8 * i);
+}
+
+static void put16(int sp, unsigned addr, uint16_t v) {
+    space[sp][addr & 0xFFFF] = v;
+    space[sp][(addr + 1) & 0xFFFF] = v >> 8;
+}
+
+static const board_t *find_board(const char *name) {
+    const board_t *b;
+    for (b = boards; b->name; b++)
+        if (strcmp(b->name, name) == 0) return b;
+    return NULL;
+}
+
+static const module_t *find_module(const char *name) {
+    const module_t *m;
+    for (m = modules; m->name; m++)
+        if (strcmp(m->name, name) == 0) return m;
+    return NULL;
+}
+
+static int add_md(int md, const module_t *m, int instances) {
+    if (md >= MAX_MDS) {
+        fprintf(stderr, "hm2_eth_emu: too many modules\n");
+        exit(1);
+    }
+    unsigned addr = MD_ADDR + md * 12;
+    put32(0, addr, m->gtag | (m->version << 8) | (m->clock_tag << 16) | (instances << 24));
+    put32(0, addr + 4, m->base | (m->num_registers << 16));
+    put32(0, addr + 8, m->multiple_registers);
+    return md + 1;
+}
+
+// -m encoder=4,stepgen=2,...
+static void build_idrom(const board_t *b, char *spec) {
+    int md = 0, i;
+
+    put32(0, HM2_ADDR_IOCOOKIE, HM2_IOCOOKIE);
+    memcpy(&space[0][HM2_ADDR_CONFIGNAME], "HOSTMOT2", 8);
+    put32(0, HM2_ADDR_IDROM_OFFSET, IDROM_ADDR);
+
+    put32(0, IDROM_ADDR + 0x00, 3);                     // IDROM type
+    put32(0, IDROM_ADDR + 0x04, MD_ADDR - IDROM_ADDR);
+    put32(0, IDROM_ADDR + 0x08, PD_ADDR - IDROM_ADDR);
+    char name[9];
+    snprintf(name, sizeof(name), "MESA%-4.4s", b->name);
+    memcpy(&space[0][IDROM_ADDR + 0x0C], name, 8);
+    put32(0, IDROM_ADDR + 0x1C, b->io_ports);
+    put32(0, IDROM_ADDR + 0x20, b->io_ports * b->port_width);
+    put32(0, IDROM_ADDR + 0x24, b->port_width);
+    put32(0, IDROM_ADDR + 0x28, 100000000);             // ClockLow
+    put32(0, IDROM_ADDR + 0x2C, 200000000);             // ClockHigh
+    put32(0, IDROM_ADDR + 0x30, 4);                     // InstanceStride0
+    put32(0, IDROM_ADDR + 0x34, 0x40);                  // InstanceStride1
+    put32(0, IDROM_ADDR + 0x38, 0x100);                 // RegisterStride0
+    put32(0, IDROM_ADDR + 0x3C, 4);                     // RegisterStride1
+
+    md = add_md(md, find_module("watchdog"), 1);
+    md = add_md(md, find_module("ioport"), b->io_ports);
+
+    char *tok, *save = NULL;
+    for (tok = strtok_r(spec, ",", &save); tok; tok = strtok_r(NULL, ",", &save)) {
+        char *eq = strchr(tok, '=');
+        int n = 1;
+        if (eq) {
+            *eq = 0;
+            n = atoi(eq + 1);
+        }
+        const module_t *m = find_module(tok);
+        if (m == NULL || m->max_instances < 0 || n < 1 || n > m->max_instances
+            || m->gtag == 2) {
+            fprintf(stderr, "hm2_eth_emu: bad module '%s'\n", tok);
+            exit(1);
+        }
+        md = add_md(md, m, n);
+    }
+    // the MD after the last one has GTag 0
+
+    // all pins are plain GPIO
+    for (i = 0; i < b->io_ports * b->port_width; i++)
+        put32(0, PD_ADDR + i * 4, 3 << 24);
+}
+
+// the MAC address of the interface owning addr, so hm2_eth's static ARP
+// entry matches on a veth; 'lo' has none, keep the default then
+static void interface_mac(int sockfd, struct in_addr addr, u8 mac[6]) {
+    struct ifaddrs *ifa, *it;
+    if (getifaddrs(&ifa) < 0) return;
+    for (it = ifa; it; it = it->ifa_next) {
+        struct sockaddr_in *sin = (struct sockaddr_in *)it->ifa_addr;
+        if (sin == NULL || sin->sin_family != AF_INET) continue;
+        if (sin->sin_addr.s_addr != addr.s_addr) continue;
+        struct ifreq ifr;
+        memset(&ifr, 0, sizeof(ifr));
+        snprintf(ifr.ifr_name, sizeof(ifr.ifr_name), "%s", it->ifa_name);
+        if (ioctl(sockfd, SIOCGIFHWADDR, &ifr) == 0) {
+            static const u8 zero[6];
+            if (memcmp(ifr.ifr_hwaddr.sa_data, zero, 6) != 0)
+                memcpy(mac, ifr.ifr_hwaddr.sa_data, 6);
+        }
+        break;
+    }
+    freeifaddrs(ifa);
+}
+
+static void init_spaces(const board_t *b, const u8 mac[6]) {
+    int i;
+    // MAC address, stored backwards in the EEPROM (see fetch_hwaddr())
+    for (i = 0; i < 6; i++)
+        space[2][2 + i] = mac[5 - i];
+    strncpy((char *)&space[7][0], b->name, 16);
+}
+
+// LBP16 area info: a cookie, the memory size and the address range
+static void area_info(int sp, u8 *out) {
+    static const char *names[LBP16_MEM_SPACE_COUNT] = {
+        "HostMot2", "", "EEPROM", "Flash", "Timer", "", "LBP16RW", "BoardInf" };
+    lbp_mem_info_area info;
+    memset(&info, 0, sizeof(info));
+    info.cookie = 0x5A00 | (sp << 8);
+    info.size = sp == 0 ? 0x0400 : 0x0200;      // 32 bit / 16 bit access
+    info.range = 16;                            // 2^16 bytes
+    memcpy(info.name, names[sp], strlen(names[sp]));
+    memcpy(out, &info, sizeof(info));
+}
+
+// process one request datagram, return the length of the reply
+static int lbp16(const u8 *p, int len, u8 *reply) {
+    const u8 *end = p + len;
+    int out = 0;
+
+    // low 16 bits of the received packet count, read by hm2_eth
+    // to detect lost requests
+    put16(6, 0x08, (uint16_t)stats.rx);
+
+    while (end - p >= LBP16_CMDONLY_PACKET_SIZE) {
+        unsigned cmd = p[0] | (p[1] << 8);
+        int sp = (cmd >> 10) & 7;
+        int width = 1 << ((cmd >> 8) & 3);
+        int count = cmd & LBP16_MAX_PACKET_DATA_SIZE;
+        int i;
+        p += LBP16_CMD_SIZE;
+
+        if (cmd & LBP16_ADDR) {
+            if (end - p < LBP16_ADDR_SIZE) goto bad;
+            space_addr[sp] = p[0] | (p[1] << 8);
+            p += LBP16_ADDR_SIZE;
+        }
+
+        if (cmd & LBP16_INFO_ACC) {
+            u8 info[sizeof(lbp_mem_info_area)];
+            area_info(sp, info);
+            for (i = 0; i < count * width; i++) {
+                if (out >= MAX_PACKET) goto bad;
+                reply[out++] = info[(space_addr[sp] + i) % sizeof(info)];
+            }
+            continue;
+        }
+
+        for (i = 0; i < count; i++) {
+            unsigned a = space_addr[sp];
+            if (cmd & LBP16_WRITE) {
+                if (end - p < width) goto bad;
+                if (a + width <= SPACE_SIZE)
+                    memcpy(&space[sp][a], p, width);
+                p += width;
+            } else {
+                if (out + width > MAX_PACKET) goto bad;
+                if (a + width <= SPACE_SIZE)
+                    memcpy(&reply[out], &space[sp][a], width);
+                else
+                    memset(&reply[out], 0, width);
+                out += width;
+            }
+            if (cmd & LBP16_ADDR_AUTO_INC)
+                space_addr[sp] = a + width;
+        }
+    }
+    if (p != end) goto bad;
+    return out;
+
+bad:
+    stats.bad++;
+    if (opt.verbose)
+        fprintf(stderr, "hm2_eth_emu: malformed request (%d bytes)\n", len);
+    return out;
+}
+
+static void enqueue(const struct sockaddr_in *peer, const u8 *data, int len) {
+    long long due = now_ns() + opt.latency_us * 1000LL;
+    if (opt.jitter_us)
+        due += (long long)(drand48() * opt.jitter_us * 1000.0);
+    if (chance(opt.reorder)) {
+        // held back long enough for the following replies to overtake it
+        due += opt.reorder_us * 1000LL;
+        stats.reordered++;
+    }
+    if (num_pending == MAX_PENDING) {
+        stats.overflow++;
+        return;
+    }
+    // keep the queue sorted by due time, it is short
+    int i = num_pending++;
+    while (i > 0 && pending[i - 1].due > due) {
+        pending[i] = pending[i - 1];
+        i--;
+    }
+    pending[i].due = due;
+    pending[i].peer = *peer;
+    pending[i].len = len;
+    memcpy(pending[i].data, data, len);
+}
+
+static void flush_due(int sockfd) {
+    long long now = now_ns();
+    int n = 0;
+    while (n < num_pending && pending[n].due <= now) {
+        sendto(sockfd, pending[n].data, pending[n].len, 0,
+               (struct sockaddr *)&pending[n].peer, sizeof(pending[n].peer));
+        stats.tx++;
+        n++;
+    }
+    if (n) {
+        memmove(pending, pending + n, (num_pending - n) * sizeof(pending[0]));
+        num_pending -= n;
+    }
+}
+
+static void print_stats(void) {
+    fprintf(stderr,
+            "hm2_eth_emu: rx %lu tx %lu dropped rx %lu tx %lu reordered %lu "
+            "malformed %lu overflow %lu, %.2f uS/request\n",
+            stats.rx, stats.tx, stats.dropped_rx, stats.dropped_tx,
+            stats.reordered, stats.bad, stats.overflow,
+            stats.rx ? stats.busy_ns / 1000.0 / stats.rx : 0.0);
+}
+
+static void usage(void) {
+    fprintf(stderr,
+"usage: hm2_eth_emu [options]\n"
+"  -a ADDR      address to listen on (default 127.0.0.1)\n"
+"  -p PORT      UDP port (default %d)\n"
+"  -b BOARD     board name reported to hm2_eth (default 7I92)\n"
+"  -m SPEC      extra modules, e.g. encoder=4,stepgen=4,pwmgen=2,led\n"
+"               (an IOPort per connector and a watchdog are always present)\n"
+"  -l USEC      reply latency\n"
+"  -j USEC      additional random reply latency, uniform in 0..USEC\n"
+"  -L PCT       drop this percentage of requests\n"
+"  -T PCT       drop this percentage of replies\n"
+"  -r PCT       reorder this percentage of replies ...\n"
+"  -d USEC      ... by holding them back this long (default 500)\n"
+"  -s SEED      random seed (default 1)\n"
+"  -v           print statistics every second\n",
+            LBP16_UDP_PORT);
+    exit(1);
+}
+
+int main(int argc, char **argv) {
+    const char *addr = "127.0.0.1", *board_name = "7I92";
+    char spec[256] = "";
+    int port = LBP16_UDP_PORT, c;
+    long seed = 1;
+
+    while ((c = getopt(argc, argv, "a:p:b:m:l:j:L:T:r:d:s:vh")) != -1) {
+        switch (c) {
+        case 'a': addr = optarg; break;
+        case 'p': port = atoi(optarg); break;
+        case 'b': board_name = optarg; break;
+        case 'm': snprintf(spec, sizeof(spec), "%s", optarg); break;
+        case 'l': opt.latency_us = atol(optarg); break;
+        case 'j': opt.jitter_us = atol(optarg); break;
+        case 'L': opt.loss_rx = atof(optarg); break;
+        case 'T': opt.loss_tx = atof(optarg); break;
+        case 'r': opt.reorder = atof(optarg); break;
+        case 'd': opt.reorder_us = atol(optarg); break;
+        case 's': seed = atol(optarg); break;
+        case 'v': opt.verbose = 1; break;
+        default: usage();
+        }
+    }
+
+    const board_t *b = find_board(board_name);
+    if (b == NULL) {
+        fprintf(stderr, "hm2_eth_emu: unknown board '%s'\n", board_name);
+        return 1;
+    }
+    srand48(seed);
+
+    build_idrom(b, spec);
+
+    int sockfd = socket(PF_INET, SOCK_DGRAM, IPPROTO_UDP);
+    if (sockfd < 0) {
+        perror("hm2_eth_emu: socket");
+        return 1;
+    }
+    struct sockaddr_in sa;
+    memset(&sa, 0, sizeof(sa));
+    sa.sin_family = AF_INET;
+    sa.sin_port = htons(port);
+    if (inet_pton(AF_INET, addr, &sa.sin_addr) != 1) {
+        fprintf(stderr, "hm2_eth_emu: bad address '%s'\n", addr);
+        return 1;
+    }
+    if (bind(sockfd, (struct sockaddr *)&sa, sizeof(sa)) < 0) {
+        perror("hm2_eth_emu: bind");
+        return 1;
+    }
+
+    // a locally administered MAC address, unless there is a real one
+    u8 mac[6] = { 0x02, 0x00, 0x4d, 0x45, 0x53, 0x41 };
+    interface_mac(sockfd, sa.sin_addr, mac);
+    init_spaces(b, mac);
+
+    // the default 50uS timer slack would swamp short latencies
+    prctl(PR_SET_TIMERSLACK, 1);
+
+    signal(SIGINT, quit);
+    signal(SIGTERM, quit);
+    fprintf(stderr, "hm2_eth_emu: %s on %s:%d\n", b->name, addr, port);
+
+    long long next_stats = now_ns() + 1000000000LL;
+    while (!done) {
+        struct pollfd pfd = { .fd = sockfd, .events = POLLIN };
+        struct timespec ts = { 1, 0 }, *tsp = &ts;
+        if (num_pending) {
+            long long wait = pending[0].due - now_ns();
+            if (wait < 0) wait = 0;
+            ts.tv_sec = wait / 1000000000LL;
+            ts.tv_nsec = wait % 1000000000LL;
+        }
+
+        int r = ppoll(&pfd, 1, tsp, NULL);
+        if (r < 0 && errno != EINTR) {
+            perror("hm2_eth_emu: poll");
+            break;
+        }
+
+        if (r > 0 && (pfd.revents & POLLIN)) {
+            u8 request[MAX_PACKET], reply[MAX_PACKET];
+            struct sockaddr_in peer;
+            socklen_t peerlen = sizeof(peer);
+            int len = recvfrom(sockfd, request, sizeof(request), 0,
+                               (struct sockaddr *)&peer, &peerlen);
+            if (len > 0) {
+                long long t0 = now_ns();
+                if (chance(opt.loss_rx)) {
+                    stats.dropped_rx++;
+                } else {
+                    stats.rx++;
+                    int n = lbp16(request, len, reply);
+                    if (n && chance(opt.loss_tx))
+                        stats.dropped_tx++;
+                    else if (n)
+                        enqueue(&peer, reply, n);
+                }
+                stats.busy_ns += now_ns() - t0;
+            }
+        }
+        flush_due(sockfd);
+
+        if (opt.verbose && now_ns() > next_stats) {
+            print_stats();
+            next_stats += 1000000000LL;
+        }
+    }
+
+    print_stats();
+    close(sockfd);
+    return 0;
+}
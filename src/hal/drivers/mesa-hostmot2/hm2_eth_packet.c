@@ -0,0 +1,307 @@
+/*    This is a component of Machinekit
+ *    Copyright 2026 Machinekit HAL developers
+ *
+ *    This program is free software; you can redistribute it and/or modify
+ *    it under the terms of the GNU General Public License as published by
+ *    the Free Software Foundation; either version 2 of the License, or
+ *    (at your option) any later version.
+ *
+ *    This program is distributed in the hope that it will be useful,
+ *    but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *    GNU General Public License for more details.
+ *
+ *    You should have received a copy of the GNU General Public License
+ *    along with this program; if not, write to the Free Software
+ *    Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ */
+
+// AF_PACKET transport for hm2_eth (transport=packet)
+//
+// LBP16 requests go out as complete Ethernet/IPv4/UDP frames on a packet
+// socket bound to the board's interface, replies are picked up from a
+// mmap()ed TPACKET_V2 receive ring by spinning on the frame status, so
+// neither direction passes through the IP/UDP stack, netfilter or the
+// socket wakeup path.  A classic BPF filter lets only the board's replies
+// into the ring.
+//
+// The connected UDP socket stays open: it is used for the initial
+// MAC address fetch, keeps the local port reserved (so the kernel does
+// not answer replies with ICMP port unreachable) and keeps the iptables
+// rules of hm2_eth meaningful.  Its receive buffer is shrunk, as the
+// replies are also queued there and never read.
+//
+// TPACKET_V2 rather than V3: a V3 block is only handed to userspace when
+// it is full or its retire timeout (>= 1ms) expires, far too late for a
+// single small reply per servo cycle.
+
+#include "config.h"
+#include "config_module.h"
+#include RTAPI_INC_SLAB_H
+#include RTAPI_INC_STRING_H
+
+#include <sys/ioctl.h>
+#include <sys/mman.h>
+#include <sys/socket.h>
+#include <arpa/inet.h>
+#include <linux/filter.h>
+#include <linux/if_packet.h>
+#include <net/ethernet.h>
+#include <net/if.h>
+#include <net/if_arp.h>
+#include <netinet/in.h>
+#include <errno.h>
+#include <unistd.h>
+
+#include "rtapi.h"
+
+#include "hal.h"
+
+#include "hostmot2-lowlevel.h"
+#include "hostmot2.h"
+#include "hm2_eth.h"
+
+#ifndef PACKET_QDISC_BYPASS
+#define PACKET_QDISC_BYPASS 20
+#endif
+#ifndef PACKET_IGNORE_OUTGOING
+#define PACKET_IGNORE_OUTGOING 23
+#endif
+
+#define RING_FRAME_SIZE 2048
+#define RING_BLOCK_SIZE 16384
+#define RING_BLOCK_NR   8
+
+#define IP_OFFSET   14
+#define UDP_OFFSET  (IP_OFFSET + 20)
+
+static u16 ip_checksum(const u8 *hdr, int len) {
+    u32 sum = 0;
+    int i;
+    for (i = 0; i < len; i += 2)
+        sum += (hdr[i] << 8) | hdr[i + 1];
+    while (sum >> 16)
+        sum = (sum & 0xFFFF) + (sum >> 16);
+    return ~sum;
+}
+
+static void put16(u8 *p, u16 v) {
+    p[0] = v >> 8;
+    p[1] = v;
+}
+
+static int attach_filter(int fd, u32 board_ip, u16 board_port, u16 local_port) {
+    // IPv4, UDP, unfragmented, from the board's address and LBP16 port to
+    // our port; everything in host byte order, BPF loads are big endian
+    struct sock_filter code[] = {
+        BPF_STMT(BPF_LD  | BPF_H   | BPF_ABS, 12),
+        BPF_JUMP(BPF_JMP | BPF_JEQ | BPF_K, ETHERTYPE_IP, 0, 12),
+        BPF_STMT(BPF_LD  | BPF_B   | BPF_ABS, IP_OFFSET + 9),
+        BPF_JUMP(BPF_JMP | BPF_JEQ | BPF_K, IPPROTO_UDP, 0, 10),
+        BPF_STMT(BPF_LD  | BPF_W   | BPF_ABS, IP_OFFSET + 12),
+        BPF_JUMP(BPF_JMP | BPF_JEQ | BPF_K, board_ip, 0, 8),
+        BPF_STMT(BPF_LD  | BPF_H   | BPF_ABS, IP_OFFSET + 6),
+        BPF_JUMP(BPF_JMP | BPF_JSET | BPF_K, 0x1FFF, 6, 0),
+        BPF_STMT(BPF_LDX | BPF_B   | BPF_MSH, IP_OFFSET),
+        BPF_STMT(BPF_LD  | BPF_H   | BPF_IND, IP_OFFSET),
+        BPF_JUMP(BPF_JMP | BPF_JEQ | BPF_K, board_port, 0, 3),
+        BPF_STMT(BPF_LD  | BPF_H   | BPF_IND, IP_OFFSET + 2),
+        BPF_JUMP(BPF_JMP | BPF_JEQ | BPF_K, local_port, 0, 1),
+        BPF_STMT(BPF_RET | BPF_K, 0xFFFF),
+        BPF_STMT(BPF_RET | BPF_K, 0),
+    };
+    struct sock_fprog prog = {
+        .len = sizeof(code) / sizeof(code[0]),
+        .filter = code,
+    };
+    return setsockopt(fd, SOL_SOCKET, SO_ATTACH_FILTER, &prog, sizeof(prog));
+}
+
+static struct tpacket2_hdr *ring_frame(hm2_eth_packet_t *pkt, unsigned i) {
+    return (struct tpacket2_hdr *)(pkt->ring + (size_t)i * pkt->frame_size);
+}
+
+static void ring_release(hm2_eth_packet_t *pkt, struct tpacket2_hdr *hdr) {
+    __sync_synchronize();
+    hdr->tp_status = TP_STATUS_KERNEL;
+    pkt->frame = (pkt->frame + 1) % pkt->frame_nr;
+}
+
+int hm2_eth_packet_open(hm2_eth_t *board, const char *ifname, const unsigned char board_hwaddr[6]) {
+    hm2_eth_packet_t *pkt = &board->packet;
+    struct sockaddr_in local;
+    socklen_t addrlen = sizeof(local);
+    struct ifreq ifr;
+    int ret, one = 1;
+
+    pkt->fd = -1;
+    pkt->ring = NULL;
+
+    if (getsockname(board->sockfd, (struct sockaddr *)&local, &addrlen) < 0) {
+        LL_PRINT("ERROR: packet transport: getsockname: %s\n", strerror(errno));
+        return -errno;
+    }
+
+    pkt->fd = socket(AF_PACKET, SOCK_RAW, htons(ETH_P_IP));
+    if (pkt->fd < 0) {
+        ret = -errno;
+        LL_PRINT("ERROR: packet transport: can't open socket: %s\n", strerror(errno));
+        return ret;
+    }
+
+    memset(&ifr, 0, sizeof(ifr));
+    rtapi_snprintf(ifr.ifr_name, sizeof(ifr.ifr_name), "%s", ifname);
+    if (ioctl(pkt->fd, SIOCGIFINDEX, &ifr) < 0) goto fail_errno;
+    int ifindex = ifr.ifr_ifindex;
+    if (ioctl(pkt->fd, SIOCGIFFLAGS, &ifr) < 0) goto fail_errno;
+    // frames injected on 'lo' have no route attached and are dropped
+    // as martians, so a hm2_eth_emu there must be reached through UDP
+    if (ifr.ifr_flags & IFF_LOOPBACK) {
+        LL_PRINT("ERROR: packet transport is not supported on %s\n", ifname);
+        hm2_eth_packet_close(board);
+        return -EOPNOTSUPP;
+    }
+    if (ioctl(pkt->fd, SIOCGIFHWADDR, &ifr) < 0) goto fail_errno;
+
+    // only the board's replies
+    if (attach_filter(pkt->fd, ntohl(board->server_addr.sin_addr.s_addr),
+                      ntohs(board->server_addr.sin_port),
+                      ntohs(local.sin_port)) < 0)
+        goto fail_errno;
+    setsockopt(pkt->fd, SOL_PACKET, PACKET_IGNORE_OUTGOING, &one, sizeof(one));
+    setsockopt(pkt->fd, SOL_PACKET, PACKET_QDISC_BYPASS, &one, sizeof(one));
+
+    int version = TPACKET_V2;
+    if (setsockopt(pkt->fd, SOL_PACKET, PACKET_VERSION, &version, sizeof(version)) < 0)
+        goto fail_errno;
+
+    struct tpacket_req req = {
+        .tp_block_size = RING_BLOCK_SIZE,
+        .tp_block_nr = RING_BLOCK_NR,
+        .tp_frame_size = RING_FRAME_SIZE,
+        .tp_frame_nr = RING_BLOCK_SIZE / RING_FRAME_SIZE * RING_BLOCK_NR,
+    };
+    if (setsockopt(pkt->fd, SOL_PACKET, PACKET_RX_RING, &req, sizeof(req)) < 0)
+        goto fail_errno;
+    pkt->frame_size = req.tp_frame_size;
+    pkt->frame_nr = req.tp_frame_nr;
+    pkt->frame = 0;
+    pkt->ring_size = (size_t)req.tp_block_size * req.tp_block_nr;
+    pkt->ring = mmap(NULL, pkt->ring_size, PROT_READ | PROT_WRITE,
+                     MAP_SHARED | MAP_LOCKED, pkt->fd, 0);
+    if (pkt->ring == MAP_FAILED) {
+        pkt->ring = NULL;
+        goto fail_errno;
+    }
+
+    struct sockaddr_ll sll;
+    memset(&sll, 0, sizeof(sll));
+    sll.sll_family = AF_PACKET;
+    sll.sll_protocol = htons(ETH_P_IP);
+    sll.sll_ifindex = ifindex;
+    if (bind(pkt->fd, (struct sockaddr *)&sll, sizeof(sll)) < 0)
+        goto fail_errno;
+
+    // frames that got in before the filter was attached
+    while (ring_frame(pkt, pkt->frame)->tp_status & TP_STATUS_USER)
+        ring_release(pkt, ring_frame(pkt, pkt->frame));
+
+    // the replies also end up in the UDP socket, which is never read
+    int small = 1;
+    setsockopt(board->sockfd, SOL_SOCKET, SO_RCVBUF, &small, sizeof(small));
+
+    // Ethernet
+    u8 *h = pkt->tx;
+    memset(h, 0, HM2_ETH_PACKET_HDR_SIZE);
+    memcpy(h, board_hwaddr, ETH_ALEN);
+    memcpy(h + ETH_ALEN, ifr.ifr_hwaddr.sa_data, ETH_ALEN);
+    put16(h + 12, ETHERTYPE_IP);
+
+    // IPv4: version 4, 20 byte header, don't fragment, TTL 64
+    h = pkt->tx + IP_OFFSET;
+    h[0] = 0x45;
+    put16(h + 6, 0x4000);
+    h[8] = 64;
+    h[9] = IPPROTO_UDP;
+    memcpy(h + 12, &local.sin_addr.s_addr, 4);
+    memcpy(h + 16, &board->server_addr.sin_addr.s_addr, 4);
+
+    // UDP, no checksum
+    h = pkt->tx + UDP_OFFSET;
+    memcpy(h + 0, &local.sin_port, 2);
+    memcpy(h + 2, &board->server_addr.sin_port, 2);
+
+    LL_PRINT("%s: using packet transport on %s\n",
+             inet_ntoa(board->server_addr.sin_addr), ifname);
+    return 0;
+
+fail_errno:
+    ret = -errno;
+    LL_PRINT("ERROR: packet transport on %s: %s\n", ifname, strerror(errno));
+    hm2_eth_packet_close(board);
+    return ret;
+}
+
+void hm2_eth_packet_close(hm2_eth_t *board) {
+    hm2_eth_packet_t *pkt = &board->packet;
+    if (pkt->ring) munmap(pkt->ring, pkt->ring_size);
+    pkt->ring = NULL;
+    if (pkt->fd >= 0) close(pkt->fd);
+    pkt->fd = -1;
+}
+
+int hm2_eth_packet_send(hm2_eth_t *board, const void *buffer, int len) {
+    hm2_eth_packet_t *pkt = &board->packet;
+    u8 *ip = pkt->tx + IP_OFFSET, *udp = pkt->tx + UDP_OFFSET;
+
+    if (len > (int)sizeof(pkt->tx) - HM2_ETH_PACKET_HDR_SIZE) {
+        errno = EMSGSIZE;
+        return -1;
+    }
+    memcpy(pkt->tx + HM2_ETH_PACKET_HDR_SIZE, buffer, len);
+
+    put16(ip + 2, 20 + 8 + len);
+    put16(ip + 4, pkt->ip_id++);
+    put16(ip + 10, 0);
+    put16(ip + 10, ip_checksum(ip, 20));
+    put16(udp + 4, 8 + len);
+
+    int result = send(pkt->fd, pkt->tx, HM2_ETH_PACKET_HDR_SIZE + len, 0);
+    return result < 0 ? result : result - HM2_ETH_PACKET_HDR_SIZE;
+}
+
+// like recv() with SO_RCVTIMEO on the UDP socket, but spinning on the
+// ring instead of sleeping
+int hm2_eth_packet_recv(hm2_eth_t *board, void *buffer, int len, long timeout_ns) {
+    hm2_eth_packet_t *pkt = &board->packet;
+    long long end = rtapi_get_time() + timeout_ns;
+
+    do {
+        struct tpacket2_hdr *hdr = ring_frame(pkt, pkt->frame);
+        if (!(hdr->tp_status & TP_STATUS_USER))
+            continue;
+        __sync_synchronize();
+
+        struct sockaddr_ll *sll = (struct sockaddr_ll *)
+            ((u8 *)hdr + TPACKET_ALIGN(sizeof(*hdr)));
+        u8 *frame = (u8 *)hdr + hdr->tp_mac;
+        int ihl = (frame[IP_OFFSET] & 0x0F) * 4;
+        int payload = ((frame[IP_OFFSET + ihl + 4] << 8)
+                       | frame[IP_OFFSET + ihl + 5]) - 8;
+
+        if (sll->sll_pkttype == PACKET_OUTGOING
+            || IP_OFFSET + ihl + 8 + payload > (int)hdr->tp_snaplen
+            || payload < 0) {
+            ring_release(pkt, hdr);
+            continue;
+        }
+
+        if (payload > len) payload = len;
+        memcpy(buffer, frame + IP_OFFSET + ihl + 8, payload);
+        ring_release(pkt, hdr);
+        return payload;
+    } while (rtapi_get_time() < end);
+
+    errno = EAGAIN;
+    return -1;
+}
@@ -74,6 +74,52 @@ static void set32(hm2_test_t *me, u16 addr, u32 val) {
 }
 
 
+//
+// Test pattern 16 has an Encoder module whose counters move.  Each read
+// of the Counter registers is one servo period of 1000 timestamp clocks
+// (1 MHz timestamps from the 2 MHz ClockLow).  Every 256 periods each
+// encoder goes on to the next of eight motions: stopped, slow forward,
+// fast forward, slow reverse, fast reverse, dithering on an edge, and
+// stopped twice more, long enough to time out its velocity.  The
+// channels are out of phase and move at different speeds, so a period
+// sees all of them at once.  It's all a function of the period
+// number, so every run sees the same counts.
+//
+
+#define HM2_TEST_ENCODER_ADDR     (0x3000)
+#define HM2_TEST_ENCODER_COUNTER  (HM2_TEST_ENCODER_ADDR + (0 * 0x100))
+#define HM2_TEST_ENCODER_TSC      (HM2_TEST_ENCODER_ADDR + (3 * 0x100))
+
+static void hm2_test_encoder_step(hm2_test_t *me) {
+    u32 t = ++me->encoder_tick;
+    u32 tsc = t * 1000;
+    int i;
+
+    for (i = 0; i < me->num_encoders; i ++) {
+        u32 *reg = &me->test_pattern.tp32[(HM2_TEST_ENCODER_COUNTER / 4) + i];
+        u32 slow = 5 + (i % 7);
+        s32 delta = 0;
+
+        switch (((t / 256) + i) % 8) {
+            case 1: delta = ((t % slow) == 0);    break;
+            case 2: delta = i + 1;                break;
+            case 3: delta = -((t % slow) == 0);   break;
+            case 4: delta = -(2 * i + 3);         break;
+            case 5: delta = ((t % 3) == 0) ? (((t / 3) & 1) ? 1 : -1) : 0; break;
+            default: break;
+        }
+
+        if (delta != 0) {
+            u16 count = (*reg & 0xffff) + delta;
+            u16 timestamp = tsc - ((i * 37 + t * 11) % 997);
+            *reg = ((u32)timestamp << 16) | count;
+        }
+    }
+
+    set32(me, HM2_TEST_ENCODER_TSC, tsc & 0xffff);
+}
+
+
 //
 // these are the "low-level I/O" functions exported up
 //
@@ -81,6 +127,11 @@ static void set32(hm2_test_t *me, u16 addr, u32 val) {
 
 static int hm2_test_read(hm2_lowlevel_io_t *this, u32 addr, void *buffer, int size) {
     hm2_test_t *me = this->private;
+    if (me->num_encoders
+            && (addr <= HM2_TEST_ENCODER_COUNTER)
+            && (HM2_TEST_ENCODER_COUNTER < addr + size)) {
+        hm2_test_encoder_step(me);
+    }
     memcpy(buffer, &me->test_pattern.tp8[addr], size);
     return 1;  // success
 }
@@ -556,6 +607,147 @@ int rtapi_app_main(void) {
             break;
         }
 
+
+        //
+        // a good board: one 24-pin connector, one IOPort instance,
+        // every pin a GPIO - loads, used for benchmarking the driver
+        //
+
+        case 15: {
+            int num_io_pins = 24;
+            int pd_index;
+
+            set32(me, HM2_ADDR_IOCOOKIE, HM2_IOCOOKIE);
+            set8(me, HM2_ADDR_CONFIGNAME+0, 'H');
+            set8(me, HM2_ADDR_CONFIGNAME+1, 'O');
+            set8(me, HM2_ADDR_CONFIGNAME+2, 'S');
+            set8(me, HM2_ADDR_CONFIGNAME+3, 'T');
+            set8(me, HM2_ADDR_CONFIGNAME+4, 'M');
+            set8(me, HM2_ADDR_CONFIGNAME+5, 'O');
+            set8(me, HM2_ADDR_CONFIGNAME+6, 'T');
+            set8(me, HM2_ADDR_CONFIGNAME+7, '2');
+            set32(me, HM2_ADDR_IDROM_OFFSET, 0x400); // put the IDROM at 0x400, where it usually lives
+            set32(me, 0x400, 2); // standard idrom type
+
+            // normal offset to Module Descriptors
+            set32(me, 0x404, 64);
+
+            // normal offset to PinDescriptors
+            set32(me, 0x408, 0x200);
+
+            // IOPorts
+            set32(me, 0x41c, 1);
+
+            // IOWidth
+            set32(me, 0x420, num_io_pins);
+
+            // PortWidth
+            set32(me, 0x424, 24);
+
+            // ClockLow = 2e6
+            set32(me, 0x428, 2e6);
+
+            // ClockHigh = 2e7
+            set32(me, 0x42c, 2e7);
+
+            // InstanceStride0, RegisterStride0
+            set32(me, 0x430, 4);
+            set32(me, 0x438, 4);
+
+            me->llio.num_ioport_connectors = 1;
+            me->llio.ioport_connector_name[0] = "P3";
+
+            // one Module Descriptor: IOPort, version 0, ClockLow, 1 instance,
+            // 5 registers at 0x1000, all of them per-instance
+            set32(me, 0x440 + 0, HM2_GTAG_IOPORT | (1 << 16) | (1 << 24));
+            set32(me, 0x440 + 4, 0x1000 | (5 << 16));
+            set32(me, 0x440 + 8, 0x1F);
+            // the next MD has GTag 0, end of list
+
+            for (pd_index = 0; pd_index < num_io_pins; pd_index ++) {
+                set8(me, 0x600 + (pd_index * 4) + 0, 0);
+                set8(me, 0x600 + (pd_index * 4) + 1, 0);
+                set8(me, 0x600 + (pd_index * 4) + 2, 0);
+                set8(me, 0x600 + (pd_index * 4) + 3, HM2_GTAG_IOPORT);
+            }
+
+            break;
+        }
+
+        //
+        // a good board: one 24-pin connector of GPIOs and 32 Encoder
+        // instances that move (see hm2_test_encoder_step()) - used to
+        // check the encoder batch path against the per-instance path
+        //
+
+        case 16: {
+            int num_io_pins = 24;
+            int pd_index;
+
+            set32(me, HM2_ADDR_IOCOOKIE, HM2_IOCOOKIE);
+            set8(me, HM2_ADDR_CONFIGNAME+0, 'H');
+            set8(me, HM2_ADDR_CONFIGNAME+1, 'O');
+            set8(me, HM2_ADDR_CONFIGNAME+2, 'S');
+            set8(me, HM2_ADDR_CONFIGNAME+3, 'T');
+            set8(me, HM2_ADDR_CONFIGNAME+4, 'M');
+            set8(me, HM2_ADDR_CONFIGNAME+5, 'O');
+            set8(me, HM2_ADDR_CONFIGNAME+6, 'T');
+            set8(me, HM2_ADDR_CONFIGNAME+7, '2');
+            set32(me, HM2_ADDR_IDROM_OFFSET, 0x400); // put the IDROM at 0x400, where it usually lives
+            set32(me, 0x400, 2); // standard idrom type
+
+            // normal offset to Module Descriptors
+            set32(me, 0x404, 64);
+
+            // normal offset to PinDescriptors
+            set32(me, 0x408, 0x200);
+
+            // IOPorts
+            set32(me, 0x41c, 1);
+
+            // IOWidth
+            set32(me, 0x420, num_io_pins);
+
+            // PortWidth
+            set32(me, 0x424, 24);
+
+            // ClockLow = 2e6
+            set32(me, 0x428, 2e6);
+
+            // ClockHigh = 2e7
+            set32(me, 0x42c, 2e7);
+
+            // InstanceStride0, RegisterStride0
+            set32(me, 0x430, 4);
+            set32(me, 0x438, 0x100);
+
+            me->llio.num_ioport_connectors = 1;
+            me->llio.ioport_connector_name[0] = "P3";
+
+            // IOPort, version 0, ClockLow, 1 instance,
+            // 5 registers at 0x1000, all of them per-instance
+            set32(me, 0x440 + 0, HM2_GTAG_IOPORT | (1 << 16) | (1 << 24));
+            set32(me, 0x440 + 4, 0x1000 | (5 << 16));
+            set32(me, 0x440 + 8, 0x1F);
+
+            // Encoder, version 3, ClockLow, 32 instances,
+            // 5 registers, Counter and Latch/Control per-instance
+            me->num_encoders = 32;
+            set32(me, 0x44c + 0, HM2_GTAG_ENCODER | (3 << 8) | (1 << 16) | (me->num_encoders << 24));
+            set32(me, 0x44c + 4, HM2_TEST_ENCODER_ADDR | (5 << 16));
+            set32(me, 0x44c + 8, 0x03);
+            // the next MD has GTag 0, end of list
+
+            for (pd_index = 0; pd_index < num_io_pins; pd_index ++) {
+                set8(me, 0x600 + (pd_index * 4) + 0, 0);
+                set8(me, 0x600 + (pd_index * 4) + 1, 0);
+                set8(me, 0x600 + (pd_index * 4) + 2, 0);
+                set8(me, 0x600 + (pd_index * 4) + 3, HM2_GTAG_IOPORT);
+            }
+
+            break;
+        }
+
         default: {
             LL_ERR("unknown test pattern %d", test_pattern);
 	    hal_exit(comp_id);
@@ -28,6 +28,10 @@ typedef struct {
         u32 tp32[16 * 1024];
     } test_pattern;
 
+    // test pattern 16: encoders that move on every read of their counters
+    int num_encoders;
+    u32 encoder_tick;
+
     hm2_lowlevel_io_t llio;
 } hm2_test_t;
 
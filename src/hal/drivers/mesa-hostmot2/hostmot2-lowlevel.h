@@ -25,6 +25,7 @@
 
 #include "rtapi.h"
 #include "hal.h"
+#include "hal_priv.h"      // hal_funct_args_t
 
 #include "bitfile.h"
 
@@ -150,6 +151,11 @@ struct hm2_lowlevel_io_struct {
     // TRUE if it is useful to split reads into a request and response part
     int split_read;
 
+    // TRUE if the llio driver cycles this board from its own functs
+    // (hm2_eth gang mode), so the per-board read, read-request and write
+    // functs are not exported: they would never put a packet on the wire
+    int no_functs;
+
     // this gets set to TRUE when the llio driver detects an io_error, and
     // by the hm2 watchdog (if present) when it detects a watchdog bite
     // this requires user intervention to clear the io_error and then
@@ -197,6 +203,12 @@ struct hm2_lowlevel_io_struct {
 int hm2_register(hm2_lowlevel_io_t *llio, char *config);
 void hm2_unregister(hm2_lowlevel_io_t *llio);
 
+// the bodies of a registered board's read-request, read and write functs,
+// for llio drivers that cycle several boards from one funct
+int hm2_llio_read_request(hm2_lowlevel_io_t *llio, const hal_funct_args_t *fa);
+int hm2_llio_read(hm2_lowlevel_io_t *llio, const hal_funct_args_t *fa);
+int hm2_llio_write(hm2_lowlevel_io_t *llio, const hal_funct_args_t *fa);
+
 
 #endif //  HOSTMOT2_LOWLEVEL_H
 
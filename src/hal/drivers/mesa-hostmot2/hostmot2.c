@@ -177,6 +177,41 @@ static int hm2_write(void *void_hm2, const hal_funct_args_t *fa) {
     return 0;
 }
 
+//
+// the same for llio drivers which run the cycle of several boards from a
+// funct of their own (hm2_eth's gang mode) instead of the per-board functs
+//
+
+static hostmot2_t *hm2_find_llio(hm2_lowlevel_io_t *llio) {
+    struct list_head *ptr;
+    list_for_each(ptr, &hm2_list) {
+        hostmot2_t *hm2 = list_entry(ptr, hostmot2_t, list);
+        if (hm2->llio == llio) return hm2;
+    }
+    return NULL;
+}
+
+EXPORT_SYMBOL_GPL(hm2_llio_read_request);
+int hm2_llio_read_request(hm2_lowlevel_io_t *llio, const hal_funct_args_t *fa) {
+    hostmot2_t *hm2 = hm2_find_llio(llio);
+    if (hm2 == NULL) return -ENODEV;
+    return hm2_read_request(hm2, fa);
+}
+
+EXPORT_SYMBOL_GPL(hm2_llio_read);
+int hm2_llio_read(hm2_lowlevel_io_t *llio, const hal_funct_args_t *fa) {
+    hostmot2_t *hm2 = hm2_find_llio(llio);
+    if (hm2 == NULL) return -ENODEV;
+    return hm2_read(hm2, fa);
+}
+
+EXPORT_SYMBOL_GPL(hm2_llio_write);
+int hm2_llio_write(hm2_lowlevel_io_t *llio, const hal_funct_args_t *fa) {
+    hostmot2_t *hm2 = hm2_find_llio(llio);
+    if (hm2 == NULL) return -ENODEV;
+    return hm2_write(hm2, fa);
+}
+
 static int hm2_read_gpio(void *void_hm2, const hal_funct_args_t *fa) {
     hostmot2_t *hm2 = void_hm2;
 
@@ -420,6 +455,7 @@ static int hm2_parse_config_string(hostmot2_t *hm2, char *config_string) {
     hm2->config.enable_raw = 0;
     hm2->config.enable_adc = 0;
     hm2->config.num_capsensors = -1;
+    hm2->config.dirty_writes = 0;
     hm2->config.firmware = NULL;
 
     if (config_string == NULL) return 0;
@@ -541,6 +577,10 @@ static int hm2_parse_config_string(hostmot2_t *hm2, char *config_string) {
             token += 14;
             hm2->config.num_capsensors = simple_strtol(token, NULL, 0);
 
+        } else if (strncmp(token, "dirty_writes=", 13) == 0) {
+            token += 13;
+            hm2->config.dirty_writes = simple_strtol(token, NULL, 0);
+
 	} else if (strncmp(token, "nofwid", 6) == 0) {
             hm2->config.skip_fwid = 1;
 
@@ -582,6 +622,7 @@ static int hm2_parse_config_string(hostmot2_t *hm2, char *config_string) {
     HM2_DBG("    enable_raw=%d\n",   hm2->config.enable_raw);
     HM2_DBG("    enable_adc=%d\n",   hm2->config.enable_adc);
     HM2_DBG("    num_capsensors=%d\n",   hm2->config.num_capsensors);
+    HM2_DBG("    dirty_writes=%d\n",   hm2->config.dirty_writes);
     HM2_DBG("    firmware=%s\n",   hm2->config.firmware ? hm2->config.firmware : "(NULL)");
 
     argv_free(argv);
@@ -1741,7 +1782,7 @@ int hm2_register(hm2_lowlevel_io_t *llio, char *config_string) {
     // export the main read/write functions
     //
 
-    {
+    if (!hm2->llio->no_functs) {
     if(hm2->llio->split_read) {
         hal_export_xfunct_args_t read_request_args = {
             .type = FS_XTHREADFUNC,
@@ -1927,4 +1968,5 @@ void hm2_force_write(hostmot2_t *hm2) {
     hm2_bspi_force_write(hm2);
     hm2_dbspi_force_write(hm2);
     hm2_dpll_force_write(hm2);
+    hm2_tram_force_write(hm2);
 }
@@ -376,6 +376,8 @@ typedef struct {
     s32 tsc_num_rollovers;
     u16 prev_time_of_interest;
 
+    hal_float_t prev_scale;  // .scale the position pins were last computed with
+
     enum { HM2_ENCODER_STOPPED, HM2_ENCODER_MOVING } state;
 
 } hm2_encoder_instance_t;
@@ -387,6 +389,7 @@ typedef struct {
         hal_u32_t *sample_frequency;
         hal_u32_t *skew;
         hal_s32_t *dpll_timer_num;
+        hal_bit_t *batch;
     } pin;
 } hm2_encoder_module_global_t;
 
@@ -414,6 +417,10 @@ typedef struct {
     u32 *control_reg;
     u32 *read_control_reg;
 
+    // batch path scratch, one entry per instance (see hm2_encoder_process_tram_read())
+    u16 *batch_count;
+    int *batch_busy;
+
     u32 timestamp_div_addr;
     u32 timestamp_div_reg;  // one register for the whole Function
     hal_float_t seconds_per_tsdiv_clock;
@@ -1164,9 +1171,28 @@ typedef struct {
     u16 addr;
     u16 size;
     u32 **buffer;
+    u16 offset;     // into the TRAM buffer, once placed
+    u8 flags;
     struct list_head list;
 } hm2_tram_entry_t;
 
+#define HM2_TRAM_PLACED  (1 << 0)    // has an offset in the current buffer
+#define HM2_TRAM_STROBE  (1 << 1)    // access has a side effect (FIFO, command):
+                                     // kept in registration order and, in
+                                     // dirty-write mode, written every cycle
+#define HM2_TRAM_SHARED  (1 << 2)    // write entry also read back, so the firmware
+                                     // may change it: written every cycle
+#define HM2_TRAM_RUNFLAGS (HM2_TRAM_STROBE | HM2_TRAM_SHARED)
+
+// the TRAM planner's idea of the registers to transfer each cycle:
+// address-adjacent entries merged into one queue_read()/queue_write()
+typedef struct {
+    u16 addr;
+    u16 size;
+    u16 offset;     // into the TRAM buffer
+    u8 flags;
+} hm2_tram_run_t;
+
 
 
 
@@ -1198,6 +1224,7 @@ typedef struct {
         int enable_raw;
         int enable_adc;
         int num_capsensors;
+        int dirty_writes;   // 0, or cycles between full TRAM writes
         char *firmware;
 	int skip_fwid;  // skip applying the fwid proto message if set
     } config;
@@ -1228,6 +1255,18 @@ typedef struct {
     u32 *tram_write_buffer;
     u16 tram_write_size;
 
+    hm2_tram_run_t *tram_read_runs;
+    int num_tram_read_runs;
+    hm2_tram_run_t *tram_write_runs;
+    int num_tram_write_runs;
+
+    // dirty-write mode: what the board was last sent, what was queued
+    // since (copied into the shadow once the queue is sent), and cycles
+    // until the next full write (0 forces one)
+    u32 *tram_write_shadow;
+    u32 *tram_write_pending;
+    int tram_write_countdown;
+
     // the hostmot2 "Functions"
     hm2_encoder_t encoder;
     hm2_encoder_t muxed_encoder;
@@ -1303,6 +1342,8 @@ int hm2_get_pktuart(hostmot2_t **hm2, char *name);
 
 int hm2_register_tram_read_region(hostmot2_t *hm2, u16 addr, u16 size, u32 **buffer);
 int hm2_register_tram_write_region(hostmot2_t *hm2, u16 addr, u16 size, u32 **buffer);
+int hm2_register_tram_read_strobe_region(hostmot2_t *hm2, u16 addr, u16 size, u32 **buffer);
+int hm2_register_tram_write_strobe_region(hostmot2_t *hm2, u16 addr, u16 size, u32 **buffer);
 int hm2_allocate_tram_regions(hostmot2_t *hm2);
 int hm2_tram_read(hostmot2_t *hm2);
 
@@ -1310,6 +1351,7 @@ int hm2_finish_read(hostmot2_t *hm2);
 int hm2_queue_read(hostmot2_t *hm2);
 int hm2_tram_write(hostmot2_t *hm2);
 int hm2_finish_write(hostmot2_t *hm2);
+void hm2_tram_force_write(hostmot2_t *hm2);
 void hm2_tram_cleanup(hostmot2_t *hm2);
 
 
@@ -1434,6 +1476,8 @@ void hm2_sserial_print_module(hostmot2_t *hm2);
 void hm2_sserial_force_write(hostmot2_t *hm2);
 void hm2_sserial_prepare_tram_write(hostmot2_t *hm2, long period);
 int hm2_sserial_read_pins(hm2_sserial_remote_t *chan);
+void hm2_sserial_write_pins(hm2_sserial_remote_t *chan);
+int hm2_sserial_compile_plan(hostmot2_t *hm2, hm2_sserial_remote_t *chan);
 void hm2_sserial_process_tram_read(hostmot2_t *hm2, long period);
 void hm2_sserial_cleanup(hostmot2_t *hm2);
 int hm2_sserial_waitfor(hostmot2_t *hm2, u32 addr, u32 mask, int ms);
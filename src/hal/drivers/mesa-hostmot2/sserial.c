@@ -34,8 +34,6 @@
 //utility function delarations
 int hm2_sserial_stopstart(hostmot2_t *hm2, hm2_module_descriptor_t *md, 
                           hm2_sserial_instance_t *inst, u32 start_mode);
-int getbits(hm2_sserial_remote_t *chan, u64 *val, int start, int len);
-int setbits(hm2_sserial_remote_t *chan, u64 *val, int start, int len);
 int hm2_sserial_get_bytes(hostmot2_t *hm2, hm2_sserial_remote_t *chan, void *buffer, int addr, int size);
 int hm2_sserial_read_globals(hostmot2_t *hm2,hm2_sserial_remote_t *chan);
 int hm2_sserial_create_params(hostmot2_t *hm2, hm2_sserial_remote_t *chan);
@@ -395,9 +393,9 @@ int hm2_sserial_setup_channel(hostmot2_t *hm2, hm2_sserial_instance_t *inst, int
         
     }
     // Nothing happens without a "Do It" command
-    r = hm2_register_tram_write_region(hm2, inst->command_reg_addr,
-                                       sizeof(u32),
-                                       &inst->command_reg_write);
+    r = hm2_register_tram_write_strobe_region(hm2, inst->command_reg_addr,
+                                              sizeof(u32),
+                                              &inst->command_reg_write);
     if (r < 0) {
         HM2_ERR("error registering tram write region for sserial "
                 "command register (%d)\n", index);
@@ -1089,7 +1087,7 @@ int hm2_sserial_create_pins(hostmot2_t *hm2, hm2_sserial_remote_t *chan){
                         chan->confs[i].UnitString);
         }
     }
-    return 0;
+    return hm2_sserial_compile_plan(hm2, chan);
 }
 
 int hm2_sserial_register_tram(hostmot2_t *hm2, hm2_sserial_remote_t *chan){
@@ -1184,10 +1182,7 @@ void hm2_sserial_prepare_tram_write(hostmot2_t *hm2, long period){
     // The ports as well as setting up the pin data
 
     static int doit_err_count, comm_err_flag; // to avoid repeating error messages
-    int b, f, i, p, r; 
-    int bitcount;
-    u64 buff;
-    float val;
+    int f, i, r; 
     
     if (hm2->sserial.num_instances <= 0) return;
     
@@ -1272,81 +1267,7 @@ void hm2_sserial_prepare_tram_write(hostmot2_t *hm2, long period){
                 
                 // All seems well, handle the pins. 
                 for (r = 0 ; r < inst->num_remotes ; r++ ) {
-                    hm2_sserial_remote_t *chan = &inst->remotes[r];
-                    bitcount = 0;
-                    if (chan->reg_0_write) *chan->reg_0_write = 0;
-                    if (chan->reg_1_write) *chan->reg_1_write = 0;
-                    if (chan->reg_2_write) *chan->reg_2_write = 0;
-                    for (p = 0 ; p < chan->num_confs ; p++){
-                        hm2_sserial_data_t *conf = &chan->confs[p];
-                        hm2_sserial_pins_t *pin = &chan->pins[p];
-                        if (conf->DataDir & 0xC0){
-                            switch (conf->DataType){
-                                case LBP_PAD:
-                                    // do nothing
-                                    break;
-                                case LBP_BITS:
-                                    buff = 0;
-                                    for (b = 0 ; b < conf->DataLength ; b++){
-                                        buff |= ((u64)(*pin->bit_pins[b] != 0) << b)
-                                        ^ ((u64)(pin->invert[b] != 0) << b);
-                                    }
-                                    break;
-                                case LBP_UNSIGNED:
-                                    val = *pin->float_pin;
-                                    if (val > pin->maxlim) val = pin->maxlim;
-                                    if (val < pin->minlim) val = pin->minlim;
-				    /* convert to u32 before u64 to
-				     avoid needing __fixunsdfdi() in
-				     libgcc.a from some gccs on 32-bit
-				     arches
-				    */
-                                    buff = (u64)(u32)
-					((val / (float)pin->fullscale)
-					 * (~0ull >> (64 - conf->DataLength)));
-                                    break;
-                                case LBP_SIGNED:
-                                    //this only works if DataLength <= 32
-                                    val = *pin->float_pin;
-                                    if (val > pin->maxlim) val = pin->maxlim;
-                                    if (val < pin->minlim) val = pin->minlim;
-                                    buff = (((s32)(val / pin->fullscale * 2147483647))
-                                            >> (32 - conf->DataLength))
-                                    & (~0ull >> (64 - conf->DataLength));
-                                    break;
-                                case LBP_STREAM:
-                                    buff = *pin->u32_pin & (~0ull >> (64 - conf->DataLength));
-                                    break;
-                                case LBP_BOOLEAN:
-                                    buff = 0;
-                                    if (*pin->boolean ^ *pin->invert){
-                                        buff = (~0ull >> (64 - conf->DataLength));
-                                    }
-                                    break;
-                                case LBP_ENCODER:
-                                     // Would we ever write to a counter? 
-                                    // Assume not for the time being
-                                    break;
-                                case LBP_FLOAT:
-                                    if (conf->DataLength == sizeof(float) * 8 ){
-                                        float temp = *pin->float_pin;
-                                        memcpy(&buff, &temp, sizeof(float));
-                                    } else if (conf->DataLength == sizeof(double) * 8){
-                                        double temp = *pin->float_pin;
-                                        memcpy(&buff, &temp, sizeof(double));
-                                    } else {
-                                        HM2_ERR_NO_LL("sserial write: LBP_FLOAT of bit-length %i not handled\n", conf->DataLength);
-                                        conf->DataType = 0; // only warn once, then ignore
-                                    }
-                                    break;
-                                default:
-                                    HM2_ERR("Unsupported output datatype %i (name ""%s"")\n",
-                                            conf->DataType, conf->NameString);
-                                    
-                            }
-                            bitcount = setbits(chan, &buff, bitcount, conf->DataLength);
-                        }
-                    }
+                    hm2_sserial_write_pins(&inst->remotes[r]);
                 }
                 
                 *inst->command_reg_write = 0x1000 | inst->tag;
@@ -1385,167 +1306,6 @@ void hm2_sserial_prepare_tram_write(hostmot2_t *hm2, long period){
     }
 }
 
-int hm2_sserial_read_pins(hm2_sserial_remote_t *chan){
-    static int h_flag = 0, l_flag = 0;//these are the "memory" for 2-part 
-    static int bitshift = 1;               //Fanuc encoders where the full turns
-    static u64 buff_store;             //and part turns are not contiguous
-    int b, p, r;
-    int bitcount = 0;
-    u64 buff;
-    s32 buff32;
-    s64 buff64;
-    chan->status = *chan->reg_cs_read;
-    for (p=0 ; p < chan->num_confs ; p++){
-        hm2_sserial_data_t *conf = &chan->confs[p];
-        hm2_sserial_pins_t *pin = &chan->pins[p];
-        if (! (conf->DataDir & 0x80)){
-            r = getbits(chan, &buff, bitcount, conf->DataLength);
-            if(r < 0) return r;
-            
-            switch (conf->DataType){
-            case LBP_PAD:
-                // do nothing
-                break;
-            case LBP_BITS:
-                for (b = 0 ; b < conf->DataLength ; b++){
-                    *pin->bit_pins[b] = ((buff & (1LL << b)) != 0);
-                    *pin->bit_pins_not[b] = ! *pin->bit_pins[b];
-                }
-                break;
-            case LBP_UNSIGNED:
-                
-                if (pin->graycode){
-                    u64 mask;
-                    for(mask = buff >> 1 ; mask != 0 ; mask = mask >> 1){
-                        buff ^= mask;
-                    }
-                }
-                
-                *pin->float_pin = (buff * pin->fullscale)
-                / ((1 << conf->DataLength) - 1);
-                break;
-            case LBP_SIGNED:
-                buff32 = (buff & 0xFFFFFFFFL) << (32 - conf->DataLength);
-                *pin->float_pin = (buff32 / 2147483647.0 )
-                                    * pin->fullscale;
-                break;
-            case LBP_STREAM:
-                *pin->u32_pin = buff & (~0ull >> (64 - conf->DataLength));
-                break;
-            case LBP_BOOLEAN:
-                *pin->boolean = (buff != 0);
-                *pin->boolean2 = (buff == 0);
-                break;
-            case LBP_ENCODER_H:
-            case LBP_ENCODER_L:
-                if (conf->DataType == LBP_ENCODER_H){
-                    h_flag = conf->DataLength;
-                    buff_store |= (buff << bitshift);
-                } else {
-                    l_flag = conf->DataLength;
-                    bitshift = conf->DataLength;
-                    buff_store |= buff;
-                }
-                if ( ! (h_flag && l_flag)){
-                    break;
-                }
-                buff = buff_store;
-                /* no break */
-            case LBP_ENCODER:
-            {
-                int bitlength;
-                s32 rem1, rem2;
-                s64 previous;
-                u32 ppr = pin->u32_param;
-                
-                if (conf->DataType == LBP_ENCODER){
-                    bitlength = conf->DataLength;
-                } else {
-                    bitlength = h_flag + l_flag;
-                    h_flag = 0; l_flag = 0;
-                    buff_store = 0;
-                }
-                
-                
-                if (pin->graycode){
-                    u64 mask;
-                    for(mask = buff >> 1 ; mask != 0 ; mask = mask >> 1){
-                        buff ^= mask;
-                    }
-                }
-
-                // sign-extend buff into buff64
-                buff64 = (1U << (bitlength - 1));
-                buff64 = (buff ^ buff64) - buff64;
-                previous = pin->accum;
-
-                if ((buff64 - pin->oldval) > (1 << (bitlength - 2))){
-                    pin->accum -= (1 << bitlength);
-                } else if ((pin->oldval - buff64) > (1 << (bitlength - 2))){
-                    pin->accum += (1 << bitlength);
-                }
-                pin->accum += (buff64 - pin->oldval);
-
-                //reset
-                if (*pin->boolean2){pin->offset = pin->accum;}
-
-                //index-enable
-                if (*pin->boolean && ppr > 0){ // index-enable set
-                    rtapi_div_s64_rem(previous, ppr, &rem1);
-                    rtapi_div_s64_rem(pin->accum, ppr, &rem2);
-                    if (abs(rem1 - rem2) > ppr / 2
-                            || (rem1 >= 0 && rem2 < 0)
-                            || (rem1 < 0 && rem2 >= 0)){
-                        if (pin->accum > previous){
-                            if (pin->accum > 0){
-                                pin->offset = pin->accum - rem2;
-                            } else if (pin->accum < 0){
-                                pin->offset = pin->accum - rem2;
-                            } else {
-                                pin->offset = 0;
-                            }
-                        } else {
-                            if (pin->accum > 0){
-                                pin->offset = pin->accum - rem2 + ppr;
-                            } else if (pin->accum < 0){
-                                pin->offset = pin->accum - rem2;
-                            } else {
-                                pin->offset = 0;
-                            }
-                        }
-                        *pin->boolean = 0;
-                    }
-                }
-                pin->oldval = buff64;
-                *pin->s32_pin = pin->accum - pin->offset;
-                *pin->s32_pin2 = pin->accum;
-                *pin->float_pin = (double)(pin->accum - pin->offset) / pin->fullscale ;
-                break;
-            case LBP_FLOAT:
-                if (conf->DataLength == sizeof(float) * 8){
-                    float temp;
-                    memcpy(&temp, &buff, sizeof(float));
-                    *pin->float_pin = temp;
-                } else if (conf->DataLength == sizeof(double) * 8){
-                    double temp;
-                    memcpy(&temp, &buff, sizeof(double));
-                    *pin->float_pin = temp;
-                } else {
-                    HM2_ERR_NO_LL("sserial read: LBP_FLOAT of bit-length %i not handled\n", conf->DataLength);
-                    conf->DataType = 0; // Only warn once, then ignore
-                }
-                break;
-            }
-            default:
-                HM2_ERR_NO_LL("Unsupported input datatype %i (name ""%s"")\n",
-                        conf->DataType, conf->NameString);
-            }
-            bitcount += conf->DataLength;
-        }
-    }
-    return 0;
-}
-
 void hm2_sserial_process_tram_read(hostmot2_t *hm2, long period){
     int i, c;
     for (i = 0 ; i < hm2->sserial.num_instances ; i++){
@@ -1655,73 +1415,6 @@ int hm2_sserial_get_bytes(hostmot2_t *hm2, hm2_sserial_remote_t *chan, void *buf
     return addr;
 }
 
-int getbits(hm2_sserial_remote_t *chan, u64 *val, int start, int len){
-    long long user0 = (chan->reg_0_read == NULL)? 0 : *chan->reg_0_read;
-    long long user1 = (chan->reg_1_read == NULL)? 0 : *chan->reg_1_read;
-    long long user2 = (chan->reg_2_read == NULL)? 0 : *chan->reg_2_read;
-    long long mask = (~0ull >> (64 - len));
-    
-    if (start + len <= 32){
-        *val = (user0 >> start) & mask;
-    } else if (start + len <= 64){
-        if (start >= 32){
-            *val = (user1 >> (start - 32)) & mask;
-        } else { 
-            *val = (((user1 << 32) | user0) >> start ) & mask;
-        }
-    } else {
-        if (start >= 64){
-            *val = (user2 >> (start - 64)) & mask;
-        } else if (start >= 32) {
-            *val = (((user2 << 32) | user1) >> (start - 32)) & mask;
-        } else {
-            *val = ((user2 << (64 - start)) | (user1 << (32 - start)) 
-                    | (user0 >> start)) & mask;
-        }
-    }
-    return 0;
-}
-
-
-int setbits(hm2_sserial_remote_t *chan, u64 *val, int start, int len){
-    // Assumes that all registers are zeroed elsewhere as required
-    long long mask0, mask1, mask2;
-    int end = start + len;
-    
-    if (end <= 32){
-        mask0 = (~0ull >> (64 - len));
-        *chan->reg_0_write |= (*val  & mask0) << start;
-    } else if (end <= 64){
-        if (start >= 32){
-            mask1 = (~0ull >> (64 - len));
-            *chan->reg_1_write |= (*val & mask1) << (start - 32);
-        } else { 
-            mask0 = (~0ull >> (32 + start));
-            mask1 = (~0ull >> (96 - (end))) << (32 - start);
-            *chan->reg_0_write |= (*val & mask0) << start;
-            *chan->reg_1_write |= (*val & mask1) >> (32 - start);
-        }
-    } else {
-        if (start >= 64){
-            mask2 = (~0ull >> (64 - len));
-            *chan->reg_2_write |= (*val  & mask2) << (start - 64);
-        } else if (start >= 32) {
-            mask1 = (~0ull >> start);
-            mask2 = (~0ull >> (128 - (end))) << (64 - start);
-            *chan->reg_1_write |= (*val & mask1) << (start - 32);
-            *chan->reg_2_write |= (*val & mask2) >> (64 - start);
-        } else {
-            mask0 = (~0ull >> (32 + start));
-            mask1 = (0xFFFFFFFFull << (32 - start));
-            mask2 = (~0ull >> (128 - (end))) << (64 - start);
-            *chan->reg_0_write |= (*val & mask0) << start;
-            *chan->reg_1_write = (*val & mask1) >> (32 - start);
-            *chan->reg_2_write |= (*val & mask2) >> (64 - start);
-        }
-    }
-    return end;
-}
-
 int hm2_sserial_stopstart(hostmot2_t *hm2, hm2_module_descriptor_t *md, 
                           hm2_sserial_instance_t *inst, u32 start_mode){
     u32 buff, addr;
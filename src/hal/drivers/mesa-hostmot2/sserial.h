@@ -189,6 +189,27 @@ typedef struct {
     hal_bit_t *error;
 }hm2_sserial_params_t;
 
+// One field of a remote's process data, compiled from its PTOC
+// descriptor by hm2_sserial_compile_plan().  The field starts at bit
+// 32 * word + shift of the (up to 96) bits in interface registers 0-2.
+typedef struct {
+    u8 type;                // LBP_* data type, LBP_PAD for fields to skip
+    u8 len;                 // bits
+    u8 word;
+    u8 shift;
+    u8 spill;               // reaches into word + 2
+    u8 low_len;             // second half of an LBP_ENCODER_H/L pair: L bits
+    s16 partner;            // ... and the op holding the first half
+    u64 mask;
+    double recip;           // LBP_UNSIGNED: 1 / mask, LBP_SIGNED: 1 / (2^31 - 1)
+    double scale_of;        // encoders: the fullscale that recip_scale is for
+    double recip_scale;
+    u64 held;               // first half of an LBP_ENCODER_H/L pair
+    hm2_sserial_pins_t *pin;
+}hm2_sserial_op_t;
+
+#define HM2_SSERIAL_OP_HOLD     0xFF    // first half of a H/L pair, just kept
+
 typedef struct {
     int num_confs;
     int num_modes;
@@ -201,6 +222,10 @@ typedef struct {
     hm2_sserial_data_t *globals;
     hm2_sserial_pins_t *pins;
     hm2_sserial_params_t *params;
+    hm2_sserial_op_t *read_ops;
+    hm2_sserial_op_t *write_ops;
+    int num_read_ops;
+    int num_write_ops;
     hal_u32_t serialnumber;
     hal_u32_t status;
 
@@ -0,0 +1,400 @@
+//
+//   Copyright (C) 2010 Andy Pugh
+//
+//   This program is free software; you can redistribute it and/or modify
+//   it under the terms of the GNU General Public License as published by
+//   the Free Software Foundation; either version 2 of the License, or
+//   (at your option) any later version.
+//
+//   This program is distributed in the hope that it will be useful,
+//   but WITHOUT ANY WARRANTY; without even the implied warranty of
+//   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//   GNU General Public License for more details.
+//
+//   You should have received a copy of the GNU General Public License
+//   along with this program; if not, write to the Free Software
+//   Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301 USA
+//
+
+//
+// Smart Serial process data, packed into and unpacked from interface
+// registers 0-2 of a remote (or an absolute encoder channel).
+//
+// The PTOC descriptors of a remote are interpreted once, when its pins
+// are created, into a flat list of read and write ops with the bit
+// positions, masks and constant factors worked out.  The per-cycle code
+// only walks those lists.
+//
+
+#include "config_module.h"
+#include RTAPI_INC_STRING_H
+
+#include "rtapi.h"
+#include "rtapi_math.h"
+#include "rtapi_math64.h"
+
+#include "hal.h"
+
+#include "hostmot2.h"
+
+
+static void compile_op(hm2_sserial_op_t *op, hm2_sserial_data_t *conf,
+                       hm2_sserial_pins_t *pin, int bitcount) {
+    op->type = conf->DataType;
+    op->len = conf->DataLength;
+    op->word = bitcount / 32;
+    op->shift = bitcount % 32;
+    op->spill = (op->shift + op->len > 64);
+    op->low_len = 0;
+    op->partner = -1;
+    op->mask = (op->len == 0) ? 0 : (~0ull >> (64 - op->len));
+    op->recip = 0;
+    op->scale_of = 0;
+    op->recip_scale = 0;
+    op->held = 0;
+    op->pin = pin;
+
+    switch (op->type) {
+    case LBP_UNSIGNED:
+        if (op->mask) op->recip = 1.0 / (double)op->mask;
+        break;
+    case LBP_SIGNED:
+        op->recip = 1.0 / 2147483647.0;
+        break;
+    }
+}
+
+
+static int compile_ops(hostmot2_t *hm2, hm2_sserial_remote_t *chan,
+                       hm2_sserial_op_t *ops, int write) {
+    int p, n = 0, bitcount = 0;
+    int first_half = -1;    // op index of an unpaired LBP_ENCODER_H/L
+
+    for (p = 0 ; p < chan->num_confs ; p++){
+        hm2_sserial_data_t *conf = &chan->confs[p];
+        hm2_sserial_op_t *op = &ops[n];
+
+        if (write ? !(conf->DataDir & 0xC0) : (conf->DataDir & 0x80)) continue;
+
+        compile_op(op, conf, &chan->pins[p], bitcount);
+        bitcount += conf->DataLength;
+        n++;
+
+        switch (op->type) {
+        case LBP_PAD:
+        case LBP_BITS:
+        case LBP_UNSIGNED:
+        case LBP_SIGNED:
+        case LBP_STREAM:
+        case LBP_BOOLEAN:
+            break;
+        case LBP_ENCODER:
+            // Would we ever write to a counter?
+            // Assume not for the time being
+            if (write) op->type = LBP_PAD;
+            break;
+        case LBP_ENCODER_H:
+        case LBP_ENCODER_L:
+            if (write) {
+                op->type = LBP_PAD;
+                break;
+            }
+            // Fanuc absolute encoders send full and part turns in two
+            // fields: the first one is held, the second one combines
+            // both and drives the pins, which belong to the H field
+            if (first_half < 0) {
+                first_half = n - 1;
+                break;
+            }
+            if (ops[first_half].type == op->type) {
+                HM2_ERR("%s: two %s encoder halves in a row\n", chan->name,
+                        op->type == LBP_ENCODER_H ? "H" : "L");
+                return -EINVAL;
+            }
+            op->partner = first_half;
+            if (op->type == LBP_ENCODER_L) {
+                op->low_len = op->len;
+                op->pin = ops[first_half].pin;
+            } else {
+                op->low_len = ops[first_half].len;
+            }
+            ops[first_half].type = HM2_SSERIAL_OP_HOLD;
+            first_half = -1;
+            break;
+        case LBP_FLOAT:
+            if (conf->DataLength != sizeof(float) * 8
+                && conf->DataLength != sizeof(double) * 8) {
+                HM2_ERR("sserial %s: LBP_FLOAT of bit-length %i not handled\n",
+                        write ? "write" : "read", conf->DataLength);
+                op->type = LBP_PAD;
+            }
+            break;
+        default:
+            HM2_ERR("Unsupported %s datatype %i (name ""%s"")\n",
+                    write ? "output" : "input", conf->DataType, conf->NameString);
+            op->type = LBP_PAD;
+        }
+    }
+
+    if (first_half >= 0) {
+        HM2_ERR("%s: encoder half without its other half, ignored\n", chan->name);
+        ops[first_half].type = LBP_PAD;
+    }
+    return n;
+}
+
+
+int hm2_sserial_compile_plan(hostmot2_t *hm2, hm2_sserial_remote_t *chan) {
+    int r;
+
+    chan->read_ops = (hm2_sserial_op_t*)hal_malloc((chan->num_confs + 1)
+                                                   * sizeof(hm2_sserial_op_t));
+    chan->write_ops = (hm2_sserial_op_t*)hal_malloc((chan->num_confs + 1)
+                                                    * sizeof(hm2_sserial_op_t));
+    if (chan->read_ops == NULL || chan->write_ops == NULL) {
+        HM2_ERR("out of memory\n");
+        return -ENOMEM;
+    }
+
+    r = compile_ops(hm2, chan, chan->read_ops, 0);
+    if (r < 0) return r;
+    chan->num_read_ops = r;
+
+    r = compile_ops(hm2, chan, chan->write_ops, 1);
+    if (r < 0) return r;
+    chan->num_write_ops = r;
+
+    return 0;
+}
+
+
+static inline u64 extract(const u32 *data, const hm2_sserial_op_t *op) {
+    u64 v = ((u64)data[op->word] | ((u64)data[op->word + 1] << 32)) >> op->shift;
+    if (op->spill) v |= (u64)data[op->word + 2] << (64 - op->shift);
+    return v & op->mask;
+}
+
+
+static inline void insert(u32 *data, const hm2_sserial_op_t *op, u64 v) {
+    u64 lo = (v & op->mask) << op->shift;
+    data[op->word] |= (u32)lo;
+    data[op->word + 1] |= (u32)(lo >> 32);
+    if (op->spill) data[op->word + 2] |= (u32)((v & op->mask) >> (64 - op->shift));
+}
+
+
+static inline u64 gray_to_binary(u64 v) {
+    v ^= v >> 1;
+    v ^= v >> 2;
+    v ^= v >> 4;
+    v ^= v >> 8;
+    v ^= v >> 16;
+    v ^= v >> 32;
+    return v;
+}
+
+
+static void read_encoder(hm2_sserial_op_t *op, u64 buff, int bitlength) {
+    hm2_sserial_pins_t *pin = op->pin;
+    s32 rem1, rem2;
+    s64 previous, buff64;
+    u32 ppr = pin->u32_param;
+
+    if (pin->graycode) buff = gray_to_binary(buff);
+
+    // sign-extend buff into buff64
+    buff64 = (1ULL << (bitlength - 1));
+    buff64 = (buff ^ buff64) - buff64;
+    previous = pin->accum;
+
+    if ((buff64 - pin->oldval) > (1LL << (bitlength - 2))){
+        pin->accum -= (1LL << bitlength);
+    } else if ((pin->oldval - buff64) > (1LL << (bitlength - 2))){
+        pin->accum += (1LL << bitlength);
+    }
+    pin->accum += (buff64 - pin->oldval);
+
+    //reset
+    if (*pin->boolean2){pin->offset = pin->accum;}
+
+    //index-enable
+    if (*pin->boolean && ppr > 0){ // index-enable set
+        rtapi_div_s64_rem(previous, ppr, &rem1);
+        rtapi_div_s64_rem(pin->accum, ppr, &rem2);
+        if (abs(rem1 - rem2) > ppr / 2
+                || (rem1 >= 0 && rem2 < 0)
+                || (rem1 < 0 && rem2 >= 0)){
+            if (pin->accum > previous){
+                if (pin->accum > 0){
+                    pin->offset = pin->accum - rem2;
+                } else if (pin->accum < 0){
+                    pin->offset = pin->accum - rem2;
+                } else {
+                    pin->offset = 0;
+                }
+            } else {
+                if (pin->accum > 0){
+                    pin->offset = pin->accum - rem2 + ppr;
+                } else if (pin->accum < 0){
+                    pin->offset = pin->accum - rem2;
+                } else {
+                    pin->offset = 0;
+                }
+            }
+            *pin->boolean = 0;
+        }
+    }
+    pin->oldval = buff64;
+    *pin->s32_pin = pin->accum - pin->offset;
+    *pin->s32_pin2 = pin->accum;
+
+    // the scale is a parameter, so the reciprocal is only redone when it
+    // has been changed
+    if (pin->fullscale != op->scale_of) {
+        op->scale_of = pin->fullscale;
+        op->recip_scale = 1.0 / pin->fullscale;
+    }
+    *pin->float_pin = (double)(pin->accum - pin->offset) * op->recip_scale;
+}
+
+
+int hm2_sserial_read_pins(hm2_sserial_remote_t *chan){
+    // two spare words so that extract() never needs to check the length
+    u32 data[5] = {
+        (chan->reg_0_read == NULL) ? 0 : *chan->reg_0_read,
+        (chan->reg_1_read == NULL) ? 0 : *chan->reg_1_read,
+        (chan->reg_2_read == NULL) ? 0 : *chan->reg_2_read,
+        0, 0 };
+    int b, o;
+    u64 buff;
+    s32 buff32;
+
+    chan->status = *chan->reg_cs_read;
+    for (o = 0 ; o < chan->num_read_ops ; o++){
+        hm2_sserial_op_t *op = &chan->read_ops[o];
+        hm2_sserial_pins_t *pin = op->pin;
+
+        switch (op->type){
+        case LBP_PAD:
+            break;
+        case HM2_SSERIAL_OP_HOLD:
+            op->held = extract(data, op);
+            break;
+        case LBP_BITS:
+            buff = extract(data, op);
+            for (b = 0 ; b < op->len ; b++){
+                *pin->bit_pins[b] = (buff >> b) & 1;
+                *pin->bit_pins_not[b] = ! *pin->bit_pins[b];
+            }
+            break;
+        case LBP_UNSIGNED:
+            buff = extract(data, op);
+            if (pin->graycode) buff = gray_to_binary(buff);
+            *pin->float_pin = buff * pin->fullscale * op->recip;
+            break;
+        case LBP_SIGNED:
+            buff32 = (extract(data, op) & 0xFFFFFFFFL) << (32 - op->len);
+            *pin->float_pin = buff32 * op->recip * pin->fullscale;
+            break;
+        case LBP_STREAM:
+            *pin->u32_pin = extract(data, op);
+            break;
+        case LBP_BOOLEAN:
+            buff = extract(data, op);
+            *pin->boolean = (buff != 0);
+            *pin->boolean2 = (buff == 0);
+            break;
+        case LBP_ENCODER:
+            read_encoder(op, extract(data, op), op->len);
+            break;
+        case LBP_ENCODER_H: // second half of a pair, the L half is held
+            buff = (extract(data, op) << op->low_len)
+                   | chan->read_ops[op->partner].held;
+            read_encoder(op, buff, op->len + op->low_len);
+            break;
+        case LBP_ENCODER_L:
+            buff = (chan->read_ops[op->partner].held << op->low_len)
+                   | extract(data, op);
+            read_encoder(op, buff, op->len + chan->read_ops[op->partner].len);
+            break;
+        case LBP_FLOAT:
+            buff = extract(data, op);
+            if (op->len == sizeof(float) * 8){
+                float temp;
+                u32 buff32u = buff;
+                memcpy(&temp, &buff32u, sizeof(float));
+                *pin->float_pin = temp;
+            } else {
+                double temp;
+                memcpy(&temp, &buff, sizeof(double));
+                *pin->float_pin = temp;
+            }
+            break;
+        }
+    }
+    return 0;
+}
+
+
+void hm2_sserial_write_pins(hm2_sserial_remote_t *chan){
+    u32 data[5] = { 0, 0, 0, 0, 0 };
+    int b, o;
+    u64 buff;
+    float val;
+
+    for (o = 0 ; o < chan->num_write_ops ; o++){
+        hm2_sserial_op_t *op = &chan->write_ops[o];
+        hm2_sserial_pins_t *pin = op->pin;
+
+        switch (op->type){
+        case LBP_BITS:
+            buff = 0;
+            for (b = 0 ; b < op->len ; b++){
+                buff |= ((u64)((*pin->bit_pins[b] != 0) ^ (pin->invert[b] != 0)) << b);
+            }
+            break;
+        case LBP_UNSIGNED:
+            val = *pin->float_pin;
+            if (val > pin->maxlim) val = pin->maxlim;
+            if (val < pin->minlim) val = pin->minlim;
+            /* convert to u32 before u64 to
+             avoid needing __fixunsdfdi() in
+             libgcc.a from some gccs on 32-bit
+             arches
+            */
+            buff = (u64)(u32)((val / (float)pin->fullscale) * op->mask);
+            break;
+        case LBP_SIGNED:
+            //this only works if DataLength <= 32
+            val = *pin->float_pin;
+            if (val > pin->maxlim) val = pin->maxlim;
+            if (val < pin->minlim) val = pin->minlim;
+            buff = ((s32)(val / pin->fullscale * 2147483647)) >> (32 - op->len);
+            break;
+        case LBP_STREAM:
+            buff = *pin->u32_pin;
+            break;
+        case LBP_BOOLEAN:
+            buff = (*pin->boolean ^ *pin->invert) ? ~0ull : 0;
+            break;
+        case LBP_FLOAT:
+            if (op->len == sizeof(float) * 8){
+                float temp = *pin->float_pin;
+                u32 buff32u;
+                memcpy(&buff32u, &temp, sizeof(float));
+                buff = buff32u;
+            } else {
+                double temp = *pin->float_pin;
+                memcpy(&buff, &temp, sizeof(double));
+            }
+            break;
+        default: // LBP_PAD
+            continue;
+        }
+        insert(data, op, buff);
+    }
+
+    if (chan->reg_0_write) *chan->reg_0_write = data[0];
+    if (chan->reg_1_write) *chan->reg_1_write = data[1];
+    if (chan->reg_2_write) *chan->reg_2_write = data[2];
+}
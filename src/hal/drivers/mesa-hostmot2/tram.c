@@ -31,6 +31,33 @@
 
 
 
+// the count field of an LBP16 command (hm2_eth) is 7 bits, so a merged
+// run stops at 127 registers; the other llios have no such limit, but
+// longer runs gain nothing there
+#define HM2_TRAM_MAX_RUN (127 * sizeof(u32))
+
+
+static int hm2_register_tram_region(hostmot2_t *hm2, struct list_head *entries, u16 addr, u16 size, u32 **buffer, u8 flags) {
+    hm2_tram_entry_t *tram_entry;
+
+    tram_entry = kmalloc(sizeof(hm2_tram_entry_t), GFP_KERNEL);
+    if (tram_entry == NULL) {
+        HM2_ERR("out of memory!\n");
+        return -ENOMEM;
+    }
+
+    tram_entry->addr = addr;
+    tram_entry->size = size;
+    tram_entry->buffer = buffer;
+    tram_entry->offset = 0;
+    tram_entry->flags = flags;
+
+    list_add_tail(&tram_entry->list, entries);
+
+    return 0;
+}
+
+
 //
 // This function is called by the MD parsers.  It records that in the
 // specified hm2 instance, the specified register address range should be
@@ -44,101 +71,195 @@
 //
 
 int hm2_register_tram_read_region(hostmot2_t *hm2, u16 addr, u16 size, u32 **buffer) {
-    hm2_tram_entry_t *tram_entry;
+    return hm2_register_tram_region(hm2, &hm2->tram_read_entries, addr, size, buffer, 0);
+}
 
-    tram_entry = kmalloc(sizeof(hm2_tram_entry_t), GFP_KERNEL);
-    if (tram_entry == NULL) {
-        HM2_ERR("out of memory!\n");
-        return -ENOMEM;
-    }
 
-    tram_entry->addr = addr;
-    tram_entry->size = size;
-    tram_entry->buffer = buffer;
+int hm2_register_tram_write_region(hostmot2_t *hm2, u16 addr, u16 size, u32 **buffer) {
+    return hm2_register_tram_region(hm2, &hm2->tram_write_entries, addr, size, buffer, 0);
+}
 
-    list_add_tail(&tram_entry->list, &hm2->tram_read_entries);
 
-    return 0;
+//
+// The same for registers where the access itself does something (FIFOs,
+// command registers): the planner does not reorder these relative to
+// other entries, and dirty-write mode writes them every cycle.
+//
+
+int hm2_register_tram_read_strobe_region(hostmot2_t *hm2, u16 addr, u16 size, u32 **buffer) {
+    return hm2_register_tram_region(hm2, &hm2->tram_read_entries, addr, size, buffer, HM2_TRAM_STROBE);
 }
 
 
-int hm2_register_tram_write_region(hostmot2_t *hm2, u16 addr, u16 size, u32 **buffer) {
-    hm2_tram_entry_t *tram_entry;
+int hm2_register_tram_write_strobe_region(hostmot2_t *hm2, u16 addr, u16 size, u32 **buffer) {
+    return hm2_register_tram_region(hm2, &hm2->tram_write_entries, addr, size, buffer, HM2_TRAM_STROBE);
+}
 
-    tram_entry = kmalloc(sizeof(hm2_tram_entry_t), GFP_KERNEL);
-    if (tram_entry == NULL) {
-        HM2_ERR("out of memory!\n");
-        return -ENOMEM;
-    }
 
-    tram_entry->addr = addr;
-    tram_entry->size = size;
-    tram_entry->buffer = buffer;
+//
+// Sort the entries between strobe entries by address (stable), so that
+// registers of different instances or channels that were registered
+// interleaved end up next to each other.
+//
 
-    list_add_tail(&tram_entry->list, &hm2->tram_write_entries);
+static void hm2_tram_sort(struct list_head *entries) {
+    struct list_head sorted, *ptr, *next, *pos;
 
-    return 0;
+    INIT_LIST_HEAD(&sorted);
+    list_for_each_safe(ptr, next, entries) {
+        hm2_tram_entry_t *tram_entry = list_entry(ptr, hm2_tram_entry_t, list);
+
+        list_del(ptr);
+        pos = sorted.prev;
+        if (!(tram_entry->flags & HM2_TRAM_STROBE)) {
+            while (pos != &sorted) {
+                hm2_tram_entry_t *prev = list_entry(pos, hm2_tram_entry_t, list);
+                if ((prev->flags & HM2_TRAM_STROBE) || prev->addr <= tram_entry->addr) break;
+                pos = pos->prev;
+            }
+        }
+        list_add(ptr, pos);
+    }
+    list_splice(&sorted, entries);
 }
 
 
-int hm2_allocate_tram_regions(hostmot2_t *hm2) {
+//
+// Lay out one direction's buffer in sorted entry order, carrying over the
+// contents of entries placed by an earlier call, and plan the runs.
+//
+
+static int hm2_tram_plan(hostmot2_t *hm2, struct list_head *entries, u32 **buffer, u16 *size, hm2_tram_run_t **runs, int *num_runs) {
     struct list_head *ptr;
+    hm2_tram_run_t *run = NULL;
+    u32 *new_buffer;
+    int num_entries = 0;
     u16 offset;
 
-    int old_tram_read_size = hm2->tram_read_size;
-    int old_tram_write_size = hm2->tram_write_size;
+    hm2_tram_sort(entries);
 
-    hm2->tram_read_size = 0;
-    list_for_each(ptr, &hm2->tram_read_entries) {
+    *size = 0;
+    list_for_each(ptr, entries) {
         hm2_tram_entry_t *tram_entry = list_entry(ptr, hm2_tram_entry_t, list);
-        hm2->tram_read_size += tram_entry->size;
+        *size += tram_entry->size;
+        num_entries++;
     }
 
-    hm2->tram_write_size = 0;
-    list_for_each(ptr, &hm2->tram_write_entries) {
-        hm2_tram_entry_t *tram_entry = list_entry(ptr, hm2_tram_entry_t, list);
-        hm2->tram_write_size += tram_entry->size;
+    new_buffer = kmalloc(*size ? *size : sizeof(u32), GFP_KERNEL);
+    if (new_buffer == NULL) return -ENOMEM;
+    memset(new_buffer, 0, *size);
+
+    kfree(*runs);
+    *num_runs = 0;
+    *runs = kmalloc((num_entries ? num_entries : 1) * sizeof(hm2_tram_run_t), GFP_KERNEL);
+    if (*runs == NULL) {
+        kfree(new_buffer);
+        return -ENOMEM;
     }
 
-    HM2_DBG(
-        "allocating Translation RAM buffers (reading %d bytes, writing %d bytes)\n",
-        hm2->tram_read_size,
-        hm2->tram_write_size
-    );
+    offset = 0;
+    list_for_each(ptr, entries) {
+        hm2_tram_entry_t *tram_entry = list_entry(ptr, hm2_tram_entry_t, list);
 
-    hm2->tram_read_buffer = (u32 *)krealloc(hm2->tram_read_buffer, hm2->tram_read_size, GFP_KERNEL);
-    if (hm2->tram_read_buffer == NULL) {
-        HM2_ERR("Error while (re)allocating Translation RAM read buffer (%d bytes)\n", hm2->tram_read_size);
-        return -ENOMEM;
+        if ((tram_entry->flags & HM2_TRAM_PLACED) && *buffer != NULL)
+            memcpy((u8*)new_buffer + offset, (u8*)*buffer + tram_entry->offset, tram_entry->size);
+        tram_entry->offset = offset;
+        tram_entry->flags |= HM2_TRAM_PLACED;
+        *tram_entry->buffer = (u32*)((u8*)new_buffer + offset);
+        offset += tram_entry->size;
+        HM2_DBG("    addr=0x%04x, size=%d, buffer=%p%s\n", tram_entry->addr, tram_entry->size, *tram_entry->buffer,
+            (tram_entry->flags & HM2_TRAM_STROBE) ? " (strobe)" : "");
+
+        // entries are laid out back to back, so an entry that continues
+        // the previous one's address range continues its run
+        if (run != NULL
+            && tram_entry->addr == run->addr + run->size
+            && (tram_entry->flags & HM2_TRAM_RUNFLAGS) == run->flags
+            && run->size + tram_entry->size <= HM2_TRAM_MAX_RUN) {
+            run->size += tram_entry->size;
+            continue;
+        }
+        run = &(*runs)[(*num_runs)++];
+        run->addr = tram_entry->addr;
+        run->size = tram_entry->size;
+        run->offset = tram_entry->offset;
+        run->flags = tram_entry->flags & HM2_TRAM_RUNFLAGS;
     }
-    if(hm2->tram_read_size>old_tram_read_size)
-        memset(hm2->tram_read_buffer+old_tram_read_size, 0, hm2->tram_read_size-old_tram_read_size);
 
-    hm2->tram_write_buffer = (u32 *)krealloc(hm2->tram_write_buffer, hm2->tram_write_size, GFP_KERNEL);
-    if (hm2->tram_write_buffer == NULL) {
-        HM2_ERR("Error while (re)allocating Translation RAM write buffer (%d bytes)\n", hm2->tram_write_size);
-        return -ENOMEM;
+    kfree(*buffer);
+    *buffer = new_buffer;
+
+    HM2_DBG("    %d entries in %d runs\n", num_entries, *num_runs);
+    return 0;
+}
+
+
+//
+// Mark the write entries whose registers are also read back: the firmware
+// may change those (the sserial interface registers carry the reply), so
+// the write shadow says nothing about what the register holds now.
+//
+
+static void hm2_tram_mark_shared(hostmot2_t *hm2) {
+    struct list_head *wptr, *rptr;
+
+    list_for_each(wptr, &hm2->tram_write_entries) {
+        hm2_tram_entry_t *w = list_entry(wptr, hm2_tram_entry_t, list);
+
+        list_for_each(rptr, &hm2->tram_read_entries) {
+            hm2_tram_entry_t *r = list_entry(rptr, hm2_tram_entry_t, list);
+            if (w->addr < r->addr + r->size && r->addr < w->addr + w->size) {
+                w->flags |= HM2_TRAM_SHARED;
+                break;
+            }
+        }
     }
-    if(hm2->tram_write_size>old_tram_write_size)
-        memset(hm2->tram_write_buffer+old_tram_write_size, 0, hm2->tram_write_size-old_tram_write_size);
+}
+
+
+int hm2_allocate_tram_regions(hostmot2_t *hm2) {
+    int r;
+
+    hm2_tram_mark_shared(hm2);
 
-    HM2_DBG("buffer address %p\n", &hm2->tram_write_buffer);
     HM2_DBG("Translation RAM read buffer:\n");
-    offset = 0;
-    list_for_each(ptr, &hm2->tram_read_entries) {
-        hm2_tram_entry_t *tram_entry = list_entry(ptr, hm2_tram_entry_t, list);
-        *tram_entry->buffer = (u32*)((u8*)hm2->tram_read_buffer + offset);
-        offset += tram_entry->size;
-        HM2_DBG("    addr=0x%04x, size=%d, buffer=%p\n", tram_entry->addr, tram_entry->size, *tram_entry->buffer);
+    r = hm2_tram_plan(hm2, &hm2->tram_read_entries, &hm2->tram_read_buffer, &hm2->tram_read_size,
+                      &hm2->tram_read_runs, &hm2->num_tram_read_runs);
+    if (r < 0) {
+        HM2_ERR("Error while (re)allocating Translation RAM read buffer\n");
+        return r;
     }
 
     HM2_DBG("Translation RAM write buffer:\n");
-    offset = 0;
-    list_for_each(ptr, &hm2->tram_write_entries) {
-        hm2_tram_entry_t *tram_entry = list_entry(ptr, hm2_tram_entry_t, list);
-        *tram_entry->buffer = (u32*)((u8*)hm2->tram_write_buffer + offset);
-        offset += tram_entry->size;
-        HM2_DBG("    addr=0x%04x, size=%d, buffer=%p\n", tram_entry->addr, tram_entry->size, *tram_entry->buffer);
+    r = hm2_tram_plan(hm2, &hm2->tram_write_entries, &hm2->tram_write_buffer, &hm2->tram_write_size,
+                      &hm2->tram_write_runs, &hm2->num_tram_write_runs);
+    if (r < 0) {
+        HM2_ERR("Error while (re)allocating Translation RAM write buffer\n");
+        return r;
+    }
+
+    HM2_DBG(
+        "allocated Translation RAM buffers (reading %d bytes in %d runs, writing %d bytes in %d runs)\n",
+        hm2->tram_read_size, hm2->num_tram_read_runs,
+        hm2->tram_write_size, hm2->num_tram_write_runs
+    );
+
+    if (hm2->config.dirty_writes > 0) {
+        int size = hm2->tram_write_size ? hm2->tram_write_size : sizeof(u32);
+
+        kfree(hm2->tram_write_shadow);
+        kfree(hm2->tram_write_pending);
+        hm2->tram_write_shadow = kmalloc(size, GFP_KERNEL);
+        hm2->tram_write_pending = kmalloc(size, GFP_KERNEL);
+        if (hm2->tram_write_shadow == NULL || hm2->tram_write_pending == NULL) {
+            HM2_ERR("Error while allocating Translation RAM write shadow (%d bytes)\n", hm2->tram_write_size);
+            kfree(hm2->tram_write_shadow);
+            kfree(hm2->tram_write_pending);
+            hm2->tram_write_shadow = NULL;
+            hm2->tram_write_pending = NULL;
+            return -ENOMEM;
+        }
+        hm2->tram_write_countdown = 0;
     }
 
     return 0;
@@ -147,13 +268,13 @@ int hm2_allocate_tram_regions(hostmot2_t *hm2) {
 
 static u32 tram_read_iteration = 0;
 int hm2_tram_read(hostmot2_t *hm2) {
-    struct list_head *ptr;
+    int i;
 
-    list_for_each(ptr, &hm2->tram_read_entries) {
-        hm2_tram_entry_t *tram_entry = list_entry(ptr, hm2_tram_entry_t, list);
+    for (i = 0; i < hm2->num_tram_read_runs; i++) {
+        hm2_tram_run_t *run = &hm2->tram_read_runs[i];
 
-        if (!hm2->llio->queue_read(hm2->llio, tram_entry->addr, *tram_entry->buffer, tram_entry->size)) {
-            HM2_ERR("TRAM read error! (addr=0x%04x, size=%d, iter=%u)\n", tram_entry->addr, tram_entry->size, tram_read_iteration);
+        if (!hm2->llio->queue_read(hm2->llio, run->addr, (u8*)hm2->tram_read_buffer + run->offset, run->size)) {
+            HM2_ERR("TRAM read error! (addr=0x%04x, size=%d, iter=%u)\n", run->addr, run->size, tram_read_iteration);
             return -EIO;
         }
     }
@@ -190,30 +311,107 @@ int hm2_finish_read(hostmot2_t *hm2) {
 
 
 static u32 tram_write_iteration = 0;
-int hm2_tram_write(hostmot2_t *hm2) {
-    struct list_head *ptr;
 
-    list_for_each(ptr, &hm2->tram_write_entries) {
-        hm2_tram_entry_t *tram_entry = list_entry(ptr, hm2_tram_entry_t, list);
+static int hm2_tram_queue_write(hostmot2_t *hm2, u16 addr, u16 offset, u16 size) {
+    if (!hm2->llio->queue_write(hm2->llio, addr, (u8*)hm2->tram_write_buffer + offset, size)) {
+        HM2_ERR("TRAM write error! (addr=0x%04x, size=%d, iter=%u)\n", addr, size, tram_write_iteration);
+        return -EIO;
+    }
+    if (hm2->tram_write_pending != NULL)
+        memcpy((u8*)hm2->tram_write_pending + offset, (u8*)hm2->tram_write_buffer + offset, size);
+    return 0;
+}
+
+//
+// The queued writes reached the board: the shadow takes what was queued.
+// hm2_tram_write() starts the pending copy from the shadow, so writes
+// that were queued but never sent are dropped.
+//
+
+static void hm2_tram_write_sent(hostmot2_t *hm2) {
+    if (hm2->tram_write_shadow == NULL) return;
+    memcpy(hm2->tram_write_shadow, hm2->tram_write_pending,
+        hm2->tram_write_size ? hm2->tram_write_size : sizeof(u32));
+}
 
-        if (!hm2->llio->queue_write(hm2->llio, tram_entry->addr, *tram_entry->buffer, tram_entry->size)) {
-            HM2_ERR("TRAM write error! (addr=0x%04x, size=%d, iter=%u)\n", tram_entry->addr, tram_entry->size, tram_write_iteration);
+//
+// In dirty-write mode (the dirty_writes=N config option), only queue the
+// registers of a run that changed since they were last sent.  Runs of
+// strobe registers and of registers that are also read are always
+// queued whole.  A clean
+// register between two dirty ones is sent along, which is cheaper than a
+// second command header.  Lost writes are caught by the llio (hm2_eth
+// confirms each write packet) setting needs_soft_reset, which forces a
+// full write, as does every Nth cycle.
+//
+
+static int hm2_tram_write_dirty(hostmot2_t *hm2, hm2_tram_run_t *run) {
+    u32 *cur = (u32*)((u8*)hm2->tram_write_buffer + run->offset);
+    u32 *old = (u32*)((u8*)hm2->tram_write_shadow + run->offset);
+    int n = run->size / sizeof(u32);
+    int i = 0;
+
+    while (i < n) {
+        int first, last;
+
+        while (i < n && cur[i] == old[i]) i++;
+        if (i == n) break;
+        first = last = i++;
+        while (i < n) {
+            if (cur[i] != old[i]) last = i;
+            else if (i - last > 1) break;
+            i++;
+        }
+        if (hm2_tram_queue_write(hm2, run->addr + first * sizeof(u32),
+                run->offset + first * sizeof(u32), (last - first + 1) * sizeof(u32)))
             return -EIO;
+    }
+    return 0;
+}
+
+int hm2_tram_write(hostmot2_t *hm2) {
+    int i, full = 1;
+
+    if (hm2->tram_write_shadow != NULL) {
+        if (hm2->llio->needs_soft_reset || hm2->tram_write_countdown <= 0) {
+            hm2->tram_write_countdown = hm2->config.dirty_writes;
+        } else {
+            full = 0;
         }
+        hm2->tram_write_countdown--;
+        memcpy(hm2->tram_write_pending, hm2->tram_write_shadow,
+            hm2->tram_write_size ? hm2->tram_write_size : sizeof(u32));
+    }
+
+    for (i = 0; i < hm2->num_tram_write_runs; i++) {
+        hm2_tram_run_t *run = &hm2->tram_write_runs[i];
+        int r;
+
+        if (full || (run->flags & (HM2_TRAM_STROBE | HM2_TRAM_SHARED)))
+            r = hm2_tram_queue_write(hm2, run->addr, run->offset, run->size);
+        else
+            r = hm2_tram_write_dirty(hm2, run);
+        if (r) return r;
     }
     tram_write_iteration ++;
 
     return 0;
 }
 
+// make the next hm2_tram_write() a full one
+void hm2_tram_force_write(hostmot2_t *hm2) {
+    hm2->tram_write_countdown = 0;
+}
+
 int hm2_finish_write(hostmot2_t *hm2) {
-    if (!hm2->llio->send_queued_writes) return 0;
-    if (!hm2->llio->send_queued_writes(hm2->llio)) {
+    // without send_queued_writes, queue_write wrote to the board
+    if (hm2->llio->send_queued_writes && !hm2->llio->send_queued_writes(hm2->llio)) {
         HM2_ERR("error finishing write! iter=%u)\n",
             tram_write_iteration);
         return -EIO;
     }
 
+    hm2_tram_write_sent(hm2);
     return 0;
 }
 
@@ -235,5 +433,9 @@ void hm2_tram_cleanup(hostmot2_t *hm2) {
     // free the tram buffers
     if (hm2->tram_read_buffer != NULL) kfree(hm2->tram_read_buffer);
     if (hm2->tram_write_buffer != NULL) kfree(hm2->tram_write_buffer);
+    if (hm2->tram_write_shadow != NULL) kfree(hm2->tram_write_shadow);
+    if (hm2->tram_write_pending != NULL) kfree(hm2->tram_write_pending);
+    if (hm2->tram_read_runs != NULL) kfree(hm2->tram_read_runs);
+    if (hm2->tram_write_runs != NULL) kfree(hm2->tram_write_runs);
 }
 
@@ -802,6 +802,40 @@ static inline int hal_unlink(const char *pin_name) {
     return halg_unlink(1, pin_name);
 }
 
+/** 'halg_bulk()' applies a batch of link and set operations as one
+    transaction, for configuration scripts issuing them by the thousand.
+    All names are resolved in one pass over the HAL objects, and types,
+    directions and values of all items are checked - in order, as if
+    each was done by itself - before the first one is applied. Then
+    all of them are applied under one hold of the HAL mutex, with one
+    memory barrier for all the links.
+    HAL_BULK_NET links pin 'name' to signal 'arg', creating the signal
+    with the pin's type if needed, as 'net' does. HAL_BULK_SETP sets
+    writable parameter or unlinked input pin 'name', and HAL_BULK_SETS
+    sets signal 'name' without writers, to the value in text form 'arg'.
+    HAL_BULK_NET items are refused under HAL_LOCK_CONFIG, and
+    HAL_BULK_SETP/SETS items under HAL_LOCK_PARAMS, as part of the check.
+    On success, returns 0. On failure nothing was changed, a negative
+    error code is returned, and if 'failed' is not NULL, *failed is
+    set to the index of the item in error (or -1 if none was at fault).
+*/
+typedef enum {
+    HAL_BULK_NET,
+    HAL_BULK_SETP,
+    HAL_BULK_SETS,
+} hal_bulk_op_t;
+
+typedef struct {
+    hal_bulk_op_t op;
+    const char *name;
+    const char *arg;
+} hal_bulk_item_t;
+
+int halg_bulk(const int use_hal_mutex,
+	      const hal_bulk_item_t *items,
+	      const int count,
+	      int *failed);
+
 /***********************************************************************
 *                     "PARAMETER" FUNCTIONS                            *
 ************************************************************************/
@@ -0,0 +1,431 @@
+// bulk link and set operations, see halg_bulk() in hal.h
+//
+// a configuration script doing thousands of 'net' and 'setp' pays for
+// a mutex round trip and a walk of the object list per name, and a
+// memory barrier per link. halg_bulk() instead indexes the pins, params
+// and signals once, checks the whole batch against the index - in
+// order, tracking the signals and links the batch itself creates - and
+// only then applies it, under the same hold of the HAL mutex.
+
+#include "config.h"
+#include "rtapi.h"		/* RTAPI realtime OS API */
+#include "hal.h"		/* HAL public API decls */
+#include "hal_priv.h"		/* HAL private decls */
+#include "hal_internal.h"
+
+#include <stdlib.h>		/* qsort(), bsearch(), strto*() */
+#include <string.h>
+#include <strings.h>		/* strcasecmp() */
+#include <ctype.h>
+
+typedef struct {
+    const char *name;
+    int type;			// HAL_PIN, HAL_PARAM or HAL_SIGNAL
+    hal_object_ptr o;
+} bulk_ref_t;
+
+typedef struct {		// a signal as it will be after the batch
+    const char *name;
+    hal_sig_t *sig;		// NULL until created
+    int type;			// HAL_TYPE_UNSPECIFIED until a pin decides
+    int writers, bidirs;
+    bool touched;		// linked to by the batch
+} bulk_sig_t;
+
+typedef struct {		// a pin the batch links
+    hal_pin_t *pin;
+    bulk_sig_t *bs;		// set once its NET item is checked
+} bulk_pin_t;
+
+typedef struct {		// an item, resolved and checked
+    hal_object_ptr o;		// the pin or param, NULL for SETS
+    bulk_sig_t *bs;		// NET, SETS
+    hal_type_t type;		// of value
+    hal_data_u value;
+    bool skip;			// NET of a pin already on the signal
+} bulk_res_t;
+
+typedef struct {
+    bulk_ref_t *refs;
+    size_t nrefs, size;
+    bulk_sig_t *sigs;
+    int nsigs;
+    bulk_pin_t *pins;
+    int npins;
+    bulk_res_t *res;
+} bulk_t;
+
+static int index_object(hal_object_ptr o, foreach_args_t *args)
+{
+    bulk_t *b = args->user_ptr1;
+    int type = hh_get_object_type(o.hdr);
+
+    if ((type != HAL_PIN) && (type != HAL_PARAM) && (type != HAL_SIGNAL))
+	return 0;
+    if (b->nrefs == b->size) {
+	size_t size = b->size ? b->size * 2 : 1024;
+	bulk_ref_t *refs = realloc(b->refs, size * sizeof(bulk_ref_t));
+	if (refs == NULL)
+	    return -ENOMEM;
+	b->refs = refs;
+	b->size = size;
+    }
+    b->refs[b->nrefs].name = hh_get_name(o.hdr);
+    b->refs[b->nrefs].type = type;
+    b->refs[b->nrefs].o = o;
+    b->nrefs++;
+    return 0;
+}
+
+static int cmp_ref(const void *a, const void *b)
+{
+    const bulk_ref_t *ra = a, *rb = b;
+    if (ra->type != rb->type)
+	return ra->type - rb->type;
+    return strcmp(ra->name, rb->name);
+}
+
+static hal_object_ptr lookup(bulk_t *b, int type, const char *name)
+{
+    bulk_ref_t key = { .name = name, .type = type };
+    bulk_ref_t *ref = bsearch(&key, b->refs, b->nrefs,
+			      sizeof(bulk_ref_t), cmp_ref);
+    return ref ? ref->o : HO_NULL;
+}
+
+static int cmp_sig(const void *a, const void *b)
+{
+    return strcmp(((const bulk_sig_t *) a)->name,
+		  ((const bulk_sig_t *) b)->name);
+}
+
+static bulk_sig_t *find_sig(bulk_t *b, const char *name)
+{
+    bulk_sig_t key = { .name = name };
+    return bsearch(&key, b->sigs, b->nsigs, sizeof(bulk_sig_t), cmp_sig);
+}
+
+static int cmp_pin(const void *a, const void *b)
+{
+    const hal_pin_t *pa = ((const bulk_pin_t *) a)->pin;
+    const hal_pin_t *pb = ((const bulk_pin_t *) b)->pin;
+    return (pa > pb) - (pa < pb);
+}
+
+static bulk_pin_t *find_pin(bulk_t *b, hal_pin_t *pin)
+{
+    bulk_pin_t key = { .pin = pin };
+    return bsearch(&key, b->pins, b->npins, sizeof(bulk_pin_t), cmp_pin);
+}
+
+// text to value, as halcmd setp/sets accept it
+static int parse_value(hal_type_t type, const char *text, hal_data_u *v)
+{
+    char *cp = (char *) text;
+
+    switch (type) {
+    case HAL_BIT:
+	if ((strcmp("1", text) == 0) || (strcasecmp("TRUE", text) == 0))
+	    v->b = 1;
+	else if ((strcmp("0", text) == 0) || (strcasecmp("FALSE", text) == 0))
+	    v->b = 0;
+	else
+	    return -EINVAL;
+	return 0;
+    case HAL_FLOAT:
+	v->f = strtod(text, &cp);
+	break;
+    case HAL_S32:
+	v->s = strtol(text, &cp, 0);
+	break;
+    case HAL_U32:
+	v->u = strtoul(text, &cp, 0);
+	break;
+    case HAL_S64:
+	v->ls = strtoll(text, &cp, 0);
+	break;
+    case HAL_U64:
+	v->lu = strtoull(text, &cp, 0);
+	break;
+    default:
+	return -EINVAL;
+    }
+    if ((cp == text) || ((*cp != '\0') && !isspace(*cp)))
+	return -EINVAL;
+    return 0;
+}
+
+// store only the member of type, the rest of *dst may be live
+static void set_value(hal_type_t type, hal_data_u *dst, const hal_data_u *src)
+{
+    switch (type) {
+    case HAL_BIT:   dst->b = src->b; break;
+    case HAL_FLOAT: dst->f = src->f; break;
+    case HAL_S32:   dst->s = src->s; break;
+    case HAL_U32:   dst->u = src->u; break;
+    case HAL_S64:   dst->ls = src->ls; break;
+    case HAL_U64:   dst->lu = src->lu; break;
+    default: break;
+    }
+}
+
+// collect the signals and pins the batch refers to
+static int bulk_prepare(bulk_t *b, const hal_bulk_item_t *items,
+			const int count, int *failed)
+{
+    int i, n;
+
+    for (i = 0; i < count; i++) {
+	const hal_bulk_item_t *item = &items[i];
+
+	*failed = i;
+	if ((item->name == NULL) || (item->arg == NULL))
+	    HALFAIL_RC(EINVAL, "item %d: name and argument required", i);
+	if (strlen(item->name) >= HAL_NAME_LEN)
+	    HALFAIL_RC(EINVAL, "name '%s' too long", item->name);
+
+	switch (item->op) {
+	case HAL_BULK_NET:
+	    if (strlen(item->arg) >= HAL_NAME_LEN)
+		HALFAIL_RC(EINVAL, "signal name '%s' too long", item->arg);
+	    b->sigs[b->nsigs++].name = item->arg;
+	    if ((b->pins[b->npins].pin =
+		 lookup(b, HAL_PIN, item->name).pin) == NULL)
+		HALFAIL_RC(EINVAL, "pin '%s' not found", item->name);
+	    b->npins++;
+	    break;
+	case HAL_BULK_SETS:
+	    b->sigs[b->nsigs++].name = item->name;
+	    break;
+	case HAL_BULK_SETP:
+	    break;
+	default:
+	    HALFAIL_RC(EINVAL, "item %d: invalid operation %d", i, item->op);
+	}
+    }
+    *failed = -1;
+
+    // one record per distinct signal and pin
+    qsort(b->sigs, b->nsigs, sizeof(bulk_sig_t), cmp_sig);
+    for (i = n = 0; i < b->nsigs; i++)
+	if ((n == 0) || strcmp(b->sigs[n - 1].name, b->sigs[i].name))
+	    b->sigs[n++] = b->sigs[i];
+    b->nsigs = n;
+    for (i = 0; i < b->nsigs; i++) {
+	bulk_sig_t *bs = &b->sigs[i];
+
+	bs->sig = lookup(b, HAL_SIGNAL, bs->name).sig;
+	if (bs->sig) {
+	    bs->type = bs->sig->type;
+	    bs->writers = bs->sig->writers;
+	    bs->bidirs = bs->sig->bidirs;
+	} else {
+	    bs->type = HAL_TYPE_UNSPECIFIED;
+	}
+    }
+    qsort(b->pins, b->npins, sizeof(bulk_pin_t), cmp_pin);
+    for (i = n = 0; i < b->npins; i++)
+	if ((n == 0) || (b->pins[n - 1].pin != b->pins[i].pin))
+	    b->pins[n++] = b->pins[i];
+    b->npins = n;
+    return 0;
+}
+
+// check one item against the state the items before it leave
+static int bulk_check(bulk_t *b, const hal_bulk_item_t *item, bulk_res_t *r)
+{
+    bulk_pin_t *bp;
+    hal_pin_t *pin;
+    hal_param_t *param;
+    bulk_sig_t *bs;
+    int lock;
+
+    // a link needs the config unlocked, a plain set only the params
+    lock = (item->op == HAL_BULK_NET) ? HAL_LOCK_CONFIG : HAL_LOCK_PARAMS;
+    if (hal_data->lock & lock)
+	HALFAIL_RC(EPERM, "'%s': called while HAL is locked (%d)",
+		   item->name, lock);
+
+    switch (item->op) {
+    case HAL_BULK_NET:
+	bs = r->bs = find_sig(b, item->arg);
+	pin = r->o.pin = lookup(b, HAL_PIN, item->name).pin;
+	bp = find_pin(b, pin);
+
+	if ((bs->sig == NULL) && (lookup(b, HAL_PIN, bs->name).pin != NULL))
+	    HALFAIL_RC(EINVAL, "signal name '%s' must not be the same as a pin",
+		       bs->name);
+	if (bp->bs != NULL) {
+	    if (bp->bs != bs)
+		HALFAIL_RC(EINVAL, "pin '%s' was already linked to signal '%s'",
+			   item->name, bp->bs->name);
+	    r->skip = true;
+	    return 0;
+	}
+	if (pin_is_linked(pin)) {
+	    if ((bs->sig == NULL) || (signal_of(pin) != bs->sig))
+		HALFAIL_RC(EINVAL, "pin '%s' was already linked to signal '%s'",
+			   item->name, ho_name(signal_of(pin)));
+	    bp->bs = bs;
+	    r->skip = true;
+	    return 0;
+	}
+	if (bs->type == HAL_TYPE_UNSPECIFIED)
+	    bs->type = pin->type;
+	if (bs->type != pin->type)
+	    HALFAIL_RC(EINVAL, "signal '%s' of type %d cannot add pin '%s' "
+		       "of type %d", bs->name, bs->type, item->name, pin->type);
+	if ((pin->dir == HAL_OUT) && (bs->writers || bs->bidirs))
+	    HALFAIL_RC(EINVAL, "signal '%s' already has output or I/O pin(s), "
+		       "can not add '%s'", bs->name, item->name);
+	if ((pin->dir == HAL_IO) && bs->writers)
+	    HALFAIL_RC(EINVAL, "signal '%s' already has an output pin, "
+		       "can not add '%s'", bs->name, item->name);
+	if (pin->dir == HAL_OUT)
+	    bs->writers++;
+	if (pin->dir == HAL_IO)
+	    bs->bidirs++;
+	bp->bs = bs;
+	return 0;
+
+    case HAL_BULK_SETP:
+	if ((param = lookup(b, HAL_PARAM, item->name).param) != NULL) {
+	    if (param->dir == HAL_RO)
+		HALFAIL_RC(EINVAL, "param '%s' is not writable", item->name);
+	    r->o.param = param;
+	    r->type = param->type;
+	} else if ((pin = lookup(b, HAL_PIN, item->name).pin) != NULL) {
+	    hal_comp_t *comp = halpr_find_owning_comp(ho_owner_id(pin));
+
+	    if ((pin->dir == HAL_OUT) && comp && (comp->state != COMP_UNBOUND))
+		HALFAIL_RC(EINVAL, "pin '%s' is not writable", item->name);
+	    bp = find_pin(b, pin);
+	    if (pin_is_linked(pin) || (bp && bp->bs))
+		HALFAIL_RC(EINVAL, "pin '%s' is connected to a signal",
+			   item->name);
+	    r->o.pin = pin;
+	    r->type = pin->type;
+	} else {
+	    HALFAIL_RC(EINVAL, "parameter or pin '%s' not found", item->name);
+	}
+	break;
+
+    case HAL_BULK_SETS:
+	bs = r->bs = find_sig(b, item->name);
+	if (bs->type == HAL_TYPE_UNSPECIFIED)
+	    HALFAIL_RC(EINVAL, "signal '%s' not found", item->name);
+	if (bs->writers > 0)
+	    HALFAIL_RC(EINVAL, "signal '%s' already has writer(s)", item->name);
+	r->type = bs->type;
+	break;
+    }
+    if (parse_value(r->type, item->arg, &r->value))
+	HALFAIL_RC(EINVAL, "value '%s' invalid for '%s'", item->arg, item->name);
+    return 0;
+}
+
+static int bulk_apply(bulk_t *b, const hal_bulk_item_t *items,
+		      const int count, int *failed)
+{
+    int i, retval;
+
+    for (i = 0; i < count; i++) {
+	bulk_res_t *r = &b->res[i];
+	bulk_sig_t *bs = r->bs;
+
+	*failed = i;
+	switch (items[i].op) {
+	case HAL_BULK_NET:
+	    if (r->skip)
+		break;
+	    if ((bs->sig == NULL) &&
+		((bs->sig = halpr_signal_new(bs->name, bs->type)) == NULL))
+		return _halerrno;
+	    if ((retval = link_pin(r->o.pin, bs->sig)) < 0)
+		return retval;
+	    bs->touched = true;
+	    break;
+	case HAL_BULK_SETP:
+	    if (hh_get_object_type(r->o.hdr) == HAL_PARAM)
+		set_value(r->type, param_value(r->o.param), &r->value);
+	    else
+		set_value(r->type, &r->o.pin->dummysig, &r->value);
+	    break;
+	case HAL_BULK_SETS:
+	    set_value(r->type, sig_value(bs->sig), &r->value);
+	    break;
+	}
+    }
+    *failed = -1;
+
+    // one barrier for all links, then propagate per signal
+    rtapi_smp_wmb();
+    for (i = 0; i < b->nsigs; i++)
+	if (b->sigs[i].touched)
+	    halg_signal_propagate_barriers(0, b->sigs[i].sig);
+    return 0;
+}
+
+int halg_bulk(const int use_hal_mutex,
+	      const hal_bulk_item_t *items,
+	      const int count,
+	      int *failed)
+{
+    bulk_t b;
+    int i, nnew, retval, failed_dummy;
+
+    if (failed == NULL)
+	failed = &failed_dummy;
+    *failed = -1;
+
+    CHECK_HALDATA();
+    if (count <= 0)
+	return 0;
+
+    memset(&b, 0, sizeof(b));
+    if (((b.sigs = calloc(count, sizeof(bulk_sig_t))) == NULL) ||
+	((b.pins = calloc(count, sizeof(bulk_pin_t))) == NULL) ||
+	((b.res = calloc(count, sizeof(bulk_res_t))) == NULL)) {
+	retval = -ENOMEM;
+	HALERR("halg_bulk: out of memory for %d items", count);
+	goto out;
+    }
+    {
+	WITH_HAL_MUTEX_IF(use_hal_mutex);
+
+	foreach_args_t args =  {
+	    .user_ptr1 = &b,
+	};
+	if ((retval = halg_foreach(false, &args, index_object)) < 0) {
+	    HALERR("halg_bulk: out of memory indexing HAL objects");
+	    goto out;
+	}
+	qsort(b.refs, b.nrefs, sizeof(bulk_ref_t), cmp_ref);
+
+	if ((retval = bulk_prepare(&b, items, count, failed)) < 0)
+	    goto out;
+	for (i = 0; i < count; i++) {
+	    if ((retval = bulk_check(&b, &items[i], &b.res[i])) < 0) {
+		*failed = i;
+		goto out;
+	    }
+	}
+
+	// signal creation is the only allocation - make sure it succeeds
+	for (i = nnew = 0; i < b.nsigs; i++)
+	    if ((b.sigs[i].sig == NULL) &&
+		(b.sigs[i].type != HAL_TYPE_UNSPECIFIED))
+		nnew++;
+	if ((retval = halpr_reserve(nnew * (sizeof(hal_sig_t) + 64), 0)) < 0)
+	    goto out;
+
+	retval = bulk_apply(&b, items, count, failed);
+	HALDBG("%d items applied: %d", count, retval);
+    }
+ out:
+    free(b.refs);
+    free(b.sigs);
+    free(b.pins);
+    free(b.res);
+    return retval;
+}
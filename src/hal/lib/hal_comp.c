@@ -492,7 +492,32 @@ static int create_instance(const hal_funct_args_t *fa)
     if (inst) {
 	HALFAIL_RC(EBUSY,"instance '%s' already exists", iname);
     }
-    return comp->ctor(argc, argv);
+    int retval = comp->ctor(argc, argv);
+    if (retval < 0)
+	return retval;
+
+    // keep the arguments, as insmod_args for a comp
+    size_t len = 1;
+    int i;
+    for (i = 2; i < argc; i++)
+	len += strlen(argv[i]) + 1;
+    {
+	WITH_HAL_MUTEX();
+
+	inst = halpr_find_inst_by_name(iname);
+	if ((inst == NULL) || (argc < 3))
+	    return retval;
+	char *s = shmalloc_desc(len);
+	if (s == NULL)
+	    return retval; // no reason to fail the instance
+	for (i = 2; i < argc; i++) {
+	    strcat(s, argv[i]);
+	    if (i < argc - 1)
+		strcat(s, " ");
+	}
+	inst->inst_args = SHMOFF(s);
+    }
+    return retval;
 }
 
 static int delete_instance(const hal_funct_args_t *fa)
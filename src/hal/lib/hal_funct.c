@@ -194,6 +194,87 @@ int hal_call_usrfunct(const char *name, const int argc, char * const *argv,
 	*ureturn = retval;
     return 0;
 }
+// add funct to thread at position - call with the HAL mutex held
+int halpr_add_funct_to_thread(hal_funct_t *funct,
+			      hal_thread_t *thread,
+			      const int position,
+			      const int read_barrier,
+			      const int write_barrier)
+{
+    hal_list_t *list_root, *list_entry;
+    hal_funct_entry_t *funct_entry;
+    int n;
+
+    /* make sure position is valid */
+    if (position == 0) {
+	/* zero is not allowed */
+	HALFAIL_RC(EINVAL, "bad position: 0");
+    }
+    // type-check the functions which go onto threads
+    switch (funct->type) {
+    case FS_LEGACY_THREADFUNC:
+    case FS_XTHREADFUNC:
+	break;
+    default:
+	HALFAIL_RC(EINVAL, "cant add type %d function '%s' "
+		   "to a thread", funct->type, ho_name(funct));
+    }
+    /* found the function, is it available? */
+    if ((funct->users > 0) && (funct->reentrant == 0)) {
+	HALFAIL_RC(EINVAL, "function '%s' may only be added "
+		   "to one thread", ho_name(funct));
+    }
+    /* ok, we have thread and function, are they compatible? */
+    if ((funct->uses_fp) && (!thread->uses_fp)) {
+	HALFAIL_RC(EINVAL, "function '%s' needs FP", ho_name(funct));
+    }
+    /* find insertion point */
+    list_root = &(thread->funct_list);
+    list_entry = list_root;
+    n = 0;
+    if (position > 0) {
+	/* insertion is relative to start of list */
+	while (++n < position) {
+	    /* move further into list */
+	    list_entry = dlist_next(list_entry);
+	    if (list_entry == list_root) {
+		/* reached end of list */
+		HALFAIL_RC(EINVAL, "position '%d' is too high", position);
+	    }
+	}
+    } else {
+	/* insertion is relative to end of list */
+	while (--n > position) {
+	    /* move further into list */
+	    list_entry = dlist_prev(list_entry);
+	    if (list_entry == list_root) {
+		/* reached end of list */
+		HALFAIL_RC(EINVAL, "position '%d' is too low", position);
+	    }
+	}
+	/* want to insert before list_entry, so back up one more step */
+	list_entry = dlist_prev(list_entry);
+    }
+    /* allocate a funct entry structure */
+    funct_entry = alloc_funct_entry_struct();
+    if (funct_entry == 0)
+	NOMEM("thread->function link");
+
+    /* init struct contents */
+    funct_entry->funct_ptr = SHMOFF(funct);
+    funct_entry->arg = funct->arg;
+    funct_entry->funct.l = funct->funct.l;
+    funct_entry->rmb = read_barrier;
+    funct_entry->wmb = write_barrier;
+    funct_entry->type = funct->type;
+
+    /* add the entry to the list */
+    dlist_add_after((hal_list_t *) funct_entry, list_entry);
+    /* update the function usage count */
+    funct->users++;
+    return 0;
+}
+
 int hal_add_funct_to_thread(const char *funct_name,
 			    const char *thread_name,
 			    const int position,
@@ -201,9 +282,6 @@ int hal_add_funct_to_thread(const char *funct_name,
 			    const int write_barrier)
 {
     hal_funct_t *funct;
-    hal_list_t *list_root, *list_entry;
-    int n;
-    hal_funct_entry_t *funct_entry;
     char buff[HAL_NAME_LEN + 1];
     rtapi_snprintf(buff, HAL_NAME_LEN, "%s.funct", funct_name);
 
@@ -218,12 +296,6 @@ int hal_add_funct_to_thread(const char *funct_name,
 
 	hal_thread_t *thread;
 
-	/* make sure position is valid */
-	if (position == 0) {
-	    /* zero is not allowed */
-	    HALFAIL_RC(EINVAL, "bad position: 0");
-	}
-
 	/* search function list for the function */
 	funct = halpr_find_funct_by_name(funct_name);
 	if (funct == NULL) {
@@ -233,76 +305,15 @@ int hal_add_funct_to_thread(const char *funct_name,
 	    } else
 		HALWARN("'%s' should be added to thread as '%s' ", funct_name, buff);
 	}
-	// type-check the functions which go onto threads
-	switch (funct->type) {
-	case FS_LEGACY_THREADFUNC:
-	case FS_XTHREADFUNC:
-	    break;
-	default:
-	    HALFAIL_RC(EINVAL, "cant add type %d function '%s' "
-		   "to a thread", funct->type, funct_name);
-	}
-	/* found the function, is it available? */
-	if ((funct->users > 0) && (funct->reentrant == 0)) {
-	    HALFAIL_RC(EINVAL, "function '%s' may only be added "
-		       "to one thread", funct_name);
-	}
 	/* search thread list for thread_name */
 	thread = halpr_find_thread_by_name(thread_name);
 	if (thread == 0) {
 	    /* thread not found */
 	    HALFAIL_RC(EINVAL, "thread '%s' not found", thread_name);
 	}
-	/* ok, we have thread and function, are they compatible? */
-	if ((funct->uses_fp) && (!thread->uses_fp)) {
-	    HALFAIL_RC(EINVAL, "function '%s' needs FP", funct_name);
-	}
-	/* find insertion point */
-	list_root = &(thread->funct_list);
-	list_entry = list_root;
-	n = 0;
-	if (position > 0) {
-	    /* insertion is relative to start of list */
-	    while (++n < position) {
-		/* move further into list */
-		list_entry = dlist_next(list_entry);
-		if (list_entry == list_root) {
-		    /* reached end of list */
-		    HALFAIL_RC(EINVAL, "position '%d' is too high", position);
-		}
-	    }
-	} else {
-	    /* insertion is relative to end of list */
-	    while (--n > position) {
-		/* move further into list */
-		list_entry = dlist_prev(list_entry);
-		if (list_entry == list_root) {
-		    /* reached end of list */
-		    HALFAIL_RC(EINVAL, "position '%d' is too low", position);
-		}
-	    }
-	    /* want to insert before list_entry, so back up one more step */
-	    list_entry = dlist_prev(list_entry);
-	}
-	/* allocate a funct entry structure */
-	funct_entry = alloc_funct_entry_struct();
-	if (funct_entry == 0)
-	    NOMEM("thread->function link");
-
-	/* init struct contents */
-	funct_entry->funct_ptr = SHMOFF(funct);
-	funct_entry->arg = funct->arg;
-	funct_entry->funct.l = funct->funct.l;
-	funct_entry->rmb = read_barrier;
-	funct_entry->wmb = write_barrier;
-	funct_entry->type = funct->type;
-
-	/* add the entry to the list */
-	dlist_add_after((hal_list_t *) funct_entry, list_entry);
-	/* update the function usage count */
-	funct->users++;
+	return halpr_add_funct_to_thread(funct, thread, position,
+					 read_barrier, write_barrier);
     }
-    return 0;
 }
 
 int hal_del_funct_from_thread(const char *funct_name, const char *thread_name)
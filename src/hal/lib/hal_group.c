@@ -9,6 +9,8 @@
 #if defined(ULAPI)
 #include <stdlib.h>		/* malloc()/free() */
 #include <assert.h>
+#include <signal.h>		/* kill() */
+#include <unistd.h>		/* getpid() */
 #endif
 
 int halg_group_new(const int use_hal_mutex,const char *name, int arg1, int arg2)
@@ -33,6 +35,7 @@ int halg_group_new(const int use_hal_mutex,const char *name, int arg1, int arg2)
 
 	group->userarg1 = arg1;
 	group->userarg2 = arg2;
+	group->snap_ptr = 0;
 
 	halg_add_object(false, (hal_object_ptr)group);
 	return 0;
@@ -391,6 +394,11 @@ int hal_cgroup_free(hal_compiled_group_t *cgroup)
 {
     if (cgroup == NULL)
 	HALFAIL_RC(ENOENT, "null cgroup");
+    if (cgroup->snapshot &&
+	(cgroup->snapshot->writer == getpid()))
+	cgroup->snapshot->writer = 0;
+    if (cgroup->snap_values)
+	free(cgroup->snap_values);
     if (cgroup->tracking)
 	free(cgroup->tracking);
     if (cgroup->changed)
@@ -400,6 +408,191 @@ int hal_cgroup_free(hal_compiled_group_t *cgroup)
     free(cgroup);
     return 0;
 }
+
+// published snapshots - see hal_group.h
+
+static int snapshot_size_cb(hal_object_ptr o, foreach_args_t *args)
+{
+    args->user_arg1++;
+    return 0;
+}
+
+static int snapshot_check_cb(hal_object_ptr o, foreach_args_t *args)
+{
+    hal_snapshot_t *s = args->user_ptr1;
+    hal_sig_t *sig = SHMPTR(o.member->sig_ptr);
+    int i = args->user_arg1++;
+
+    if ((s->entry[i].handle != ho_id(sig)) ||
+	(s->entry[i].type != sig_type(sig)))
+	args->user_arg2++; // mismatch
+    return 0;
+}
+
+static int snapshot_init_cb(hal_object_ptr o, foreach_args_t *args)
+{
+    hal_snapshot_t *s = args->user_ptr1;
+    hal_sig_t *sig = SHMPTR(o.member->sig_ptr);
+    int i = args->user_arg1++;
+
+    s->entry[i].handle = ho_id(sig);
+    s->entry[i].type = sig_type(sig);
+    hal_snapshot_values(s)[i] = *sig_value(sig);
+    return 0;
+}
+
+// the snapshot block of a group, laid out for its current members;
+// created, or recreated if the members changed. Call with the HAL mutex
+// held. A block in use can never be recreated: its readers and writer
+// hold references to the group, which prevents member changes.
+static hal_snapshot_t *snapshot_attach(hal_group_t *grp)
+{
+    hal_snapshot_t *s = NULL;
+    foreach_args_t args =  {
+	.type = HAL_MEMBER,
+	.owner_id = ho_id(grp),
+    };
+    halg_foreach(0, &args, snapshot_size_cb);
+    int n = args.user_arg1;
+
+    if (grp->snap_ptr) {
+	s = SHMPTR(grp->snap_ptr);
+	if (s->n_members == n) {
+	    args.user_ptr1 = s;
+	    args.user_arg1 = 0;
+	    args.user_arg2 = 0;
+	    halg_foreach(0, &args, snapshot_check_cb);
+	    if (args.user_arg2 == 0)
+		return s;
+	}
+	HALDBG("group '%s' changed, recreating its snapshot", ho_name(grp));
+	shmfree_desc(s);
+	grp->snap_ptr = 0;
+    }
+
+    size_t size = sizeof(hal_snapshot_t) +
+	n * (sizeof(hal_snapshot_entry_t) + sizeof(hal_data_u));
+    if ((s = shmalloc_desc(size)) == NULL)
+	HALFAIL_NULL(ENOMEM, "insufficient memory for snapshot of group '%s'"
+		     " (%zu bytes)", ho_name(grp), size);
+    memset(s, 0, size);
+    s->magic = SNAPSHOT_MAGIC;
+    s->n_members = n;
+    args.user_ptr1 = s;
+    args.user_arg1 = 0;
+    halg_foreach(0, &args, snapshot_init_cb);
+    grp->snap_ptr = SHMOFF(s);
+    HALDBG("group '%s': snapshot of %d members, %zu bytes",
+	   ho_name(grp), n, size);
+    return s;
+}
+
+hal_snapshot_t *hal_snapshot_open(const char *name)
+{
+    if ((hal_data == NULL) || (name == NULL))
+	HALFAIL_NULL(EINVAL, "HAL not initialized or no group name");
+    {
+	WITH_HAL_MUTEX();
+
+	hal_group_t *grp = halpr_find_group_by_name(name);
+	if (grp == NULL)
+	    HALFAIL_NULL(ENOENT, "group '%s' not found", name);
+	if (!(grp->userarg2 & GROUP_PUBLISH_SNAPSHOT))
+	    HALFAIL_NULL(EINVAL, "group '%s' is not published as a snapshot", name);
+
+	hal_snapshot_t *s = snapshot_attach(grp);
+	if (s == NULL)
+	    return NULL;
+	ho_incref(grp);
+	return s;
+    }
+}
+
+int hal_snapshot_close(const char *name)
+{
+    return hal_unref_group(name);
+}
+
+int hal_snapshot_index(const hal_snapshot_t *s, int handle)
+{
+    int i;
+
+    for (i = 0; i < s->n_members; i++)
+	if (s->entry[i].handle == handle)
+	    return i;
+    return -ENOENT;
+}
+
+int hal_snapshot_lookup(const hal_snapshot_t *s, const char *signal)
+{
+    hal_sig_t *sig;
+    {
+	WITH_HAL_MUTEX();
+	if ((sig = halpr_find_sig_by_name(signal)) == NULL)
+	    return -ENOENT;
+    }
+    return hal_snapshot_index(s, ho_id(sig));
+}
+
+int hal_cgroup_publish(hal_compiled_group_t *cg)
+{
+    hal_group_t *grp;
+    hal_snapshot_t *s;
+    int i;
+
+    HAL_ASSERT(cg->magic == CGROUP_MAGIC);
+    if (cg->snapshot)
+	return 0;
+    grp = cg->group;
+    {
+	WITH_HAL_MUTEX();
+
+	if ((s = snapshot_attach(grp)) == NULL)
+	    return _halerrno;
+	if (s->writer && (s->writer != getpid()) && (kill(s->writer, 0) == 0))
+	    HALFAIL_RC(EBUSY, "snapshot of group '%s' already published by pid %d",
+		       ho_name(grp), s->writer);
+	s->writer = getpid();
+    }
+    // the compiled member order is the snapshot entry order
+    HAL_ASSERT(s->n_members == cg->n_members);
+    for (i = 0; i < cg->n_members; i++)
+	HAL_ASSERT(s->entry[i].handle ==
+		   ho_id((hal_sig_t *) SHMPTR(cg->member[i]->sig_ptr)));
+
+    if ((cg->snap_values = calloc(cg->n_members, sizeof(hal_data_u))) == NULL)
+	NOMEM("snapshot values of group '%s'", ho_name(grp));
+    cg->snapshot = s;
+    return 0;
+}
+
+int hal_cgroup_snapshot(hal_compiled_group_t *cg)
+{
+    hal_snapshot_t *s = cg->snapshot;
+    hal_data_u *v, *scan = cg->snap_values;
+    int i, changed = 0;
+
+    if (s == NULL)
+	HALFAIL_RC(EINVAL, "group '%s' not published", ho_name(cg->group));
+    v = hal_snapshot_values(s);
+
+    // only the writer stores v, so it may compare against it unlocked
+    for (i = 0; i < cg->n_members; i++) {
+	hal_sig_t *sig = SHMPTR(cg->member[i]->sig_ptr);
+	scan[i].lu = rtapi_load_u64(&sig_value(sig)->lu);
+	changed |= (scan[i].lu != v[i].lu);
+    }
+    if (changed) {
+	rtapi_store_u32(&s->seq, s->seq + 1);
+	rtapi_smp_wmb();
+	for (i = 0; i < cg->n_members; i++)
+	    v[i] = scan[i];
+	rtapi_smp_wmb();
+	rtapi_store_u32(&s->seq, s->seq + 1);
+    }
+    rtapi_store_s64(&s->scanned, rtapi_get_time());
+    return changed;
+}
 #endif // ULAPI
 
 void free_group_struct(hal_group_t * group)
@@ -410,5 +603,7 @@ void free_group_struct(hal_group_t * group)
 	.owner_id = ho_id(group),
     };
     halg_foreach(0, &args, yield_free);
+    if (group->snap_ptr)
+	shmfree_desc(SHMPTR(group->snap_ptr));
     halg_free_object(false, (hal_object_ptr)group);
 }
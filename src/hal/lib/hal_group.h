@@ -13,6 +13,7 @@ typedef struct hal_group {
     halhdr_t hdr;		// common HAL object header
     int userarg1;	        /* interpreted by using layer */
     int userarg2;	        /* interpreted by using layer */
+    int snap_ptr;		// published snapshot, 0 if none - see below
 } hal_group_t;
 
 // members are subordinate to a group identified by the group_id
@@ -26,6 +27,8 @@ typedef struct hal_member {
     __u8 eps_index;             // index into haldata->epsilon[]; default 0
 } hal_member_t;
 
+struct hal_snapshot;
+
 #define CGROUP_MAGIC  0xbeef7411
 typedef struct hal_compiled_group {
     int magic;
@@ -39,6 +42,8 @@ typedef struct hal_compiled_group {
     hal_data_u    *tracking;     // tracking values of monitored pins
     unsigned long user_flags;    // uninterpreted by HAL code
     void *user_data;             // uninterpreted by HAL code
+    struct hal_snapshot *snapshot; // set by hal_cgroup_publish()
+    hal_data_u    *snap_values;  // values of the last scan
 } hal_compiled_group_t;
 
 typedef int (*group_report_callback_t)(int,  hal_compiled_group_t *,
@@ -97,6 +102,12 @@ static inline int hal_cgroup_timer(hal_compiled_group_t *cgroup)
 	HALFAIL_RC(EINVAL, "invalid cgroup");
     return cgroup->group->userarg1;
 }
+static inline int hal_cgroup_flags(hal_compiled_group_t *cgroup)
+{
+    if (!cgroup || !cgroup->group)
+	HALFAIL_RC(EINVAL, "invalid cgroup");
+    return cgroup->group->userarg2;
+}
 extern int halpr_group_compile(const char *name, hal_compiled_group_t **cgroup);
 extern int hal_cgroup_match(hal_compiled_group_t *cgroup);
 
@@ -152,6 +163,11 @@ int demo_report(int phase, hal_compiled_group_t *cgroup, hal_sig_t *sig,
 #define GROUP_REPORT_CHANGED_MEMBERS 4
 // halcmd keyword: reportchanged reportall
 
+//              bit 3=1..publish a shared memory snapshot of the member
+//                     values for local readers, see below
+#define GROUP_PUBLISH_SNAPSHOT 8
+// halcmd keyword: snapshot
+
 // the following combination of attributes makes no sense and will
 // cause an error message by hal_compile_group():
 // - the GROUP_REPORT_ON_CHANGE bit is set in group.arg2
@@ -189,5 +205,128 @@ static inline hal_group_t *halpr_find_group_by_name(const char *name){
 }
 
 
+// published group snapshots
+//
+// the member values of a group with the GROUP_PUBLISH_SNAPSHOT bit are
+// published in a block of HAL shared memory by the reporting layer
+// (haltalk), so a process on the same host can read a consistent set of
+// values directly instead of subscribing over zeroMQ and decoding
+// protobuf.
+//
+// the block is a seqlock: the writer makes seq odd, stores the values and
+// makes seq even again; a reader copies the values and retries if seq was
+// odd or has moved meanwhile. Readers never block the writer or each
+// other. seq/2 is the snapshot version, which advances only when a value
+// changed; 'scanned' advances on every scan, so a reader can tell a quiet
+// group from a dead writer.
+//
+// the entries are in member order; values follow the entries. A reader
+// opens a snapshot by group name, which references the group so its
+// members, hence the layout, cannot change while it is open:
+//
+//   hal_snapshot_t *s = hal_snapshot_open("status");
+//   int x = hal_snapshot_lookup(s, "x-pos");  // or hal_snapshot_index(handle)
+//   hal_data_u v[s->n_members];
+//   hal_u32_t version;
+//   if (hal_snapshot_read(s, v, &version) == 0)
+//       ... v[x].f ...
+//   hal_snapshot_close("status");
+
+#define SNAPSHOT_MAGIC 0x534e4150
+
+typedef struct hal_snapshot_entry {
+    int handle;			// signal id, the handle haltalk reports
+    int type;			// hal_type_t of the signal
+} hal_snapshot_entry_t;
+
+typedef struct hal_snapshot {
+    int magic;
+    int n_members;
+    hal_u32_t seq;		// odd while the values are being updated
+    int writer;			// pid of the publishing process, 0 if none
+    hal_s64_t scanned;		// rtapi_get_time() of the last scan
+    hal_snapshot_entry_t entry[]; // n_members entries, then n_members values
+} hal_snapshot_t;
+
+static inline hal_data_u *hal_snapshot_values(const hal_snapshot_t *s)
+{
+    return (hal_data_u *) &s->entry[s->n_members];
+}
+
+// current version, cheap enough to poll
+static inline hal_u32_t hal_snapshot_version(const hal_snapshot_t *s)
+{
+    return rtapi_load_u32(&s->seq) >> 1;
+}
+
+// a reader gives up after this many attempts: the writer died or stalled
+// in the middle of an update (a preempted writer gets some millisecond)
+#define SNAPSHOT_TRIES (1 << 20)
+
+// copy all values consistently and store their version
+// returns 0, or -EAGAIN if no consistent copy could be taken - see
+// 'writer' and 'scanned' whether the writer is still alive
+static inline int hal_snapshot_read(const hal_snapshot_t *s,
+				    hal_data_u *values, hal_u32_t *version)
+{
+    const hal_data_u *v = hal_snapshot_values(s);
+    hal_u32_t seq;
+    int i, tries;
+
+    for (tries = 0; tries < SNAPSHOT_TRIES; tries++) {
+	seq = rtapi_load_u32(&s->seq);
+	if (seq & 1)
+	    continue;
+	rtapi_smp_rmb();
+	for (i = 0; i < s->n_members; i++)
+	    values[i] = v[i];
+	rtapi_smp_rmb();
+	if (rtapi_load_u32(&s->seq) == seq) {
+	    if (version)
+		*version = seq >> 1;
+	    return 0;
+	}
+    }
+    return -EAGAIN;
+}
+
+// one value at entry index, and optionally its version
+// returns 0 or -EAGAIN as hal_snapshot_read()
+static inline int hal_snapshot_get(const hal_snapshot_t *s, int index,
+				   hal_data_u *value, hal_u32_t *version)
+{
+    hal_u32_t seq;
+    int tries;
+
+    for (tries = 0; tries < SNAPSHOT_TRIES; tries++) {
+	seq = rtapi_load_u32(&s->seq);
+	if (seq & 1)
+	    continue;
+	rtapi_smp_rmb();
+	*value = hal_snapshot_values(s)[index];
+	rtapi_smp_rmb();
+	if (rtapi_load_u32(&s->seq) == seq) {
+	    if (version)
+		*version = seq >> 1;
+	    return 0;
+	}
+    }
+    return -EAGAIN;
+}
+
+// reader side
+extern hal_snapshot_t *hal_snapshot_open(const char *group);
+extern int hal_snapshot_close(const char *group);
+// entry index of a member by signal handle or name, -ENOENT if none
+extern int hal_snapshot_index(const hal_snapshot_t *s, int handle);
+extern int hal_snapshot_lookup(const hal_snapshot_t *s, const char *signal);
+
+// writer side, on a compiled group: attach to the group's snapshot
+// block, creating it as needed; then publish the current values on
+// every scan - returns 1 if they changed, 0 if not
+extern int hal_cgroup_publish(hal_compiled_group_t *cgroup);
+extern int hal_cgroup_snapshot(hal_compiled_group_t *cgroup);
+
+
 RTAPI_END_DECLS
 #endif // HAL_GROUP_H
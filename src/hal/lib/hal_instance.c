@@ -48,7 +48,7 @@ int halg_inst_create(const int use_hal_mutex,
 
 	inst->inst_data_ptr = SHMOFF(m);
 	inst->inst_size = size;
-	inst->frozen_argv = NULL; // set in create_instance post-call
+	inst->inst_args = 0; // set in create_instance post-call
 
 	HALDBG("%s: creating instance '%s' size %d",
 #ifdef RTAPI
@@ -148,9 +148,9 @@ void free_inst_struct(hal_inst_t * inst)
     args.type = HAL_PLUG;
     halg_foreach(0, &args, yield_free);  // free plugs
 
-    // free frozen argv if any
-    if (inst->frozen_argv) {
-	halg_free_argv(0, inst->frozen_argv);
+    // free the argument string if any
+    if (inst->inst_args) {
+	shmfree_desc(SHMPTR(inst->inst_args));
     }
     // now we can delete the instance itself
     halg_free_object(false, (hal_object_ptr) inst);
@@ -59,6 +59,7 @@ extern int lib_module_id;
 extern int lib_mem_id;
 
 void unlink_pin(hal_pin_t * pin);
+int link_pin(hal_pin_t *pin, hal_sig_t *sig);
 
 void free_pin_struct(hal_pin_t * pin);
 
@@ -396,6 +396,7 @@ EXPORT_SYMBOL(halg_free_str);
 EXPORT_SYMBOL(halg_dupargv);
 EXPORT_SYMBOL(halg_free_argv);
 EXPORT_SYMBOL(halg_free_single_str);
+EXPORT_SYMBOL(halpr_reserve);
 
 // hal_pin.c:
 // EXPORT_SYMBOL(halg_pin_new);
@@ -421,10 +422,15 @@ EXPORT_SYMBOL(hal_pin_s64_newf);
 EXPORT_SYMBOL(halg_signal_new);
 EXPORT_SYMBOL(halg_signal_delete);
 EXPORT_SYMBOL(halg_link);
+EXPORT_SYMBOL(halpr_signal_new);
+EXPORT_SYMBOL(halpr_link);
 EXPORT_SYMBOL(halg_unlink);
 EXPORT_SYMBOL(halg_foreach_pin_by_signal);
 EXPORT_SYMBOL(halg_signal_setbarriers);
 
+// hal_bulk.c:
+EXPORT_SYMBOL(halg_bulk);
+
 // hal_param.c:
 EXPORT_SYMBOL(halg_param_newfv); // v2 base function
 EXPORT_SYMBOL(halg_param_newf);
@@ -455,6 +461,7 @@ EXPORT_SYMBOL(hal_export_functf);
 EXPORT_SYMBOL(hal_export_xfunctf);
 EXPORT_SYMBOL(halg_export_xfunctf);
 EXPORT_SYMBOL(hal_add_funct_to_thread);
+EXPORT_SYMBOL(halpr_add_funct_to_thread);
 EXPORT_SYMBOL(hal_del_funct_from_thread);
 EXPORT_SYMBOL(hal_call_usrfunct);
 
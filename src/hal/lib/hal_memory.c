@@ -71,6 +71,30 @@ int hal_heap_addmem(size_t click)
     return 0;
 }
 
+// make sure desc_size bytes of descriptors and rt_size bytes of rt memory
+// can be allocated without failing halfway, growing the arena now if
+// needed - lets a caller making many allocations in one go fail early.
+// must be called with HAL mutex held
+int halpr_reserve(size_t desc_size, size_t rt_size)
+{
+    struct rtapi_heap_stat hs = {};
+
+    rtapi_heap_status(&hal_data->heap, &hs);
+    if (hs.total_avail < desc_size) {
+	size_t need = desc_size - hs.total_avail;
+	if (hal_heap_addmem(need > HAL_HEAP_INCREMENT ? need : HAL_HEAP_INCREMENT))
+	    return _halerrno;
+	rtapi_heap_status(&hal_data->heap, &hs);
+	if (hs.total_avail < desc_size)
+	    HALFAIL_RC(ENOMEM, "cant reserve %zu bytes of descriptors, %zu available",
+		       desc_size, hs.total_avail);
+    }
+    if (hal_freemem() < rt_size + HAL_HEAP_MINFREE)
+	HALFAIL_RC(ENOMEM, "cant reserve %zu bytes of rt memory, %zu available",
+		   rt_size, hal_freemem());
+    return 0;
+}
+
 // must be called with HAL mutex held
 void *shmalloc_desc(size_t size)
 {
@@ -297,9 +297,10 @@ typedef struct hal_inst {
     halhdr_t hdr;		// common HAL object header
     int inst_data_ptr;          // offset of instance data in HAL shm segment
     int inst_size;              // size of instdata blob
-    char **frozen_argv;         // copy of the newinst argument vectors
-                                // lives in global heap
-                                // destroyed in free_inst_struct
+    int inst_args;              // offset of the newinst arguments after
+                                // the instance name, blank separated,
+                                // in HAL shm - 0 if none
+                                // freed in free_inst_struct
 } hal_inst_t;
 
 /** HAL 'pin' data structure.
@@ -679,7 +680,7 @@ typedef struct hal_vtable {
    meaningfull error messages in case of a mismatch.
 */
 #include "rtapi_shmkeys.h"
-#define HAL_VER   13	/* version code */
+#define HAL_VER   15	/* version code */
 
 
 /***********************************************************************
@@ -831,6 +832,22 @@ int halg_foreach_pin_by_signal(const int use_hal_mutex,
 int halg_signal_propagate_barriers(const int use_hal_mutex,
 				   const hal_sig_t *sig);
 
+// descriptor based versions of halg_signal_new(), halg_link() and
+// hal_add_funct_to_thread() for callers which already looked up
+// the objects involved, see halcmd 'restore'.
+// must be called with the HAL mutex held.
+hal_sig_t *halpr_signal_new(const char *name, hal_type_t type);
+int halpr_link(hal_pin_t *pin, hal_sig_t *sig);
+int halpr_add_funct_to_thread(hal_funct_t *funct,
+			      hal_thread_t *thread,
+			      const int position,
+			      const int read_barrier,
+			      const int write_barrier);
+
+// assure desc_size bytes of descriptors and rt_size bytes of
+// hal_malloc() memory are available, see hal_memory.c
+int halpr_reserve(size_t desc_size, size_t rt_size);
+
 void report_memory_usage(void);
 
 char *halg_strdup(const int use_hal_mutex, const char *paramptr);
@@ -11,63 +11,71 @@
 *                      "SIGNAL" FUNCTIONS                              *
 ************************************************************************/
 
-int halg_signal_new(const int use_hal_mutex,
-		    const char *name, hal_type_t type)
+// create a signal, returns its descriptor - call with the HAL mutex held
+hal_sig_t *halpr_signal_new(const char *name, hal_type_t type)
 {
     hal_sig_t *new;
 
-    CHECK_HALDATA();
-    CHECK_LOCK(HAL_LOCK_CONFIG);
-    CHECK_STRLEN(name, HAL_NAME_LEN);
-    HALDBG("creating signal '%s'", name);
+    /* check for an existing signal with the same name */
+    if (halpr_find_sig_by_name(name) != 0) {
+	HALFAIL_NULL(EINVAL, "duplicate signal '%s'", name);
+    }
+    // allocate signal descriptor
+    if ((new = halg_create_objectf(0, sizeof(hal_sig_t),
+				   HAL_SIGNAL, 0, name)) == NULL) {
+	return NULL;
+    }
 
-    {
-	WITH_HAL_MUTEX_IF(use_hal_mutex);
+    switch (type) {
+    case HAL_BIT:
+	set_bit_value(&new->value, 0);
+	break;
 
-	/* check for an existing signal with the same name */
-	if (halpr_find_sig_by_name(name) != 0) {
-	    HALFAIL_RC(EINVAL, "duplicate signal '%s'", name);
-	}
-	// allocate signal descriptor
-	if ((new = halg_create_objectf(0, sizeof(hal_sig_t),
-				       HAL_SIGNAL, 0, name)) == NULL) {
-	    return _halerrno;
-	}
+    case HAL_S32:
+	set_s32_value(&new->value, 0);
+	break;
 
-	switch (type) {
-	case HAL_BIT:
-	    set_bit_value(&new->value, 0);
-	    break;
+    case HAL_U32:
+	set_u32_value(&new->value, 0);
+	break;
 
-	case HAL_S32:
-	    set_s32_value(&new->value, 0);
-	    break;
+    case HAL_FLOAT:
+	set_float_value(&new->value, 0.0);
+	break;
 
-	case HAL_U32:
-	    set_u32_value(&new->value, 0);
-	    break;
+    default:
+	halg_free_object(0, (hal_object_ptr)new);
+	HALFAIL_NULL(EINVAL,"signal '%s': illegal signal type %d'", name, type);
+	break;
+    }
 
-	case HAL_FLOAT:
-	    set_float_value(&new->value, 0.0);
-	    break;
+    /* initialize the structure */
+    new->type = type;
+    new->readers = 0;
+    new->writers = 0;
+    new->bidirs = 0;
 
-	default:
-	    halg_free_object(0, (hal_object_ptr)new);
-	    HALFAIL_RC(EINVAL,"signal '%s': illegal signal type %d'", name, type);
-	    break;
-	}
+    // propagate the news
+    rtapi_smp_mb();
 
-	/* initialize the structure */
-	new->type = type;
-	new->readers = 0;
-	new->writers = 0;
-	new->bidirs = 0;
+    // make it visible
+    halg_add_object(false, (hal_object_ptr)new);
+    return new;
+}
 
-	// propagate the news
-	rtapi_smp_mb();
+int halg_signal_new(const int use_hal_mutex,
+		    const char *name, hal_type_t type)
+{
+    CHECK_HALDATA();
+    CHECK_LOCK(HAL_LOCK_CONFIG);
+    CHECK_STRLEN(name, HAL_NAME_LEN);
+    HALDBG("creating signal '%s'", name);
 
-	// make it visible
-	halg_add_object(false, (hal_object_ptr)new);
+    {
+	WITH_HAL_MUTEX_IF(use_hal_mutex);
+
+	if (halpr_signal_new(name, type) == NULL)
+	    return _halerrno;
     }
     return 0;
 }
@@ -202,6 +210,123 @@ int halg_signal_setbarriers(const int use_hal_mutex,
 
 
 
+// link pin to sig - call with the HAL mutex held
+// halpr_link() minus the barrier propagation, so halg_bulk() can
+// link many pins and propagate once
+int link_pin(hal_pin_t *pin, hal_sig_t *sig)
+{
+    /* are they already connected? */
+    if (pin_linked_to(pin, sig)) {
+	HALWARN("pin '%s' already linked to '%s'", ho_name(pin), ho_name(sig));
+	return 0;
+    }
+    /* is the pin connected to something else? */
+    if (pin_is_linked(pin)) {
+	HALFAIL_RC(EINVAL, "pin '%s' is linked to '%s', cannot link to '%s'",
+		   ho_name(pin), ho_name(signal_of(pin)), ho_name(sig));
+    }
+    /* check types */
+    if (pin->type != sig->type) {
+	HALFAIL_RC(EINVAL, "type mismatch '%s':%d <- '%s':%d",
+		   ho_name(pin), pin->type,
+		   ho_name(sig), sig->type);
+    }
+    /* linking output pin to sig that already has output or I/O pins? */
+    if ((pin->dir == HAL_OUT) && ((sig->writers > 0) || (sig->bidirs > 0 ))) {
+	HALFAIL_RC(EINVAL, "signal '%s' already has output or I/O pin(s)",
+		   ho_name(sig));
+    }
+    /* linking bidir pin to sig that already has output pin? */
+    if ((pin->dir == HAL_IO) && (sig->writers > 0)) {
+	HALFAIL_RC(EINVAL, "signal '%s' already has output pin", ho_name(sig));
+    }
+    /* everything is OK, make the new link */
+    if (hh_get_legacy(&pin->hdr)) {
+	hal_comp_t *comp = halpr_find_owning_comp(ho_owner_id(pin));
+	void **data_ptr_addr = SHMPTR(pin->_data_ptr_addr);
+	void *data_addr = comp->shmem_base + SHMOFF(&sig->value);
+
+	HAL_ASSERT(data_ptr_addr != NULL);
+	HAL_ASSERT(*data_ptr_addr != NULL);
+
+	*data_ptr_addr = data_addr;
+    }
+
+    // track in v2 data_ptr. Eventually even this can go, just use
+    // pin->signal. Need to assure though pin->signal is not inited to 0
+    // but to SHMOFF(&sig->value). See pin_is_linked() and pin_linked(to).
+    //
+    // strategy: rename pin.signal to pin._signal and fix fallout.
+    // good runtime assertion on 'halcmd show objects'.
+    pin->data_ptr = SHMOFF(&sig->value);
+
+    if (( sig->readers == 0 ) && ( sig->writers == 0 ) &&
+	( sig->bidirs == 0 )) {
+
+	// this signal is not linked to any pins
+	// copy value from pin's "dummy" field,
+	// making it 'inherit' the value of the first pin
+	// data_addr = hal_shmem_base + sig->data_ptr;
+
+	const hal_data_u *hdu = pin_value(pin);
+
+	// assure proper typing on assignment, assigning a hal_data_u is
+	// a surefire cause for memory corrupion as hal_data_u is larger
+	// than hal_bit_t, hal_s32_t, and hal_u32_t - this works only for 
+	// hal_float_t (!)
+	// my old, buggy code:
+	//*((hal_data_u *)data_addr) = pin->dummysig;
+
+	switch (pin->type) {
+	case HAL_BIT:
+	    _set_bit_sig(sig, get_bit_value(hdu));
+	    break;
+
+	case HAL_S32:
+	    _set_s32_sig(sig, get_s32_value(hdu));
+	    break;
+
+	case HAL_U32:
+	    _set_u32_sig(sig, get_u32_value(hdu));
+	    break;
+
+	case HAL_FLOAT:
+	    _set_float_sig(sig, get_float_value(hdu));
+	    break;
+	default:
+	    HALFAIL_RC(EINVAL, "BUG: pin '%s' has invalid type %d !!\n",
+		       ho_name(pin), pin_type(pin));
+	}
+    }
+    /* update the signal's reader/writer/bidir counts */
+    if ((pin->dir & HAL_IN) != 0) {
+	sig->readers++;
+    }
+    if (pin->dir == HAL_OUT) {
+	sig->writers++;
+    }
+    if (pin->dir == HAL_IO) {
+	sig->bidirs++;
+    }
+    /* and update the pin */
+    set_signal(pin, sig);
+    return 0;
+}
+
+int halpr_link(hal_pin_t *pin, hal_sig_t *sig)
+{
+    int retval = link_pin(pin, sig);
+    if (retval)
+	return retval;
+
+    // propagate the pin->signal assignment because
+    // halg_signal_propagate_barriers() triggers on
+    // pin->signal == SHMOFF(sig)
+    rtapi_smp_wmb();
+    halg_signal_propagate_barriers(0, sig);
+    return 0;
+}
+
 int halg_link(const int use_hal_mutex,
 	      const char *pin_name,
 	      const char *sig_name)
@@ -229,109 +354,8 @@ int halg_link(const int use_hal_mutex,
 	if (sig == 0) {
 	    HALFAIL_RC(EINVAL, "signal '%s' not found", sig_name);
 	}
-	/* found both pin and signal, are they already connected? */
-	if (pin_linked_to(pin, sig)) {
-	    HALWARN("pin '%s' already linked to '%s'", pin_name, sig_name);
-	    return 0;
-	}
-	/* is the pin connected to something else? */
-	if (pin_is_linked(pin)) {
-	    sig = signal_of(pin);
-	    HALFAIL_RC(EINVAL, "pin '%s' is linked to '%s', cannot link to '%s'",
-		   pin_name, ho_name(sig), sig_name);
-	}
-	/* check types */
-	if (pin->type != sig->type) {
-	    HALFAIL_RC(EINVAL, "type mismatch '%s':%d <- '%s':%d",
-		   pin_name, pin->type,
-		   sig_name, sig->type);
-	}
-	/* linking output pin to sig that already has output or I/O pins? */
-	if ((pin->dir == HAL_OUT) && ((sig->writers > 0) || (sig->bidirs > 0 ))) {
-	    HALFAIL_RC(EINVAL, "signal '%s' already has output or I/O pin(s)", sig_name);
-	}
-	/* linking bidir pin to sig that already has output pin? */
-	if ((pin->dir == HAL_IO) && (sig->writers > 0)) {
-	    HALFAIL_RC(EINVAL, "signal '%s' already has output pin", sig_name);
-	}
-        /* everything is OK, make the new link */
-	if (hh_get_legacy(&pin->hdr)) {
-	    hal_comp_t *comp = halpr_find_owning_comp(ho_owner_id(pin));
-	    void **data_ptr_addr = SHMPTR(pin->_data_ptr_addr);
-	    void *data_addr = comp->shmem_base + SHMOFF(&sig->value);
-
-	    HAL_ASSERT(data_ptr_addr != NULL);
-	    HAL_ASSERT(*data_ptr_addr != NULL);
-
-	    *data_ptr_addr = data_addr;
-	}
-
-	// track in v2 data_ptr. Eventually even this can go, just use
-	// pin->signal. Need to assure though pin->signal is not inited to 0
-	// but to SHMOFF(&sig->value). See pin_is_linked() and pin_linked(to).
-	//
-	// strategy: rename pin.signal to pin._signal and fix fallout.
-	// good runtime assertion on 'halcmd show objects'.
-	pin->data_ptr = SHMOFF(&sig->value);
-
-	if (( sig->readers == 0 ) && ( sig->writers == 0 ) &&
-	    ( sig->bidirs == 0 )) {
-
-	    // this signal is not linked to any pins
-	    // copy value from pin's "dummy" field,
-	    // making it 'inherit' the value of the first pin
-	    // data_addr = hal_shmem_base + sig->data_ptr;
-
-	    const hal_data_u *hdu = pin_value(pin);
-
-	    // assure proper typing on assignment, assigning a hal_data_u is
-	    // a surefire cause for memory corrupion as hal_data_u is larger
-	    // than hal_bit_t, hal_s32_t, and hal_u32_t - this works only for 
-	    // hal_float_t (!)
-	    // my old, buggy code:
-	    //*((hal_data_u *)data_addr) = pin->dummysig;
-
-	    switch (pin->type) {
-	    case HAL_BIT:
-		_set_bit_sig(sig, get_bit_value(hdu));
-		break;
-
-	    case HAL_S32:
-		_set_s32_sig(sig, get_s32_value(hdu));
-		break;
-
-	    case HAL_U32:
-		_set_u32_sig(sig, get_u32_value(hdu));
-		break;
-
-	    case HAL_FLOAT:
-		_set_float_sig(sig, get_float_value(hdu));
-		break;
-	    default:
-		HALFAIL_RC(EINVAL, "BUG: pin '%s' has invalid type %d !!\n",
-		       ho_name(pin), pin_type(pin));
-	    }
-	}
-	/* update the signal's reader/writer/bidir counts */
-	if ((pin->dir & HAL_IN) != 0) {
-	    sig->readers++;
-	}
-	if (pin->dir == HAL_OUT) {
-	    sig->writers++;
-	}
-	if (pin->dir == HAL_IO) {
-	    sig->bidirs++;
-	}
-	/* and update the pin */
-	set_signal(pin, sig);
-
-	// propagate the pin->signal assignment because
-	// halg_signal_propagate_barriers() triggers on
-	// pin->signal == SHMOFF(sig)
-	rtapi_smp_wmb();
-	halg_signal_propagate_barriers(0, sig);
+	return halpr_link(pin, sig);
     }
-    return 0;
 }
 
 int halg_unlink(const int use_hal_mutex,
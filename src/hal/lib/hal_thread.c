@@ -45,6 +45,7 @@ static void thread_task(void *arg)
 	    // expose current invocation period as pin (includes jitter)
 	    act_period = fa.start_time - fa.last_start_time;
 	    set_s32_pin(thread->curr_period, act_period);
+	    RTAPI_TRACE2(thread_cycle_start, ho_name(thread), act_period);
 
 	    fa.last_start_time = fa.thread_start_time = fa.start_time;
 
@@ -60,6 +61,7 @@ static void thread_task(void *arg)
 		}
 
 		/* call the function */
+		RTAPI_TRACE1(funct_entry, ho_name(fa.funct));
 		switch (funct_entry->type) {
 		case FS_LEGACY_THREADFUNC:
 		    funct_entry->funct.l(funct_entry->arg, thread->period);
@@ -76,6 +78,7 @@ static void thread_task(void *arg)
 
 		/* update execution time data */
 		delta = end_time - fa.start_time;
+		RTAPI_TRACE2(funct_exit, ho_name(fa.funct), delta);
 		set_s32_pin(fa.funct->f_runtime, delta);
 		if ( delta > get_s32_pin(fa.funct->f_maxtime)) {
 		    set_s32_pin(fa.funct->f_maxtime, delta);
@@ -100,6 +103,7 @@ static void thread_task(void *arg)
 	    // update thread execution time in this period
 	    hal_s32_t rt = (end_time - fa.thread_start_time);
 	    set_s32_pin(thread->runtime, rt);
+	    RTAPI_TRACE2(thread_cycle_end, ho_name(thread), rt);
 	    if (rt > get_s32_pin(thread->maxtime)) {
 		set_s32_pin(thread->maxtime, rt);
 	    }
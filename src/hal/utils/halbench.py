@@ -0,0 +1,318 @@
+#!/usr/bin/env python3
+# vim: sts=4 sw=4 et
+"""
+halbench - headless HAL benchmark harness
+
+Loads a HAL configuration, runs its threads for a given number of cycles
+and reports per-funct and per-thread runtime statistics, thread dispatch
+overhead, CPU time of the RT process, HAL shared memory usage and - if
+perf(1) is available - cache statistics of the RT process.
+
+    halbench [-n cycles] [-f json|csv] [-o file] [--perf] config.hal
+
+Realtime must not be running; halbench starts and stops it.  The
+configuration must not start the threads itself.  For every thread
+a 'benchmon' instance named 'halbench.<thread>' is appended to the
+thread's funct list; it records the '<funct>.time' pins of all functs
+once per cycle into a HAL ring which is drained here.  All times are in
+nS as reported by rtapi_get_time().
+
+Funct runtimes are wallclock and include time spent blocked, e.g. waiting
+for a reply packet.  The CPU time is taken from the scheduler statistics
+of the RT process' tasks; 'per_cycle' divides the busiest task's share by
+the cycles of the fastest thread, which is exact for single-thread
+configurations.
+
+Exit status is 0 on success, 1 on error, 2 if records were lost because
+the rings overflowed (the statistics are still emitted).
+"""
+
+import argparse
+import csv
+import json
+import os
+import shutil
+import struct
+import subprocess
+import sys
+import time
+
+from machinekit import hal
+
+HDR = struct.Struct('=iii')     # period, elapsed, nfuncts - see benchmon.c
+S32 = struct.Struct('=i')
+
+
+def halcmd(*args, check=True):
+    r = subprocess.run(('halcmd',) + args, stdout=subprocess.PIPE,
+                       stderr=subprocess.PIPE, universal_newlines=True)
+    if check and r.returncode:
+        raise RuntimeError("halcmd %s failed: %s" % (' '.join(args),
+                                                    r.stderr.strip()))
+    return r.stdout
+
+
+def realtime(cmd):
+    return subprocess.call(['realtime', cmd], stdout=subprocess.DEVNULL,
+                           stderr=subprocess.DEVNULL)
+
+
+def threads():
+    """ (name, period, [functs]) per thread, from 'halcmd -s show thread' """
+    result = []
+    for line in halcmd('-s', 'show', 'thread').splitlines():
+        f = line.split()
+        if len(f) < 9:
+            continue
+        result.append((f[3], int(f[0]), f[9:]))
+    return result
+
+
+def rtapi_app_pid():
+    for pid in os.listdir('/proc'):
+        if not pid.isdigit():
+            continue
+        try:
+            with open('/proc/%s/comm' % pid) as f:
+                if f.read().startswith('rtapi:'):
+                    return int(pid)
+        except IOError:
+            pass
+    return None
+
+
+def perf_start(pid):
+    if pid is None or shutil.which('perf') is None:
+        return None
+    events = 'cycles,instructions,cache-references,cache-misses,' \
+             'L1-dcache-load-misses,LLC-load-misses'
+    return subprocess.Popen(['perf', 'stat', '-x,', '-e', events,
+                             '-p', str(pid)],
+                            stdout=subprocess.DEVNULL,
+                            stderr=subprocess.PIPE,
+                            universal_newlines=True)
+
+
+def perf_stop(p):
+    if p is None:
+        return None
+    p.send_signal(2)    # SIGINT makes perf stat print its counters
+    _, err = p.communicate()
+    counters = {}
+    for line in err.splitlines():
+        f = line.split(',')
+        if len(f) < 3:
+            continue
+        try:
+            counters[f[2]] = int(f[0])
+        except ValueError:
+            counters[f[2]] = None   # <not supported>, <not counted>
+    return counters
+
+
+def task_cpu(pid):
+    """ CPU nS per task of a process, from /proc/<pid>/task/*/schedstat """
+    cpu = {}
+    if pid is None:
+        return cpu
+    base = '/proc/%d/task' % pid
+    try:
+        tids = os.listdir(base)
+    except OSError:
+        return cpu
+    for tid in tids:
+        try:
+            with open('%s/%s/schedstat' % (base, tid)) as f:
+                cpu[tid] = int(f.read().split()[0])
+        except (IOError, ValueError, IndexError):
+            pass
+    return cpu
+
+
+def cpu_delta(before, after, cycles):
+    delta = [after[t] - before.get(t, 0) for t in after]
+    if not delta:
+        return None
+    busiest = max(delta)
+    return dict(process=sum(delta), busiest_task=busiest,
+                per_cycle=busiest / cycles if cycles else None)
+
+
+def mem_status():
+    """ the numbers of 'halcmd status mem' """
+    m = {}
+    for line in halcmd('status', 'mem').splitlines():
+        line = line.strip()
+        if line.startswith('HAL shm segment size:'):
+            f = line.split()
+            m['shm_size'] = int(f[4])
+            m['shm_unused'] = int(f[6])
+        elif line.startswith('heap: arena size='):
+            for kv in line[6:].replace(',', ' ').split():
+                if '=' in kv:
+                    k, v = kv.split('=')
+                    m['heap_' + k.replace('totail', 'total')] = int(v)
+        elif line.startswith('hal_malloc():'):
+            m['hal_malloc'] = int(line.split()[1])
+        elif line.startswith('RT objects:'):
+            m['rt_objects'] = int(line.split()[2])
+    return m
+
+
+def stats(values):
+    v = sorted(values)
+    n = len(v)
+    if n == 0:
+        return dict(min=None, mean=None, p99=None, max=None)
+    return dict(min=v[0], mean=sum(v) / n,
+                p99=v[min(n - 1, (99 * n) // 100)], max=v[-1])
+
+
+class Recorder:
+    def __init__(self, thread, functs):
+        self.thread = thread
+        self.functs = functs
+        self.inst = 'halbench.' + thread
+        self.ring = None
+        self.period = []
+        self.elapsed = []
+        self.overhead = []
+        self.times = [[] for f in functs]
+
+    def attach(self):
+        self.ring = hal.Ring(self.inst)
+
+    def drain(self, limit):
+        while len(self.period) < limit:
+            b = self.ring.read()
+            if b is None:
+                return
+            b = b.tobytes()
+            period, elapsed, n = HDR.unpack_from(b)
+            t = [S32.unpack_from(b, HDR.size + i * S32.size)[0]
+                 for i in range(n)]
+            self.ring.shift()
+            self.period.append(period)
+            self.elapsed.append(elapsed)
+            self.overhead.append(elapsed - sum(t))
+            for i in range(min(n, len(self.times))):
+                self.times[i].append(t[i])
+
+    def done(self, limit):
+        return len(self.period) >= limit
+
+    def result(self):
+        return dict(thread=self.thread,
+                    cycles=len(self.period),
+                    period=stats(self.period),
+                    runtime=stats(self.elapsed),
+                    overhead=stats(self.overhead),
+                    functs=[dict(funct=f, **stats(t))
+                            for f, t in zip(self.functs, self.times)])
+
+
+def emit_csv(result, out):
+    w = csv.writer(out)
+    w.writerow(['thread', 'funct', 'cycles', 'min', 'mean', 'p99', 'max'])
+    for t in result['threads']:
+        for key in ('period', 'runtime', 'overhead'):
+            s = t[key]
+            w.writerow([t['thread'], '<%s>' % key, t['cycles'],
+                        s['min'], s['mean'], s['p99'], s['max']])
+        for f in t['functs']:
+            w.writerow([t['thread'], f['funct'], t['cycles'],
+                        f['min'], f['mean'], f['p99'], f['max']])
+    for k, v in sorted(result['memory'].items()):
+        w.writerow(['<memory>', k, '', '', v, '', ''])
+    for k, v in sorted((result['cpu'] or {}).items()):
+        w.writerow(['<cpu>', k, '', '', v, '', ''])
+    for k, v in sorted((result['perf'] or {}).items()):
+        w.writerow(['<perf>', k, '', '', v, '', ''])
+
+
+def main():
+    ap = argparse.ArgumentParser(description='headless HAL benchmark harness')
+    ap.add_argument('config', help='HAL file to benchmark (must not start threads)')
+    ap.add_argument('-n', '--cycles', type=int, default=10000,
+                    help='cycles to record per thread (default 10000)')
+    ap.add_argument('-f', '--format', choices=('json', 'csv'), default='json')
+    ap.add_argument('-o', '--output', help='output file (default stdout)')
+    ap.add_argument('-r', '--ringsize', type=int, default=1048576,
+                    help='benchmon ring size in bytes')
+    ap.add_argument('-t', '--timeout', type=float, default=0,
+                    help='give up after this many seconds (default: '
+                    '4 * cycles * slowest period)')
+    ap.add_argument('--perf', action='store_true',
+                    help='collect perf_event counters of the RT process')
+    args = ap.parse_args()
+
+    if realtime('status') == 0:
+        sys.exit('halbench: realtime is already running, stop it first')
+    if realtime('start'):
+        sys.exit('halbench: cannot start realtime')
+
+    recorders = []
+    try:
+        halcmd('-f', args.config)
+        halcmd('stop')
+        halcmd('loadrt', 'benchmon')
+        for name, period, functs in threads():
+            r = Recorder(name, functs)
+            halcmd('newinst', 'benchmon', r.inst, 'ringsize=%d' % args.ringsize)
+            halcmd('addf', r.inst + '.sample', name)
+            r.attach()
+            recorders.append((r, period))
+        if not recorders:
+            sys.exit('halbench: %s defines no threads' % args.config)
+
+        timeout = args.timeout or \
+            max(4.0 * args.cycles * p * 1e-9 for r, p in recorders) + 5.0
+        pid = rtapi_app_pid()
+        perf = perf_start(pid) if args.perf else None
+        cpu0 = task_cpu(pid)
+        t0 = time.time()
+        halcmd('start')
+        while not all(r.done(args.cycles) for r, p in recorders):
+            for r, p in recorders:
+                r.drain(args.cycles)
+            if time.time() - t0 > timeout:
+                sys.stderr.write('halbench: timeout, results are partial\n')
+                break
+            time.sleep(0.01)
+        halcmd('stop')
+        wall = time.time() - t0
+        cpu1 = task_cpu(pid)
+        counters = perf_stop(perf)
+
+        overruns = 0
+        for r, p in recorders:
+            r.drain(args.cycles)
+            overruns += int(halcmd('-s', 'getp', r.inst + '.overruns'))
+
+        result = dict(config=args.config,
+                      cycles=args.cycles,
+                      wallclock=wall,
+                      overruns=overruns,
+                      threads=[r.result() for r, p in recorders],
+                      cpu=cpu_delta(cpu0, cpu1,
+                                    max(len(r.period) for r, p in recorders)),
+                      memory=mem_status(),
+                      perf=counters)
+    finally:
+        for r, p in recorders:
+            r.ring = None       # detach before benchmon deletes the ring
+        realtime('stop')
+
+    out = open(args.output, 'w') if args.output else sys.stdout
+    if args.format == 'json':
+        json.dump(result, out, indent=2, sort_keys=True)
+        out.write('\n')
+    else:
+        emit_csv(result, out)
+    if out is not sys.stdout:
+        out.close()
+    sys.exit(2 if overruns else 0)
+
+
+if __name__ == '__main__':
+    main()
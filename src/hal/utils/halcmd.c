@@ -215,6 +215,8 @@ void halcmd_shutdown(void) {
 
 struct halcmd_command halcmd_commands[] = {
     {"addf",    FUNCT(do_addf_cmd),    A_TWO | A_PLUS },
+    {"begin",   FUNCT(do_begin_cmd),   A_ZERO },
+    {"commit",  FUNCT(do_commit_cmd),  A_ZERO },
     //    {"alias",   FUNCT(do_alias_cmd),   A_THREE },
     {"delf",    FUNCT(do_delf_cmd),    A_TWO | A_OPTIONAL },
     {"delsig",  FUNCT(do_delsig_cmd),  A_ONE },
@@ -236,6 +238,7 @@ struct halcmd_command halcmd_commands[] = {
     {"net",     FUNCT(do_net_cmd),     A_ONE | A_PLUS | A_REMOVE_ARROWS },
     {"newsig",  FUNCT(do_newsig_cmd),  A_TWO },
     {"ping",    FUNCT(do_ping_cmd), A_ZERO },
+    {"restore", FUNCT(do_restore_cmd), A_ONE | A_TILDE },
     {"save",    FUNCT(do_save_cmd),    A_TWO | A_OPTIONAL | A_TILDE },
     {"setexact_for_test_suite_only", FUNCT(do_setexact_cmd), A_ZERO },
     {"setp",    FUNCT(do_setp_cmd),    A_TWO },
@@ -553,6 +556,101 @@ static int parse_cmd1(char **argv) {
     }
 }
 
+static int linenumber=0;
+static char *filename=NULL;
+
+/* pipelining of rtapi_app commands: while enabled, consecutive newinst,
+   newthread, delthread and call commands are queued, and sent to
+   rtapi_app as a single batch request once a command of another kind
+   comes up, the batch is full, or halcmd_batch_flush() is called at the
+   end of input.  rtapi_app executes the batch in order and stops at the
+   first failing command, which is reported against its own file and
+   line - the commands after it are not executed.
+*/
+#define BATCH_MAX 64
+
+static int batching;
+static struct {
+    char *filename;
+    int linenumber;
+} batch_src[BATCH_MAX];
+
+static const char *batch_cmds[] = {
+    "newinst", "newthread", "delthread", "call", NULL
+};
+
+void halcmd_set_batch(int on)
+{
+    if (!on)
+	halcmd_batch_flush();
+    batching = on;
+    rtapi_batch(on);
+}
+
+int halcmd_batch_flush(void)
+{
+    int i, failed, n = rtapi_batch_pending();
+    int retval;
+
+    if (n == 0)
+	return 0;
+    retval = rtapi_batch_flush(&failed);
+    if (retval) {
+	if ((failed >= 0) && (failed < n)) {
+	    char *filename_save = filename;
+	    int lineno_save = linenumber;
+
+	    filename = batch_src[failed].filename;
+	    linenumber = batch_src[failed].linenumber;
+	    halcmd_error("rc=%d: %s\n", retval, rtapi_rpcerror());
+	    filename = filename_save;
+	    linenumber = lineno_save;
+	    if (n - failed - 1)
+		halcmd_info("%d queued rtapi command(s) not executed\n",
+			    n - failed - 1);
+	} else {
+	    halcmd_error("batch of %d rtapi commands failed: rc=%d: %s\n",
+			 n, retval, rtapi_rpcerror());
+	}
+    }
+    for (i = 0; i < n; i++) {
+	free(batch_src[i].filename);
+	batch_src[i].filename = NULL;
+    }
+    return retval;
+}
+
+static int batch_cmd(char **tokens)
+{
+    int i, before, after, retval;
+    int queueable = 0;
+
+    if (!batching)
+	return parse_cmd1(tokens);
+    if (count_args(tokens) == 0)
+	return 0;
+
+    for (i = 0; batch_cmds[i]; i++)
+	if (!strcmp(tokens[0], batch_cmds[i]))
+	    queueable = 1;
+    // anything else may depend on the queued commands having run
+    if (!queueable && (retval = halcmd_batch_flush()))
+	return retval;
+
+    before = rtapi_batch_pending();
+    retval = parse_cmd1(tokens);
+    after = rtapi_batch_pending();
+    if (after < before)  // flushed while executing this command
+	before = 0;
+    for (i = before; (i < after) && (i < BATCH_MAX); i++) {
+	batch_src[i].filename = strdup(filename ? filename : "");
+	batch_src[i].linenumber = linenumber;
+    }
+    if ((retval == 0) && (after >= BATCH_MAX))
+	retval = halcmd_batch_flush();
+    return retval;
+}
+
 int halcmd_parse_cmd(char *tokens[])
 {
     int retval;
@@ -565,8 +663,11 @@ int halcmd_parse_cmd(char *tokens[])
         first_time = 0;
     }
 
+    if (tokens[0] && *tokens[0] &&
+        (retval = halcmd_block_check(tokens[0])))
+        return retval;
     hal_flag = 1;
-    retval = parse_cmd1(tokens);
+    retval = batch_cmd(tokens);
     hal_flag = 0;
     return retval;
 }
@@ -979,8 +1080,6 @@ int halcmd_parse_line(char *line) {
     return halcmd_parse_cmd(tokens);
 }
 
-static int linenumber=0;
-static char *filename=NULL;
 
 void halcmd_set_filename(const char *new_filename) {
     if(filename) free(filename);
@@ -65,6 +65,12 @@ const char *halcmd_get_filename(void);
 void halcmd_set_linenumber(int new_linenumber);
 int halcmd_get_linenumber(void);
 
+void halcmd_set_batch(int on);
+int halcmd_batch_flush(void);
+
+int halcmd_block_check(const char *command);
+int halcmd_block_close(void);
+
 enum halcmd_argtype {
     A_ZERO,  /* prototype: f(void) */
     A_ONE,   /* prototype: f(char *arg) */
@@ -185,6 +185,131 @@ int do_unlock_cmd(char *command)
     return retval;
 }
 
+/* begin ... commit: the net, linkps, linksp, setp and sets commands
+   between them are collected instead of executed, and 'commit' hands
+   them to halg_bulk(), which checks all of them before applying any,
+   under a single hold of the HAL mutex. A failing command is reported
+   against its own line, and nothing of the block is applied.
+*/
+static struct {
+    int open;
+    int n, size;
+    hal_bulk_item_t *items;
+    struct {
+	char *filename;
+	int linenumber;
+    } *src;
+} block;
+
+static void block_free(void)
+{
+    int i;
+
+    for (i = 0; i < block.n; i++) {
+	free((char *) block.items[i].name);
+	free((char *) block.items[i].arg);
+	free(block.src[i].filename);
+    }
+    free(block.items);
+    free(block.src);
+    memset(&block, 0, sizeof(block));
+}
+
+static int block_add(hal_bulk_op_t op, const char *name, const char *arg)
+{
+    const char *fn = halcmd_get_filename();
+
+    if (block.n == block.size) {
+	int size = block.size ? block.size * 2 : 256;
+	void *items = realloc(block.items, size * sizeof(*block.items));
+	void *src = realloc(block.src, size * sizeof(*block.src));
+
+	if (items)
+	    block.items = items;
+	if (src)
+	    block.src = src;
+	if (!items || !src) {
+	    halcmd_error("out of memory\n");
+	    return -ENOMEM;
+	}
+	block.size = size;
+    }
+    block.items[block.n].op = op;
+    block.items[block.n].name = strdup(name);
+    block.items[block.n].arg = strdup(arg);
+    block.src[block.n].filename = strdup(fn ? fn : "");
+    block.src[block.n].linenumber = halcmd_get_linenumber();
+    block.n++;
+    return 0;
+}
+
+int halcmd_block_check(const char *command)
+{
+    static const char *allowed[] = {
+	"net", "linkps", "linksp", "setp", "sets",
+	"commit", "echo", "unecho", NULL
+    };
+    int i;
+
+    if (!block.open)
+	return 0;
+    for (i = 0; allowed[i]; i++)
+	if (!strcmp(command, allowed[i]))
+	    return 0;
+    halcmd_error("'%s' not allowed between 'begin' and 'commit'\n", command);
+    return -EINVAL;
+}
+
+int halcmd_block_close(void)
+{
+    if (!block.open)
+	return 0;
+    halcmd_error("'begin' without 'commit', %d command(s) not applied\n",
+		 block.n);
+    block_free();
+    return -EINVAL;
+}
+
+int do_begin_cmd(void)
+{
+    if (block.open) {
+	halcmd_error("'begin' inside a block, missing 'commit'\n");
+	return -EINVAL;
+    }
+    block.open = 1;
+    return 0;
+}
+
+int do_commit_cmd(void)
+{
+    int retval, failed = -1;
+
+    if (!block.open) {
+	halcmd_error("'commit' without 'begin'\n");
+	return -EINVAL;
+    }
+    retval = halg_bulk(1, block.items, block.n, &failed);
+    if (retval && (failed >= 0) && (failed < block.n)) {
+	char *filename_save = strdup(halcmd_get_filename() ?
+				     halcmd_get_filename() : "");
+	int lineno_save = halcmd_get_linenumber();
+
+	halcmd_set_filename(block.src[failed].filename);
+	halcmd_set_linenumber(block.src[failed].linenumber);
+	halcmd_error("%s\n", hal_lasterror());
+	halcmd_set_filename(filename_save);
+	halcmd_set_linenumber(lineno_save);
+	free(filename_save);
+    } else if (retval) {
+	halcmd_error("commit of %d commands failed: %s\n",
+		     block.n, hal_lasterror());
+    } else {
+	halcmd_info("%d commands committed\n", block.n);
+    }
+    block_free();
+    return retval;
+}
+
 int do_linkpp_cmd(char *first_pin_name, char *second_pin_name)
 {
     int retval;
@@ -243,6 +368,8 @@ int do_linkps_cmd(char *pin, char *sig)
 {
     int retval;
 
+    if (block.open)
+	return block_add(HAL_BULK_NET, pin, sig);
     retval = hal_link(pin, sig);
     if (retval == 0) {
 	/* print success message */
@@ -537,6 +664,16 @@ int do_net_cmd(char *signal, char *pins[]) {
     hal_sig_t *sig;
     int i, retval;
 
+    if (block.open) {
+	if (!pins[0] || !*pins[0]) {
+	    halcmd_error("'net' requires at least one pin, none given\n");
+	    return -EINVAL;
+	}
+	for (i = 0; pins[i] && *pins[i]; i++)
+	    if ((retval = block_add(HAL_BULK_NET, pins[i], signal)))
+		return retval;
+	return 0;
+    }
     rtapi_mutex_get(&(hal_data->mutex));
     /* see if signal already exists */
     sig = halpr_find_sig_by_name(signal);
@@ -695,6 +832,8 @@ int do_setp_cmd(char *name, char *value)
     void *d_ptr;
     hal_comp_t *comp; // owning component
 
+    if (block.open)
+	return block_add(HAL_BULK_SETP, name, value);
     halcmd_info("setting parameter '%s' to '%s'\n", name, value);
     /* get mutex before accessing shared data */
     rtapi_mutex_get(&(hal_data->mutex));
@@ -868,6 +1007,8 @@ int do_sets_cmd(char *name, char *value)
     hal_type_t type;
     void *d_ptr;
 
+    if (block.open)
+	return block_add(HAL_BULK_SETS, name, value);
     rtapi_print_msg(RTAPI_MSG_DBG, "setting signal '%s'\n", name);
     /* get mutex before accessing shared data */
     rtapi_mutex_get(&(hal_data->mutex));
@@ -2936,6 +3077,14 @@ int do_save_cmd(char *type, char *filename)
 {
     FILE *dst;
 
+    if ((type != NULL) && (strcmp(type, "snapshot") == 0)) {
+	/* binary, for 'restore' - not a listing, so not subject to -Q */
+	if (filename == NULL || *filename == '\0' ) {
+	    halcmd_error("save snapshot: a filename is required\n");
+	    return -EINVAL;
+	}
+	return halcmd_save_snapshot(filename);
+    }
     if (rtapi_get_msg_level() == RTAPI_MSG_NONE) {
 	/* must be -Q, don't print anything */
 	return 0;
@@ -3041,6 +3190,8 @@ int do_newg_cmd(char *group,char **opt)
 			arg2 |= GROUP_REPORT_CHANGED_MEMBERS;
 		    } else if (!strcmp(s1, "reportall")) {
 			arg2 &= ~GROUP_REPORT_CHANGED_MEMBERS;
+		    } else if (!strcmp(s1, "snapshot")) {
+			arg2 |= GROUP_PUBLISH_SNAPSHOT;
 		    } else {
 			// try to convert from integer
 			arg2 = 	strtol(s1, &cp, 0);
@@ -3946,7 +4097,8 @@ int do_callfunc_cmd(char *func, char *args[])
 	halcmd_error("function call %s returned %d: %s\n", func, retval, rtapi_rpcerror());
 	return retval;
     }
-    halcmd_info("function '%s' returned %d\n", func, retval);
+    if (!rtapi_batch_pending())  // else the value is not known yet
+	halcmd_info("function '%s' returned %d\n", func, retval);
     return 0;
 }
 
@@ -3983,6 +4135,10 @@ int do_newinst_cmd(char *comp, char *inst, char *args[])
     switch (status) {
     case CS_NOT_LOADED:
 	if (autoload) {
+	    // commands queued before go first, reported on their own lines
+	    retval = halcmd_batch_flush();
+	    if (retval)
+		return retval;
 	    retval = loadrt_cmd(false, comp, argv);
 	    if (retval)
 		return retval;
@@ -4546,6 +4702,30 @@ int do_help_cmd(char *command)
 	printf("  or 'thread'.  ('linka' and 'neta' show arrows for pin\n");
 	printf("  direction.)  If 'type' is omitted or 'all', does the\n");
 	printf("  equivalent of 'comp', 'netl', 'param', and 'thread'.\n");
+	printf("  Type 'snapshot' writes a binary snapshot of the HAL\n");
+	printf("  configuration to 'filename' instead, see 'restore'.\n");
+    } else if ((strcmp(command, "begin") == 0) ||
+	       (strcmp(command, "commit") == 0)) {
+	printf("begin\n");
+	printf("commit\n");
+	printf("  The net, linkps, linksp, setp and sets commands between\n");
+	printf("  'begin' and 'commit' are collected, and applied together by\n");
+	printf("  'commit': all names are looked up and all commands checked\n");
+	printf("  before the first is applied.  If one fails, it is reported\n");
+	printf("  with its line, and none of the block is applied.\n");
+	printf("  Other commands are not allowed inside a block.\n");
+    } else if (strcmp(command, "restore") == 0) {
+	printf("restore filename\n");
+	printf("  Rebuilds the HAL configuration recorded by 'save snapshot':\n");
+	printf("  loads modules, creates instances, threads and signals, links\n");
+	printf("  pins, sets values and adds functs to threads.  Objects which\n");
+	printf("  exist already are kept.  Nothing is changed if the snapshot\n");
+	printf("  does not match this HAL version, a module binary changed, or\n");
+	printf("  an existing object conflicts with it.  Pins, params and\n");
+	printf("  functs of modules loaded by the restore are checked once\n");
+	printf("  they exist; if one of those does not match, the modules,\n");
+	printf("  instances and threads loaded so far stay, and no signal is\n");
+	printf("  created or pin linked.\n");
     } else if (strcmp(command, "start") == 0) {
 	printf("start\n");
 	printf("  Starts all realtime threads.\n");
@@ -4606,11 +4786,13 @@ static void print_help_commands(void)
     printf("  ptype, stype        Get the type of a pin, parameter or signal\n");
     printf("  setp, sets          Set the value of a pin, parameter or signal\n");
     printf("  addf, delf          Add/remove function to/from a thread\n");
+    printf("  begin, commit       Apply net/setp/sets commands as one batch\n");
     printf("  show                Display info about HAL objects\n");
     printf("  list                Display names of HAL objects\n");
     printf("  source              Execute commands from another .hal file\n");
     printf("  status              Display status information\n");
     printf("  save                Print config as commands\n");
+    printf("  restore             Rebuild config from a saved snapshot\n");
     printf("  start, stop         Start/stop realtime threads\n");
     printf("  alias, unalias      Add or remove pin or parameter name aliases\n");
     printf("  echo, unecho        Echo commands from stdin to stderr\n");
@@ -86,6 +86,10 @@ extern int do_unloadusr_cmd(char *mod_name);
 extern int do_loadusr_cmd(char *args[]);
 extern int do_waitusr_cmd(char *arg1, char *arg2);
 extern int do_save_cmd(char *type, char *filename);
+extern int do_restore_cmd(char *filename);
+extern int do_begin_cmd(void);
+extern int do_commit_cmd(void);
+extern int halcmd_save_snapshot(char *filename);
 extern int do_setexact_cmd(void);
 extern int do_sleep_cmd(char *naptime);
 
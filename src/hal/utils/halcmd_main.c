@@ -65,6 +65,7 @@ static int get_input(FILE *srcfile, char *buf, size_t bufsize);
 static void print_help_general(int showR);
 static int release_HAL_mutex(void);
 static int propose_completion(char *all, char *fragment, int start);
+static void preload_modules(FILE *srcfile);
 
 static const char *inifile;
 static FILE *inifp;
@@ -314,6 +315,12 @@ int main(int argc, char **argv)
             }
         }
     } else {
+        /* pipeline rtapi_app commands unless interactive, or each
+           command's failure is to be reported and skipped (-k) */
+        if (!prompt_mode && !keep_going)
+            halcmd_set_batch(1);
+        if (!prompt_mode)
+            preload_modules(srcfile);
         /* read command line(s) from 'srcfile' */
         while (1) {
             char *tokens[MAX_TOK+1];
@@ -350,6 +357,14 @@ int main(int argc, char **argv)
                 break;
             }
         }
+        /* run what is still queued - it precedes any failed line */
+        if ( halcmd_batch_flush() != 0 ) {
+            errorcount++;
+        }
+        /* an unfinished begin/commit block is discarded */
+        if ( halcmd_block_close() != 0 ) {
+            errorcount++;
+        }
     }
     /* all done */
     if (!scriptmode && srcfile == stdin && isatty(0)) {
@@ -366,6 +381,41 @@ int main(int argc, char **argv)
 
 }
 
+#define MAX_PRELOAD 256
+
+/* tell rtapi_app which modules the file is going to load, so it can
+   read them ahead in parallel while the commands before are executed
+   - a hint only, names using variables or expressions are skipped */
+static void preload_modules(FILE *srcfile)
+{
+    char line[MAX_CMD_LEN], *cmd, *name, *save;
+    const char *modules[MAX_PRELOAD + 1];
+    long start;
+    int i, n = 0;
+
+    if ((start = ftell(srcfile)) < 0)
+        return;  /* a pipe - can't read it twice */
+    while ((n < MAX_PRELOAD) && fgets(line, sizeof(line), srcfile)) {
+        if (((cmd = strtok_r(line, " \t\r\n", &save)) == NULL) ||
+            ((name = strtok_r(NULL, " \t\r\n", &save)) == NULL) ||
+            (strcasecmp(cmd, "loadrt") && strcasecmp(cmd, "newinst")) ||
+            strpbrk(name, "$[#"))
+            continue;
+        for (i = 0; i < n; i++)
+            if (!strcmp(modules[i], name))
+                break;
+        if ((i == n) && ((modules[n] = strdup(name)) != NULL))
+            n++;
+    }
+    fseek(srcfile, start, SEEK_SET);
+    if (n == 0)
+        return;
+    modules[n] = NULL;
+    rtapi_preload(rtapi_instance, modules);
+    for (i = 0; i < n; i++)
+        free((char *) modules[i]);
+}
+
 /* release_HAL_mutex() unconditionally releases the hal_mutex
    very useful after a program segfaults while holding the mutex
 */
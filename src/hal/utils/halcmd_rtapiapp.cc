@@ -16,6 +16,8 @@
 using namespace google::protobuf;
 
 static machinetalk::Container command, reply;
+static machinetalk::Container batch;   // queued MT_RTAPI_APP_BATCH members
+static bool batching;
 
 static zsock_t *z_command = NULL;
 static int timeout = 5000;
@@ -68,90 +70,128 @@ int rtapi_rpc(void *socket, machinetalk::Container &tx, machinetalk::Container &
 }
 
 
-int rtapi_callfunc(int instance,
-		   const char *func,
-		   const char **args)
+// start a command: a new batch member if batching and the command
+// may be queued, else the single command of the next request
+static machinetalk::RTAPICommand *new_command(machinetalk::ContainerType type,
+					      bool queue)
 {
-    machinetalk::RTAPICommand *cmd;
+    if (queue && batching) {
+	machinetalk::RTAPICommand *cmd = batch.add_rtapi_batch();
+	cmd->set_type(type);
+	return cmd;
+    }
     command.Clear();
-    command.set_type(machinetalk::MT_RTAPI_APP_CALLFUNC);
-    cmd = command.mutable_rtapicmd();
-    cmd->set_func(func);
-    cmd->set_instance(instance);
+    command.set_type(type);
+    return command.mutable_rtapicmd();
+}
+
+// send the command started by new_command(), unless it was queued
+static int run_command(bool queue)
+{
+    if (queue && batching)
+	return 0;  // see rtapi_batch_flush()
 
+    // keep the order of commands: queued ones go first
+    int retval = rtapi_batch_flush(NULL);
+    if (retval)
+	return retval;
+    retval = rtapi_rpc(z_command, command, reply);
+    if (retval)
+	return retval;
+    return reply.retcode();
+}
+
+static void add_argv(machinetalk::RTAPICommand *cmd, const char **args)
+{
     int argc = 0;
     if (args)
 	while(args[argc] && *args[argc]) {
 	    cmd->add_argv(args[argc]);
 	    argc++;
 	}
-    int retval = rtapi_rpc(z_command, command, reply);
+}
+
+int rtapi_batch(int on)
+{
+    int retval = 0;
+
+    if (!on)
+	retval = rtapi_batch_flush(NULL);
+    batching = on;
+    return retval;
+}
+
+int rtapi_batch_pending(void)
+{
+    return batch.rtapi_batch_size();
+}
+
+int rtapi_batch_flush(int *failed)
+{
+    int n = batch.rtapi_batch_size();
+
+    if (failed)
+	*failed = -1;
+    if (n == 0)
+	return 0;
+
+    batch.set_type(machinetalk::MT_RTAPI_APP_BATCH);
+    // rtapi_app may take as long as for n single requests
+    zsock_set_rcvtimeo (z_command, n * timeout * ZMQ_POLL_MSEC);
+    int retval = rtapi_rpc(z_command, batch, reply);
+    zsock_set_rcvtimeo (z_command, timeout * ZMQ_POLL_MSEC);
+    batch.Clear();
     if (retval)
 	return retval;
+    if (reply.retcode() && failed)
+	*failed = reply.rtapi_result_size() - 1;
     return reply.retcode();
 }
 
+int rtapi_callfunc(int instance,
+		   const char *func,
+		   const char **args)
+{
+    machinetalk::RTAPICommand *cmd =
+	new_command(machinetalk::MT_RTAPI_APP_CALLFUNC, true);
+    cmd->set_func(func);
+    cmd->set_instance(instance);
+    add_argv(cmd, args);
+    return run_command(true);
+}
+
 int rtapi_newinst(int instance,
 		  const char *comp,
 		  const char *instname,
 		  const char **args)
 {
-    machinetalk::RTAPICommand *cmd;
-    command.Clear();
-    command.set_type(machinetalk::MT_RTAPI_APP_NEWINST);
-    cmd = command.mutable_rtapicmd();
+    machinetalk::RTAPICommand *cmd =
+	new_command(machinetalk::MT_RTAPI_APP_NEWINST, true);
     cmd->set_instance(instance);
 
     cmd->set_comp(comp);
     cmd->set_instname(instname);
-
-    int argc = 0;
-    if (args)
-	while(args[argc] && *args[argc]) {
-	    cmd->add_argv(args[argc]);
-	    argc++;
-	}
-    int retval = rtapi_rpc(z_command, command, reply);
-    if (retval)
-	return retval;
-    return reply.retcode();
+    add_argv(cmd, args);
+    return run_command(true);
 }
 
 int rtapi_delinst(int instance,
 		  const char *instname)
 {
-    machinetalk::RTAPICommand *cmd;
-    command.Clear();
-    command.set_type(machinetalk::MT_RTAPI_APP_DELINST);
-    cmd = command.mutable_rtapicmd();
+    machinetalk::RTAPICommand *cmd =
+	new_command(machinetalk::MT_RTAPI_APP_DELINST, false);
     cmd->set_instance(instance);
     cmd->set_instname(instname);
-    int retval = rtapi_rpc(z_command, command, reply);
-    if (retval)
-	return retval;
-    return reply.retcode();
-
+    return run_command(false);
 }
 
 static int rtapi_loadop(machinetalk::ContainerType type, int instance, const char *modname, const char **args)
 {
-    machinetalk::RTAPICommand *cmd;
-    command.Clear();
-    command.set_type(type);
-    cmd = command.mutable_rtapicmd();
+    machinetalk::RTAPICommand *cmd = new_command(type, false);
     cmd->set_modname(modname);
     cmd->set_instance(instance);
-
-    int argc = 0;
-    if (args)
-	while(args[argc] && *args[argc]) {
-	    cmd->add_argv(args[argc]);
-	    argc++;
-	}
-    int retval = rtapi_rpc(z_command, command, reply);
-    if (retval)
-	return retval;
-    return reply.retcode();
+    add_argv(cmd, args);
+    return run_command(false);
 }
 
 int rtapi_loadrt(int instance, const char *modname, const char **args)
@@ -166,42 +206,36 @@ int rtapi_unloadrt(int instance, const char *modname)
 
 int rtapi_shutdown(int instance)
 {
-    machinetalk::RTAPICommand *cmd;
-
-    command.Clear();
-    command.set_type(machinetalk::MT_RTAPI_APP_EXIT);
-    cmd = command.mutable_rtapicmd();
+    machinetalk::RTAPICommand *cmd =
+	new_command(machinetalk::MT_RTAPI_APP_EXIT, false);
     cmd->set_instance(instance);
-
-    int retval = rtapi_rpc(z_command, command, reply);
-    if (retval)
-	return retval;
-    return reply.retcode();
+    return run_command(false);
 }
 
 
 int rtapi_ping(int instance)
 {
-    machinetalk::RTAPICommand *cmd;
-    command.Clear();
-    command.set_type(machinetalk::MT_RTAPI_APP_PING);
-    cmd = command.mutable_rtapicmd();
+    machinetalk::RTAPICommand *cmd =
+	new_command(machinetalk::MT_RTAPI_APP_PING, false);
     cmd->set_instance(instance);
+    return run_command(false);
+}
 
-    int retval = rtapi_rpc(z_command, command, reply);
-    if (retval)
-	return retval;
-    return reply.retcode();
+int rtapi_preload(int instance, const char **modules)
+{
+    machinetalk::RTAPICommand *cmd =
+	new_command(machinetalk::MT_RTAPI_APP_PRELOAD, false);
+    cmd->set_instance(instance);
+    add_argv(cmd, modules);
+    return run_command(false);
 }
 
 int rtapi_newthread(
     int instance, const char *name, int period, int cpu,
     char *cgname, int use_fp, int flags)
 {
-    machinetalk::RTAPICommand *cmd;
-    command.Clear();
-    command.set_type(machinetalk::MT_RTAPI_APP_NEWTHREAD);
-    cmd = command.mutable_rtapicmd();
+    machinetalk::RTAPICommand *cmd =
+	new_command(machinetalk::MT_RTAPI_APP_NEWTHREAD, true);
     cmd->set_instance(instance);
     cmd->set_threadname(name);
     cmd->set_threadperiod(period);
@@ -209,25 +243,16 @@ int rtapi_newthread(
     cmd->set_use_fp(use_fp);
     cmd->set_flags(flags);
     cmd->set_cgname(cgname);
-
-    int retval = rtapi_rpc(z_command, command, reply);
-    if (retval)
-	return retval;
-    return reply.retcode();
+    return run_command(true);
 }
 
 int rtapi_delthread(int instance, const char *name)
 {
-    machinetalk::RTAPICommand *cmd;
-    command.Clear();
-    command.set_type(machinetalk::MT_RTAPI_APP_DELTHREAD);
-    cmd = command.mutable_rtapicmd();
+    machinetalk::RTAPICommand *cmd =
+	new_command(machinetalk::MT_RTAPI_APP_DELTHREAD, true);
     cmd->set_instance(instance);
     cmd->set_threadname(name);
-    int retval = rtapi_rpc(z_command, command, reply);
-    if (retval)
-	return retval;
-    return reply.retcode();
+    return run_command(true);
 }
 
 const char *rtapi_rpcerror(void)
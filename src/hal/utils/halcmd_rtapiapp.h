@@ -10,6 +10,8 @@ extern "C" {
     int rtapi_unloadrt(int instance, const char *modname);
     int rtapi_shutdown(int instance);
     int rtapi_ping(int instance);
+    // hint: modules (NULL terminated) are about to be loaded
+    int rtapi_preload(int instance, const char **modules);
     int rtapi_newthread(int instance, const char *name, int period,
                         int cpu, char *cgname, int use_fp, int flags);
     int rtapi_delthread(int instance, const char *name);
@@ -23,6 +25,16 @@ extern "C" {
     int rtapi_delinst(int instance,
 		      const char *instname);
     const char *rtapi_rpcerror(void);
+
+    // batching: while on, callfunc, newinst, newthread and delthread
+    // are queued and return 0; rtapi_batch_flush() sends the queue as
+    // one request, which rtapi_app executes in order up to the first
+    // failing command. Returns its retcode, and its queue index in
+    // *failed if given (-1 if none, or the request itself failed).
+    // Other commands flush the queue before they are sent.
+    int rtapi_batch(int on);    // off flushes
+    int rtapi_batch_pending(void);
+    int rtapi_batch_flush(int *failed);
     void rtapi_cleanup();
 
     extern int proto_debug;
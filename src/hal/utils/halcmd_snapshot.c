@@ -0,0 +1,966 @@
+/*
+ * binary snapshots of the HAL graph
+ *
+ * 'save snapshot <file>' records the configuration built so far: modules
+ * loaded by loadrt with their arguments, instances, threads, signals,
+ * links, writable parameter values, values of unlinked input pins, and
+ * the functs of every thread in order.
+ *
+ * 'restore <file>' rebuilds it. What only rtapi_app can do - loading
+ * modules, creating instances and threads - is done first. The rest is
+ * applied under a single hold of the HAL mutex: objects are looked up
+ * through an index built in one pass over the object list, names and
+ * types are checked and memory is reserved before anything is changed,
+ * and signals, links and functs are made with the descriptor based
+ * halpr_* functions instead of one name lookup after another.
+ *
+ * A snapshot is only valid with the HAL version and the module binaries
+ * it was taken with: restore refuses to load a module whose size or
+ * mtime changed - bring up a changed configuration from its .hal files.
+ * Objects which exist already are left alone, so restoring on top of a
+ * partly built configuration completes it.
+ */
+
+#include "config.h"
+#include "rtapi.h"		/* RTAPI realtime OS API */
+#include "rtapi_compat.h"	/* rtapi_module_path() */
+#include "hal.h"		/* HAL public API decls */
+#include "hal_priv.h"		/* private HAL decls */
+#include "halcmd.h"
+#include "halcmd_commands.h"
+#include "halcmd_rtapiapp.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <string.h>
+#include <errno.h>
+#include <limits.h>
+#include <time.h>
+#include <sys/stat.h>
+
+#define SNAP_MAGIC   0x534c4148   // HALS
+#define SNAP_VERSION 1
+
+// the payload is one section per kind, in this order
+enum snap_kind {
+    SNAP_MODULE,    // name args size mtime_sec mtime_nsec
+    SNAP_INST,      // comp name args
+    SNAP_THREAD,    // name period cpu uses_fp flags cgname
+    SNAP_SIGNAL,    // name type value
+    SNAP_LINK,      // pin signal-index
+    SNAP_PARAM,     // name type value
+    SNAP_PIN,       // name type value - unlinked input pins
+    SNAP_FUNCT,     // thread-index funct rmb wmb
+    SNAP_NKINDS
+};
+
+typedef struct {
+    uint32_t magic;
+    uint32_t version;
+    uint32_t hal_version;
+    uint32_t size;          // of the payload following
+    uint32_t checksum;      // FNV-1a of the payload
+    uint32_t count[SNAP_NKINDS];
+} snap_hdr_t;
+
+static uint32_t fnv1a(const char *p, size_t n)
+{
+    uint32_t h = 0x811c9dc5;
+    while (n--)
+	h = (h ^ (unsigned char) *p++) * 0x01000193;
+    return h;
+}
+
+////////////////////////////////////////////////////////////////////////
+// save snapshot
+
+typedef struct {
+    hal_sig_t *sig;
+    uint32_t index;
+} sigref_t;
+
+typedef struct {
+    char *buf;
+    size_t len, size;
+    int error;
+    uint32_t count[SNAP_NKINDS];
+
+    sigref_t *sigs;             // signals written, sorted by descriptor
+    size_t nsigs;
+    hal_thread_t **threads;     // threads written, in order
+    size_t nthreads;
+} snapctx_t;
+
+static void put(snapctx_t *c, const void *p, size_t n)
+{
+    if (c->error)
+	return;
+    if (c->len + n > c->size) {
+	size_t size = c->size ? c->size * 2 : 65536;
+	while (size < c->len + n)
+	    size *= 2;
+	char *buf = realloc(c->buf, size);
+	if (buf == NULL) {
+	    c->error = -ENOMEM;
+	    return;
+	}
+	c->buf = buf;
+	c->size = size;
+    }
+    memcpy(c->buf + c->len, p, n);
+    c->len += n;
+}
+
+static void put_u32(snapctx_t *c, uint32_t v) { put(c, &v, sizeof(v)); }
+static void put_i64(snapctx_t *c, int64_t v)  { put(c, &v, sizeof(v)); }
+static void put_value(snapctx_t *c, const hal_data_u *v) { put(c, v, sizeof(*v)); }
+
+// legacy params live in the component's own memory and are only as
+// wide as their type - never copy a whole hal_data_u to or from one
+static void copy_value(hal_type_t type, hal_data_u *dst, const hal_data_u *src)
+{
+    switch (type) {
+    case HAL_BIT:   dst->b = src->b; break;
+    case HAL_FLOAT: dst->f = src->f; break;
+    case HAL_S32:   dst->s = src->s; break;
+    case HAL_U32:   dst->u = src->u; break;
+    case HAL_S64:   dst->ls = src->ls; break;
+    case HAL_U64:   dst->lu = src->lu; break;
+    default: break;
+    }
+}
+
+// strings go with their NUL, so restore can use them in place
+static void put_str(snapctx_t *c, const char *s)
+{
+    size_t n = strlen(s) + 1;
+    put_u32(c, n);
+    put(c, s, n);
+}
+
+static void *grow(void *p, size_t n, size_t size)
+{
+    // double at powers of two
+    if (n && (n & (n - 1)))
+	return p;
+    return realloc(p, (n ? 2 * n : 16) * size);
+}
+
+static int snap_module(hal_object_ptr o, foreach_args_t *args)
+{
+    snapctx_t *c = args->user_ptr1;
+    hal_comp_t *comp = o.comp;
+    char path[PATH_MAX];
+    struct stat st;
+
+    // as 'save comp': the RT comps loaded by loadrt
+    if ((comp->type != TYPE_RT) || (comp->insmod_args == 0))
+	return 0;
+    memset(&st, 0, sizeof(st));
+    if (rtapi_module_path(path, sizeof(path), ho_name(comp)) == 0)
+	stat(path, &st);
+    put_str(c, ho_name(comp));
+    put_str(c, SHMPTR(comp->insmod_args));
+    put_i64(c, st.st_size);
+    put_i64(c, st.st_mtim.tv_sec);
+    put_i64(c, st.st_mtim.tv_nsec);
+    c->count[SNAP_MODULE]++;
+    return 0;
+}
+
+static int snap_inst(hal_object_ptr o, foreach_args_t *args)
+{
+    snapctx_t *c = args->user_ptr1;
+    hal_inst_t *inst = o.inst;
+    hal_comp_t *comp = halpr_find_comp_by_id(ho_owner_id(inst));
+
+    if (comp == NULL)
+	return 0;
+    put_str(c, ho_name(comp));
+    put_str(c, ho_name(inst));
+    put_str(c, inst->inst_args ? (char *) SHMPTR(inst->inst_args) : "");
+    c->count[SNAP_INST]++;
+    return 0;
+}
+
+static int snap_thread(hal_object_ptr o, foreach_args_t *args)
+{
+    snapctx_t *c = args->user_ptr1;
+    hal_thread_t *thread = o.thread;
+    hal_thread_t **threads;
+
+    if ((threads = grow(c->threads, c->nthreads, sizeof(*threads))) == NULL)
+	return -ENOMEM;
+    c->threads = threads;
+    c->threads[c->nthreads++] = thread;
+
+    put_str(c, ho_name(thread));
+    put_i64(c, thread->period);
+    put_u32(c, thread->cpu_id);
+    put_u32(c, thread->uses_fp);
+    put_u32(c, thread->flags);
+    put_str(c, thread->cgname);
+    c->count[SNAP_THREAD]++;
+    return 0;
+}
+
+static int snap_signal(hal_object_ptr o, foreach_args_t *args)
+{
+    snapctx_t *c = args->user_ptr1;
+    hal_sig_t *sig = o.sig;
+    sigref_t *sigs;
+
+    if ((sigs = grow(c->sigs, c->nsigs, sizeof(*sigs))) == NULL)
+	return -ENOMEM;
+    c->sigs = sigs;
+    c->sigs[c->nsigs].sig = sig;
+    c->sigs[c->nsigs].index = c->nsigs;
+    c->nsigs++;
+
+    put_str(c, ho_name(sig));
+    put_u32(c, sig->type);
+    put_value(c, &sig->value);
+    c->count[SNAP_SIGNAL]++;
+    return 0;
+}
+
+static int cmp_sigref(const void *a, const void *b)
+{
+    const hal_sig_t *sa = ((const sigref_t *) a)->sig;
+    const hal_sig_t *sb = ((const sigref_t *) b)->sig;
+    return (sa > sb) - (sa < sb);
+}
+
+static int snap_link(hal_object_ptr o, foreach_args_t *args)
+{
+    snapctx_t *c = args->user_ptr1;
+    hal_pin_t *pin = o.pin;
+    sigref_t key, *ref;
+
+    if (!pin_is_linked(pin))
+	return 0;
+    key.sig = signal_of(pin);
+    ref = bsearch(&key, c->sigs, c->nsigs, sizeof(sigref_t), cmp_sigref);
+    if (ref == NULL)
+	return 0;
+    put_str(c, ho_name(pin));
+    put_u32(c, ref->index);
+    c->count[SNAP_LINK]++;
+    return 0;
+}
+
+static int snap_param(hal_object_ptr o, foreach_args_t *args)
+{
+    snapctx_t *c = args->user_ptr1;
+    hal_param_t *param = o.param;
+    hal_data_u value;
+
+    // as 'save param': the writable ones
+    if (param->dir == HAL_RO)
+	return 0;
+    memset(&value, 0, sizeof(value));
+    copy_value(param->type, &value, param_value(param));
+    put_str(c, ho_name(param));
+    put_u32(c, param->type);
+    put_value(c, &value);
+    c->count[SNAP_PARAM]++;
+    return 0;
+}
+
+static int snap_pin(hal_object_ptr o, foreach_args_t *args)
+{
+    snapctx_t *c = args->user_ptr1;
+    hal_pin_t *pin = o.pin;
+
+    // values set by setp on pins
+    if (pin_is_linked(pin) || (pin->dir == HAL_OUT))
+	return 0;
+    put_str(c, ho_name(pin));
+    put_u32(c, pin->type);
+    put_value(c, &pin->dummysig);
+    c->count[SNAP_PIN]++;
+    return 0;
+}
+
+static void snap_functs(snapctx_t *c)
+{
+    size_t i;
+
+    for (i = 0; i < c->nthreads; i++) {
+	hal_list_t *list_root = &(c->threads[i]->funct_list);
+	hal_list_t *list_entry = dlist_next(list_root);
+
+	while (list_entry != list_root) {
+	    hal_funct_entry_t *fentry = (hal_funct_entry_t *) list_entry;
+	    hal_funct_t *funct = SHMPTR(fentry->funct_ptr);
+
+	    put_u32(c, i);
+	    put_str(c, ho_name(funct));
+	    put_u32(c, fentry->rmb);
+	    put_u32(c, fentry->wmb);
+	    c->count[SNAP_FUNCT]++;
+	    list_entry = dlist_next(list_entry);
+	}
+    }
+}
+
+int halcmd_save_snapshot(char *filename)
+{
+    snapctx_t c;
+    snap_hdr_t hdr;
+    FILE *dst;
+    int retval = 0;
+
+    memset(&c, 0, sizeof(c));
+    {
+	// one consistent view of the graph
+	WITH_HAL_MUTEX();
+
+	static const struct {
+	    int type;
+	    hal_object_callback_t cb;
+	} passes[] = {
+	    { HAL_COMPONENT, snap_module },
+	    { HAL_INST,      snap_inst },
+	    { HAL_THREAD,    snap_thread },
+	    { HAL_SIGNAL,    snap_signal },
+	    { HAL_PIN,       snap_link },
+	    { HAL_PARAM,     snap_param },
+	    { HAL_PIN,       snap_pin },
+	};
+	size_t i;
+
+	for (i = 0; i < sizeof(passes) / sizeof(passes[0]); i++) {
+	    foreach_args_t args =  {
+		.type = passes[i].type,
+		.user_ptr1 = &c,
+	    };
+	    if (passes[i].cb == snap_link)
+		qsort(c.sigs, c.nsigs, sizeof(sigref_t), cmp_sigref);
+	    retval = halg_foreach(false, &args, passes[i].cb);
+	    if (retval < 0)
+		break;
+	}
+	if (retval >= 0)
+	    snap_functs(&c);
+    }
+    free(c.sigs);
+    free(c.threads);
+    if ((retval < 0) || c.error) {
+	halcmd_error("save snapshot: %s\n",
+		     strerror(-(retval < 0 ? retval : c.error)));
+	free(c.buf);
+	return -1;
+    }
+
+    memset(&hdr, 0, sizeof(hdr));
+    hdr.magic = SNAP_MAGIC;
+    hdr.version = SNAP_VERSION;
+    hdr.hal_version = HAL_VER;
+    hdr.size = c.len;
+    hdr.checksum = fnv1a(c.buf, c.len);
+    memcpy(hdr.count, c.count, sizeof(hdr.count));
+
+    if ((dst = fopen(filename, "w")) == NULL) {
+	halcmd_error("Can't open 'save' destination '%s'\n", filename);
+	free(c.buf);
+	return -1;
+    }
+    if ((fwrite(&hdr, sizeof(hdr), 1, dst) != 1) ||
+	(c.len && (fwrite(c.buf, c.len, 1, dst) != 1))) {
+	halcmd_error("save snapshot: writing '%s': %s\n",
+		     filename, strerror(errno));
+	retval = -1;
+    }
+    if (fclose(dst) && (retval == 0)) {
+	halcmd_error("save snapshot: writing '%s': %s\n",
+		     filename, strerror(errno));
+	retval = -1;
+    }
+    free(c.buf);
+    if (retval == 0)
+	halcmd_info("snapshot of %u signals, %u links, %u functs saved to '%s'\n",
+		    c.count[SNAP_SIGNAL], c.count[SNAP_LINK],
+		    c.count[SNAP_FUNCT], filename);
+    return retval;
+}
+
+////////////////////////////////////////////////////////////////////////
+// restore
+
+typedef struct {
+    char *name, *args;
+    int64_t size, sec, nsec;
+} snap_module_t;
+
+typedef struct {
+    char *comp, *name, *args;
+} snap_inst_t;
+
+typedef struct {
+    char *name;
+    int64_t period;
+    uint32_t cpu, uses_fp, flags;
+    char *cgname;
+} snap_thread_t;
+
+typedef struct {        // signals, params, pins
+    char *name;
+    uint32_t type;
+    hal_data_u value;
+} snap_value_t;
+
+typedef struct {
+    char *pin;
+    uint32_t sig;
+} snap_link_t;
+
+typedef struct {
+    uint32_t thread;
+    char *funct;
+    uint32_t rmb, wmb;
+} snap_funct_t;
+
+typedef struct {
+    snap_hdr_t hdr;
+    char *payload;
+    char *p, *end;      // read cursor
+    int error;
+
+    snap_module_t *modules;
+    snap_inst_t *insts;
+    snap_thread_t *threads;
+    snap_value_t *signals;
+    snap_link_t *links;
+    snap_value_t *params;
+    snap_value_t *pins;
+    snap_funct_t *functs;
+} snap_t;
+
+static void get(snap_t *s, void *p, size_t n)
+{
+    if (s->error || (n > (size_t)(s->end - s->p))) {
+	s->error = 1;
+	memset(p, 0, n);
+	return;
+    }
+    memcpy(p, s->p, n);
+    s->p += n;
+}
+
+static uint32_t get_u32(snap_t *s) { uint32_t v; get(s, &v, sizeof(v)); return v; }
+static int64_t get_i64(snap_t *s)  { int64_t v;  get(s, &v, sizeof(v)); return v; }
+static void get_value(snap_t *s, hal_data_u *v) { get(s, v, sizeof(*v)); }
+
+static char *get_str(snap_t *s)
+{
+    uint32_t n = get_u32(s);
+    char *str = s->p;
+
+    if (s->error || (n == 0) || (n > (size_t)(s->end - s->p)) ||
+	(str[n - 1] != '\0')) {
+	s->error = 1;
+	return "";
+    }
+    s->p += n;
+    return str;
+}
+
+static void get_values(snap_t *s, snap_value_t *v, uint32_t n)
+{
+    uint32_t i;
+
+    for (i = 0; i < n; i++) {
+	v[i].name = get_str(s);
+	v[i].type = get_u32(s);
+	get_value(s, &v[i].value);
+    }
+}
+
+static void snap_free(snap_t *s)
+{
+    free(s->payload);
+    free(s->modules);
+    free(s->insts);
+    free(s->threads);
+    free(s->signals);
+    free(s->links);
+    free(s->params);
+    free(s->pins);
+    free(s->functs);
+}
+
+#define SNAP_ALLOC(s, field, kind)					\
+    (((s)->field = calloc((s)->hdr.count[kind] + 1, sizeof(*(s)->field))) != NULL)
+
+static int snap_read(const char *filename, snap_t *s)
+{
+    FILE *src;
+    uint32_t i, *count = s->hdr.count;
+
+    memset(s, 0, sizeof(*s));
+    if ((src = fopen(filename, "r")) == NULL) {
+	halcmd_error("restore: can't open '%s': %s\n", filename, strerror(errno));
+	return -1;
+    }
+    if ((fread(&s->hdr, sizeof(s->hdr), 1, src) != 1) ||
+	(s->hdr.magic != SNAP_MAGIC) ||
+	(s->hdr.version != SNAP_VERSION)) {
+	halcmd_error("restore: '%s' is not a HAL snapshot\n", filename);
+	fclose(src);
+	return -1;
+    }
+    if (s->hdr.hal_version != HAL_VER) {
+	halcmd_error("restore: '%s' was saved by HAL version %u, this is %u\n",
+		     filename, s->hdr.hal_version, HAL_VER);
+	fclose(src);
+	return -1;
+    }
+    if (((s->payload = malloc(s->hdr.size + 1)) == NULL) ||
+	(fread(s->payload, 1, s->hdr.size, src) != s->hdr.size) ||
+	(fnv1a(s->payload, s->hdr.size) != s->hdr.checksum)) {
+	halcmd_error("restore: '%s' is truncated or corrupt\n", filename);
+	fclose(src);
+	snap_free(s);
+	return -1;
+    }
+    fclose(src);
+
+    if (!SNAP_ALLOC(s, modules, SNAP_MODULE) ||
+	!SNAP_ALLOC(s, insts, SNAP_INST) ||
+	!SNAP_ALLOC(s, threads, SNAP_THREAD) ||
+	!SNAP_ALLOC(s, signals, SNAP_SIGNAL) ||
+	!SNAP_ALLOC(s, links, SNAP_LINK) ||
+	!SNAP_ALLOC(s, params, SNAP_PARAM) ||
+	!SNAP_ALLOC(s, pins, SNAP_PIN) ||
+	!SNAP_ALLOC(s, functs, SNAP_FUNCT)) {
+	halcmd_error("restore: out of memory\n");
+	snap_free(s);
+	return -1;
+    }
+
+    s->p = s->payload;
+    s->end = s->payload + s->hdr.size;
+    for (i = 0; i < count[SNAP_MODULE]; i++) {
+	s->modules[i].name = get_str(s);
+	s->modules[i].args = get_str(s);
+	s->modules[i].size = get_i64(s);
+	s->modules[i].sec = get_i64(s);
+	s->modules[i].nsec = get_i64(s);
+    }
+    for (i = 0; i < count[SNAP_INST]; i++) {
+	s->insts[i].comp = get_str(s);
+	s->insts[i].name = get_str(s);
+	s->insts[i].args = get_str(s);
+    }
+    for (i = 0; i < count[SNAP_THREAD]; i++) {
+	s->threads[i].name = get_str(s);
+	s->threads[i].period = get_i64(s);
+	s->threads[i].cpu = get_u32(s);
+	s->threads[i].uses_fp = get_u32(s);
+	s->threads[i].flags = get_u32(s);
+	s->threads[i].cgname = get_str(s);
+    }
+    get_values(s, s->signals, count[SNAP_SIGNAL]);
+    for (i = 0; i < count[SNAP_LINK]; i++) {
+	s->links[i].pin = get_str(s);
+	s->links[i].sig = get_u32(s);
+	if (s->links[i].sig >= count[SNAP_SIGNAL])
+	    s->error = 1;
+    }
+    get_values(s, s->params, count[SNAP_PARAM]);
+    get_values(s, s->pins, count[SNAP_PIN]);
+    for (i = 0; i < count[SNAP_FUNCT]; i++) {
+	s->functs[i].thread = get_u32(s);
+	s->functs[i].funct = get_str(s);
+	s->functs[i].rmb = get_u32(s);
+	s->functs[i].wmb = get_u32(s);
+	if (s->functs[i].thread >= count[SNAP_THREAD])
+	    s->error = 1;
+    }
+    if (s->error || (s->p != s->end)) {
+	halcmd_error("restore: '%s' is corrupt\n", filename);
+	snap_free(s);
+	return -1;
+    }
+    return 0;
+}
+
+// split a blank separated argument string in place
+static void split_args(char *s, char *argv[], int max)
+{
+    int n = 0;
+    char *save, *tok;
+
+    for (tok = strtok_r(s, " \t", &save);
+	 tok && (n < max);
+	 tok = strtok_r(NULL, " \t", &save))
+	argv[n++] = tok;
+    argv[n] = NULL;
+}
+
+// conflicts with objects which exist already, checked before anything
+// is loaded; objects created by restore_rtapi() are checked by
+// restore_graph()
+static int check_existing(snap_t *s)
+{
+    uint32_t *count = s->hdr.count;
+    uint32_t i;
+
+    WITH_HAL_MUTEX();
+
+    for (i = 0; i < count[SNAP_SIGNAL]; i++) {
+	snap_value_t *v = &s->signals[i];
+	hal_sig_t *sig = halpr_find_sig_by_name(v->name);
+	if (sig && (sig->type != v->type)) {
+	    halcmd_error("restore: signal '%s' exists with another type\n",
+			 v->name);
+	    return -EINVAL;
+	}
+    }
+    for (i = 0; i < count[SNAP_LINK]; i++) {
+	snap_link_t *l = &s->links[i];
+	hal_pin_t *pin = halpr_find_pin_by_name(l->pin);
+	if ((pin == NULL) || !pin_is_linked(pin))
+	    continue;
+	if (strcmp(ho_name(signal_of(pin)), s->signals[l->sig].name)) {
+	    halcmd_error("restore: pin '%s' is linked to '%s'\n",
+			 l->pin, ho_name(signal_of(pin)));
+	    return -EINVAL;
+	}
+    }
+    for (i = 0; i < count[SNAP_PARAM]; i++) {
+	snap_value_t *v = &s->params[i];
+	hal_param_t *param = halpr_find_param_by_name(v->name);
+	if (param && ((param->type != v->type) || (param->dir == HAL_RO))) {
+	    halcmd_error("restore: no writable param '%s' of that type\n",
+			 v->name);
+	    return -EINVAL;
+	}
+    }
+    for (i = 0; i < count[SNAP_PIN]; i++) {
+	snap_value_t *v = &s->pins[i];
+	hal_pin_t *pin = halpr_find_pin_by_name(v->name);
+	if (pin && (pin->type != v->type)) {
+	    halcmd_error("restore: no pin '%s' of that type\n", v->name);
+	    return -EINVAL;
+	}
+    }
+    return 0;
+}
+
+// modules, instances and threads: through rtapi_app
+static int restore_rtapi(snap_t *s)
+{
+    char *argv[MAX_TOK + 1];
+    char path[PATH_MAX];
+    struct stat st;
+    uint32_t i;
+    int retval;
+
+    // check all modules first, so nothing is loaded if one changed
+    for (i = 0; i < s->hdr.count[SNAP_MODULE]; i++) {
+	snap_module_t *m = &s->modules[i];
+
+	if (module_loaded(1, m->name))
+	    continue;
+	if ((rtapi_module_path(path, sizeof(path), m->name) != 0) ||
+	    (stat(path, &st) != 0)) {
+	    halcmd_error("restore: module '%s' not found\n", m->name);
+	    return -ENOENT;
+	}
+	if ((st.st_size != m->size) ||
+	    (st.st_mtim.tv_sec != m->sec) ||
+	    (st.st_mtim.tv_nsec != m->nsec)) {
+	    halcmd_error("restore: module '%s' changed since the snapshot "
+			 "was saved\n", m->name);
+	    return -ESTALE;
+	}
+    }
+    for (i = 0; i < s->hdr.count[SNAP_MODULE]; i++) {
+	snap_module_t *m = &s->modules[i];
+
+	if (module_loaded(1, m->name))
+	    continue;
+	split_args(m->args, argv, MAX_TOK);
+	if ((retval = do_loadrt_cmd(m->name, argv)) != 0)
+	    return retval;
+    }
+    for (i = 0; i < s->hdr.count[SNAP_INST]; i++) {
+	snap_inst_t *inst = &s->insts[i];
+
+	if (inst_name_exists(1, inst->name))
+	    continue;
+	split_args(inst->args, argv, MAX_TOK);
+	if ((retval = do_newinst_cmd(inst->comp, inst->name, argv)) != 0)
+	    return retval;
+    }
+    for (i = 0; i < s->hdr.count[SNAP_THREAD]; i++) {
+	snap_thread_t *t = &s->threads[i];
+	bool exists;
+	{
+	    WITH_HAL_MUTEX();
+	    exists = (halpr_find_thread_by_name(t->name) != NULL);
+	}
+	if (exists)
+	    continue;
+	retval = rtapi_newthread(rtapi_instance, t->name, (int) t->period,
+				 (int) t->cpu, t->cgname, t->uses_fp,
+				 t->flags);
+	if (retval) {
+	    halcmd_error("rc=%d: %s\n", retval, rtapi_rpcerror());
+	    return retval;
+	}
+    }
+    // queued newinst/newthread must be done before the graph refers to them
+    return halcmd_batch_flush();
+}
+
+// index of the HAL objects by type and name, valid under the HAL mutex
+typedef struct {
+    const char *name;
+    int type;
+    hal_object_ptr o;
+} objref_t;
+
+typedef struct {
+    objref_t *refs;
+    size_t n, size;
+} objindex_t;
+
+static int index_object(hal_object_ptr o, foreach_args_t *args)
+{
+    objindex_t *ix = args->user_ptr1;
+
+    if (ix->n == ix->size) {
+	size_t size = ix->size ? ix->size * 2 : 1024;
+	objref_t *refs = realloc(ix->refs, size * sizeof(objref_t));
+	if (refs == NULL)
+	    return -ENOMEM;
+	ix->refs = refs;
+	ix->size = size;
+    }
+    ix->refs[ix->n].name = hh_get_name(o.hdr);
+    ix->refs[ix->n].type = hh_get_object_type(o.hdr);
+    ix->refs[ix->n].o = o;
+    ix->n++;
+    return 0;
+}
+
+static int cmp_objref(const void *a, const void *b)
+{
+    const objref_t *ra = a, *rb = b;
+    if (ra->type != rb->type)
+	return ra->type - rb->type;
+    return strcmp(ra->name, rb->name);
+}
+
+static hal_object_ptr lookup(objindex_t *ix, int type, const char *name)
+{
+    objref_t key = { .name = name, .type = type };
+    objref_t *ref = bsearch(&key, ix->refs, ix->n, sizeof(objref_t), cmp_objref);
+    return ref ? ref->o : HO_NULL;
+}
+
+static bool funct_on_thread(hal_funct_t *funct, hal_thread_t *thread)
+{
+    hal_list_t *list_root = &(thread->funct_list);
+    hal_list_t *list_entry;
+
+    for (list_entry = dlist_next(list_root);
+	 list_entry != list_root;
+	 list_entry = dlist_next(list_entry))
+	if (((hal_funct_entry_t *) list_entry)->funct_ptr == SHMOFF(funct))
+	    return true;
+    return false;
+}
+
+// check everything, then apply - all with the HAL mutex held
+static int restore_graph(snap_t *s, objindex_t *ix)
+{
+    uint32_t *count = s->hdr.count;
+    hal_sig_t **sigs = NULL;
+    hal_pin_t **pins = NULL;
+    hal_param_t **params = NULL;
+    hal_pin_t **values = NULL;
+    hal_funct_t **functs = NULL;
+    hal_thread_t **threads = NULL;
+    size_t new_sigs = 0, new_functs = 0;
+    uint32_t i;
+    int retval = -EINVAL;
+
+    if (((sigs = calloc(count[SNAP_SIGNAL] + 1, sizeof(*sigs))) == NULL) ||
+	((pins = calloc(count[SNAP_LINK] + 1, sizeof(*pins))) == NULL) ||
+	((params = calloc(count[SNAP_PARAM] + 1, sizeof(*params))) == NULL) ||
+	((values = calloc(count[SNAP_PIN] + 1, sizeof(*values))) == NULL) ||
+	((functs = calloc(count[SNAP_FUNCT] + 1, sizeof(*functs))) == NULL) ||
+	((threads = calloc(count[SNAP_THREAD] + 1, sizeof(*threads))) == NULL)) {
+	retval = -ENOMEM;
+	goto out;
+    }
+    {
+	WITH_HAL_MUTEX();
+
+	foreach_args_t args =  {
+	    .user_ptr1 = ix,
+	};
+	if ((retval = halg_foreach(false, &args, index_object)) < 0)
+	    goto out;
+	qsort(ix->refs, ix->n, sizeof(objref_t), cmp_objref);
+	retval = -EINVAL;
+
+	// resolve and check
+	for (i = 0; i < count[SNAP_SIGNAL]; i++) {
+	    snap_value_t *v = &s->signals[i];
+	    sigs[i] = lookup(ix, HAL_SIGNAL, v->name).sig;
+	    if (sigs[i] == NULL)
+		new_sigs++;
+	    else if (sigs[i]->type != v->type) {
+		halcmd_error("restore: signal '%s' exists with another type\n",
+			     v->name);
+		goto out;
+	    }
+	}
+	for (i = 0; i < count[SNAP_LINK]; i++) {
+	    snap_link_t *l = &s->links[i];
+	    if ((pins[i] = lookup(ix, HAL_PIN, l->pin).pin) == NULL) {
+		halcmd_error("restore: pin '%s' not found\n", l->pin);
+		goto out;
+	    }
+	    if (pins[i]->type != s->signals[l->sig].type) {
+		halcmd_error("restore: pin '%s' type does not match signal '%s'\n",
+			     l->pin, s->signals[l->sig].name);
+		goto out;
+	    }
+	    if (pin_is_linked(pins[i]) &&
+		(signal_of(pins[i]) != sigs[l->sig])) {
+		halcmd_error("restore: pin '%s' is linked to '%s'\n",
+			     l->pin, ho_name(signal_of(pins[i])));
+		goto out;
+	    }
+	}
+	for (i = 0; i < count[SNAP_PARAM]; i++) {
+	    snap_value_t *v = &s->params[i];
+	    params[i] = lookup(ix, HAL_PARAM, v->name).param;
+	    if ((params[i] == NULL) || (params[i]->type != v->type) ||
+		(params[i]->dir == HAL_RO)) {
+		halcmd_error("restore: no writable param '%s' of that type\n",
+			     v->name);
+		goto out;
+	    }
+	}
+	for (i = 0; i < count[SNAP_PIN]; i++) {
+	    snap_value_t *v = &s->pins[i];
+	    values[i] = lookup(ix, HAL_PIN, v->name).pin;
+	    if ((values[i] == NULL) || (values[i]->type != v->type)) {
+		halcmd_error("restore: no pin '%s' of that type\n",
+			     v->name);
+		goto out;
+	    }
+	}
+	for (i = 0; i < count[SNAP_THREAD]; i++) {
+	    snap_thread_t *t = &s->threads[i];
+	    if ((threads[i] = lookup(ix, HAL_THREAD, t->name).thread) == NULL) {
+		halcmd_error("restore: thread '%s' not found\n", t->name);
+		goto out;
+	    }
+	}
+	for (i = 0; i < count[SNAP_FUNCT]; i++) {
+	    snap_funct_t *f = &s->functs[i];
+	    if ((functs[i] = lookup(ix, HAL_FUNCT, f->funct).funct) == NULL) {
+		halcmd_error("restore: function '%s' not found\n", f->funct);
+		goto out;
+	    }
+	    if (funct_on_thread(functs[i], threads[f->thread]))
+		functs[i] = NULL;
+	    else
+		new_functs++;
+	}
+
+	// size the allocations up front rather than failing halfway
+	if ((retval = halpr_reserve(new_sigs * (sizeof(hal_sig_t) + 64),
+				    new_functs * (sizeof(hal_funct_entry_t) + 8))) < 0) {
+	    halcmd_error("restore: %s\n", hal_lasterror());
+	    goto out;
+	}
+	retval = -EINVAL;
+
+	// apply
+	for (i = 0; i < count[SNAP_SIGNAL]; i++) {
+	    snap_value_t *v = &s->signals[i];
+	    if ((sigs[i] == NULL) &&
+		((sigs[i] = halpr_signal_new(v->name, v->type)) == NULL)) {
+		halcmd_error("restore: %s\n", hal_lasterror());
+		goto out;
+	    }
+	}
+	for (i = 0; i < count[SNAP_LINK]; i++) {
+	    if (halpr_link(pins[i], sigs[s->links[i].sig])) {
+		halcmd_error("restore: %s\n", hal_lasterror());
+		goto out;
+	    }
+	}
+	for (i = 0; i < count[SNAP_SIGNAL]; i++) {
+	    // undriven signals keep the value set by 'sets'
+	    if ((sigs[i]->writers == 0) && (sigs[i]->bidirs == 0))
+		sigs[i]->value = s->signals[i].value;
+	}
+	for (i = 0; i < count[SNAP_PARAM]; i++)
+	    copy_value(params[i]->type, param_value(params[i]),
+		       &s->params[i].value);
+	for (i = 0; i < count[SNAP_PIN]; i++)
+	    if (!pin_is_linked(values[i]))
+		values[i]->dummysig = s->pins[i].value;
+	for (i = 0; i < count[SNAP_FUNCT]; i++) {
+	    snap_funct_t *f = &s->functs[i];
+	    if (functs[i] &&
+		halpr_add_funct_to_thread(functs[i], threads[f->thread], -1,
+					  f->rmb, f->wmb)) {
+		halcmd_error("restore: %s\n", hal_lasterror());
+		goto out;
+	    }
+	}
+	retval = 0;
+    }
+ out:
+    free(sigs);
+    free(pins);
+    free(params);
+    free(values);
+    free(functs);
+    free(threads);
+    return retval;
+}
+
+int do_restore_cmd(char *filename)
+{
+    struct timespec t0, t1;
+    objindex_t ix;
+    snap_t s;
+    int retval;
+
+    if (hal_get_lock() & HAL_LOCK_CONFIG) {
+	halcmd_error("HAL is locked, restore is not permitted\n");
+	return -EPERM;
+    }
+    clock_gettime(CLOCK_MONOTONIC, &t0);
+    if (snap_read(filename, &s))
+	return -EINVAL;
+    if (((retval = check_existing(&s)) == 0) &&
+	((retval = restore_rtapi(&s)) == 0)) {
+	memset(&ix, 0, sizeof(ix));
+	retval = restore_graph(&s, &ix);
+	free(ix.refs);
+    }
+    clock_gettime(CLOCK_MONOTONIC, &t1);
+    if (retval == 0)
+	halcmd_info("restored %u signals, %u links, %u functs from '%s' "
+		    "in %ld ms\n",
+		    s.hdr.count[SNAP_SIGNAL], s.hdr.count[SNAP_LINK],
+		    s.hdr.count[SNAP_FUNCT], filename,
+		    (t1.tv_sec - t0.tv_sec) * 1000 +
+		    (t1.tv_nsec - t0.tv_nsec) / 1000000);
+    snap_free(&s);
+    return retval;
+}
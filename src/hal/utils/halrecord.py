@@ -0,0 +1,142 @@
+#!/usr/bin/env python3
+# vim: sts=4 sw=4 et
+"""
+halrecord - stream the records of a 'recorder' or 'samplerv2' instance
+
+    halrecord <ring> -o file.rec [-n slots]     record into a file
+    halrecord <ring> -r file.bin|-              write raw records
+    halrecord <ring> -z tcp://*:6660            publish on a zeroMQ socket
+    halrecord --dump file.rec [-f csv|raw]      decode a record file
+
+The record file is a memory-mapped circular buffer of 'slots' records,
+so it always holds the latest records and survives a crash of the
+recording machine's HAL side - write it to persistent storage for
+post-mortem analysis.  The file format and the record layout are in
+machinekit.recordfile.
+
+On the zeroMQ socket, each record is sent as a two-frame message
+[ <ring name>, <record> ]; the layout is sent as
+[ <ring name>.layout, <layout text> ] once per second, so subscribers
+can join at any time.
+
+Raw output is the records back to back with no layout, growing without
+bound; it is what 'halstream' feeds to a streamerv2.
+"""
+
+import argparse
+import mmap
+import sys
+import time
+
+from machinekit.recordfile import Layout, RecordFile, file_layout, file_records
+
+
+class RawFile:
+    def __init__(self, path):
+        if path == '-':
+            self.f = sys.stdout.buffer
+        else:
+            self.f = open(path, 'wb')
+
+    def write(self, record):
+        self.f.write(record)
+
+    def close(self):
+        self.f.flush()
+        if self.f is not sys.stdout.buffer:
+            self.f.close()
+
+
+class Publisher:
+    def __init__(self, uri, name, layout):
+        import zmq
+        self.ctx = zmq.Context()
+        self.socket = self.ctx.socket(zmq.PUB)
+        self.socket.bind(uri)
+        self.topic = name.encode()
+        self.layout = [(name + '.layout').encode(), layout.text.encode()]
+        self.last = 0
+
+    def write(self, record):
+        now = time.time()
+        if now - self.last > 1.0:
+            self.socket.send_multipart(self.layout)
+            self.last = now
+        self.socket.send_multipart([self.topic, record])
+
+    def close(self):
+        self.socket.close()
+        self.ctx.term()
+
+
+def dump(path, fmt):
+    with open(path, 'rb') as f:
+        m = mmap.mmap(f.fileno(), 0, access=mmap.ACCESS_READ)
+    layout = file_layout(m)
+    out = sys.stdout
+    if fmt == 'csv':
+        out.write(','.join(['sequence', 'timestamp'] + layout.names) + '\n')
+    for record in file_records(m, layout):
+        if fmt == 'raw':
+            out.buffer.write(record)
+            continue
+        seq, ts, values = layout.decode(record)
+        out.write(','.join(str(v) for v in [seq, ts] + values) + '\n')
+
+
+def stream(args):
+    from machinekit import hal
+
+    ring = hal.Ring(args.ring)
+    layout = Layout.from_ring(ring)
+    if args.output:
+        sink = RecordFile(args.output, layout, args.slots)
+    elif args.raw:
+        sink = RawFile(args.raw)
+    else:
+        sink = Publisher(args.zmq, args.ring, layout)
+
+    written = 0
+    try:
+        while args.count == 0 or written < args.count:
+            record = ring.read()
+            if record is None:
+                time.sleep(args.poll)
+                continue
+            sink.write(record.tobytes())
+            ring.shift()
+            written += 1
+    except KeyboardInterrupt:
+        pass
+    finally:
+        sink.close()
+
+
+def main():
+    ap = argparse.ArgumentParser(description='stream recorder records')
+    ap.add_argument('ring', nargs='?', help='recorder instance/ring name')
+    ap.add_argument('-o', '--output', help='memory-mapped record file')
+    ap.add_argument('-n', '--slots', type=int, default=100000,
+                    help='records kept in the file (default 100000)')
+    ap.add_argument('-r', '--raw', help="raw record file, '-' for stdout")
+    ap.add_argument('-z', '--zmq', help='zeroMQ PUB socket URI to bind')
+    ap.add_argument('-c', '--count', type=int, default=0,
+                    help='stop after this many records (default: run '
+                    'until interrupted)')
+    ap.add_argument('-p', '--poll', type=float, default=0.005,
+                    help='ring poll interval in seconds')
+    ap.add_argument('--dump', metavar='FILE', help='decode a record file')
+    ap.add_argument('-f', '--format', choices=('csv', 'raw'), default='csv')
+    args = ap.parse_args()
+
+    if args.dump:
+        dump(args.dump, args.format)
+        return
+    sinks = [a for a in (args.output, args.raw, args.zmq) if a]
+    if not args.ring or len(sinks) != 1:
+        ap.error('need a ring name and exactly one of -o, -r or -z')
+    stream(args)
+
+
+if __name__ == '__main__':
+    main()
@@ -0,0 +1,111 @@
+#!/usr/bin/env python3
+# vim: sts=4 sw=4 et
+"""
+halstream - feed the ring of a 'streamerv2' instance
+
+    halstream <ring> file.bin           raw records, back to back
+    halstream <ring> file.rec           a halrecord record file, in order
+    halstream <ring> -t [file|-]        text, one record per line
+
+Records are binary in the layout the streamerv2 publishes in its ring
+scratchpad (see streamerv2.c), so raw and record files go to the ring
+without any conversion: the file is memory-mapped and each record is
+copied into the ring once.  Raw files are what 'halrecord -r' or
+'halrecord --dump -f raw' write.  A record file must come from an
+instance with the same pin types; the pin names do not matter.
+
+Text input is the halstreamer format: whitespace separated values in
+cfg order, one line per record; lines starting with '#' are skipped.
+Each line is parsed with one pack() of a precompiled struct.
+
+When the ring is full, halstream waits for the streamer to catch up.
+"""
+
+import argparse
+import mmap
+import sys
+import time
+
+from machinekit.recordfile import (Layout, is_record_file, file_layout,
+                                   file_records)
+
+
+class Feeder:
+    def __init__(self, ring, poll):
+        self.ring = ring
+        self.poll = poll
+        self.count = 0
+
+    def write(self, record):
+        while not self.ring.write(record):
+            time.sleep(self.poll)
+        self.count += 1
+
+
+def feed_file(feeder, layout, path):
+    with open(path, 'rb') as f:
+        m = mmap.mmap(f.fileno(), 0, access=mmap.ACCESS_READ)
+    size = layout.size
+    if is_record_file(m):
+        if not file_layout(m).same(layout):
+            raise ValueError('%s: record layout does not match the ring'
+                             % path)
+        for record in file_records(m, layout):
+            feeder.write(record)
+    else:
+        if len(m) % size:
+            raise ValueError('%s: size %d is not a multiple of the %d byte '
+                             'record' % (path, len(m), size))
+        for offset in range(0, len(m), size):
+            feeder.write(m[offset:offset + size])
+    m.close()
+
+
+def feed_text(feeder, layout, f):
+    for n, line in enumerate(f, 1):
+        line = line.strip()
+        if not line or line.startswith('#'):
+            continue
+        try:
+            feeder.write(layout.parse(n, line))
+        except ValueError as e:
+            sys.exit('line %d: %s' % (n, e))
+
+
+def main():
+    ap = argparse.ArgumentParser(description='feed a streamerv2 ring')
+    ap.add_argument('ring', help='streamerv2 instance/ring name')
+    ap.add_argument('input', nargs='?', default='-',
+                    help='raw or record file, or text with -t '
+                    '(default: stdin)')
+    ap.add_argument('-t', '--text', action='store_true',
+                    help='input is text, one record per line')
+    ap.add_argument('-p', '--poll', type=float, default=0.001,
+                    help='wait this many seconds when the ring is full')
+    args = ap.parse_args()
+
+    from machinekit import hal
+
+    ring = hal.Ring(args.ring)
+    layout = Layout.from_ring(ring)
+    feeder = Feeder(ring, args.poll)
+    try:
+        if args.text:
+            if args.input == '-':
+                feed_text(feeder, layout, sys.stdin)
+            else:
+                with open(args.input) as f:
+                    feed_text(feeder, layout, f)
+        else:
+            if args.input == '-':
+                ap.error('binary input needs a file name')
+            feed_file(feeder, layout, args.input)
+    except KeyboardInterrupt:
+        pass
+    except ValueError as e:
+        sys.exit(str(e))
+    print('%d records' % feeder.count, file=sys.stderr)
+
+
+if __name__ == '__main__':
+    main()
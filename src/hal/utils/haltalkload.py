@@ -0,0 +1,237 @@
+#!/usr/bin/env python3
+# vim: sts=4 sw=4 et
+"""
+haltalkload - haltalk group update latency under load
+
+Creates N HAL groups of M float signals each, changes the signals at a
+given rate and subscribes to every group on haltalk's halgroup service,
+reporting per group how long it took from writing a value to receiving
+the incremental update carrying it.
+
+    haltalkload -u tcp://127.0.0.1:6650 [-g groups] [-m members]
+                [-t msec] [-r rate] [-d seconds] [-f text|json]
+
+haltalk must already be running; -u is the halgroup URI it announces
+(see 'haltalk -d' or the HALGROUP service in mkwrapper/zeroconf).
+Groups are named '<prefix>.<n>' with signals '<prefix>.<n>.<m>'; they
+are created with REPORT_ON_CHANGE|MONITOR_ALL_MEMBERS and a scan timer
+of -t msec, and deleted again on exit unless --keep is given.
+
+Member 0 of each group ('<prefix>.<n>.stamp') carries the CLOCK_MONOTONIC
+time at which the writer last changed the group; it is written after the
+other members so an update carrying it carries the whole change.  Latency
+is receive time minus that stamp and therefore includes up to one scan
+period of timer quantisation - compare runs at equal -t.  haltalkload
+must run on the haltalk host for the clocks to agree.
+
+Lost updates are detected from gaps in the per-group serial.
+Exit status is 0 on success, 1 on error, 2 if any updates were lost.
+"""
+
+import argparse
+import json
+import subprocess
+import sys
+import threading
+import time
+
+import zmq
+
+from machinekit import hal
+from machinetalk.protobuf.message_pb2 import Container
+from machinetalk.protobuf.types_pb2 import (MT_HALGROUP_FULL_UPDATE,
+                                            MT_HALGROUP_INCREMENTAL_UPDATE)
+
+REPORT_ON_CHANGE = 1
+MONITOR_ALL_MEMBERS = 2
+
+
+def halcmd(*args, check=True):
+    r = subprocess.run(('halcmd',) + args, stdout=subprocess.PIPE,
+                       stderr=subprocess.PIPE, universal_newlines=True)
+    if check and r.returncode:
+        raise RuntimeError("halcmd %s failed: %s" % (' '.join(args),
+                                                    r.stderr.strip()))
+    return r.stdout
+
+
+class LoadGroup(object):
+    def __init__(self, prefix, n, members, msec):
+        self.name = '%s.%d' % (prefix, n)
+        self.stamp = hal.Signal(self.name + '.stamp', hal.HAL_FLOAT)
+        self.sigs = [hal.Signal('%s.%d' % (self.name, m), hal.HAL_FLOAT)
+                     for m in range(1, members)]
+        self.group = hal.Group(self.name, arg1=msec,
+                               arg2=REPORT_ON_CHANGE | MONITOR_ALL_MEMBERS)
+        self.group.member_add(self.stamp)
+        for s in self.sigs:
+            self.group.member_add(s)
+        # filled in by the subscriber
+        self.stamp_handle = None
+        self.serial = None
+        self.updates = 0
+        self.lost = 0
+        self.latency = []
+
+    def write(self, value, now):
+        for s in self.sigs:
+            s.set(value)
+        self.stamp.set(now)
+
+    def delete(self):
+        halcmd('delg', self.name, check=False)
+        for s in self.sigs + [self.stamp]:
+            halcmd('delsig', s.name, check=False)
+
+
+def writer(groups, rate, stop):
+    period = 1.0 / rate
+    value = 0.0
+    deadline = time.monotonic()
+    while not stop.is_set():
+        value += 1.0
+        for g in groups:
+            g.write(value, time.monotonic())
+        deadline += period
+        delay = deadline - time.monotonic()
+        if delay > 0:
+            stop.wait(delay)
+
+
+def update(g, rx, now):
+    if g.serial is not None and rx.serial != g.serial + 1:
+        g.lost += rx.serial - g.serial - 1
+    g.serial = rx.serial
+
+    if rx.type == MT_HALGROUP_FULL_UPDATE:
+        for grp in rx.group:
+            for m in grp.member:
+                if m.signal.name == g.name + '.stamp':
+                    g.stamp_handle = m.signal.handle
+        return
+
+    if rx.type != MT_HALGROUP_INCREMENTAL_UPDATE:
+        return
+    g.updates += 1
+    for s in rx.signal:
+        if s.handle == g.stamp_handle and s.halfloat > 0.0:
+            g.latency.append(now - s.halfloat)
+
+
+def subscribe(uri, groups, seconds):
+    byname = dict((g.name.encode(), g) for g in groups)
+    ctx = zmq.Context.instance()
+    sub = ctx.socket(zmq.SUB)
+    sub.setsockopt(zmq.LINGER, 0)
+    sub.connect(uri)
+    for name in byname:
+        sub.setsockopt(zmq.SUBSCRIBE, name)
+
+    rx = Container()
+    end = time.monotonic() + seconds
+    while True:
+        timeout = end - time.monotonic()
+        if timeout <= 0:
+            break
+        if not sub.poll(int(timeout * 1000) + 1):
+            continue
+        frames = sub.recv_multipart()
+        now = time.monotonic()
+        g = byname.get(frames[0])
+        if g is None or len(frames) < 2:
+            continue
+        rx.ParseFromString(frames[1])
+        update(g, rx, now)
+    sub.close()
+
+
+def percentile(sorted_values, p):
+    if not sorted_values:
+        return 0.0
+    i = int(round(p / 100.0 * (len(sorted_values) - 1)))
+    return sorted_values[i]
+
+
+def statistics(g, seconds):
+    lat = sorted(v * 1e3 for v in g.latency)
+    return {
+        'group': g.name,
+        'members': len(g.sigs) + 1,
+        'updates': g.updates,
+        'rate': g.updates / seconds,
+        'lost': g.lost,
+        'min': lat[0] if lat else 0.0,
+        'mean': sum(lat) / len(lat) if lat else 0.0,
+        'p50': percentile(lat, 50),
+        'p99': percentile(lat, 99),
+        'max': lat[-1] if lat else 0.0,
+    }
+
+
+def report(stats, fmt, out):
+    if fmt == 'json':
+        json.dump(stats, out, indent=2)
+        out.write('\n')
+        return
+    out.write('%-20s %7s %8s %6s %9s %9s %9s %9s %9s\n' %
+              ('group', 'members', 'updates', 'lost',
+               'min ms', 'mean ms', 'p50 ms', 'p99 ms', 'max ms'))
+    for s in stats:
+        out.write('%-20s %7d %8d %6d %9.3f %9.3f %9.3f %9.3f %9.3f\n' %
+                  (s['group'], s['members'], s['updates'], s['lost'],
+                   s['min'], s['mean'], s['p50'], s['p99'], s['max']))
+
+
+def main():
+    ap = argparse.ArgumentParser(description=__doc__.split('\n')[1])
+    ap.add_argument('-u', '--uri', required=True,
+                    help='halgroup URI of haltalk, e.g. tcp://127.0.0.1:6650')
+    ap.add_argument('-g', '--groups', type=int, default=10,
+                    help='number of groups (default 10)')
+    ap.add_argument('-m', '--members', type=int, default=100,
+                    help='signals per group, including the stamp (default 100)')
+    ap.add_argument('-t', '--msec', type=int, default=20,
+                    help='group scan timer in mS (default 20)')
+    ap.add_argument('-r', '--rate', type=float, default=50.0,
+                    help='writer rate in Hz (default 50)')
+    ap.add_argument('-d', '--duration', type=float, default=10.0,
+                    help='measurement time in seconds (default 10)')
+    ap.add_argument('-p', '--prefix', default='load',
+                    help='group and signal name prefix (default load)')
+    ap.add_argument('-f', '--format', choices=('text', 'json'),
+                    default='text')
+    ap.add_argument('--keep', action='store_true',
+                    help='do not delete groups and signals on exit')
+    args = ap.parse_args()
+
+    if args.groups < 1 or args.members < 1 or args.rate <= 0:
+        ap.error('groups, members and rate must be positive')
+
+    groups = []
+    stop = threading.Event()
+    try:
+        for n in range(args.groups):
+            groups.append(LoadGroup(args.prefix, n, args.members, args.msec))
+
+        w = threading.Thread(target=writer, args=(groups, args.rate, stop))
+        w.daemon = True
+        w.start()
+        subscribe(args.uri, groups, args.duration)
+        stop.set()
+        w.join()
+    except (RuntimeError, zmq.ZMQError) as e:
+        sys.stderr.write('haltalkload: %s\n' % e)
+        return 1
+    finally:
+        stop.set()
+        if not args.keep:
+            for g in groups:
+                g.delete()
+
+    stats = [statistics(g, args.duration) for g in groups]
+    report(stats, args.format, sys.stdout)
+    return 2 if any(s['lost'] for s in stats) else 0
+
+
+if __name__ == '__main__':
+    sys.exit(main())
@@ -80,6 +80,9 @@ static scope_usr_control_t ctrl_struct;	/* scope control structure */
 /* init functions */
 static void init_usr_control_struct(void *shmem);
 
+static void start_roll(void);
+static void capture_roll_data(void);
+
 static void define_scope_windows(void);
 static void init_run_mode_window(void);
 
@@ -251,7 +254,7 @@ static int heartbeat(gpointer data)
         if(!gtk_window_is_active(GTK_WINDOW(ctrl_usr->main_win)))
             gtk_window_set_urgency_hint(GTK_WINDOW(ctrl_usr->main_win), TRUE);
 	capture_complete();
-    } else if (ctrl_usr->run_mode == ROLL) capture_cont();
+    } else if (ctrl_shm->state == ROLLING) capture_cont();
     return 1;
 }
 
@@ -331,13 +334,16 @@ hal_param_t *param;
 	}
     }
     ctrl_shm->pre_trig = (ctrl_shm->rec_len-2) * ctrl_usr->trig.position;
+    ctrl_shm->roll = (ctrl_usr->run_mode == ROLL);
+    if (ctrl_shm->roll) {
+	start_roll();
+    }
     ctrl_shm->state = INIT;
 }
 
-void capture_copy_data(void) {
+static void set_data_offsets(void)
+{
     int n, offs;
-    scope_data_t *src, *dst, *src_end;
-    int samp_len, samp_size;
 
     offs = 0;
     for (n = 0; n < 16; n++) {
@@ -350,8 +356,90 @@ void capture_copy_data(void) {
 	    ctrl_usr->vert.data_offset[n] = -1;
 	}
     }
+}
+
+/* roll mode: the RT code fills the shared buffer as a ring and counts
+   samples in ctrl_shm->head; the display buffer mirrors it slot for
+   slot, so each heartbeat copies only what is new */
+static void start_roll(void)
+{
+    char *sp;
+
+    set_data_offsets();
+    ctrl_usr->samples = 0;
+    ctrl_usr->disp_start = 0;
+    ctrl_usr->tail = 0;
+    ctrl_usr->tail_slot = 0;
+    memset(ctrl_usr->disp_buf, 0, sizeof(scope_data_t) * ctrl_shm->buf_len);
+    pyramid_rebuild();
+    /* tell readers of the 'scope' ring what the records hold */
+    if (ctrl_shm->stream_ring && !ctrl_usr->ring_attached) {
+	if (hal_ring_attachf(&ctrl_usr->ring, NULL, "%s",
+		SCOPE_RING_NAME) == 0) {
+	    ctrl_usr->ring_attached = 1;
+	}
+    }
+    if (ctrl_usr->ring_attached) {
+	sp = ctrl_usr->ring.scratchpad;
+	if (format_record_layout(sp,
+		ring_scratchpad_size(&ctrl_usr->ring)) < 0) {
+	    sp[0] = '\0';
+	    fprintf(stderr, "halscope: record layout does not fit the "
+		"'%s' ring scratchpad\n", SCOPE_RING_NAME);
+	}
+    }
+}
+
+static void capture_roll_data(void)
+{
+    __u32 head, new;
+    int rec_len, samp_len, samp_size, count, slot, first;
+
+    rec_len = ctrl_shm->rec_len;
+    samp_len = ctrl_shm->sample_len;
+    samp_size = samp_len * sizeof(scope_data_t);
+    head = ctrl_shm->head;
+    rtapi_smp_rmb();
+    new = head - ctrl_usr->tail;
+    if (new == 0) {
+	return;
+    }
+    /* if we fell behind, only the last rec_len samples still exist */
+    count = (new > (__u32) rec_len) ? rec_len : (int) new;
+    ctrl_usr->tail_slot = (ctrl_usr->tail_slot + new % rec_len) % rec_len;
+    slot = (ctrl_usr->tail_slot - count + rec_len) % rec_len;
+    /* copy in at most two pieces; a slot the RT code overwrites while
+       we copy it is refreshed by the next call */
+    first = rec_len - slot;
+    if (first > count) {
+	first = count;
+    }
+    memcpy(ctrl_usr->disp_buf + slot * samp_len,
+	ctrl_usr->buffer + slot * samp_len, first * samp_size);
+    pyramid_update(slot, first);
+    if (count > first) {
+	memcpy(ctrl_usr->disp_buf, ctrl_usr->buffer,
+	    (count - first) * samp_size);
+	pyramid_update(0, count - first);
+    }
+    ctrl_usr->tail = head;
+    if (ctrl_usr->samples + count >= rec_len) {
+	ctrl_usr->samples = rec_len;
+	ctrl_usr->disp_start = ctrl_usr->tail_slot;
+    } else {
+	ctrl_usr->samples += count;
+    }
+}
+
+void capture_copy_data(void) {
+    int n;
+    scope_data_t *src, *dst, *src_end;
+    int samp_len, samp_size;
+
+    set_data_offsets();
     /* copy data from shared buffer to display buffer */
     ctrl_usr->samples = ctrl_shm->samples;
+    ctrl_usr->disp_start = 0;
     samp_len = ctrl_shm->sample_len;
     samp_size = samp_len * sizeof(scope_data_t);
     dst = ctrl_usr->disp_buf;
@@ -369,11 +457,12 @@ void capture_copy_data(void) {
 	    src = ctrl_usr->buffer;
 	}
     }
+    pyramid_rebuild();
 }
 
 void capture_cont()
 {
-    capture_copy_data();
+    capture_roll_data();
     refresh_display();
 }
 
@@ -438,10 +527,6 @@ static void init_usr_control_struct(void *shmem)
     /* done */
 }
 
-static void menuitem_response(gchar *string) {
-    printf("%s\n", string);
-}
-
 static void about(int junk) {
     gtk_show_about_dialog(GTK_WINDOW(ctrl_usr->main_win),
             "copyright", "Copyright (C) 2003 John Kasunich",
@@ -524,6 +609,37 @@ static void save_configuration(int junk) {
 }
 
 
+static void do_open_data_file(GtkWidget *w, GtkFileSelection *fs) {
+    /* stop acquiring, so the loaded data stays on screen */
+    set_run_mode(0);
+    if (read_data_file((char *)
+	    gtk_file_selection_get_filename(GTK_FILE_SELECTION(fs))) > 0) {
+	refresh_display();
+    }
+}
+
+static void open_data_file(int junk) {
+    GtkWidget *filew;
+    filew = gtk_file_selection_new(_("Open Data File:"));
+    gtk_signal_connect (GTK_OBJECT (filew), "destroy",
+        (GtkSignalFunc) gtk_widget_destroy, &filew);
+    gtk_signal_connect (GTK_OBJECT (GTK_FILE_SELECTION (filew)->ok_button),
+                        "clicked", (GtkSignalFunc) do_open_data_file, filew );
+    //link ok to destroy, otherwise the window stays open
+    gtk_signal_connect_object (GTK_OBJECT (GTK_FILE_SELECTION
+                                            (filew)->ok_button),
+                               "clicked", (GtkSignalFunc) gtk_widget_destroy,
+                               GTK_OBJECT (filew));
+    gtk_signal_connect_object (GTK_OBJECT (GTK_FILE_SELECTION
+                                            (filew)->cancel_button),
+                               "clicked", (GtkSignalFunc) gtk_widget_destroy,
+                               GTK_OBJECT (filew));
+    gtk_file_selection_set_select_multiple(GTK_FILE_SELECTION(filew), FALSE);
+    gtk_file_selection_hide_fileop_buttons (GTK_FILE_SELECTION(filew) );
+    gtk_file_selection_complete(GTK_FILE_SELECTION(filew), "*.rec");
+    gtk_dialog_run(GTK_DIALOG(filew));
+}
+
 static void define_menubar(GtkWidget *vboxtop) {
     GtkWidget *file_rootmenu, *help_rootmenu;
     GtkWidget *menubar, *filemenu, 
@@ -556,8 +672,7 @@ static void define_menubar(GtkWidget *vboxtop) {
     fileopendatafile = gtk_menu_item_new_with_mnemonic(_("O_pen Data File..."));
     gtk_menu_append(GTK_MENU(filemenu), fileopendatafile);
     gtk_signal_connect_object(GTK_OBJECT(fileopendatafile), "activate", 
-            GTK_SIGNAL_FUNC(menuitem_response), "file/open datafile");
-    gtk_widget_set_sensitive(GTK_WIDGET(fileopendatafile), FALSE); // XXX
+            GTK_SIGNAL_FUNC(open_data_file), 0);
     gtk_widget_show(fileopendatafile);
     
     filesavedatafile = gtk_menu_item_new_with_mnemonic(_("S_ave Data File..."));
@@ -760,6 +875,9 @@ static void init_run_mode_window(void)
 
 static void exit_from_hal(void)
 {
+    if (ctrl_usr->ring_attached) {
+	hal_ring_detach(&ctrl_usr->ring);
+    }
     rtapi_shmem_delete(shm_id, comp_id);
     hal_exit(comp_id);
 }
@@ -791,11 +909,9 @@ int set_run_mode(int mode)
     } else if ( mode == 2 ) {
 	/* single sweep mode */
 	button = ctrl_usr->rm_single_button;
-#if 0 /* FIXME - roll mode not implemented yet */
     } else if ( mode == 3 ) {
 	/* roll mode */
 	button = ctrl_usr->rm_roll_button;
-#endif
     } else {
 	/* illegal mode */
 	return -1;
@@ -811,7 +927,10 @@ static void rm_normal_button_clicked(GtkWidget * widget, gpointer * gdata)
 	return;
     }
     ctrl_usr->run_mode = NORMAL;
-    if (ctrl_shm->state == IDLE) {
+    if (ctrl_shm->state == ROLLING) {
+	/* rolling never finishes, restart with a triggered capture */
+	prepare_scope_restart();
+    } else if (ctrl_shm->state == IDLE) {
 	start_capture();
     }
 }
@@ -823,7 +942,10 @@ static void rm_single_button_clicked(GtkWidget * widget, gpointer * gdata)
 	return;
     }
     ctrl_usr->run_mode = SINGLE;
-    if (ctrl_shm->state == IDLE) {
+    if (ctrl_shm->state == ROLLING) {
+	/* rolling never finishes, restart with a triggered capture */
+	prepare_scope_restart();
+    } else if (ctrl_shm->state == IDLE) {
 	start_capture();
     }
 }
@@ -837,6 +959,9 @@ static void rm_roll_button_clicked(GtkWidget * widget, gpointer * gdata)
     ctrl_usr->run_mode = ROLL;
     if (ctrl_shm->state == IDLE) {
 	start_capture();
+    } else if (ctrl_shm->state != ROLLING) {
+	/* don't wait for a trigger that may never come */
+	prepare_scope_restart();
     }
 }
 
@@ -63,6 +63,8 @@ static void update_readout(void);
 static void draw_grid(void);
 static void draw_baseline(int chan_num, int highlight);
 static void draw_waveform(int chan_num, int highlight);
+static int minmax_points(int chan_num, int level, int block,
+    GdkPoint *points, int highlight);
 static void draw_triggerline(int chan_num, int highlight);
 static void handle_window_expose(GtkWidget * widget, gpointer data);
 static int handle_click(GtkWidget *widget, GdkEventButton *event, gpointer data);
@@ -113,6 +115,148 @@ void invalidate_all_channels(void)
     }
 }
 
+/* chronological sample 'n' of the display buffer; in roll mode the
+   buffer is a ring whose oldest sample is at 'disp_start' */
+scope_data_t *disp_sample(int n)
+{
+    if (ctrl_usr->disp_start != 0) {
+	n = (ctrl_usr->disp_start + n) % ctrl_shm->rec_len;
+    }
+    return ctrl_usr->disp_buf + n * ctrl_shm->sample_len;
+}
+
+double sample_value(scope_data_t *dptr, hal_type_t type)
+{
+    switch (type) {
+    case HAL_BIT:
+	return dptr->d_u8 ? 1.0 : 0.0;
+    case HAL_FLOAT:
+	return dptr->d_real;
+    case HAL_S32:
+	return dptr->d_s32;
+    case HAL_U32:
+	return dptr->d_u32;
+    case HAL_S64:
+	return dptr->d_s64;
+    case HAL_U64:
+	return dptr->d_u64;
+    default:
+	return 0.0;
+    }
+}
+
+/* size the pyramid levels for the current record length */
+static void pyramid_alloc(void)
+{
+    scope_disp_t *disp;
+    int chan, level, len;
+
+    disp = &(ctrl_usr->disp);
+    if (disp->pyr_rec_len == ctrl_shm->rec_len) {
+	return;
+    }
+    len = ctrl_shm->rec_len;
+    for (level = 0; level < SCOPE_PYR_LEVELS; level++) {
+	len = (len + SCOPE_PYR_FACTOR - 1) >> SCOPE_PYR_SHIFT;
+	disp->pyr_len[level] = len;
+	for (chan = 0; chan < 16; chan++) {
+	    g_free(disp->pyr[chan][level]);
+	    disp->pyr[chan][level] = NULL;
+	}
+    }
+    disp->pyr_rec_len = ctrl_shm->rec_len;
+}
+
+/* recompute entries 'first' to 'last' of one level of one channel */
+static void pyramid_fill(int chan, int level, int first, int last)
+{
+    scope_disp_t *disp;
+    scope_minmax_t *dst, *src, m;
+    scope_data_t *dptr;
+    hal_type_t type;
+    int j, k, end, sample_len;
+    double v;
+
+    disp = &(ctrl_usr->disp);
+    dst = disp->pyr[chan][level];
+    type = ctrl_usr->chan[chan].data_type;
+    sample_len = ctrl_shm->sample_len;
+    for (j = first; j <= last; j++) {
+	k = j << SCOPE_PYR_SHIFT;
+	if (level == 0) {
+	    /* from the samples */
+	    end = MIN(k + SCOPE_PYR_FACTOR, ctrl_shm->rec_len);
+	    dptr = ctrl_usr->disp_buf + k * sample_len
+		+ ctrl_usr->vert.data_offset[chan];
+	    v = sample_value(dptr, type);
+	    m.min = m.max = m.sum = v;
+	    for (k++, dptr += sample_len; k < end; k++, dptr += sample_len) {
+		v = sample_value(dptr, type);
+		m.min = MIN(m.min, v);
+		m.max = MAX(m.max, v);
+		m.sum += v;
+	    }
+	} else {
+	    /* from the level below */
+	    src = disp->pyr[chan][level - 1];
+	    end = MIN(k + SCOPE_PYR_FACTOR, disp->pyr_len[level - 1]);
+	    m = src[k];
+	    for (k++; k < end; k++) {
+		m.min = MIN(m.min, src[k].min);
+		m.max = MAX(m.max, src[k].max);
+		m.sum += src[k].sum;
+	    }
+	}
+	dst[j] = m;
+    }
+}
+
+/* bring the pyramid up to date after display buffer slots 'slot' to
+   'slot + count - 1' changed; the cost is proportional to 'count' */
+void pyramid_update(int slot, int count)
+{
+    scope_disp_t *disp;
+    int chan, level, first, last;
+
+    disp = &(ctrl_usr->disp);
+    if (count <= 0) {
+	return;
+    }
+    for (chan = 0; chan < 16; chan++) {
+	if ((ctrl_usr->vert.data_offset[chan] < 0)
+	    || (disp->pyr[chan][0] == NULL)) {
+	    continue;
+	}
+	first = slot;
+	last = slot + count - 1;
+	for (level = 0; level < SCOPE_PYR_LEVELS; level++) {
+	    first >>= SCOPE_PYR_SHIFT;
+	    last >>= SCOPE_PYR_SHIFT;
+	    pyramid_fill(chan, level, first, last);
+	}
+    }
+}
+
+void pyramid_rebuild(void)
+{
+    scope_disp_t *disp;
+    int chan, level;
+
+    disp = &(ctrl_usr->disp);
+    pyramid_alloc();
+    for (chan = 0; chan < 16; chan++) {
+	if ((ctrl_usr->vert.data_offset[chan] < 0)
+	    || (disp->pyr[chan][0] != NULL)) {
+	    continue;
+	}
+	for (level = 0; level < SCOPE_PYR_LEVELS; level++) {
+	    disp->pyr[chan][level] =
+		g_malloc(disp->pyr_len[level] * sizeof(scope_minmax_t));
+	}
+    }
+    pyramid_update(0, ctrl_shm->rec_len);
+}
+
 void request_display_refresh(int delay)
 {
     if (delay > 5) {
@@ -130,44 +274,19 @@ static int motion_x = -1, motion_y = -1;
 static void calculate_offset(int chan_num) {
     int n;
     scope_chan_t *chan = &(ctrl_usr->chan[chan_num]);
-    scope_data_t *dptr =
-        ctrl_usr->disp_buf + ctrl_usr->vert.data_offset[chan_num];
-    int type = chan->data_type;
+    scope_disp_t *disp = &(ctrl_usr->disp);
+    scope_minmax_t *top = disp->pyr[chan_num][SCOPE_PYR_LEVELS - 1];
 
-    double sum=0, value;
+    double sum=0;
 
     if(!chan->ac_offset) return;
+    if(ctrl_usr->vert.data_offset[chan_num] < 0 || top == NULL) return;
 
-    for(n=0; n < ctrl_usr->samples; n++) {
-	switch (type) {
-	case HAL_BIT:
-	    if (dptr->d_u8) {
-		value = 1.0;
-	    } else {
-		value = 0.0;
-	    };
-	    break;
-	case HAL_FLOAT:
-	    value = dptr->d_real;
-	    break;
-	case HAL_S32:
-	    value = dptr->d_s32;
-	    break;
-	case HAL_U32:
-	    value = dptr->d_u32;
-	    break;
-	case HAL_S64:
-	    value = dptr->d_s64;
-	    break;
-	case HAL_U64:
-	    value = dptr->d_u64;
-	    break;
-	default:
-	    value = 0.0;
-	    break;
-        }
-        sum = sum + value;
+    /* unused slots are zero, so the top level sums hold the total */
+    for(n=0; n < disp->pyr_len[SCOPE_PYR_LEVELS - 1]; n++) {
+        sum = sum + top[n].sum;
     }
+    n = ctrl_usr->samples;
     if(n == 0) {
         chan->vert_offset = 0;
     } else {
@@ -777,8 +896,8 @@ void draw_baseline(int chan_num, int highlight) {
 
 void draw_waveform(int chan_num, int highlight)
 {
-    scope_data_t *dptr;
-    int start, end, n, sample_len;
+    scope_data_t *dptr, *dend;
+    int start, end, n, sample_len, level, block;
     scope_disp_t *disp;
     scope_chan_t *chan;
     double xscale, xoffset;
@@ -802,17 +921,10 @@ void draw_waveform(int chan_num, int highlight)
     yscale = disp->height / (-10.0 * chan->scale);
     yfoffset = chan->vert_offset;
     ypoffset = chan->position * disp->height;
-    /* point to first sample in the record for this channel */
-    dptr = ctrl_usr->disp_buf + ctrl_usr->vert.data_offset[chan_num - 1];
-    /* point to first one that gets displayed */
     start = disp->start_sample;
     end = disp->end_sample;
-    ct = end - start + 1;
-    points = alloca(2 * ct * sizeof(GdkPoint));
     pn = 0;
     n = start;
-    dptr += n * sample_len;
-
 
     /* set color to draw */
     if (highlight) {
@@ -821,38 +933,37 @@ void draw_waveform(int chan_num, int highlight)
 	gdk_gc_set_foreground(disp->context, &(disp->color_normal[chan_num-1]));
     }
 
+    /* zoomed out: use the coarsest pyramid level that still has at
+       least two entries per pixel, so the cost depends on the width
+       of the window and not on the length of the record */
+    level = -1;
+    block = SCOPE_PYR_FACTOR;
+    while ((level + 1 < SCOPE_PYR_LEVELS) && (block * xscale * 2 <= 1.0)
+	&& (disp->pyr[chan_num - 1][level + 1] != NULL)) {
+	level++;
+	block <<= SCOPE_PYR_SHIFT;
+    }
+    if (level >= 0) {
+	block >>= SCOPE_PYR_SHIFT;
+	ct = (end - start) / block + 3;
+	points = alloca(2 * ct * sizeof(GdkPoint));
+	pn = minmax_points(chan_num, level, block, points, highlight);
+	n = end + 1;
+    } else {
+	ct = end - start + 1;
+	points = alloca(2 * ct * sizeof(GdkPoint));
+    }
+    /* point to first sample that gets displayed, and past the last slot */
+    dptr = disp_sample(start) + ctrl_usr->vert.data_offset[chan_num - 1];
+    dend = ctrl_usr->disp_buf + ctrl_usr->vert.data_offset[chan_num - 1]
+	+ ctrl_shm->rec_len * sample_len;
+
     x1 = y1 = 0;
     while (n <= end) {
 	/* calc x coordinate of this point */
 	x2 = (n * xscale) - xoffset;
 	/* calc y coordinate of this point */
-	switch (type) {
-	case HAL_BIT:
-	    if (dptr->d_u8) {
-		fy = 1.0;
-	    } else {
-		fy = 0.0;
-	    };
-	    break;
-	case HAL_FLOAT:
-	    fy = dptr->d_real;
-	    break;
-	case HAL_S32:
-	    fy = dptr->d_s32;
-	    break;
-	case HAL_U32:
-	    fy = dptr->d_u32;
-	    break;
-	case HAL_S64:
-	    fy = dptr->d_s64;
-	    break;
-	case HAL_U64:
-	    fy = dptr->d_u64;
-	    break;
-	default:
-	    fy = 0.0;
-	    break;
-	}
+	fy = sample_value(dptr, type);
 	y2 = ((fy - yfoffset) * yscale) + ypoffset;
 	if (y2 < miny) {
 	    y2 = miny;
@@ -905,6 +1016,9 @@ void draw_waveform(int chan_num, int highlight)
 
 	/* point to next sample */
 	dptr += sample_len;
+	if (dptr >= dend) {
+	    dptr -= ctrl_shm->rec_len * sample_len;
+	}
 	n++;
         prev_fy = fy;
     }
@@ -938,6 +1052,59 @@ void draw_waveform(int chan_num, int highlight)
     }
 }
 
+/* one vertical min to max stroke per pyramid entry, joined up in a
+   zigzag; returns the number of points */
+static int minmax_points(int chan_num, int level, int block,
+    GdkPoint *points, int highlight)
+{
+    scope_disp_t *disp = &(ctrl_usr->disp);
+    scope_chan_t *chan = &(ctrl_usr->chan[chan_num - 1]);
+    scope_minmax_t *pyr = disp->pyr[chan_num - 1][level];
+    scope_horiz_t *horiz = &(ctrl_usr->horiz);
+    int rec_len = ctrl_shm->rec_len;
+    double xscale = disp->pixels_per_sample;
+    double xoffset = disp->horiz_offset;
+    double yscale = disp->height / (-10.0 * chan->scale);
+    double yfoffset = chan->vert_offset;
+    double ypoffset = chan->position * disp->height;
+    int miny = -disp->height, maxy = 2 * disp->height;
+    int n, slot, j, x, ylo, yhi, tmp, pn = 0, first = 1;
+    double fy;
+
+    n = disp->start_sample;
+    while (n <= disp->end_sample) {
+	slot = (ctrl_usr->disp_start + n) % rec_len;
+	j = slot / block;
+	/* x of the first sample in the entry */
+	x = ((n - (slot - j * block)) * xscale) - xoffset;
+	ylo = ((pyr[j].min - yfoffset) * yscale) + ypoffset;
+	yhi = ((pyr[j].max - yfoffset) * yscale) + ypoffset;
+	ylo = COORDINATE_CLIP(MIN(MAX(ylo, miny), maxy));
+	yhi = COORDINATE_CLIP(MIN(MAX(yhi, miny), maxy));
+	x = COORDINATE_CLIP(x);
+	if (pn & 2) {
+	    tmp = ylo; ylo = yhi; yhi = tmp;
+	}
+	points[pn].x = x; points[pn].y = ylo; pn++;
+	points[pn].x = x; points[pn].y = yhi; pn++;
+	if (first && highlight && DRAWING && x >= motion_x) {
+	    first = 0;
+	    fy = sample_value(disp_sample(n)
+		+ ctrl_usr->vert.data_offset[chan_num - 1], chan->data_type);
+	    tmp = ((fy - yfoffset) * yscale) + ypoffset;
+	    gdk_draw_arc(disp->win, disp->context, TRUE,
+		x-3, tmp-3, 7, 7, 0, 360*64);
+	    cursor_prev_value = fy;
+	    cursor_value = fy;
+	    cursor_time = (n - ctrl_shm->pre_trig)*horiz->sample_period;
+	    cursor_valid = 1;
+	}
+	/* on to the first sample of the next entry */
+	n += MIN((j + 1) * block, rec_len) - slot;
+    }
+    return pn;
+}
+
 static int ch=0;
 // X limits all windows to 16-bit heights, so this static array will be OK
 static char conflict_map[32768];
@@ -33,6 +33,9 @@
 */
 
 #include <sys/types.h>
+#include <sys/stat.h>
+#include <sys/mman.h>
+#include <fcntl.h>
 #include <unistd.h>
 #include <stdio.h>
 #include <stdlib.h>
@@ -46,6 +49,7 @@
 #include <gtk/gtk.h>
 #include "miscgtk.h"		/* generic GTK stuff */
 #include "scope_usr.h"		/* scope related declarations */
+#include "hal/components/hal_record.h"	/* record file format */
 
 /***********************************************************************
 *                         DOCUMENTATION                                *
@@ -82,6 +86,23 @@
   
 */
 
+/* Captured data is saved as text (write_log_file), or in the binary
+   record file format of 'halrecord' (write_data_file, see
+   hal_record.h): a header of whole pages with its size, the number of
+   records and the layout text; one record per sample follows.  A record is a u64
+   sequence number, an s64 timestamp in ns, and the sample's values
+   packed at their natural sizes, as in the 'scope' ring (see
+   scope_rec_offsets() in scope_shm.h):
+
+   recorder 1 <record size> <number of channels>
+   <offset> <bit|float|s32|u32|s64|u64> <channel source name>
+
+   'halrecord --dump' decodes these files, and read_data_file() loads
+   any record file - saved by halscope, or recorded from the 'scope'
+   ring or a recorder/samplerv2 instance - into the channels whose
+   sources have the same names.
+*/
+
 
 /***********************************************************************
 *                         TYPEDEFS AND DEFINES                         *
@@ -223,10 +244,8 @@ void write_config_file (char *filename)
 	fprintf(fp, "RMODE 1\n" );
     } else if ( ctrl_usr->run_mode == SINGLE ) {
 	fprintf(fp, "RMODE 2\n" );
-#if 0 /* FIXME - role mode not implemented yet */
     } else if ( ctrl_usr->run_mode == ROLL ) {
 	fprintf(fp, "RMODE 3\n" );
-#endif
     } else {
 	/* stop mode */
 	fprintf(fp, "RMODE 0\n" );
@@ -238,7 +257,7 @@ void write_config_file (char *filename)
 
 void write_log_file (char *filename)
 {
-	scope_data_t *dptr, *start;
+	scope_data_t *dptr;
 	scope_horiz_t *horiz;
 	int sample_len, chan_num, sample_period_ns, samples, n;
 	char *label[16];
@@ -278,15 +297,15 @@ void write_log_file (char *filename)
     /* write data */
     fprintf(fp, "Sampling period is %i nSec \n", sample_period_ns );
 
-	/* point to the first sample in the display buffer */
-	start = ctrl_usr->disp_buf ;
+	/* samples are fetched in time order, the display buffer is a ring
+	   in roll mode */
 
 	switch (log->order) {
 		case INTERLACED:
 				while (n <= samples) {
 				
 					for (chan_num=0; chan_num<sample_len; chan_num++) {	
-						dptr=start+n;	
+						dptr=disp_sample(n/sample_len)+n%sample_len;
 						if ((n%sample_len)==0){
 						fprintf( fp, "\n");
 						}
@@ -300,7 +319,7 @@ void write_log_file (char *filename)
 				for (chan_num=0; chan_num<sample_len; chan_num++) {
 					n=chan_num;
 					while (n <= samples) {
-						dptr=start+n;
+						dptr=disp_sample(n/sample_len)+n%sample_len;
 						write_sample( fp, label[chan_num], dptr, type[chan_num]);
 						fprintf( fp, "\n");
 						/* point to next sample */
@@ -314,6 +333,223 @@ void write_log_file (char *filename)
     fprintf(stderr, "Log file '%s' written.\n", filename );
 }
 
+/* the record offset of each displayed channel, -1 for the others,
+   see scope_rec_offsets(); returns the record size */
+static int record_offsets(int *offset)
+{
+    char len[16];
+    int n;
+
+    for (n = 0; n < 16; n++) {
+	len[n] = 0;
+	if (ctrl_usr->vert.data_offset[n] >= 0) {
+	    len[n] = rec_value_size(ctrl_usr->chan[n].data_type);
+	}
+    }
+    return scope_rec_offsets(len, offset);
+}
+
+/* the layout text for one sample of the current capture, returns its
+   length or -1 if it doesn't fit */
+int format_record_layout(char *buf, int buflen)
+{
+    scope_chan_t *chan;
+    int offset[16], n, count, size, len;
+
+    size = record_offsets(offset);
+    count = 0;
+    for (n = 0; n < 16; n++) {
+	if (offset[n] >= 0) {
+	    count++;
+	}
+    }
+    len = snprintf(buf, buflen, "recorder 1 %d %d\n", size, count);
+    for (n = 0; n < 16 && len < buflen; n++) {
+	if (offset[n] < 0) {
+	    continue;
+	}
+	chan = &(ctrl_usr->chan[n]);
+	len += snprintf(buf + len, buflen - len, "%d %s %s\n",
+	    offset[n], rec_type_name(chan->data_type), chan->name);
+    }
+    return (len < buflen) ? len : -1;
+}
+
+/* writes captured data to disk in binary record format */
+int write_data_file(char *filename)
+{
+    char text[16 * REC_LINE_LEN + 64], *header, *rec;
+    __u64 hdr[2], count, hsize;
+    long period_ns;
+    int offset[16], n, chan, len, size;
+    scope_data_t *src;
+    FILE *fp;
+
+    len = format_record_layout(text, sizeof(text));
+    if (len < 0) {
+	fprintf(stderr, "ERROR: too many channels for data file '%s'\n",
+	    filename);
+	return -1;
+    }
+    size = record_offsets(offset);
+    hsize = rec_file_header_size(len);
+    header = calloc(1, hsize);
+    rec = calloc(1, size);
+    if ((header == NULL) || (rec == NULL)) {
+	fprintf(stderr, "ERROR: out of memory for data file '%s'\n", filename);
+	free(header);
+	free(rec);
+	return -1;
+    }
+    count = ctrl_usr->samples;
+    memcpy(header + REC_FILE_SIZE_OFFSET, &hsize, sizeof(hsize));
+    memcpy(header + REC_FILE_COUNT_OFFSET, &count, sizeof(count));
+    memcpy(header + REC_FILE_TEXT_OFFSET, text, len);
+    fp = fopen(filename, "w");
+    if ( fp == NULL ) {
+	fprintf(stderr, "ERROR: data file '%s' could not be created\n", filename );
+	free(header);
+	free(rec);
+	return -1;
+    }
+    fwrite(header, hsize, 1, fp);
+    free(header);
+    period_ns = ctrl_usr->horiz.sample_period_ns;
+    for (n = 0; n < ctrl_usr->samples; n++) {
+	hdr[0] = n;
+	hdr[1] = (__u64) n * period_ns;
+	memcpy(rec, hdr, sizeof(hdr));
+	src = disp_sample(n);
+	for (chan = 0; chan < 16; chan++) {
+	    if (offset[chan] >= 0) {
+		memcpy(rec + offset[chan],
+		    src + ctrl_usr->vert.data_offset[chan],
+		    rec_value_size(ctrl_usr->chan[chan].data_type));
+	    }
+	}
+	fwrite(rec, size, 1, fp);
+    }
+    free(rec);
+    if (fclose(fp) != 0) {
+	fprintf(stderr, "ERROR: data file '%s' could not be written\n", filename );
+	return -1;
+    }
+    fprintf(stderr, "Data file '%s' written.\n", filename );
+    return 0;
+}
+
+/* loads a record file into the display buffer; returns the number of
+   channels loaded, or -1 */
+int read_data_file(char *filename)
+{
+    struct stat st;
+    char *map, *text, *line, type[16], name[256];
+    __u64 count, first, hsize;
+    int fd, n, chan, size, nsig, off, slots, samples, sample_len, matched;
+    int src_off[16], src_len[16];
+    scope_chan_t *c;
+    scope_data_t *dst;
+
+    fd = open(filename, O_RDONLY);
+    if (fd < 0) {
+	fprintf(stderr, "ERROR: data file '%s' could not be opened\n", filename );
+	return -1;
+    }
+    if ((fstat(fd, &st) < 0) || (st.st_size < REC_PAGE)) {
+	fprintf(stderr, "ERROR: '%s' is not a data file\n", filename );
+	close(fd);
+	return -1;
+    }
+    map = mmap(NULL, st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+    close(fd);
+    if (map == MAP_FAILED) {
+	fprintf(stderr, "ERROR: data file '%s' could not be mapped\n", filename );
+	return -1;
+    }
+    memcpy(&hsize, map + REC_FILE_SIZE_OFFSET, sizeof(hsize));
+    if ((hsize < REC_PAGE) || (hsize % REC_PAGE) || (hsize > (__u64) st.st_size)) {
+	fprintf(stderr, "ERROR: '%s' is not a data file\n", filename );
+	munmap(map, st.st_size);
+	return -1;
+    }
+    text = g_strndup(map + REC_FILE_TEXT_OFFSET, hsize - REC_FILE_TEXT_OFFSET);
+    memcpy(&count, map + REC_FILE_COUNT_OFFSET, sizeof(count));
+    if ((sscanf(text, "recorder 1 %d %d", &size, &nsig) != 2)
+	|| (size <= SCOPE_REC_HDR_SIZE)) {
+	fprintf(stderr, "ERROR: '%s' is not a data file\n", filename );
+	g_free(text);
+	munmap(map, st.st_size);
+	return -1;
+    }
+    /* match the signals to the channels by source name and type */
+    for (chan = 0; chan < 16; chan++) {
+	src_off[chan] = -1;
+	src_len[chan] = 0;
+    }
+    line = strchr(text, '\n');
+    for (n = 0; n < nsig && line != NULL; n++, line = strchr(line + 1, '\n')) {
+	if (sscanf(line + 1, "%d %15s %255s", &off, type, name) != 3) {
+	    break;
+	}
+	for (chan = 0; chan < 16; chan++) {
+	    c = &(ctrl_usr->chan[chan]);
+	    if ((c->name != NULL) && (strcmp(c->name, name) == 0)
+		&& (strcmp(rec_type_name(c->data_type), type) == 0)
+		&& (off + rec_value_size(c->data_type) <= size)) {
+		src_off[chan] = off;
+		src_len[chan] = rec_value_size(c->data_type);
+		break;
+	    }
+	}
+	if (chan == 16) {
+	    fprintf(stderr, "halscope: '%s': no channel for %s '%s'\n",
+		filename, type, name);
+	}
+    }
+    g_free(text);
+    /* each channel gets a slot in the display buffer */
+    sample_len = ctrl_shm->sample_len;
+    matched = 0;
+    for (chan = 0; chan < 16; chan++) {
+	if ((src_off[chan] >= 0) && (matched < sample_len)) {
+	    ctrl_usr->vert.data_offset[chan] = matched++;
+	} else {
+	    ctrl_usr->vert.data_offset[chan] = -1;
+	    src_off[chan] = -1;
+	}
+    }
+    /* the file is circular; keep the newest samples that fit */
+    slots = (st.st_size - hsize) / size;
+    if (slots <= 0) {
+	count = 0;
+    }
+    first = (count > (__u64) slots) ? count - slots : 0;
+    if (count - first > (__u64) ctrl_shm->rec_len) {
+	first = count - ctrl_shm->rec_len;
+    }
+    samples = count - first;
+    memset(ctrl_usr->disp_buf, 0, sizeof(scope_data_t) * ctrl_shm->buf_len);
+    for (n = 0; n < samples; n++) {
+	char *rec = map + hsize + ((first + n) % slots) * size;
+	dst = ctrl_usr->disp_buf + n * sample_len;
+	for (chan = 0; chan < 16; chan++) {
+	    if (src_off[chan] >= 0) {
+		memcpy(dst + ctrl_usr->vert.data_offset[chan],
+		    rec + src_off[chan], src_len[chan]);
+	    }
+	}
+    }
+    munmap(map, st.st_size);
+    ctrl_usr->samples = samples;
+    ctrl_usr->disp_start = 0;
+    pyramid_rebuild();
+    if (matched == 0) {
+	fprintf(stderr, "ERROR: no channel matches data file '%s'\n", filename );
+	return -1;
+    }
+    return matched;
+}
+
 /* format the data and print it */
 void write_sample(FILE *fp, char *label, scope_data_t *dptr, hal_type_t type)
 {
@@ -290,11 +290,12 @@ void refresh_state_info(void)
 	"TRIGGER?",
 	"TRIGGERED",
 	"DONE",
-	"RESET"
+	"RESET",
+	"ROLLING"
     };
 
     horiz = &(ctrl_usr->horiz);
-    if (ctrl_shm->state > RESET) {
+    if (ctrl_shm->state > ROLLING) {
 	ctrl_shm->state = IDLE;
     }
     gtk_label_set_text_if(horiz->state_label, state_names[ctrl_shm->state]);
@@ -787,7 +788,17 @@ void file_ok_sel( GtkWidget        *w,
     //    (char*)gtk_file_selection_get_filename (GTK_FILE_SELECTION (fs));
     //g_print ("filename is: %s\n", log_prefs->filename); 
     
-    write_log_file( (char*)gtk_file_selection_get_filename (GTK_FILE_SELECTION (fs)));
+    char *filename;
+    int len;
+
+    /* '.rec' files are binary, anything else is a text log */
+    filename = (char*)gtk_file_selection_get_filename (GTK_FILE_SELECTION (fs));
+    len = strlen(filename);
+    if (len > 4 && strcmp(filename + len - 4, ".rec") == 0) {
+	write_data_file(filename);
+    } else {
+	write_log_file(filename);
+    }
     //gtk_widget_destroy( w);
 }
 
@@ -810,7 +821,7 @@ void log_popup(int junk)
                                "clicked", (GtkSignalFunc) gtk_widget_destroy,
                                GTK_OBJECT (filew));
     gtk_file_selection_set_filename (GTK_FILE_SELECTION(filew), 
-                                     "halscope.log");
+                                     "halscope.rec");
     gtk_file_selection_hide_fileop_buttons (GTK_FILE_SELECTION(filew) );
     gtk_widget_show(filew);
 
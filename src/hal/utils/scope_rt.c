@@ -1,6 +1,13 @@
 /** This file, 'halscope_rt.c', is a HAL component that together with
     'halscope.c' provides an oscilloscope to view HAL pins, signals,
     and parameters
+
+    In roll mode the sample buffer is a ring that is never frozen, and
+    if loaded with 'ring_size=<bytes>' every sample is also written to
+    the 'scope' record ring, for 'halrecord scope -o file.rec' to keep
+    captures far longer than the buffer:
+
+	loadrt scope_rt num_samples=4000000 ring_size=16777216
 */
 
 /** Copyright (C) 2003 John Kasunich
@@ -47,6 +54,8 @@ MODULE_LICENSE("GPL");
 long num_samples = 16000;
 long shm_size;
 RTAPI_MP_LONG(num_samples, "Number of samples in the shared memory block")
+long ring_size = 0;
+RTAPI_MP_LONG(ring_size, "Size of the 'scope' record ring fed in roll mode, 0 for none")
 
 /***********************************************************************
 *                         GLOBAL VARIABLES                             *
@@ -72,6 +81,7 @@ static void init_shm_control_struct(void);
 
 static void sample(void *arg, long period);
 static void capture_sample(void);
+static void stream_sample(scope_data_t *src);
 static int check_trigger(void);
 
 /***********************************************************************
@@ -112,6 +122,24 @@ int rtapi_app_main(void)
     ctrl_rt = &ctrl_struct;
     init_rt_control_struct(shm_base);
 
+    /* the optional record ring for continuous capture */
+    if (ring_size > 0) {
+	retval = hal_ring_newf(ring_size, 4096, RINGTYPE_RECORD,
+	    "%s", SCOPE_RING_NAME);
+	if (retval == 0) {
+	    retval = hal_ring_attachf(&ctrl_rt->ring, NULL,
+		"%s", SCOPE_RING_NAME);
+	}
+	if (retval < 0) {
+	    rtapi_print_msg(RTAPI_MSG_ERR,
+		"SCOPE: ERROR: failed to create ring '%s'\n", SCOPE_RING_NAME);
+	    rtapi_shmem_delete(shm_id, comp_id);
+	    hal_exit(comp_id);
+	    return -1;
+	}
+	ctrl_shm->stream_ring = 1;
+    }
+
     /* export scope data sampling function */
     retval = hal_export_funct("scope.sample", sample, NULL, 0, 0, comp_id);
     if (retval != 0) {
@@ -132,6 +160,10 @@ void rtapi_app_exit(void)
 	/* need to unlink it before we release the scope shared memory */
 	hal_del_funct_from_thread("scope.sample", ctrl_shm->thread_name);
     }
+    if (ctrl_shm->stream_ring) {
+	hal_ring_detach(&ctrl_rt->ring);
+	hal_ring_deletef("%s", SCOPE_RING_NAME);
+    }
     rtapi_shmem_delete(shm_id, comp_id);
     hal_exit(comp_id);
 }
@@ -142,6 +174,7 @@ void rtapi_app_exit(void)
 
 static void sample(void *arg, long period)
 {
+    scope_data_t *dest;
     int n;
 
     ctrl_shm->watchdog = 0;
@@ -171,6 +204,7 @@ static void sample(void *arg, long period)
 	ctrl_shm->curr = 0;
 	ctrl_shm->start = ctrl_shm->curr;
 	ctrl_shm->samples = 0;
+	ctrl_shm->head = 0;
 	ctrl_shm->force_trig = 0;
 	ctrl_rt->auto_timer = 0;
 	/* get info about channels */
@@ -179,8 +213,14 @@ static void sample(void *arg, long period)
 	    ctrl_rt->data_type[n] = ctrl_shm->data_type[n];
 	    ctrl_rt->data_len[n] = ctrl_shm->data_len[n];
 	}
+	ctrl_rt->rec_size = scope_rec_offsets(ctrl_rt->data_len,
+	    ctrl_rt->rec_offset);
 	/* set next state */
-	ctrl_shm->state = PRE_TRIG;
+	if (ctrl_shm->roll) {
+	    ctrl_shm->state = ROLLING;
+	} else {
+	    ctrl_shm->state = PRE_TRIG;
+	}
 	break;
     case PRE_TRIG:
 	/* acquire a sample */
@@ -226,6 +266,22 @@ static void sample(void *arg, long period)
 	    ctrl_shm->state = DONE;
 	}
 	break;
+    case ROLLING:
+	/* acquire a sample, overwriting the oldest once the record is full */
+	dest = &(ctrl_rt->buffer[ctrl_shm->curr]);
+	capture_sample();
+	if (ctrl_shm->samples < ctrl_shm->rec_len) {
+	    ctrl_shm->samples++;
+	} else {
+	    ctrl_shm->start = ctrl_shm->curr;
+	}
+	if (ctrl_shm->stream_ring) {
+	    stream_sample(dest);
+	}
+	/* publish the sample only after it is complete */
+	rtapi_smp_wmb();
+	ctrl_shm->head++;
+	break;
     case DONE:
 	/* do nothing while GUI displays waveform */
 	break;
@@ -279,6 +335,33 @@ static void capture_sample(void)
     }
 }
 
+/* copy the sample just captured into the record ring; if the reader
+   has fallen behind, the record is dropped - the gap shows up in the
+   sequence numbers */
+static void stream_sample(scope_data_t *src)
+{
+    void *ptr;
+    __u64 *hdr;
+    int n, size;
+
+    size = ctrl_rt->rec_size;
+    if (record_write_begin(&ctrl_rt->ring, &ptr, size) != 0) {
+	return;
+    }
+    hdr = ptr;
+    hdr[0] = ctrl_shm->head;
+    hdr[1] = rtapi_get_time();
+    /* capture_sample() gave each acquired channel a scope_data_t slot,
+       the record packs the value at its own size */
+    for (n = 0; n < 16; n++) {
+	if (ctrl_rt->rec_offset[n] >= 0) {
+	    memcpy((char *) ptr + ctrl_rt->rec_offset[n], src++,
+		ctrl_rt->data_len[n]);
+	}
+    }
+    record_write_end(&ctrl_rt->ring, ptr, size);
+}
+
 // TODO: type-independent way to get high bit
 // #define SIGN_BIT (~(((ireal_t)~(ireal_t)0)>>1))
 static int check_trigger(void)
@@ -38,6 +38,7 @@
 
 /* import the shared declarations */
 #include "scope_shm.h"
+#include "hal_ring.h"
 
 /***********************************************************************
 *                         TYPEDEFS AND DEFINES                         *
@@ -52,6 +53,9 @@ typedef struct {
     char data_len[16];		/* data size for each channel */
     void *data_addr[16];	/* pointers to data for each channel */
     hal_type_t data_type[16];	/* data type for each channel */
+    ringbuffer_t ring;		/* 'scope' record ring, roll mode */
+    int rec_offset[16];		/* record offset of each channel value */
+    int rec_size;		/* size of a record in the ring */
 } scope_rt_control_t;
 
 /***********************************************************************
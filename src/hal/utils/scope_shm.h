@@ -51,9 +51,18 @@ typedef enum {
     TRIG_WAIT,			/* waiting for trigger */
     POST_TRIG,			/* acquiring post-trigger data */
     DONE,			/* data acquisition complete */
-    RESET			/* data acquisition interrupted */
+    RESET,			/* data acquisition interrupted */
+    ROLLING			/* continuous acquisition, never DONE */
 } scope_state_t;
 
+/* the 'scope' record ring, if any, carries one record per sample in
+   roll mode: a u64 sequence number (the sample count) and an s64
+   timestamp, then the channel values packed at their natural sizes,
+   see scope_rec_offsets().  The layout text in the ring scratchpad is
+   written by halscope, see scope_files.c */
+#define SCOPE_RING_NAME "scope"
+#define SCOPE_REC_HDR_SIZE 16
+
 /* this struct holds a single value - one sample of one channel */
 
 typedef union {
@@ -66,6 +75,37 @@ typedef union {
     ireal_t d_ireal;		/* intlike variable for float */
 } scope_data_t;
 
+/* the record offset of each channel with a 'data_len' of 1, 4 or 8
+   bytes, -1 for the others; returns the record size.  Like every HAL
+   record (hal/components/hal_record.h) the 64-bit values come first,
+   then the 32-bit ones, then the bits, each group in channel order */
+static inline int scope_rec_offsets(const char *data_len, int *offset)
+{
+    int n, len, n64, n32, next[9];
+
+    n64 = n32 = 0;
+    for (n = 0; n < 16; n++) {
+	if (data_len[n] == 8) {
+	    n64++;
+	} else if (data_len[n] == 4) {
+	    n32++;
+	}
+    }
+    next[8] = SCOPE_REC_HDR_SIZE;
+    next[4] = next[8] + n64 * 8;
+    next[1] = next[4] + n32 * 4;
+    for (n = 0; n < 16; n++) {
+	len = data_len[n];
+	if ((len == 1) || (len == 4) || (len == 8)) {
+	    offset[n] = next[len];
+	    next[len] += len;
+	} else {
+	    offset[n] = -1;
+	}
+    }
+    return next[1];
+}
+
 /** This struct holds control data needed by both realtime and GUI code.
     It lives in shared memory.  The codes for each field identify which
     module(s) set the field.  "I" set at init only, "R" set by realtime
@@ -90,6 +130,9 @@ typedef struct {
     int curr;			/* R next sample to be acquired */
     int samples;		/* R number of valid samples */
     scope_state_t state;	/* RU current state */
+    int roll;			/* U INIT starts continuous acquisition */
+    __u32 head;			/* R samples acquired since INIT, wraps */
+    int stream_ring;		/* I non-zero if the 'scope' ring exists */
     int data_offset[16];	/* U data addr in shmem for each channel */
     hal_type_t data_type[16];	/* U data type for each channel */
     char data_len[16];		/* U data size, 0 if not to be acquired */
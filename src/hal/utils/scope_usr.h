@@ -38,6 +38,7 @@
 
 /* import the shared declarations */
 #include "scope_shm.h"
+#include "hal_ring.h"
 
 /***********************************************************************
 *                         TYPEDEFS AND DEFINES                         *
@@ -152,6 +153,20 @@ typedef struct {
 
 
 
+/* min/max decimation of one channel's display buffer; level L holds
+   one entry per SCOPE_PYR_FACTOR^L samples, so a zoomed out display
+   draws a few entries per pixel instead of every sample */
+
+#define SCOPE_PYR_SHIFT 3
+#define SCOPE_PYR_FACTOR (1 << SCOPE_PYR_SHIFT)
+#define SCOPE_PYR_LEVELS 8
+
+typedef struct {
+    double min;
+    double max;
+    double sum;
+} scope_minmax_t;
+
 /* this struct holds control data related to the display */
 /* it lives in user space (as part of the master control struct) */
 
@@ -177,6 +192,10 @@ typedef struct {
 
     GdkGC *context;		/* graphics context for drawing */
     int selected_part;
+    /* decimation pyramid, built over rec_len samples */
+    int pyr_rec_len;		/* rec_len the pyramid was sized for */
+    int pyr_len[SCOPE_PYR_LEVELS];	/* entries in each level */
+    scope_minmax_t *pyr[16][SCOPE_PYR_LEVELS];	/* per channel, level */
 } scope_disp_t;
 
 /* this struct holds data relating to logging */ 
@@ -203,6 +222,11 @@ typedef struct {
     scope_data_t *buffer;	/* ptr to shmem buffer (user mapping) */
     scope_data_t *disp_buf;	/* ptr to user buffer for display */
     int samples;		/* number of samples in display buffer */
+    int disp_start;		/* slot of the oldest sample, roll mode */
+    __u32 tail;			/* ctrl_shm->head at the last roll copy */
+    int tail_slot;		/* slot the RT code fills next */
+    ringbuffer_t ring;		/* 'scope' ring, for its layout text */
+    int ring_attached;
     int display_refresh_timer;	/* flag for display refresh */
     scope_run_mode_t run_mode;	/* current run mode */
     scope_run_mode_t old_run_mode;	/* run mode to restore*/
@@ -262,6 +286,10 @@ void channel_changed(void);
 
 
 void format_signal_value(char *buf, int buflen, double value);
+scope_data_t *disp_sample(int n);
+double sample_value(scope_data_t *dptr, hal_type_t type);
+void pyramid_rebuild(void);
+void pyramid_update(int slot, int count);
 
 int read_config_file (char *filename);
 void write_config_file (char *filename);
@@ -269,6 +297,9 @@ void write_horiz_config(FILE *fp);
 void write_vert_config(FILE *fp);
 void write_trig_config(FILE *fp);
 void write_log_file (char *filename);
+int format_record_layout(char *buf, int buflen);
+int write_data_file(char *filename);
+int read_data_file(char *filename);
 void write_sample(FILE *fp, char *label, scope_data_t *dptr, hal_type_t type);
 
 /* the following functions set various parameters, they are normally
@@ -32,6 +32,7 @@
 
 #include <string>
 #include <unordered_map>
+#include <vector>
 
 #ifndef ULAPI
 #error This is intended as a userspace component only.
@@ -56,12 +57,19 @@ namespace gpb = google::protobuf;
 #define HAL_HALRCOMP_STATUS_VERSION 2
 #define HAL_RCOMMAND_VERSION     2
 
+#if ALLOC_COUNT
+// operator new calls of this thread, counted in --enable-dev builds
+// and logged per group/rcomp report - see haltalk_main.cc
+extern thread_local size_t ht_allocs;
+#endif
+
 #if JSON_TIMING
 #include <machinetalk/json2pb/json2pb.h>
 #include <jansson.h>
 #endif
 
 typedef struct htself htself_t;
+typedef struct htworker htworker_t;
 
 typedef struct {
     hal_compiled_group_t *cg;
@@ -70,6 +78,9 @@ typedef struct {
     htself_t *self;
     int timer_id; // > -1: scan timer active - subscribers present
     int msec;
+    int snap_timer_id; // > -1: refreshing the shared memory snapshot
+    bool published;    // shared memory snapshot created, see publish_groups()
+    htworker_t *worker; // reporting thread, NULL: the main loop
 } group_t;
 
 typedef struct {
@@ -79,6 +90,7 @@ typedef struct {
     htself_t *self;
     int timer_id;
     int msec;
+    htworker_t *worker; // reporting thread, NULL: the main loop
 } rcomp_t;
 
 typedef struct htbridge {
@@ -100,6 +112,38 @@ typedef compmap_t::iterator compmap_iterator;
 typedef std::unordered_map<int, hal_object_ptr> itemmap_t;
 typedef itemmap_t::iterator itemmap_iterator;
 
+// a compiled MT_HALRCOMMAND_PREPARE handle list
+typedef struct {
+    hal_object_ptr o;
+    int id;          // handle the entry was compiled from
+    hal_type_t type;
+    unsigned size;   // bytes in the packed value vector
+    int link;        // pin: signal linked at prepare time
+    hal_data_u *vp;  // resolved value pointer
+} plan_entry_t;
+
+typedef struct {
+    int id;
+    unsigned size;   // expected value vector size
+    std::string client; // ROUTER identity of the client which prepared it
+    std::vector<plan_entry_t> entries;
+} plan_t;
+
+// prepared plans indexed by plan id
+typedef std::unordered_map<int, plan_t *> planmap_t;
+typedef planmap_t::iterator planmap_iterator;
+
+// clients holding plans, indexed by ROUTER identity
+typedef struct {
+    int nplans;
+    int64_t last_seen; // zclock_mono() of its last request, msec
+} plan_client_t;
+typedef std::unordered_map<std::string, plan_client_t> planclientmap_t;
+typedef planclientmap_t::iterator planclient_iterator;
+
+#define PLANS_PER_CLIENT 64
+#define PLAN_TIMEOUT 30000 // msec without a request before plans are freed
+
 #define NSVCS  3
 enum {
     SVC_HALGROUP=0,
@@ -125,6 +169,7 @@ typedef struct htconf {
     int default_rcomp_timer; // msec
     int keepalive_timer; // msec; disabled if zero
     bool trap_signals;
+    int workers; // reporting threads; zero: report from the main loop
 } htconf_t;
 
 typedef struct htself {
@@ -145,10 +190,51 @@ typedef struct htself {
     groupmap_t groups;
     compmap_t  rcomps;
     itemmap_t  items;
+    planmap_t  plans;
+    planclientmap_t plan_clients;
+    int        plan_serial;
 
     htbridge_t *bridge;
+
+    // with cfg->workers > 0: the workers' PUB sockets connect to these,
+    // everything received is forwarded to the halgroup/halrcomp XPUB
+    std::vector<htworker_t *> workers;
+    zsock_t *group_xsub;
+    zsock_t *rcomp_xsub;
 } htself_t;
 
+// a reporting thread: groups and rcomps are sharded across workers,
+// each scanning, serialising and publishing its share on its own loop
+// while the main loop stays free for subscriptions and commands
+typedef struct htworker {
+    htself_t *self;
+    int index;
+    zactor_t *actor;
+    zloop_t *loop;
+    zsock_t *group_pub;
+    zsock_t *rcomp_pub;
+    machinetalk::Container tx;
+    int load; // group members and rcomp pins reported
+} htworker_t;
+
+// the Container, socket and loop a group or rcomp is reported through
+static inline machinetalk::Container &report_tx(htself_t *self, htworker_t *w)
+{
+    return w ? w->tx : self->tx;
+}
+
+static inline void *report_socket(htself_t *self, htworker_t *w, int svc)
+{
+    if (w)
+	return svc == SVC_HALGROUP ? w->group_pub : w->rcomp_pub;
+    return self->mksock[svc].socket;
+}
+
+static inline zloop_t *report_loop(htself_t *self, htworker_t *w)
+{
+    return w ? w->loop : self->netopts.z_loop;
+}
+
 
 // haltalk_group.cc:
 int scan_groups(htself_t *self);
@@ -156,6 +242,10 @@ int release_groups(htself_t *self);
 int handle_group_timer(zloop_t *loop, int timer_id, void *arg);
 int handle_group_input(zloop_t *loop, zsock_t *socket, void *arg);
 int ping_groups(htself_t *self);
+int publish_groups(htself_t *self);
+int group_snapshot_start(group_t *g);
+int group_subscribed(group_t *g);
+int group_unsubscribed(group_t *g);
 
 // haltalk_rcomp.cc:
 int scan_comps(htself_t *self);
@@ -163,15 +253,28 @@ int release_comps(htself_t *self);
 int handle_rcomp_input(zloop_t *loop, zsock_t *socket, void *arg);
 int handle_rcomp_timer(zloop_t *loop, int timer_id, void *arg);
 int ping_comps(htself_t *self);
+int rcomp_subscribed(rcomp_t *rc);
+int rcomp_unsubscribed(rcomp_t *rc);
 
 // haltalk_command.cc:
 int handle_command_input(zloop_t *loop, zsock_t *socket, void *arg);
 
+// haltalk_plan.cc:
+int dispatch_plan(htself_t *self, zmsg_t *from, void *socket);
+int release_plans(htself_t *self);
+int plan_client_seen(htself_t *self, zmsg_t *from);
+int handle_plan_timer(zloop_t *loop, int timer_id, void *arg);
+
 // haltalk_introspect.cc:
 int process_describe(htself_t *self, zmsg_t *from,  void *socket);
-int describe_group(htself_t *self, const char *group, const std::string &from,  void *socket);
-int describe_comp(htself_t *self, const char *comp, const std::string &from,  void *socket);
-int describe_parameters(htself_t *self);
+int describe_group(machinetalk::Container &tx, const char *group, const std::string &from,  void *socket);
+int describe_comp(machinetalk::Container &tx, const char *comp, const std::string &from,  void *socket);
+int describe_parameters(htself_t *self, machinetalk::Container &tx);
+
+// haltalk_worker.cc:
+int start_workers(htself_t *self);
+int stop_workers(htself_t *self);
+htworker_t *assign_worker(htself_t *self, int load);
 
 // haltalk_bridge.cc:
 int bridge_init(htself_t *self);
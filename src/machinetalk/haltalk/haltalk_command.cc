@@ -294,6 +294,7 @@ create_rcomp(htself_t *self,  const machinetalk::Component *pbcomp,
         goto EXIT_COMP;
     }
     rc->cc = cc;
+    rc->worker = assign_worker(self, cc->n_pins);
     return rc;
 
  EXIT_COMP:
@@ -470,6 +471,9 @@ dispatch_request(htself_t *self, zmsg_t *from, void *socket)
     int retval = 0;
     machinetalk::ContainerType type = self->rx.type();
 
+    // any request, pings included, keeps the client's plans alive
+    plan_client_seen(self, from);
+
     // rtapi_print_msg(RTAPI_MSG_INFO, "%s: rcommand type %d",
     //          self->cfg->progname, type);
     switch (type) {
@@ -510,6 +514,12 @@ dispatch_request(htself_t *self, zmsg_t *from, void *socket)
         retval = process_get(self, from, socket);
         break;
 
+    case machinetalk::MT_HALRCOMMAND_PREPARE:
+    case machinetalk::MT_HALRCOMMAND_EXECUTE:
+    case machinetalk::MT_HALRCOMMAND_RELEASE:
+        retval = dispatch_plan(self, from, socket);
+        break;
+
     case machinetalk::MT_HALRCOMMAND_DESCRIBE:
         self->tx.set_type(machinetalk::MT_HALRCOMMAND_DESCRIPTION);
         retval = process_describe(self, from, socket);
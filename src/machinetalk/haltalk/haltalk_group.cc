@@ -23,6 +23,11 @@
 static int group_report_cb(int phase, hal_compiled_group_t *cgroup,
 			   hal_sig_t *sig, void *cb_data);
 static int scan_group_cb(hal_object_ptr o, foreach_args_t *args);
+static void subscribe_group(group_t *g);
+
+#if ALLOC_COUNT
+static thread_local size_t report_allocs; // ht_allocs at REPORT_BEGIN
+#endif
 
 
 // monitor group subscribe events:
@@ -52,6 +57,7 @@ handle_group_input(zloop_t *loop, zsock_t *socket, void *arg)
 
 	// adopt and compile any groups defined since startup
 	scan_groups(self);
+	publish_groups(self);
 
 	if (strlen(topic) == 0) {
 	    // this was a subscribe("") - all topics
@@ -60,52 +66,22 @@ handle_group_input(zloop_t *loop, zsock_t *socket, void *arg)
 		 gi != self->groups.end(); gi++) {
 
 		group_t *g = gi->second;
-		self->tx.set_type(machinetalk::MT_HALGROUP_FULL_UPDATE);
-		self->tx.set_uuid(self->netopts.proc_uuid, sizeof(self->netopts.proc_uuid));
-		self->tx.set_serial(g->serial++);
-		describe_parameters(self);
-		describe_group(self, gi->first.c_str(), gi->first.c_str(), socket);
-
-		// if first subscriber: activate scanning
-		if (g->timer_id < 0) { // not scanning
-		    g->timer_id = zloop_timer(loop, g->msec,
-					      0, handle_group_timer, (void *)g);
-		    assert(g->timer_id > -1);
-		    rtapi_print_msg(RTAPI_MSG_DBG,
-				    "%s: start scanning group %s, tid=%d, %d mS, %d members, %d monitored",
-				    self->cfg->progname, topic, g->timer_id, g->msec,
-				    g->cg->n_members, g->cg->n_monitored);
-		}
+		subscribe_group(g);
 		rtapi_print_msg(RTAPI_MSG_DBG,
-				"%s: wildcard subscribe group='%s' serial=%d",
+				"%s: wildcard subscribe group='%s'",
 				self->cfg->progname,
-				gi->first.c_str(), gi->second->serial);
+				gi->first.c_str());
 	    }
 	} else {
 	    // a selective subscribe - describe only the desired group
 	    groupmap_iterator gi = self->groups.find(topic);
 	    if (gi != self->groups.end()) {
 		group_t *g = gi->second;
-		self->tx.set_type(machinetalk::MT_HALGROUP_FULL_UPDATE);
-		self->tx.set_uuid(self->netopts.proc_uuid, sizeof(self->netopts.proc_uuid));
-		self->tx.set_serial(g->serial++);
-		describe_parameters(self);
-		describe_group(self, gi->first.c_str(), gi->first.c_str(), socket);
+		subscribe_group(g);
 		rtapi_print_msg(RTAPI_MSG_DBG,
-				"%s: subscribe group='%s' serial=%d",
+				"%s: subscribe group='%s'",
 				self->cfg->progname,
-				gi->first.c_str(), gi->second->serial);
-
-		// if first subscriber: activate scanning
-		if (g->timer_id < 0) { // not scanning
-		    g->timer_id = zloop_timer(loop, g->msec,
-					      0, handle_group_timer, (void *)g);
-		    assert(g->timer_id > -1);
-		    rtapi_print_msg(RTAPI_MSG_DBG,
-				    "%s: start scanning group %s, tid=%d, %d mS, %d members, %d monitored",
-				    self->cfg->progname, topic,
-				    g->timer_id, g->msec, g->cg->n_members, g->cg->n_monitored);
-		}
+				gi->first.c_str());
 	    } else {
 		// non-existant topic, complain.
 		self->tx.set_type(machinetalk::MT_STP_NOGROUP);
@@ -128,14 +104,10 @@ handle_group_input(zloop_t *loop, zsock_t *socket, void *arg)
 	if (self->groups.count(topic) > 0) {
 	    group_t *g = self->groups[topic];
 	    // stop the scanning timer
-	    if (g->timer_id > -1) {  // currently scanning
-		rtapi_print_msg(RTAPI_MSG_DBG,
-				"%s: group %s stop scanning, tid=%d",
-				self->cfg->progname, topic, g->timer_id);
-		int retval = zloop_timer_end (loop, g->timer_id);
-		assert(retval == 0);
-		g->timer_id = -1;
-	    }
+	    if (g->worker)
+		zsock_send(g->worker->actor, "sp", "GUNSUB", g);
+	    else
+		group_unsubscribed(g);
 	}
 	break;
 
@@ -147,6 +119,53 @@ handle_group_input(zloop_t *loop, zsock_t *socket, void *arg)
 }
 
 
+// send a full update and, if first subscriber, activate scanning
+// runs on the loop the group is reported from
+int
+group_subscribed(group_t *g)
+{
+    htself_t *self = g->self;
+    machinetalk::Container &tx = report_tx(self, g->worker);
+    const char *name = ho_name(g->cg->group);
+
+    tx.set_type(machinetalk::MT_HALGROUP_FULL_UPDATE);
+    tx.set_uuid(self->netopts.proc_uuid, sizeof(self->netopts.proc_uuid));
+    tx.set_serial(g->serial++);
+    describe_parameters(self, tx);
+    describe_group(tx, name, name,
+		   report_socket(self, g->worker, SVC_HALGROUP));
+
+    if (g->timer_id < 0) { // not scanning
+	g->timer_id = zloop_timer(report_loop(self, g->worker), g->msec,
+				  0, handle_group_timer, (void *)g);
+	assert(g->timer_id > -1);
+	rtapi_print_msg(RTAPI_MSG_DBG,
+			"%s: start scanning group %s, tid=%d, %d mS, %d members, %d monitored,"
+			" worker %d",
+			self->cfg->progname, name, g->timer_id, g->msec,
+			g->cg->n_members, g->cg->n_monitored,
+			g->worker ? g->worker->index : -1);
+    }
+    return 0;
+}
+
+// last subscriber gone - stop scanning
+int
+group_unsubscribed(group_t *g)
+{
+    htself_t *self = g->self;
+
+    if (g->timer_id > -1) {  // currently scanning
+	rtapi_print_msg(RTAPI_MSG_DBG,
+			"%s: group %s stop scanning, tid=%d",
+			self->cfg->progname, ho_name(g->cg->group), g->timer_id);
+	int retval = zloop_timer_end(report_loop(self, g->worker), g->timer_id);
+	assert(retval == 0);
+	g->timer_id = -1;
+    }
+    return 0;
+}
+
 // detect if a group needs reporting, and do so
 int
 handle_group_timer(zloop_t *loop, int timer_id, void *arg)
@@ -157,6 +176,64 @@ handle_group_timer(zloop_t *loop, int timer_id, void *arg)
     return 0;
 }
 
+// refresh the shared memory snapshot of a group
+static int
+handle_snapshot_timer(zloop_t *loop, int timer_id, void *arg)
+{
+    group_t *g = (group_t *) arg;
+    hal_cgroup_snapshot(g->cg);
+    return 0;
+}
+
+// start publishing snapshots of the groups with the snapshot flag
+// set - unlike reporting, regardless of subscribers, since local
+// readers are not visible to haltalk
+int
+publish_groups(htself_t *self)
+{
+    int nfail = 0;
+
+    for (groupmap_iterator gi = self->groups.begin();
+	 gi != self->groups.end(); gi++) {
+	group_t *g = gi->second;
+
+	if (g->published ||
+	    !(hal_cgroup_flags(g->cg) & GROUP_PUBLISH_SNAPSHOT))
+	    continue;
+	if (hal_cgroup_publish(g->cg)) {
+	    rtapi_print_msg(RTAPI_MSG_ERR,
+			    "%s: cant publish snapshot of group '%s'\n",
+			    self->cfg->progname, gi->first.c_str());
+	    nfail++;
+	    continue;
+	}
+	g->published = true;
+	if (g->worker)
+	    zsock_send(g->worker->actor, "sp", "GSNAP", g);
+	else
+	    group_snapshot_start(g);
+    }
+    return -nfail;
+}
+
+// take the first snapshot of a published group and keep refreshing it
+// runs on the loop the group is reported from
+int
+group_snapshot_start(group_t *g)
+{
+    htself_t *self = g->self;
+
+    hal_cgroup_snapshot(g->cg);
+    g->snap_timer_id = zloop_timer(report_loop(self, g->worker), g->msec,
+				   0, handle_snapshot_timer, (void *)g);
+    assert(g->snap_timer_id > -1);
+    rtapi_print_msg(RTAPI_MSG_DBG,
+		    "%s: publishing snapshot of group '%s' every %d mS, worker %d\n",
+		    self->cfg->progname, ho_name(g->cg->group), g->msec,
+		    g->worker ? g->worker->index : -1);
+    return 0;
+}
+
 // walk HAL groups, and compile any which are not in self->groups yet
 // idempotent - will add new groups as found
 int
@@ -182,6 +259,16 @@ scan_groups(htself_t *self)
 
 // ----- end of public functions ----
 
+// hand a new subscription to the loop the group is reported from
+static void
+subscribe_group(group_t *g)
+{
+    if (g->worker)
+	zsock_send(g->worker->actor, "sp", "GSUB", g);
+    else
+	group_subscribed(g);
+}
+
 // static int
 // add_sig_to_items(int level, hal_group_t **groups,
 // 		 hal_member_t *member, void *cb_data)
@@ -248,9 +335,12 @@ scan_group_cb(hal_object_ptr o, foreach_args_t *args)
     grp->self = self;
     grp->flags = 0;
     grp->timer_id = -1; // not yet scanning
+    grp->snap_timer_id = -1; // see group_snapshot_start()
+    grp->published = false;
     grp->msec =  hal_cgroup_timer(cgroup);
     if (grp->msec == 0)
 	grp->msec = self->cfg->default_group_timer;
+    grp->worker = assign_worker(self, cgroup->n_members);
 
     self->groups[ho_name(g)] = grp;
 
@@ -281,36 +371,46 @@ group_report_cb(int phase, hal_compiled_group_t *cgroup,
 {
     group_t *grp = (group_t *) cb_data;
     htself_t *self = grp->self;
+    machinetalk::Container &tx = report_tx(self, grp->worker);
     machinetalk::Signal *signal;
     int retval;
 
     switch (phase) {
 
     case REPORT_BEGIN:	// report initialisation
-	self->tx.set_type(machinetalk::MT_HALGROUP_INCREMENTAL_UPDATE);
+	tx.set_type(machinetalk::MT_HALGROUP_INCREMENTAL_UPDATE);
 	// the serial enables detection of lost updates
 	// for a client to recover from a lost update:
 	// unsubscribe + re-subscribe which will cause
 	// a full state dump to be sent
-	self->tx.set_serial(grp->serial++);
+	tx.set_serial(grp->serial++);
+#if ALLOC_COUNT
+	report_allocs = ht_allocs;
+#endif
 	break;
 
     case REPORT_SIGNAL: // per-reported-signal action
-	signal = self->tx.add_signal();
+	signal = tx.add_signal();
 	signal->set_handle(ho_id(sig));
 	retval = hal_sig2pb(sig, signal);
 	assert(retval == 0);
 	break;
 
     case REPORT_END: // finalize & send
-	retval = send_pbcontainer(ho_name(cgroup->group), self->tx,
-				  self->mksock[SVC_HALGROUP].socket);
+	retval = send_pbcontainer(ho_name(cgroup->group), tx,
+				  report_socket(self, grp->worker, SVC_HALGROUP));
 	assert(retval == 0);
+#if ALLOC_COUNT
+	if (self->cfg->debug)
+	    rtapi_print_msg(RTAPI_MSG_DBG, "%s: group %s report %d: %zu allocations",
+			    self->cfg->progname, ho_name(cgroup->group),
+			    grp->serial - 1, ht_allocs - report_allocs);
+#endif
 
 #if JSON_TIMING
 	// timing test:
 	try {
-	    std::string json = pb2json(self->tx);
+	    std::string json = pb2json(tx);
 	    zframe_t *z_jsonframe = zframe_new( json.c_str(), json.size());
 	    //assert(zframe_send(&z_jsonframe, self->z_status, 0) == 0);
 	    zframe_destroy(&z_jsonframe);
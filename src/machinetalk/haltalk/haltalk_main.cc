@@ -35,9 +35,35 @@
 #include <setup_signals.h>
 #include <mk-service.hh>
 #include <mk-backtrace.h>
+#if ALLOC_COUNT
+#include <new>
+#endif
 
 int print_container; // see pbutil.cc
 
+#if ALLOC_COUNT
+thread_local size_t ht_allocs;
+
+void *operator new(size_t size)
+{
+    ht_allocs++;
+    void *p = malloc(size ? size : 1);
+    if (p == NULL)
+	throw std::bad_alloc();
+    return p;
+}
+
+void operator delete(void *p) noexcept
+{
+    free(p);
+}
+
+void operator delete(void *p, size_t size) noexcept
+{
+    free(p);
+}
+#endif
+
 // configuration defaults
 static htconf_t conf = {
     "",
@@ -55,6 +81,7 @@ static htconf_t conf = {
     100,  // odefault_rcomp_timer
     2000, // keepalive
     true, // trap_signals
+    0,    // workers
 };
 
 
@@ -104,6 +131,8 @@ mainloop( htself_t *self)
     zloop_reader(loop, self->mksock[SVC_HALGROUP].socket, handle_group_input, self);
     zloop_reader(loop, self->mksock[SVC_HALRCOMP].socket, handle_rcomp_input, self);
     zloop_reader(loop, self->mksock[SVC_HALRCMD].socket, handle_command_input, self);
+    publish_groups(self);
+    zloop_timer(loop, PLAN_TIMEOUT / 2, 0, handle_plan_timer, (void *) self);
     if (self->cfg->keepalive_timer)
 	zloop_timer(loop, self->cfg->keepalive_timer, 0,
 		    handle_keepalive_timer, (void *) self);
@@ -265,8 +294,10 @@ static int
 hal_cleanup(htself_t *self)
 {
     int retval;
+    stop_workers(self);
     retval = release_comps(self);
     retval = release_groups(self);
+    release_plans(self);
 
     if (self->comp_id)
 	hal_exit(self->comp_id);
@@ -318,8 +349,11 @@ read_config(htself_t *self)
 	    iniFindInt(inifp, "DEBUG", conf->section, &conf->debug);
     }
 #endif
-    if (inifp)
+    if (inifp) {
+	if (!self->cfg->workers)
+	    iniFindInt(inifp, "WORKERS", self->cfg->section, &self->cfg->workers);
 	fclose(inifp);
+    }
     return 0;
 }
 
@@ -342,11 +376,14 @@ usage(void)
 	   "    set the RTAPI message level.\n"
 	   "-t or --timer <msec>\n"
 	   "    set the default group scan timer (100mS).\n"
+	   "-w or --workers <n>\n"
+	   "    report groups and remote components from <n> threads\n"
+	   "    (default 0: from the main loop).\n"
 	   "-d or --debug\n"
 	   "    Turn on event debugging messages.\n");
 }
 
-static const char *option_string = "hI:S:d:t:T:R:sK:G";
+static const char *option_string = "hI:S:d:t:T:R:sK:Gw:";
 static struct option long_options[] = {
     {"help", no_argument, 0, 'h'},
     {"ini", required_argument, 0, 'I'},     // default: getenv(INI_FILE_NAME)
@@ -358,6 +395,7 @@ static struct option long_options[] = {
     {"svcuuid", required_argument, 0, 'R'},
     {"stderr",  no_argument,        0, 's'},
     {"nosighdlr",   no_argument,    0, 'G'},
+    {"workers", required_argument, 0, 'w'},
     {0,0,0,0}
 };
 
@@ -415,6 +453,9 @@ int main (int argc, char *argv[])
 	case 'G':
 	    conf.trap_signals = false;
 	    break;
+	case 'w':
+	    conf.workers = atoi(optarg);
+	    break;
 	case 's':
 	    logopt |= LOG_PERROR;
 	    break;
@@ -454,6 +495,9 @@ int main (int argc, char *argv[])
     retval = zmq_init(&self);
     if (retval) exit(retval);
 
+    retval = start_workers(&self);
+    if (retval) exit(retval);
+
 #ifdef NOTYET
     retval = bridge_init(&self);
     if (retval) exit(retval);
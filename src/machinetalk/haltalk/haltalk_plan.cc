@@ -0,0 +1,371 @@
+// prepared set commands: MT_HALRCOMMAND_PREPARE/EXECUTE/RELEASE
+//
+// MT_HALRCOMMAND_SET looks up every pin and signal by handle, checks
+// direction and type and writes through pin_value() one at a time.
+// A client issuing the same multi-pin set at high rate (jog pendant,
+// teach UI) registers its handle list once instead: PREPARE validates
+// the handles and compiles a plan with the value pointers resolved,
+// EXECUTE then carries just the plan id and a packed value vector
+// which is applied in one loop followed by a single write barrier.
+//
+// a plan records the link state it was compiled against. Should a
+// handle be deleted, a pin be relinked or a signal gain a writer,
+// EXECUTE rejects the plan and drops it - the client must re-PREPARE.
+//
+// a client may hold up to PLANS_PER_CLIENT plans. A ROUTER socket does
+// not tell when a peer goes away, so the plans of a client which sent
+// no request - its heartbeat pings included - for PLAN_TIMEOUT are
+// freed, and a later EXECUTE is rejected as for any unknown plan.
+
+#include "haltalk.hh"
+#include "pbutil.hh"
+
+#include <endian.h>
+
+static int process_prepare(htself_t *self, zmsg_t *from, void *socket);
+static int process_execute(htself_t *self, zmsg_t *from, void *socket);
+static int process_release(htself_t *self, zmsg_t *from, void *socket);
+static std::string client_id(zmsg_t *from);
+static void drop_plan(htself_t *self, planmap_iterator it);
+
+int
+dispatch_plan(htself_t *self, zmsg_t *from, void *socket)
+{
+    switch (self->rx.type()) {
+    case machinetalk::MT_HALRCOMMAND_PREPARE:
+	return process_prepare(self, from, socket);
+    case machinetalk::MT_HALRCOMMAND_EXECUTE:
+	return process_execute(self, from, socket);
+    case machinetalk::MT_HALRCOMMAND_RELEASE:
+	return process_release(self, from, socket);
+    default:
+	return -1;
+    }
+}
+
+int
+release_plans(htself_t *self)
+{
+    for (planmap_iterator it = self->plans.begin();
+	 it != self->plans.end(); it++)
+	delete it->second;
+    self->plans.clear();
+    self->plan_clients.clear();
+    return 0;
+}
+
+int
+plan_client_seen(htself_t *self, zmsg_t *from)
+{
+    if (self->plan_clients.empty())
+	return 0;
+    planclient_iterator ci = self->plan_clients.find(client_id(from));
+    if (ci != self->plan_clients.end())
+	ci->second.last_seen = zclock_mono();
+    return 0;
+}
+
+// free the plans of clients gone quiet
+int
+handle_plan_timer(zloop_t *loop, int timer_id, void *arg)
+{
+    htself_t *self = (htself_t *) arg;
+    int64_t now = zclock_mono();
+    int n = 0;
+
+    for (planmap_iterator it = self->plans.begin();
+	 it != self->plans.end(); ) {
+	planmap_iterator next = it;
+	next++;
+	planclient_iterator ci = self->plan_clients.find(it->second->client);
+	if ((ci == self->plan_clients.end()) ||
+	    (now - ci->second.last_seen > PLAN_TIMEOUT)) {
+	    drop_plan(self, it);
+	    n++;
+	}
+	it = next;
+    }
+    if (n)
+	rtapi_print_msg(RTAPI_MSG_DBG,
+			"%s: freed %d plans of clients silent for %d mS",
+			self->cfg->progname, n, PLAN_TIMEOUT);
+    return 0;
+}
+
+// size of a value in the packed vector
+static unsigned
+value_size(const hal_type_t type)
+{
+    switch (type) {
+    case HAL_BIT:
+	return 1;
+    case HAL_S32:
+    case HAL_U32:
+	return 4;
+    case HAL_FLOAT:
+    case HAL_S64:
+    case HAL_U64:
+	return 8;
+    default:
+	return 0;
+    }
+}
+
+// validate one handle and fill in the plan entry
+// any errors are added as self->tx.note strings.
+// call with HAL mutex held.
+static int
+compile_entry(htself_t *self, const int handle, plan_entry_t *pe)
+{
+    itemmap_iterator it = self->items.find(handle);
+
+    if (it == self->items.end()) {
+	note_printf(self->tx, "no such handle: %d", handle);
+	return -1;
+    }
+    hal_object_ptr o = it->second;
+
+    pe->o = o;
+    pe->id = handle;
+    pe->link = 0;
+
+    switch (hh_get_object_type(o.hdr)) {
+    case HAL_PIN:
+	if (o.pin->dir == HAL_OUT) {
+	    note_printf(self->tx,
+			"HALrcommand: cant set an HAL_OUT pin: handle=%d name=%s",
+			handle, ho_name(o.pin));
+	    return -1;
+	}
+	pe->type = o.pin->type;
+	pe->link = o.pin->_signal;
+	pe->vp = pin_value(o.pin);
+	break;
+
+    case HAL_SIGNAL:
+	if (o.sig->writers > 0) {
+	    note_printf(self->tx,
+			"cannot update signal '%s'  - %d output pin(s) linked",
+			ho_name(o.sig), o.sig->writers);
+	    return -1;
+	}
+	pe->type = o.sig->type;
+	pe->vp = sig_value(o.sig);
+	break;
+
+    default:
+	note_printf(self->tx,
+		    "handle type mismatch - not a pin or signal: handle=%d type=%s",
+		    handle, hh_get_object_typestr(o.hdr));
+	return -1;
+    }
+    pe->size = value_size(pe->type);
+    if (pe->size == 0) {
+	note_printf(self->tx, "bad type %d name=%s",
+		    pe->type, hh_get_name(o.hdr));
+	return -1;
+    }
+    return 0;
+}
+
+// true if the HAL object and its link state are still those
+// the plan entry was compiled against.
+// call with HAL mutex held.
+static bool
+entry_current(const plan_entry_t *pe)
+{
+    const hal_object_ptr o = pe->o;
+
+    if (!hh_is_valid(o.hdr) || (hh_get_id(o.hdr) != pe->id))
+	return false;
+
+    if (hh_get_object_type(o.hdr) == HAL_PIN)
+	return (o.pin->dir != HAL_OUT) && (o.pin->_signal == pe->link);
+
+    return o.sig->writers == 0;
+}
+
+// the ROUTER identity frame a request came with
+static std::string
+client_id(zmsg_t *from)
+{
+    zframe_t *f = zmsg_first(from);
+
+    if (f == NULL)
+	return std::string();
+    return std::string((const char *) zframe_data(f), zframe_size(f));
+}
+
+static void
+drop_plan(htself_t *self, planmap_iterator it)
+{
+    plan_t *plan = it->second;
+    planclient_iterator ci = self->plan_clients.find(plan->client);
+
+    if ((ci != self->plan_clients.end()) && (--ci->second.nplans <= 0))
+	self->plan_clients.erase(ci);
+    self->plans.erase(it);
+    delete plan;
+}
+
+static int
+process_prepare(htself_t *self, zmsg_t *from, void *socket)
+{
+    std::string client = client_id(from);
+    planclient_iterator ci = self->plan_clients.find(client);
+
+    if ((ci != self->plan_clients.end()) &&
+	(ci->second.nplans >= PLANS_PER_CLIENT)) {
+	note_printf(self->tx, "prepare: %d plans held already - release some",
+		    ci->second.nplans);
+	self->tx.set_type(machinetalk::MT_HALRCOMMAND_PREPARE_REJECT);
+	return send_pbcontainer(from, self->tx, socket);
+    }
+
+    plan_t *plan = new plan_t();
+
+    plan->size = 0;
+    plan->entries.resize(self->rx.handle_size());
+    {
+	WITH_HAL_MUTEX();
+
+	for (int i = 0; i < self->rx.handle_size(); i++) {
+	    plan_entry_t *pe = &plan->entries[i];
+	    if (compile_entry(self, self->rx.handle(i), pe))
+		continue;
+	    plan->size += pe->size;
+	}
+    }
+    if (self->rx.handle_size() == 0)
+	note_printf(self->tx, "prepare: no handles");
+
+    if (self->tx.note_size()) {
+	delete plan;
+	self->tx.set_type(machinetalk::MT_HALRCOMMAND_PREPARE_REJECT);
+	return send_pbcontainer(from, self->tx, socket);
+    }
+
+    // plan ids are never reused during a haltalk run, so a stale id
+    // held by a client cannot silently address someone else's plan
+    plan->id = ++self->plan_serial;
+    plan->client = client;
+    self->plans[plan->id] = plan;
+
+    plan_client_t &c = self->plan_clients[client];
+    c.nplans++;
+    c.last_seen = zclock_mono();
+
+    self->tx.set_type(machinetalk::MT_HALRCOMMAND_PREPARE_CONFIRM);
+    self->tx.set_plan(plan->id);
+    self->tx.mutable_handle()->CopyFrom(self->rx.handle());
+    // size of the value vector EXECUTE must carry
+    self->tx.set_plan_size(plan->size);
+    return send_pbcontainer(from, self->tx, socket);
+}
+
+static int
+process_execute(htself_t *self, zmsg_t *from, void *socket)
+{
+    planmap_iterator it = self->plans.find(self->rx.plan());
+
+    if (!self->rx.has_plan() || (it == self->plans.end())) {
+	note_printf(self->tx, "execute: no such plan: %d", self->rx.plan());
+	self->tx.set_type(machinetalk::MT_HALRCOMMAND_EXECUTE_REJECT);
+	return send_pbcontainer(from, self->tx, socket);
+    }
+    plan_t *plan = it->second;
+    const std::string &values = self->rx.values();
+
+    if (values.size() != plan->size) {
+	note_printf(self->tx,
+		    "execute: plan %d expects %u value bytes, got %zu",
+		    plan->id, plan->size, values.size());
+	self->tx.set_type(machinetalk::MT_HALRCOMMAND_EXECUTE_REJECT);
+	return send_pbcontainer(from, self->tx, socket);
+    }
+    {
+	WITH_HAL_MUTEX();
+
+	for (size_t i = 0; i < plan->entries.size(); i++) {
+	    const plan_entry_t *pe = &plan->entries[i];
+	    if (!entry_current(pe)) {
+		note_printf(self->tx,
+			    "execute: plan %d stale at handle %d - prepare again",
+			    plan->id, pe->id);
+		break;
+	    }
+	}
+	if (self->tx.note_size() == 0) {
+	    const unsigned char *vp = (const unsigned char *) values.data();
+
+	    for (size_t i = 0; i < plan->entries.size(); i++) {
+		const plan_entry_t *pe = &plan->entries[i];
+		__u32 u32;
+		__u64 u64;
+
+		switch (pe->type) {
+		case HAL_BIT:
+		    set_bit_value(pe->vp, *vp != 0);
+		    break;
+		case HAL_S32:
+		    memcpy(&u32, vp, sizeof(u32));
+		    set_s32_value(pe->vp, (hal_s32_t) le32toh(u32));
+		    break;
+		case HAL_U32:
+		    memcpy(&u32, vp, sizeof(u32));
+		    set_u32_value(pe->vp, le32toh(u32));
+		    break;
+		case HAL_S64:
+		    memcpy(&u64, vp, sizeof(u64));
+		    set_s64_value(pe->vp, (hal_s64_t) le64toh(u64));
+		    break;
+		case HAL_U64:
+		    memcpy(&u64, vp, sizeof(u64));
+		    set_u64_value(pe->vp, le64toh(u64));
+		    break;
+		case HAL_FLOAT:
+		    {
+			double d;
+			memcpy(&u64, vp, sizeof(u64));
+			u64 = le64toh(u64);
+			memcpy(&d, &u64, sizeof(d));
+			set_float_value(pe->vp, d);
+		    }
+		    break;
+		default:
+		    break;
+		}
+		vp += pe->size;
+	    }
+	    rtapi_smp_wmb();
+	}
+    }
+    if (self->tx.note_size()) {
+	drop_plan(self, it);
+	self->tx.set_type(machinetalk::MT_HALRCOMMAND_EXECUTE_REJECT);
+	return send_pbcontainer(from, self->tx, socket);
+    }
+
+    // otherwise reply only if explicitly required, like MT_HALRCOMMAND_SET
+    if (self->rx.has_reply_required() && self->rx.reply_required()) {
+	self->tx.set_type(machinetalk::MT_HALRCOMMAND_ACK);
+	return send_pbcontainer(from, self->tx, socket);
+    }
+    return 0;
+}
+
+static int
+process_release(htself_t *self, zmsg_t *from, void *socket)
+{
+    planmap_iterator it = self->plans.find(self->rx.plan());
+
+    if (!self->rx.has_plan() || (it == self->plans.end())) {
+	note_printf(self->tx, "release: no such plan: %d", self->rx.plan());
+	self->tx.set_type(machinetalk::MT_HALRCOMMAND_ERROR);
+	return send_pbcontainer(from, self->tx, socket);
+    }
+    drop_plan(self, it);
+
+    self->tx.set_type(machinetalk::MT_HALRCOMMAND_ACK);
+    return send_pbcontainer(from, self->tx, socket);
+}
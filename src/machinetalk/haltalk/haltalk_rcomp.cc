@@ -34,6 +34,10 @@ add_pins_to_items(const int phase,
           const hal_data_u *vp,
           void *cb_data);
 
+#if ALLOC_COUNT
+static thread_local size_t report_allocs; // ht_allocs at REPORT_BEGIN
+#endif
+
 // handle timer event for a rcomp - report any changes in comp
 int
 handle_rcomp_timer(zloop_t *loop, int timer_id, void *arg)
@@ -44,6 +48,51 @@ handle_rcomp_timer(zloop_t *loop, int timer_id, void *arg)
     return 0;
 }
 
+// send a full update and, if first subscriber, activate scanning
+// runs on the loop the rcomp is reported from
+int
+rcomp_subscribed(rcomp_t *rc)
+{
+    htself_t *self = rc->self;
+    machinetalk::Container &tx = report_tx(self, rc->worker);
+    const char *name = ho_name(rc->cc->comp);
+
+    tx.set_type(machinetalk::MT_HALRCOMP_FULL_UPDATE);
+    tx.set_uuid(self->netopts.proc_uuid, sizeof(self->netopts.proc_uuid));
+    tx.set_serial(rc->serial++);
+    describe_parameters(self, tx);
+    describe_comp(tx, name, name,
+                  report_socket(self, rc->worker, SVC_HALRCOMP));
+
+    if (rc->timer_id < 0) { // not scanning
+        rc->timer_id = zloop_timer(report_loop(self, rc->worker), rc->msec, 0,
+                                   handle_rcomp_timer, (void *)rc);
+        assert(rc->timer_id > -1);
+        rtapi_print_msg(RTAPI_MSG_DBG,
+                        "%s: start scanning comp %s, tid=%d, %d mS, %d pins tracked,"
+                        " worker %d",
+                        self->cfg->progname, name, rc->timer_id, rc->msec,
+                        rc->cc->n_pins, rc->worker ? rc->worker->index : -1);
+    }
+    return 0;
+}
+
+// last subscriber gone - stop scanning
+int
+rcomp_unsubscribed(rcomp_t *rc)
+{
+    htself_t *self = rc->self;
+
+    if (rc->timer_id > -1) {  // currently scanning
+        rtapi_print_msg(RTAPI_MSG_DBG, "%s: stop scanning comp %s, tid=%d",
+                        self->cfg->progname, ho_name(rc->cc->comp), rc->timer_id);
+        int retval = zloop_timer_end(report_loop(self, rc->worker), rc->timer_id);
+        assert(retval == 0);
+        rc->timer_id = -1;
+    }
+    return 0;
+}
+
 // handle message input on the XPUB channel, these would be:
 //    subscribe events (\001<topic>), for every subscribe
 //    unsubscribe events (\001<topic>), for the last unsubscribe
@@ -85,30 +134,19 @@ handle_rcomp_input(zloop_t *loop, zsock_t *socket, void *arg)
         } else {
         // compiled component found, schedule a full update
         rcomp_t *g = self->rcomps[topic];
-        self->tx.set_type(machinetalk::MT_HALRCOMP_FULL_UPDATE);
-        self->tx.set_uuid(self->netopts.proc_uuid, sizeof(self->netopts.proc_uuid));
-        self->tx.set_serial(g->serial++);
-        describe_parameters(self);
-        describe_comp(self, topic, topic, socket);
-
-        // first subscriber - activate scanning
-        if (g->timer_id < 0) { // not scanning
-            g->timer_id = zloop_timer(self->netopts.z_loop, g->msec, 0,
-                          handle_rcomp_timer, (void *)g);
-            assert(g->timer_id > -1);
-            rtapi_print_msg(RTAPI_MSG_DBG,
-                    "%s: start scanning comp %s, tid=%d, %d mS, %d pins tracked",
-                    self->cfg->progname, topic, g->timer_id, g->msec, g->cc->n_pins);
-        }
+        if (g->worker)
+            zsock_send(g->worker->actor, "sp", "RSUB", g);
+        else
+            rcomp_subscribed(g);
 
         if (g->cc->comp->state == COMP_UNBOUND) {
             // once only by first subscriber
             hal_bind(topic);
-            rtapi_print_msg(RTAPI_MSG_DBG, "%s: %s bound, serial=%d",
-                    self->cfg->progname, topic, g->serial);
+            rtapi_print_msg(RTAPI_MSG_DBG, "%s: %s bound",
+                    self->cfg->progname, topic);
         } else
-            rtapi_print_msg(RTAPI_MSG_DBG, "%s: %s subscribed, serial=%d",
-                    self->cfg->progname, topic, g->serial);
+            rtapi_print_msg(RTAPI_MSG_DBG, "%s: %s subscribed",
+                    self->cfg->progname, topic);
         }
         break;
 
@@ -118,13 +156,10 @@ handle_rcomp_input(zloop_t *loop, zsock_t *socket, void *arg)
         rcomp_t *g = self->rcomps[topic];
 
         // stop the scanning timer
-        if (g->timer_id > -1) {  // currently scanning
-            rtapi_print_msg(RTAPI_MSG_DBG, "%s: stop scanning comp %s, tid=%d",
-                    self->cfg->progname, topic, g->timer_id);
-            retval = zloop_timer_end (loop, g->timer_id);
-            assert(retval == 0);
-            g->timer_id = -1;
-        }
+        if (g->worker)
+            zsock_send(g->worker->actor, "sp", "RUNSUB", g);
+        else
+            rcomp_unsubscribed(g);
         hal_unbind(topic);
         rtapi_print_msg(RTAPI_MSG_DBG, "%s: %s unbound",
                 self->cfg->progname, topic);
@@ -195,6 +230,7 @@ static int scan_component(hal_object_ptr o, foreach_args_t *args)
         rc->serial = 0;
         rc->msec = msec;
         rc->timer_id = -1; // invalid
+        rc->worker = assign_worker(self, cc->n_pins);
 
         self->rcomps[name] = rc; // all prepared, timer not yet started
 
@@ -292,18 +328,22 @@ comp_report_cb(const int phase,
 {
     rcomp_t *rc = (rcomp_t *) cb_data;
     htself_t *self =  rc->self;
+    machinetalk::Container &tx = report_tx(self, rc->worker);
     machinetalk::Pin *p;
     int retval;
 
     switch (phase) {
 
     case REPORT_BEGIN:	// report initialisation
-    self->tx.set_type(machinetalk::MT_HALRCOMP_INCREMENTAL_UPDATE);
-    self->tx.set_serial(rc->serial++);
+    tx.set_type(machinetalk::MT_HALRCOMP_INCREMENTAL_UPDATE);
+    tx.set_serial(rc->serial++);
+#if ALLOC_COUNT
+    report_allocs = ht_allocs;
+#endif
     break;
 
     case REPORT_PIN: // per-reported-pin action
-    p = self->tx.add_pin();
+    p = tx.add_pin();
     p->set_handle(ho_id(pin));
     if (hal_pin2pb((hal_pin_t *)pin, p))
         rtapi_print_msg(RTAPI_MSG_ERR, "bad type %d for pin '%s'\n",
@@ -312,9 +352,15 @@ comp_report_cb(const int phase,
 
     case REPORT_END: // finalize & send
     retval = send_pbcontainer(ho_name(cc->comp),
-                  self->tx,
-                  self->mksock[SVC_HALRCOMP].socket);
+                  tx,
+                  report_socket(self, rc->worker, SVC_HALRCOMP));
     assert(retval == 0);
+#if ALLOC_COUNT
+    if (self->cfg->debug)
+        rtapi_print_msg(RTAPI_MSG_DBG, "%s: rcomp %s report %d: %zu allocations",
+                        self->cfg->progname, ho_name(cc->comp),
+                        rc->serial - 1, ht_allocs - report_allocs);
+#endif
     break;
     }
     return 0;
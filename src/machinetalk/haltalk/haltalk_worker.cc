@@ -0,0 +1,295 @@
+// reporting workers
+//
+// with all groups and rcomps on the main zloop, scanning and
+// serialising one large group delays every other group's timer as
+// well as command replies. With WORKERS=n (or --workers n) groups and
+// rcomps are sharded across n threads instead, each running its own
+// zloop with the scan timers, a Container to serialise into and PUB
+// sockets to publish on.
+//
+// The halgroup and halrcomp XPUB sockets stay with the main loop since
+// their subscribe events drive scanning and binding. The workers' PUB
+// sockets connect to an inproc XSUB per service on the main loop which
+// forwards every message unchanged to the XPUB - a zero-copy hand over
+// of already serialised frames. Subscribe and unsubscribe events are
+// passed to the owning worker through its actor pipe, so full updates,
+// incremental updates and serials of one group stay in one thread.
+// The shared memory snapshot timers of groups run there as well.
+//
+// A PUB socket drops whatever it sends before the XSUB's subscription
+// reached it, which would lose the first full update of a group.
+// start_workers() therefore has every worker publish probes until one
+// arrived at each forwarder before any group or rcomp is handed over.
+
+#include "haltalk.hh"
+
+static const char *group_fwd_uri = "inproc://haltalk.halgroup";
+static const char *rcomp_fwd_uri = "inproc://haltalk.halrcomp";
+
+#define PROBE_MSEC  10	// wait for probes per round
+#define PROBE_TRIES 500	// rounds before giving up on the workers
+
+static void worker_actor(zsock_t *pipe, void *arg);
+static int handle_worker_pipe(zloop_t *loop, zsock_t *pipe, void *arg);
+static int handle_forward(zloop_t *loop, zsock_t *xsub, void *arg);
+static zsock_t *forwarder(htself_t *self, const char *uri, int svc);
+static int workers_ready(htself_t *self);
+static int probe_index(zmsg_t *msg);
+static void send_probe(htworker_t *w);
+
+int
+start_workers(htself_t *self)
+{
+    if (self->cfg->workers < 1)
+	return 0;
+
+    self->group_xsub = forwarder(self, group_fwd_uri, SVC_HALGROUP);
+    self->rcomp_xsub = forwarder(self, rcomp_fwd_uri, SVC_HALRCOMP);
+    if (!(self->group_xsub && self->rcomp_xsub))
+	return -1;
+
+    for (int i = 0; i < self->cfg->workers; i++) {
+	htworker_t *w = new htworker_t();
+	w->self = self;
+	w->index = i;
+	w->load = 0;
+	w->actor = zactor_new(worker_actor, w);
+	assert(w->actor);
+	self->workers.push_back(w);
+    }
+    if (workers_ready(self)) {
+	rtapi_print_msg(RTAPI_MSG_ERR,
+			"%s: reporting workers not connected after %d mS",
+			self->cfg->progname, PROBE_MSEC * PROBE_TRIES);
+	return -1;
+    }
+
+    // shard groups and rcomps adopted before the workers existed
+    for (groupmap_iterator gi = self->groups.begin();
+	 gi != self->groups.end(); gi++) {
+	group_t *g = gi->second;
+	if (g->worker == NULL)
+	    g->worker = assign_worker(self, g->cg->n_members);
+    }
+    for (compmap_iterator ci = self->rcomps.begin();
+	 ci != self->rcomps.end(); ci++) {
+	rcomp_t *rc = ci->second;
+	if ((rc->worker == NULL) && rc->cc)
+	    rc->worker = assign_worker(self, rc->cc->n_pins);
+    }
+    rtapi_print_msg(RTAPI_MSG_DBG, "%s: %d reporting workers started",
+		    self->cfg->progname, self->cfg->workers);
+    return 0;
+}
+
+// terminate the workers - their scan timers end with their loops
+int
+stop_workers(htself_t *self)
+{
+    for (size_t i = 0; i < self->workers.size(); i++) {
+	htworker_t *w = self->workers[i];
+	zactor_destroy(&w->actor);
+	delete w;
+    }
+    self->workers.clear();
+
+    for (groupmap_iterator gi = self->groups.begin();
+	 gi != self->groups.end(); gi++) {
+	gi->second->worker = NULL;
+	gi->second->timer_id = -1;
+	gi->second->snap_timer_id = -1;
+    }
+    for (compmap_iterator ci = self->rcomps.begin();
+	 ci != self->rcomps.end(); ci++) {
+	ci->second->worker = NULL;
+	ci->second->timer_id = -1;
+    }
+    if (self->group_xsub)
+	zsock_destroy(&self->group_xsub);
+    if (self->rcomp_xsub)
+	zsock_destroy(&self->rcomp_xsub);
+    return 0;
+}
+
+// pick the least loaded worker for a group or rcomp reporting 'load'
+// signals or pins; NULL if reporting from the main loop
+htworker_t *
+assign_worker(htself_t *self, int load)
+{
+    htworker_t *best = NULL;
+
+    for (size_t i = 0; i < self->workers.size(); i++) {
+	htworker_t *w = self->workers[i];
+	if ((best == NULL) || (w->load < best->load))
+	    best = w;
+    }
+    if (best)
+	best->load += (load > 0) ? load : 1;
+    return best;
+}
+
+// ----- end of public functions ---
+
+// probe each worker until one of its probes arrived at both forwarders
+static int
+workers_ready(htself_t *self)
+{
+    size_t n = self->workers.size(), ready = 0;
+    std::vector<int> seen(n, 0); // 1: halgroup, 2: halrcomp arrived
+    zpoller_t *poller = zpoller_new(self->group_xsub, self->rcomp_xsub, NULL);
+    assert(poller);
+
+    for (int tries = 0; (ready < n) && (tries < PROBE_TRIES); tries++) {
+	for (size_t i = 0; i < n; i++)
+	    if (seen[i] != 3)
+		zsock_send(self->workers[i]->actor, "sp", "PROBE", NULL);
+
+	zsock_t *which;
+	while ((which = (zsock_t *) zpoller_wait(poller, PROBE_MSEC)) != NULL) {
+	    zmsg_t *msg = zmsg_recv(which);
+	    int i = msg ? probe_index(msg) : -1;
+	    int bit = (which == self->group_xsub) ? 1 : 2;
+
+	    if ((i > -1) && ((size_t) i < n) && !(seen[i] & bit)) {
+		seen[i] |= bit;
+		if (seen[i] == 3)
+		    ready++;
+	    }
+	    zmsg_destroy(&msg);
+	}
+    }
+    zpoller_destroy(&poller);
+    return (ready == n) ? 0 : -1;
+}
+
+// a probe is an empty topic frame and the worker index - groups and
+// rcomps all have names; -1 if msg is not a probe
+static int
+probe_index(zmsg_t *msg)
+{
+    zframe_t *f = zmsg_first(msg);
+
+    if ((zmsg_size(msg) != 2) || (zframe_size(f) > 0))
+	return -1;
+    char *s = zframe_strdup(zmsg_next(msg));
+    int index = atoi(s);
+    free(s);
+    return index;
+}
+
+static void
+send_probe(htworker_t *w)
+{
+    zsock_send(w->group_pub, "si", "", w->index);
+    zsock_send(w->rcomp_pub, "si", "", w->index);
+}
+
+static zsock_t *
+forwarder(htself_t *self, const char *uri, int svc)
+{
+    zsock_t *xsub = zsock_new(ZMQ_XSUB);
+    assert(xsub);
+    zsock_set_linger(xsub, 0);
+    if (zsock_bind(xsub, "%s", uri) < 0) {
+	rtapi_print_msg(RTAPI_MSG_ERR, "%s: cant bind '%s': %s",
+			self->cfg->progname, uri, strerror(errno));
+	zsock_destroy(&xsub);
+	return NULL;
+    }
+    // subscribe to everything the workers publish
+    zframe_t *f = zframe_new("\001", 1);
+    zframe_send(&f, xsub, 0);
+
+    zloop_reader(self->netopts.z_loop, xsub, handle_forward,
+		 self->mksock[svc].socket);
+    return xsub;
+}
+
+static int
+handle_forward(zloop_t *loop, zsock_t *xsub, void *arg)
+{
+    zmsg_t *msg = zmsg_recv(xsub);
+
+    if (msg && (probe_index(msg) > -1)) {
+	zmsg_destroy(&msg); // left over from workers_ready()
+	return 0;
+    }
+    if (msg && zmsg_send(&msg, arg)) {
+	rtapi_print_msg(RTAPI_MSG_ERR, "forward: zmsg_send(): %s",
+			strerror(errno));
+	zmsg_destroy(&msg);
+    }
+    return 0;
+}
+
+static void
+worker_actor(zsock_t *pipe, void *arg)
+{
+    htworker_t *w = (htworker_t *) arg;
+    htself_t *self = w->self;
+    int retval;
+
+    w->loop = zloop_new();
+    assert(w->loop);
+
+    w->group_pub = zsock_new(ZMQ_PUB);
+    assert(w->group_pub);
+    zsock_set_linger(w->group_pub, 0);
+    retval = zsock_connect(w->group_pub, "%s", group_fwd_uri);
+    assert(retval == 0);
+
+    w->rcomp_pub = zsock_new(ZMQ_PUB);
+    assert(w->rcomp_pub);
+    zsock_set_linger(w->rcomp_pub, 0);
+    retval = zsock_connect(w->rcomp_pub, "%s", rcomp_fwd_uri);
+    assert(retval == 0);
+
+    zloop_reader(w->loop, pipe, handle_worker_pipe, w);
+    zsock_signal(pipe, 0);
+
+    rtapi_print_msg(RTAPI_MSG_DBG, "%s: worker %d startup",
+		    self->cfg->progname, w->index);
+
+    zloop_start(w->loop);
+
+    zloop_destroy(&w->loop);
+    zsock_destroy(&w->group_pub);
+    zsock_destroy(&w->rcomp_pub);
+
+    rtapi_print_msg(RTAPI_MSG_DBG, "%s: worker %d exit",
+		    self->cfg->progname, w->index);
+}
+
+// commands from the main loop: "GSUB"/"GUNSUB"/"GSNAP" <group_t *>,
+// "RSUB"/"RUNSUB" <rcomp_t *>, "PROBE" from start_workers() and
+// zactor_destroy()'s "$TERM"
+static int
+handle_worker_pipe(zloop_t *loop, zsock_t *pipe, void *arg)
+{
+    char *cmd = NULL;
+    void *ptr = NULL;
+    int retval = 0;
+
+    if (zsock_recv(pipe, "sp", &cmd, &ptr))
+	return -1; // interrupted
+
+    if (streq(cmd, "$TERM"))
+	retval = -1;
+    else if (streq(cmd, "GSUB"))
+	group_subscribed((group_t *) ptr);
+    else if (streq(cmd, "GUNSUB"))
+	group_unsubscribed((group_t *) ptr);
+    else if (streq(cmd, "GSNAP"))
+	group_snapshot_start((group_t *) ptr);
+    else if (streq(cmd, "RSUB"))
+	rcomp_subscribed((rcomp_t *) ptr);
+    else if (streq(cmd, "RUNSUB"))
+	rcomp_unsubscribed((rcomp_t *) ptr);
+    else if (streq(cmd, "PROBE"))
+	send_probe((htworker_t *) arg);
+    else
+	rtapi_print_msg(RTAPI_MSG_ERR, "worker: unknown command '%s'", cmd);
+
+    zstr_free(&cmd);
+    return retval;
+}
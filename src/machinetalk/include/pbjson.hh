@@ -0,0 +1,32 @@
+/*
+ * compiled protobuf <-> JSON codec
+ *
+ * Produces and accepts the same JSON as pb2json()/json2pb() (see
+ * json2pb.hh), but instead of walking the descriptors through reflection
+ * and building a jansson tree for every message, a codec table is
+ * compiled once per message type - field keys preformatted, value kinds
+ * resolved, submessage tables linked - and JSON is written directly into
+ * a caller supplied buffer, or parsed directly into the message.
+ *
+ * Both functions are thread safe and throw std::exception on error.
+ */
+
+#ifndef __PBJSON_H__
+#define __PBJSON_H__
+
+#include <string>
+
+namespace google {
+namespace protobuf {
+class Message;
+}
+}
+
+// replace the contents of out by msg as JSON - reuse out to avoid
+// reallocating it for every message
+void pbjson_encode(const google::protobuf::Message &msg, std::string &out);
+
+// merge the JSON object in buf into msg; msg is cleared on error
+void pbjson_decode(google::protobuf::Message &msg, const char *buf, size_t size);
+
+#endif//__PBJSON_H__
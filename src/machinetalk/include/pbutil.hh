@@ -29,6 +29,9 @@ typedef ::google::protobuf::RepeatedPtrField< ::std::string> pbstringarray_t;
 // send a protobuf - encoded Container message
 // optionally prepend destination field
 // log any failure to RTAPI
+// the Container is Clear()'d afterwards - keep it around and reuse it,
+// Clear() retains submessages and string buffers for the next message.
+// The encoded message is sent zero-copy from a pool of buffers.
 int send_pbcontainer(const std::string &dest, machinetalk::Container &c, void *socket);
 int send_pbcontainer(zmsg_t *dest, machinetalk::Container &c, void *socket);
 
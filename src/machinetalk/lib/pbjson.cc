@@ -0,0 +1,868 @@
+/*
+ * compiled protobuf <-> JSON codec, see pbjson.hh
+ *
+ * The JSON is the one pb2json()/json2pb() produce and accept, down to the
+ * byte: jansson's default dump format (", " and ": " separators), fields
+ * in field number order, doubles as "%.17g" with a '.' or exponent, enums
+ * as numbers, bytes in base64. The decoder follows jansson's grammar and
+ * json2pb's typing rules.
+ */
+
+#include <ctype.h>
+#include <errno.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+
+#include <google/protobuf/message.h>
+#include <google/protobuf/descriptor.h>
+
+#include <pbjson.hh>
+
+#include <algorithm>
+#include <deque>
+#include <mutex>
+#include <stdexcept>
+#include <unordered_map>
+#include <vector>
+
+#if defined(__has_include)
+#if __has_include(<charconv>)
+#include <charconv>
+#endif
+#endif
+#if defined(__cpp_lib_to_chars) && (__cpp_lib_to_chars >= 201611L)
+#define PBJSON_TO_CHARS 1
+#endif
+
+namespace {
+#include "bin2ascii.hh"
+}
+
+using google::protobuf::Message;
+using google::protobuf::Descriptor;
+using google::protobuf::FieldDescriptor;
+using google::protobuf::EnumDescriptor;
+using google::protobuf::EnumValueDescriptor;
+using google::protobuf::Reflection;
+
+#define PBJSON_MAX_DEPTH 2048	// as jansson's JSON_PARSER_MAX_DEPTH
+
+class pbjson_error : public std::exception {
+	std::string _error;
+public:
+	pbjson_error(const std::string &e) : _error(e) {}
+	pbjson_error(const FieldDescriptor *field, const std::string &e) : _error(field->name() + ": " + e) {}
+	virtual ~pbjson_error() throw() {};
+
+	virtual const char *what() const throw () { return _error.c_str(); };
+};
+
+// the codec tables
+
+enum value_kind {
+	K_DOUBLE, K_FLOAT, K_INT64, K_UINT64, K_INT32, K_UINT32,
+	K_BOOL, K_ENUM, K_STRING, K_BYTES, K_MESSAGE
+};
+
+struct codec;
+
+struct field_entry {
+	const FieldDescriptor *field;
+	value_kind kind;
+	bool repeated;
+	std::string key;	// "<name>": - preformatted
+	const codec *sub;	// K_MESSAGE only
+};
+
+struct codec {
+	std::vector<field_entry> fields;		// field->index() order
+	std::vector<const field_entry *> byname;	// sorted by name
+};
+
+static std::mutex codecs_lock;
+static std::unordered_map<const Descriptor *, codec *> codecs;
+
+static value_kind field_kind(const FieldDescriptor *field)
+{
+	switch (field->cpp_type()) {
+	case FieldDescriptor::CPPTYPE_DOUBLE: return K_DOUBLE;
+	case FieldDescriptor::CPPTYPE_FLOAT:  return K_FLOAT;
+	case FieldDescriptor::CPPTYPE_INT64:  return K_INT64;
+	case FieldDescriptor::CPPTYPE_UINT64: return K_UINT64;
+	case FieldDescriptor::CPPTYPE_INT32:  return K_INT32;
+	case FieldDescriptor::CPPTYPE_UINT32: return K_UINT32;
+	case FieldDescriptor::CPPTYPE_BOOL:   return K_BOOL;
+	case FieldDescriptor::CPPTYPE_ENUM:   return K_ENUM;
+	case FieldDescriptor::CPPTYPE_MESSAGE: return K_MESSAGE;
+	case FieldDescriptor::CPPTYPE_STRING:
+	default:
+		return (field->type() == FieldDescriptor::TYPE_BYTES) ? K_BYTES : K_STRING;
+	}
+}
+
+static void put_string(std::string &out, const char *s, const FieldDescriptor *field);
+
+static void make_entry(field_entry &fe, const FieldDescriptor *field)
+{
+	fe.field = field;
+	fe.kind = field_kind(field);
+	fe.repeated = field->is_repeated();
+	fe.key.clear();
+	put_string(fe.key, (field->is_extension() ?
+			    field->full_name() : field->name()).c_str(), field);
+	fe.key.append(": ", 2);
+	fe.sub = 0;
+}
+
+// called with codecs_lock held
+static const codec *compile(const Descriptor *d)
+{
+	std::unordered_map<const Descriptor *, codec *>::iterator it = codecs.find(d);
+	if (it != codecs.end())
+		return it->second;
+
+	// entered before linking submessages, so recursive types terminate
+	codec *c = new codec;
+	codecs[d] = c;
+
+	c->fields.resize(d->field_count());
+	for (int i = 0; i < d->field_count(); i++) {
+		field_entry &fe = c->fields[i];
+		make_entry(fe, d->field(i));
+		if (fe.kind == K_MESSAGE)
+			fe.sub = compile(d->field(i)->message_type());
+		c->byname.push_back(&fe);
+	}
+	std::sort(c->byname.begin(), c->byname.end(),
+		  [](const field_entry *a, const field_entry *b) {
+			  return a->field->name() < b->field->name();
+		  });
+	return c;
+}
+
+static const codec *codec_for(const Descriptor *d)
+{
+	// one message type per thread is the common case
+	static thread_local const Descriptor *last_d;
+	static thread_local const codec *last_c;
+
+	if (d != last_d) {
+		std::lock_guard<std::mutex> guard(codecs_lock);
+		last_c = compile(d);
+		last_d = d;
+	}
+	return last_c;
+}
+
+// an extension field seen at runtime - not part of any table
+static void extension_entry(field_entry &fe, const FieldDescriptor *field)
+{
+	make_entry(fe, field);
+	if (fe.kind == K_MESSAGE) {
+		std::lock_guard<std::mutex> guard(codecs_lock);
+		fe.sub = compile(field->message_type());
+	}
+}
+
+// UTF-8 validation, as jansson's utf8_check_*: length of the sequence at s,
+// 0 if invalid
+static size_t utf8_seq(const unsigned char *s, size_t avail, int32_t *cp)
+{
+	unsigned char c = s[0];
+	size_t len;
+	int32_t v;
+
+	if (c < 0x80) {
+		*cp = c;
+		return 1;
+	}
+	if (c <= 0xC1)
+		return 0;
+	else if (c <= 0xDF) {
+		len = 2;
+		v = c & 0x1F;
+	} else if (c <= 0xEF) {
+		len = 3;
+		v = c & 0x0F;
+	} else if (c <= 0xF4) {
+		len = 4;
+		v = c & 0x07;
+	} else
+		return 0;
+	if (len > avail)
+		return 0;
+	for (size_t i = 1; i < len; i++) {
+		if ((s[i] & 0xC0) != 0x80)
+			return 0;
+		v = (v << 6) | (s[i] & 0x3F);
+	}
+	if ((v > 0x10FFFF) || ((v >= 0xD800) && (v <= 0xDFFF)) ||
+	    ((len == 3) && (v < 0x800)) || ((len == 4) && (v < 0x10000)))
+		return 0;
+	*cp = v;
+	return len;
+}
+
+// encoder
+
+static void put_string(std::string &out, const char *s, const FieldDescriptor *field)
+{
+	static const char hex[] = "0123456789ABCDEF";
+	const unsigned char *p = (const unsigned char *) s;
+	size_t avail = strlen(s);
+	const unsigned char *run = p;
+
+	out += '"';
+	while (avail) {
+		int32_t cp;
+		size_t len = utf8_seq(p, avail, &cp);
+
+		if (len == 0)
+			throw pbjson_error(field, "Fail to convert to json");
+		if ((cp >= 0x20) && (cp != '"') && (cp != '\\')) {
+			p += len;
+			avail -= len;
+			continue;
+		}
+		out.append((const char *) run, p - run);
+		switch (cp) {
+		case '"':  out.append("\\\"", 2); break;
+		case '\\': out.append("\\\\", 2); break;
+		case '\b': out.append("\\b", 2); break;
+		case '\f': out.append("\\f", 2); break;
+		case '\n': out.append("\\n", 2); break;
+		case '\r': out.append("\\r", 2); break;
+		case '\t': out.append("\\t", 2); break;
+		default: {
+			char u[6] = { '\\', 'u', '0', '0', hex[cp >> 4], hex[cp & 0xF] };
+			out.append(u, 6);
+		}
+		}
+		p += len;
+		avail -= len;
+		run = p;
+	}
+	out.append((const char *) run, p - run);
+	out += '"';
+}
+
+static void put_integer(std::string &out, int64_t v)
+{
+	char buf[24], *p = buf + sizeof(buf);
+	uint64_t u = (v < 0) ? -(uint64_t) v : (uint64_t) v;
+
+	do {
+		*--p = '0' + (u % 10);
+		u /= 10;
+	} while (u);
+	if (v < 0)
+		*--p = '-';
+	out.append(p, buf + sizeof(buf) - p);
+}
+
+// as jansson's jsonp_dtostr() at the default precision
+static void put_real(std::string &out, double v, const FieldDescriptor *field)
+{
+	char buf[40];
+
+	if (!isfinite(v))
+		throw pbjson_error(field, "Fail to convert to json");
+#if PBJSON_TO_CHARS
+	// same digits as printf, several times faster
+	int len = std::to_chars(buf, buf + sizeof(buf) - 3, v,
+				std::chars_format::general, 17).ptr - buf;
+	buf[len] = '\0';
+#else
+	int len = snprintf(buf, sizeof(buf) - 2, "%.17g", v);
+	char *dot = strchr(buf, ',');	// a locale decimal point
+	if (dot)
+		*dot = '.';
+#endif
+	if (!strchr(buf, '.') && !strchr(buf, 'e')) {
+		buf[len++] = '.';
+		buf[len++] = '0';
+		buf[len] = '\0';
+	}
+	// no '+' and no leading zeros in the exponent
+	char *start = strchr(buf, 'e');
+	if (start) {
+		start++;
+		char *end = start + 1;
+		if (*start == '-')
+			start++;
+		while (*end == '0')
+			end++;
+		if (end != start) {
+			memmove(start, end, len - (end - buf) + 1);
+			len -= end - start;
+		}
+	}
+	out.append(buf, len);
+}
+
+static void encode_message(const codec *c, const Message &msg, std::string &out);
+
+static void encode_value(const field_entry &fe, const Message &msg,
+			 const Reflection *ref, int index, std::string &out)
+{
+	const FieldDescriptor *field = fe.field;
+
+	switch (fe.kind) {
+#define _ENCODE(kind, put, sfunc, afunc)				\
+	case kind:							\
+		put((fe.repeated) ?					\
+		    ref->afunc(msg, field, index) :			\
+		    ref->sfunc(msg, field));				\
+		break;
+
+#define _INT(v) put_integer(out, (int64_t) (v))
+#define _REAL(v) put_real(out, (double) (v), field)
+#define _BOOL(v) ((v) ? out.append("true", 4) : out.append("false", 5))
+
+	_ENCODE(K_DOUBLE, _REAL, GetDouble, GetRepeatedDouble);
+	_ENCODE(K_FLOAT, _REAL, GetFloat, GetRepeatedFloat);
+	_ENCODE(K_INT64, _INT, GetInt64, GetRepeatedInt64);
+	_ENCODE(K_UINT64, _INT, GetUInt64, GetRepeatedUInt64);
+	_ENCODE(K_INT32, _INT, GetInt32, GetRepeatedInt32);
+	_ENCODE(K_UINT32, _INT, GetUInt32, GetRepeatedUInt32);
+	_ENCODE(K_BOOL, _BOOL, GetBool, GetRepeatedBool);
+	_ENCODE(K_ENUM, _INT, GetEnumValue, GetRepeatedEnumValue);
+#undef _BOOL
+#undef _REAL
+#undef _INT
+#undef _ENCODE
+
+	case K_STRING:
+	case K_BYTES: {
+		std::string scratch;
+		const std::string &value = (fe.repeated) ?
+			ref->GetRepeatedStringReference(msg, field, index, &scratch) :
+			ref->GetStringReference(msg, field, &scratch);
+		if (fe.kind == K_BYTES)
+			put_string(out, b64_encode(value).c_str(), field);
+		else
+			put_string(out, value.c_str(), field);
+		break;
+	}
+	case K_MESSAGE:
+		encode_message(fe.sub, (fe.repeated) ?
+			       ref->GetRepeatedMessage(msg, field, index) :
+			       ref->GetMessage(msg, field), out);
+		break;
+	}
+}
+
+static void encode_field(const field_entry &fe, const Message &msg,
+			 const Reflection *ref, std::string &out)
+{
+	out.append(fe.key);
+	if (fe.repeated) {
+		int count = ref->FieldSize(msg, fe.field);
+		out += '[';
+		for (int i = 0; i < count; i++) {
+			if (i)
+				out.append(", ", 2);
+			encode_value(fe, msg, ref, i, out);
+		}
+		out += ']';
+	} else
+		encode_value(fe, msg, ref, -1, out);
+}
+
+static void encode_message(const codec *c, const Message &msg, std::string &out)
+{
+	// the fields set, per nesting level: ListFields() walks the has-bits,
+	// much cheaper than asking HasField() for every field of a Container
+	static thread_local std::deque<std::vector<const FieldDescriptor *> > present;
+	static thread_local size_t depth;
+
+	const Reflection *ref = msg.GetReflection();
+	if (present.size() <= depth)
+		present.resize(depth + 1);
+	std::vector<const FieldDescriptor *> &fields = present[depth];
+	fields.clear();
+	ref->ListFields(msg, &fields);
+
+	depth++;
+	out += '{';
+	try {
+		for (size_t i = 0; i < fields.size(); i++) {
+			if (i)
+				out.append(", ", 2);
+			if (fields[i]->is_extension()) {
+				field_entry fe;
+				extension_entry(fe, fields[i]);
+				encode_field(fe, msg, ref, out);
+			} else
+				encode_field(c->fields[fields[i]->index()], msg, ref, out);
+		}
+	} catch (...) {
+		depth--;
+		throw;
+	}
+	out += '}';
+	depth--;
+}
+
+void pbjson_encode(const Message &msg, std::string &out)
+{
+	out.clear();
+	encode_message(codec_for(msg.GetDescriptor()), msg, out);
+}
+
+// decoder
+
+namespace {
+
+enum token { T_OBJECT, T_ARRAY, T_STRING, T_NUMBER, T_TRUE, T_FALSE, T_NULL };
+
+struct parser {
+	const char *start, *p, *end;
+	int depth;
+	std::string str;	// last string scanned
+	bool integer;		// last number scanned
+	int64_t ival;
+	double rval;
+
+	parser(const char *buf, size_t size) :
+		start(buf), p(buf), end(buf + size), depth(0), integer(false),
+		ival(0), rval(0.0) {}
+
+	[[noreturn]] void fail(const char *what)
+	{
+		char buf[120];
+		snprintf(buf, sizeof(buf), "Load failed: %s near position %d",
+			 what, (int) (p - start));
+		throw pbjson_error(buf);
+	}
+
+	void ws()
+	{
+		while ((p < end) && ((*p == ' ') || (*p == '\t') ||
+				     (*p == '\n') || (*p == '\r')))
+			p++;
+	}
+
+	bool accept(char c)
+	{
+		ws();
+		if ((p < end) && (*p == c)) {
+			p++;
+			return true;
+		}
+		return false;
+	}
+
+	void expect(char c, const char *what)
+	{
+		if (!accept(c))
+			fail(what);
+	}
+
+	// classify the next value without consuming it
+	token peek()
+	{
+		ws();
+		if (p >= end)
+			fail("unexpected end of input");
+		switch (*p) {
+		case '{': return T_OBJECT;
+		case '[': return T_ARRAY;
+		case '"': return T_STRING;
+		case 't': return T_TRUE;
+		case 'f': return T_FALSE;
+		case 'n': return T_NULL;
+		default:
+			if ((*p == '-') || ((*p >= '0') && (*p <= '9')))
+				return T_NUMBER;
+			fail("invalid token");
+		}
+	}
+
+	void literal(const char *word)
+	{
+		size_t len = strlen(word);
+		if (((size_t) (end - p) < len) || memcmp(p, word, len) ||
+		    ((p + len < end) && isalpha((unsigned char) p[len])))
+			fail("invalid token");
+		p += len;
+	}
+
+	int hex4()
+	{
+		int v = 0;
+		if (end - p < 4)
+			fail("invalid escape");
+		for (int i = 0; i < 4; i++) {
+			char c = *p++;
+			v <<= 4;
+			if ((c >= '0') && (c <= '9'))	   v |= c - '0';
+			else if ((c >= 'a') && (c <= 'f')) v |= c - 'a' + 10;
+			else if ((c >= 'A') && (c <= 'F')) v |= c - 'A' + 10;
+			else fail("invalid escape");
+		}
+		return v;
+	}
+
+	void put_utf8(int32_t cp)
+	{
+		if (cp < 0x80)
+			str += (char) cp;
+		else if (cp < 0x800) {
+			str += (char) (0xC0 | (cp >> 6));
+			str += (char) (0x80 | (cp & 0x3F));
+		} else if (cp < 0x10000) {
+			str += (char) (0xE0 | (cp >> 12));
+			str += (char) (0x80 | ((cp >> 6) & 0x3F));
+			str += (char) (0x80 | (cp & 0x3F));
+		} else {
+			str += (char) (0xF0 | (cp >> 18));
+			str += (char) (0x80 | ((cp >> 12) & 0x3F));
+			str += (char) (0x80 | ((cp >> 6) & 0x3F));
+			str += (char) (0x80 | (cp & 0x3F));
+		}
+	}
+
+	// scan a string into str
+	void string()
+	{
+		expect('"', "string expected");
+		str.clear();
+		for (;;) {
+			const char *run = p;
+			while ((p < end) && (*p != '"') && (*p != '\\') &&
+			       ((unsigned char) *p >= 0x20) &&
+			       ((unsigned char) *p < 0x80))
+				p++;
+			str.append(run, p - run);
+			if (p >= end)
+				fail("premature end of input");
+
+			unsigned char c = *p;
+			if (c == '"') {
+				p++;
+				return;
+			}
+			if (c < 0x20)
+				fail("control character in string");
+			if (c >= 0x80) {
+				int32_t cp;
+				size_t len = utf8_seq((const unsigned char *) p, end - p, &cp);
+				if (len == 0)
+					fail("invalid UTF-8");
+				str.append(p, len);
+				p += len;
+				continue;
+			}
+			// backslash
+			if (++p >= end)
+				fail("premature end of input");
+			switch (*p++) {
+			case '"':  str += '"'; break;
+			case '\\': str += '\\'; break;
+			case '/':  str += '/'; break;
+			case 'b':  str += '\b'; break;
+			case 'f':  str += '\f'; break;
+			case 'n':  str += '\n'; break;
+			case 'r':  str += '\r'; break;
+			case 't':  str += '\t'; break;
+			case 'u': {
+				int32_t cp = hex4();
+				if ((cp >= 0xD800) && (cp <= 0xDBFF)) {
+					if ((end - p < 2) || (p[0] != '\\') || (p[1] != 'u'))
+						fail("invalid Unicode");
+					p += 2;
+					int32_t lo = hex4();
+					if ((lo < 0xDC00) || (lo > 0xDFFF))
+						fail("invalid Unicode");
+					cp = 0x10000 + (((cp - 0xD800) << 10) | (lo - 0xDC00));
+				} else if ((cp >= 0xDC00) && (cp <= 0xDFFF))
+					fail("invalid Unicode");
+				else if (cp == 0)
+					fail("\\u0000 is not allowed");
+				put_utf8(cp);
+				break;
+			}
+			default:
+				fail("invalid escape");
+			}
+		}
+	}
+
+	// scan a number into integer/ival/rval
+	void number()
+	{
+		const char *s = p;
+		char buf[64];
+
+		integer = true;
+		if ((p < end) && (*p == '-'))
+			p++;
+		if ((p < end) && (*p == '0')) {
+			p++;
+			if ((p < end) && isdigit((unsigned char) *p))
+				fail("invalid token");
+		} else if ((p < end) && isdigit((unsigned char) *p)) {
+			while ((p < end) && isdigit((unsigned char) *p))
+				p++;
+		} else
+			fail("invalid token");
+		if ((p < end) && (*p == '.')) {
+			integer = false;
+			p++;
+			if ((p >= end) || !isdigit((unsigned char) *p))
+				fail("invalid token");
+			while ((p < end) && isdigit((unsigned char) *p))
+				p++;
+		}
+		if ((p < end) && ((*p == 'e') || (*p == 'E'))) {
+			integer = false;
+			p++;
+			if ((p < end) && ((*p == '+') || (*p == '-')))
+				p++;
+			if ((p >= end) || !isdigit((unsigned char) *p))
+				fail("invalid token");
+			while ((p < end) && isdigit((unsigned char) *p))
+				p++;
+		}
+
+		// the buffer is not NUL terminated
+		std::string longnum;
+		const char *text = buf;
+		if ((size_t) (p - s) < sizeof(buf)) {
+			memcpy(buf, s, p - s);
+			buf[p - s] = '\0';
+		} else {
+			longnum.assign(s, p - s);
+			text = longnum.c_str();
+		}
+		errno = 0;
+		if (integer) {
+			ival = strtoll(text, NULL, 10);
+			if (errno == ERANGE)
+				fail((ival < 0) ? "too big negative integer" : "too big integer");
+			rval = (double) ival;
+		} else {
+			rval = strtod(text, NULL);
+			if ((errno == ERANGE) && isinf(rval))
+				fail("real number overflow");
+		}
+	}
+
+	// validate and skip any value
+	void skip()
+	{
+		switch (peek()) {
+		case T_OBJECT:
+			p++;
+			if (++depth > PBJSON_MAX_DEPTH)
+				fail("maximum parsing depth reached");
+			if (!accept('}')) {
+				do {
+					string();
+					expect(':', "':' expected");
+					skip();
+				} while (accept(','));
+				expect('}', "'}' expected");
+			}
+			depth--;
+			break;
+		case T_ARRAY:
+			p++;
+			if (++depth > PBJSON_MAX_DEPTH)
+				fail("maximum parsing depth reached");
+			if (!accept(']')) {
+				do
+					skip();
+				while (accept(','));
+				expect(']', "']' expected");
+			}
+			depth--;
+			break;
+		case T_STRING: string(); break;
+		case T_NUMBER: number(); break;
+		case T_TRUE:   literal("true"); break;
+		case T_FALSE:  literal("false"); break;
+		case T_NULL:   literal("null"); break;
+		}
+	}
+};
+
+} // namespace
+
+static void decode_message(parser &ps, const codec *c, Message &msg);
+
+static const field_entry *lookup(const codec *c, const std::string &name)
+{
+	size_t lo = 0, hi = c->byname.size();
+
+	while (lo < hi) {
+		size_t mid = (lo + hi) / 2;
+		int cmp = c->byname[mid]->field->name().compare(name);
+		if (cmp == 0)
+			return c->byname[mid];
+		if (cmp < 0)
+			lo = mid + 1;
+		else
+			hi = mid;
+	}
+	return 0;
+}
+
+static void decode_value(parser &ps, const field_entry &fe, Message &msg,
+			 const Reflection *ref)
+{
+	const FieldDescriptor *field = fe.field;
+	const bool repeated = fe.repeated;
+	token t = ps.peek();
+
+#define _SET_OR_ADD(sfunc, afunc, value)			\
+	do {							\
+		if (repeated)					\
+			ref->afunc(&msg, field, value);		\
+		else						\
+			ref->sfunc(&msg, field, value);		\
+	} while (0)
+
+	switch (fe.kind) {
+	case K_DOUBLE:
+	case K_FLOAT:
+		if (t != T_NUMBER)
+			throw pbjson_error(field, "Failed to unpack: Expected real or integer");
+		ps.number();
+		if (fe.kind == K_DOUBLE)
+			_SET_OR_ADD(SetDouble, AddDouble, ps.rval);
+		else
+			_SET_OR_ADD(SetFloat, AddFloat, ps.rval);
+		break;
+
+#define _DECODE_INT(kind, ctype, sfunc, afunc)					\
+	case kind:								\
+		if (t == T_NUMBER)						\
+			ps.number();						\
+		if ((t != T_NUMBER) || !ps.integer)				\
+			throw pbjson_error(field, "Failed to unpack: Expected integer"); \
+		_SET_OR_ADD(sfunc, afunc, (ctype) ps.ival);			\
+		break;
+
+	_DECODE_INT(K_INT64, int64_t, SetInt64, AddInt64);
+	_DECODE_INT(K_UINT64, uint64_t, SetUInt64, AddUInt64);
+	_DECODE_INT(K_INT32, int32_t, SetInt32, AddInt32);
+	_DECODE_INT(K_UINT32, uint32_t, SetUInt32, AddUInt32);
+#undef _DECODE_INT
+
+	case K_BOOL:
+		if (t == T_TRUE)
+			ps.literal("true");
+		else if (t == T_FALSE)
+			ps.literal("false");
+		else
+			throw pbjson_error(field, "Failed to unpack: Expected true or false");
+		_SET_OR_ADD(SetBool, AddBool, t == T_TRUE);
+		break;
+
+	case K_STRING:
+	case K_BYTES:
+		if (t != T_STRING)
+			throw pbjson_error(field, "Not a string");
+		ps.string();
+		if (fe.kind == K_BYTES)
+			_SET_OR_ADD(SetString, AddString, b64_decode(ps.str));
+		else
+			_SET_OR_ADD(SetString, AddString, ps.str);
+		break;
+
+	case K_ENUM: {
+		const EnumDescriptor *ed = field->enum_type();
+		const EnumValueDescriptor *ev = 0;
+		if (t == T_NUMBER) {
+			ps.number();
+			if (!ps.integer)
+				throw pbjson_error(field, "Not an integer or string");
+			ev = ed->FindValueByNumber(ps.ival);
+		} else if (t == T_STRING) {
+			ps.string();
+			ev = ed->FindValueByName(ps.str);
+		} else
+			throw pbjson_error(field, "Not an integer or string");
+		if (!ev)
+			throw pbjson_error(field, "Enum value not found");
+		_SET_OR_ADD(SetEnum, AddEnum, ev);
+		break;
+	}
+
+	case K_MESSAGE: {
+		Message *mf = (repeated) ?
+			ref->AddMessage(&msg, field) :
+			ref->MutableMessage(&msg, field);
+		// like json2pb, anything but an object leaves it empty
+		if (t == T_OBJECT)
+			decode_message(ps, fe.sub, *mf);
+		else
+			ps.skip();
+		break;
+	}
+	}
+#undef _SET_OR_ADD
+}
+
+static void decode_message(parser &ps, const codec *c, Message &msg)
+{
+	const Reflection *ref = msg.GetReflection();
+
+	ps.expect('{', "'{' expected");
+	if (++ps.depth > PBJSON_MAX_DEPTH)
+		ps.fail("maximum parsing depth reached");
+	if (ps.accept('}')) {
+		ps.depth--;
+		return;
+	}
+	do {
+		ps.string();
+		ps.expect(':', "':' expected");
+
+		field_entry ext;
+		const field_entry *fe = lookup(c, ps.str);
+		if (!fe) {
+			const FieldDescriptor *field = ref->FindKnownExtensionByName(ps.str);
+			if (!field)
+				throw pbjson_error("Unknown field: " + ps.str);
+			extension_entry(ext, field);
+			fe = &ext;
+		}
+
+		if (fe->repeated) {
+			if (ps.peek() != T_ARRAY)
+				throw pbjson_error(fe->field, "Not array");
+			ps.expect('[', "'[' expected");
+			if (!ps.accept(']')) {
+				do
+					decode_value(ps, *fe, msg, ref);
+				while (ps.accept(','));
+				ps.expect(']', "']' expected");
+			}
+		} else
+			decode_value(ps, *fe, msg, ref);
+	} while (ps.accept(','));
+	ps.expect('}', "'}' expected");
+	ps.depth--;
+}
+
+void pbjson_decode(Message &msg, const char *buf, size_t size)
+{
+	parser ps(buf, size);
+
+	try {
+		if (ps.peek() != T_OBJECT)
+			throw pbjson_error("Malformed JSON: not an object");
+		decode_message(ps, codec_for(msg.GetDescriptor()), msg);
+		ps.ws();
+		if (ps.p != ps.end)
+			ps.fail("end of file expected");
+	} catch (...) {
+		msg.Clear();
+		throw;
+	}
+}
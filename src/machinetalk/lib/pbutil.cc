@@ -19,46 +19,88 @@
 #include "pbutil.hh"
 #include "syslog_async.h"
 #include <czmq.h>
+#include <pthread.h>
 #include <google/protobuf/text_format.h>
 
 // send_pbcontainer: if set, dump container to stderr in TextFormat
 int __attribute__((weak)) print_container;
 
-int
-send_pbcontainer(const std::string &dest, machinetalk::Container &c, void *socket)
+// serialised Containers go out zero-copy in buffers taken from a free
+// list instead of a zframe_new() per message, which under log storms
+// or fast group updates made the allocator the top symbol in perf.
+// libzmq hands a buffer back through pbbuf_release() once sent -
+// possibly from its I/O thread, hence the mutex.
+#define PBBUF_SIZE   4096   // larger messages fall back to malloc()
+#define PBBUF_KEEP   64     // max buffers retained on the free list
+
+typedef struct pbbuf {
+    struct pbbuf *next;
+    unsigned char data[PBBUF_SIZE];
+} pbbuf_t;
+
+static pthread_mutex_t pbbuf_mutex = PTHREAD_MUTEX_INITIALIZER;
+static pbbuf_t *pbbuf_list;
+static int pbbuf_nfree;
+
+static pbbuf_t *
+pbbuf_get(void)
 {
-    int retval = 0;
-    zmsg_t *msg = zmsg_new();
-    zframe_t *d =  zframe_new (dest.c_str(), dest.size());
-    zmsg_append(msg, &d);
-    retval = send_pbcontainer(msg, c, socket);
-    zmsg_destroy(&msg);
-    return retval;
+    pthread_mutex_lock(&pbbuf_mutex);
+    pbbuf_t *pb = pbbuf_list;
+    if (pb) {
+	pbbuf_list = pb->next;
+	pbbuf_nfree--;
+    }
+    pthread_mutex_unlock(&pbbuf_mutex);
+    if (pb == NULL)
+	pb = (pbbuf_t *) malloc(sizeof(pbbuf_t));
+    return pb;
 }
 
-// send_pbcontainer: destination can contain multiple routing points
-int
-send_pbcontainer(zmsg_t *dest, machinetalk::Container &c, void *socket)
+// zmq_free_fn: hint is the pbbuf_t, or NULL for an oversized buffer
+static void
+pbbuf_release(void *data, void *hint)
 {
-    int retval = 0;
-    zframe_t *f;
-    size_t nsize = zmsg_size(dest);
+    pbbuf_t *pb = (pbbuf_t *) hint;
 
+    if (pb == NULL) {
+	free(data);
+	return;
+    }
+    pthread_mutex_lock(&pbbuf_mutex);
+    if (pbbuf_nfree < PBBUF_KEEP) {
+	pb->next = pbbuf_list;
+	pbbuf_list = pb;
+	pbbuf_nfree++;
+	pb = NULL;
+    }
+    pthread_mutex_unlock(&pbbuf_mutex);
+    free(pb);
+}
+
+// serialise c into a pooled buffer and wrap it as a zmq message
+static int
+pack_container(machinetalk::Container &c, zmq_msg_t *msg)
+{
 /* Needed for supporting older versions of Google Protobuf available
  * in Debian Stretch and Ubuntu Bionic */
 #if GOOGLE_PROTOBUF_VERSION >= 3006001
-    f = zframe_new(NULL, c.ByteSizeLong());
+    size_t size = c.ByteSizeLong();
 #else
-    f = zframe_new(NULL, c.ByteSize());
-#endif
-    if (f == NULL) {
-#if GOOGLE_PROTOBUF_VERSION >= 3006001
-    syslog_async(LOG_ERR,"%s: FATAL - failed to zframe_new(%d)",
-			__func__, c.ByteSizeLong());
-#else
-	syslog_async(LOG_ERR,"%s: FATAL - failed to zframe_new(%d)",
-			__func__, c.ByteSize());
+    size_t size = c.ByteSize();
 #endif
+    pbbuf_t *pb = NULL;
+    unsigned char *buf;
+
+    if (size <= PBBUF_SIZE) {
+	pb = pbbuf_get();
+	buf = pb ? pb->data : NULL;
+    } else {
+	buf = (unsigned char *) malloc(size);
+    }
+    if (buf == NULL) {
+	syslog_async(LOG_ERR,"%s: FATAL - failed to allocate %zu bytes",
+		     __func__, size);
 	return -ENOMEM;
     }
     if (print_container) {
@@ -66,19 +108,71 @@ send_pbcontainer(zmsg_t *dest, machinetalk::Container &c, void *socket)
 	google::protobuf::TextFormat::PrintToString(c, &s);
 	fprintf(stderr,"%s: %s\n",__func__,s.c_str());
     }
-    unsigned char *buf = zframe_data(f);
     unsigned char *end = c.SerializeWithCachedSizesToArray(buf);
     if ((end - buf) == 0) {
 	// serialize failed
 	syslog_async(LOG_ERR,"%s: FATAL - SerializeWithCachedSizesToArray() failed",
 			__func__);
+	pbbuf_release(buf, pb);
+	return -1;
+    }
+    zmq_msg_init_data(msg, buf, end - buf, pbbuf_release, pb);
+    return 0;
+}
+
+static int
+send_packed(zmq_msg_t *msg, void *socket)
+{
+    size_t size = zmq_msg_size(msg);
+
+    if (zmq_msg_send(msg, zsock_resolve(socket), 0) < 0) {
+	syslog_async(LOG_ERR,"%s: FATAL - failed to send %zu bytes: %s",
+		     __func__, size, zmq_strerror(errno));
+	zmq_msg_close(msg); // releases the buffer
+	return -1;
+    }
+    return 0;
+}
+
+int
+send_pbcontainer(const std::string &dest, machinetalk::Container &c, void *socket)
+{
+    int retval = 0;
+    zmq_msg_t msg;
+
+    if ((retval = pack_container(c, &msg)))
+	goto DONE;
+
+    if (dest.size() &&
+	(zmq_send(zsock_resolve(socket), dest.data(), dest.size(), ZMQ_SNDMORE) < 0)) {
+	syslog_async(LOG_ERR,"%s: FATAL - failed to send destination frame: '%s'",
+		     __func__, dest.c_str());
+	zmq_msg_close(&msg);
+	retval = -1;
 	goto DONE;
     }
+    retval = send_packed(&msg, socket);
+ DONE:
+    c.Clear();
+    return retval;
+}
+
+// send_pbcontainer: destination can contain multiple routing points
+int
+send_pbcontainer(zmsg_t *dest, machinetalk::Container &c, void *socket)
+{
+    int retval = 0;
+    size_t nsize = zmsg_size(dest);
+    zmq_msg_t msg;
+
+    if ((retval = pack_container(c, &msg)))
+	goto DONE;
 
     for (size_t i = 0; i < nsize; ++i){
-        zframe_t *f = zmsg_pop (dest); 
-	if(f == NULL){                          
+        zframe_t *f = zmsg_pop (dest);
+	if(f == NULL){
 	    syslog_async(LOG_ERR, "send_pbcontainer(): NULL zframe_t 'f' passed");
+	    zmq_msg_close(&msg);
 	    retval = -1;
 	    goto DONE;
 	    }
@@ -88,16 +182,14 @@ send_pbcontainer(zmsg_t *dest, machinetalk::Container &c, void *socket)
                 std::string str( (const char *) zframe_data(f), zframe_size(f));
                 syslog_async(LOG_ERR,"%s: FATAL - failed to send destination frame: '%.*s'",
                              __func__, str.size(), str.c_str());
+                zframe_destroy(&f);
+                zmq_msg_close(&msg);
                 goto DONE;
             }
         }
         zframe_destroy(&f);
     }
-    retval = zframe_send(&f, socket, 0);
-    if (retval) {
-	syslog_async(LOG_ERR,"%s: FATAL - failed to zframe_sendm(%d)",
-			    __func__, end-buf);
-    }
+    retval = send_packed(&msg, socket);
  DONE:
     c.Clear();
     return retval;
@@ -0,0 +1,129 @@
+// compare the compiled pbjson codec with the reflection based
+// pb2json/json2pb on the Container status updates haltalk publishes
+//
+// usage: pbjson_bench [-n signals] [-i iterations]
+//
+// both paths must produce the same JSON and decode to the same message,
+// exits 1 if they do not.
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+
+#include <string>
+
+#include <machinetalk/protobuf/types.pb.h>
+#include <machinetalk/protobuf/object.pb.h>
+#include <machinetalk/protobuf/message.pb.h>
+
+#include <json2pb.hh>
+#include <pbjson.hh>
+
+using namespace machinetalk;
+
+static double now(void)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + ts.tv_nsec * 1e-9;
+}
+
+// a halgroup update as built in haltalk_group.cc, values varying with 'k'
+static void group_update(Container &c, int nsignals, int k, bool full)
+{
+    c.Clear();
+    c.set_type(full ? MT_HALGROUP_FULL_UPDATE : MT_HALGROUP_INCREMENTAL_UPDATE);
+    c.set_serial(k);
+    for (int i = 0; i < nsignals; i++) {
+	Signal *s = c.add_signal();
+	s->set_handle(0x1000 + i);
+	if (full) {
+	    char name[64];
+	    snprintf(name, sizeof(name), "group.sig-%d", i);
+	    s->set_name(name);
+	}
+	switch (i % 4) {
+	case 0: s->set_halfloat((k + i) * 0.001 - 17.25); break;
+	case 1: s->set_halbit((k + i) & 1); break;
+	case 2: s->set_hals32(i * k - 1000); break;
+	case 3: s->set_halu32(i + k); break;
+	}
+    }
+}
+
+int main(int argc, char* argv[])
+{
+    GOOGLE_PROTOBUF_VERIFY_VERSION;
+
+    int nsignals = 50, iterations = 20000, opt;
+
+    while ((opt = getopt(argc, argv, "n:i:")) != -1) {
+	switch (opt) {
+	case 'n': nsignals = atoi(optarg); break;
+	case 'i': iterations = atoi(optarg); break;
+	default:
+	    fprintf(stderr, "usage: %s [-n signals] [-i iterations]\n", argv[0]);
+	    exit(2);
+	}
+    }
+
+    Container c, d1, d2;
+    std::string ref, json;
+    int errors = 0;
+
+    // correctness first, on full and incremental updates
+    for (int k = 0; k < 100; k++) {
+	group_update(c, nsignals, k, k == 0);
+	ref = pb2json(c);
+	pbjson_encode(c, json);
+	if (json != ref) {
+	    fprintf(stderr, "encode mismatch:\n%s\n%s\n", ref.c_str(), json.c_str());
+	    errors++;
+	}
+	d1.Clear();
+	d2.Clear();
+	json2pb(d1, ref.c_str(), ref.size());
+	pbjson_decode(d2, ref.c_str(), ref.size());
+	if (d1.SerializeAsString() != d2.SerializeAsString()) {
+	    fprintf(stderr, "decode mismatch on %s\n", ref.c_str());
+	    errors++;
+	}
+    }
+
+    group_update(c, nsignals, 4711, false);
+    ref = pb2json(c);
+    printf("%d signals, %zu bytes JSON, %d iterations\n",
+	   nsignals, ref.size(), iterations);
+
+    double t0 = now();
+    for (int k = 0; k < iterations; k++) {
+	std::string s = pb2json(c);
+    }
+    double t1 = now();
+    for (int k = 0; k < iterations; k++)
+	pbjson_encode(c, json);
+    double t2 = now();
+    for (int k = 0; k < iterations; k++) {
+	d1.Clear();
+	json2pb(d1, ref.c_str(), ref.size());
+    }
+    double t3 = now();
+    for (int k = 0; k < iterations; k++) {
+	d2.Clear();
+	pbjson_decode(d2, ref.c_str(), ref.size());
+    }
+    double t4 = now();
+
+    printf("encode: pb2json %8.2f us/msg  pbjson %8.2f us/msg  x%.1f\n",
+	   (t1 - t0) * 1e6 / iterations, (t2 - t1) * 1e6 / iterations,
+	   (t1 - t0) / (t2 - t1));
+    printf("decode: json2pb %8.2f us/msg  pbjson %8.2f us/msg  x%.1f\n",
+	   (t3 - t2) * 1e6 / iterations, (t4 - t3) * 1e6 / iterations,
+	   (t3 - t2) / (t4 - t3));
+
+    if (errors)
+	fprintf(stderr, "%d mismatches\n", errors);
+    return errors ? 1 : 0;
+}
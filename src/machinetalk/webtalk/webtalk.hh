@@ -75,11 +75,13 @@ enum wt_log_levels {
 namespace gpb = google::protobuf;
 
 #include <json2pb.hh>
+#include <pbjson.hh>
 #include <jansson.h>
 #include <uriparser/Uri.h>
 
 typedef struct wtself wtself_t;
 typedef struct zws_session_data zws_session_t;
+typedef struct wt_upstream wt_upstream_t;
 
 // policy callback phases
 typedef enum zwscvt_type {
@@ -97,6 +99,13 @@ typedef  int (*zwscvt_cb)(wtself_t *self,         // server instance
 			  zws_session_t *s,       // session
 			  zwscb_type type);       // which callback
 
+// zmq->ws conversion of one message received on a shared upstream
+// returns the frames to send to the websocket, or NULL to drop the message
+// msg must be left intact; the result is shared by all sessions using
+// the same encoder
+typedef zmsg_t *(*wt_encode_cb)(wtself_t *self,
+				zmsg_t *msg);
+
 
 // protocol flags
 typedef enum protocol_flags {
@@ -164,6 +173,18 @@ typedef struct zws_session_data {
     // the policy applied to this session
     zwscvt_cb  policy;
 
+    // shared upstream subscriptions, see webtalk_upstream.cc
+    // a policy which sets encode in ZWS_CONNECTING lets a SUB session
+    // share upstream sockets; zmq->ws traffic then bypasses ZWS_TO_WS
+    wt_encode_cb encode;
+    bool shared;         // socket is NULL, updates come from upstreams
+    zlist_t *upstreams;  // wt_upstream_t * this session is attached to
+    zlist_t *connects;   // resolved connect URIs
+    zlist_t *topics;     // subscribe= topics, attached once established
+    int tows_pending;    // shared frames in wsq_out not yet written
+    int tows_dropped;    // messages dropped because tows_pending was at tows_hwm
+    bool resync;         // dropped updates - request a full update once drained
+
     // stats counters:
     int wsin_bytes, wsin_msgs;
     int wsout_bytes, wsout_msgs;
@@ -201,6 +222,8 @@ typedef struct wtconf {
     bool trap_signals;
     int ipv6;
     int rtapi_instance;
+    int share_upstream;  // SUB sessions share upstream sockets
+    int tows_hwm;        // per-session limit of queued shared frames
 } wtconf_t;
 
 typedef struct wtself {
@@ -213,6 +236,7 @@ typedef struct wtself {
     machinetalk::Container tx; // tx must be Clear()'d after or before use
 
     zlist_t *policies;
+    zhash_t *upstreams;  // "<uri> <topic>" -> wt_upstream_t *
 #ifdef LWS_NEW_API
     struct lws_context *wsctx;
 #else
@@ -257,9 +281,20 @@ const char *zwsmimetype(const char *ext);
 
 // webtalk_jsonpolicy.cc:
 int json_policy(wtself_t *self, zws_session_t *wss, zwscb_type type);
+zmsg_t *json_encode(wtself_t *self, zmsg_t *msg);
 
 // webtalk_defaultpolicy.cc:
 int default_policy(wtself_t *self, zws_session_t *wss, zwscb_type type);
+zmsg_t *raw_encode(wtself_t *self, zmsg_t *msg);
+
+// webtalk_upstream.cc:
+int wt_upstream_attach(wtself_t *self, zws_session_t *wss,
+		       const char *uri, const char *topic);
+int wt_upstream_detach(wtself_t *self, zws_session_t *wss,
+		       const char *uri, const char *topic);
+void wt_upstream_detach_all(wtself_t *self, zws_session_t *wss);
+void wt_upstream_sent(wtself_t *self, zws_session_t *wss);
+void wt_upstream_shutdown(wtself_t *self);
 
 
 // webtalk_plugin.cc:
@@ -26,6 +26,8 @@
 #define RESOLVE_TIMEOUT 3000
 
 static const char *zerconf_dsn(wtself_t *self, const char *service);
+static char *connect_uri(wtself_t *self, const char *value, int fd);
+static int share_subscriptions(wtself_t *self, zws_session_t *wss, int fd);
 
 int default_policy(wtself_t *self,
 		   zws_session_t *wss,
@@ -40,6 +42,7 @@ int default_policy(wtself_t *self,
     case ZWS_CONNECTING:
 	{
 	    const char *identity = NULL;
+	    bool share = true;
 	    wss->txmode = LWS_WRITE_BINARY;
 	    UriQueryListA *q = wss->queryList;
 #ifdef LWS_NEW_API
@@ -56,6 +59,8 @@ int default_policy(wtself_t *self,
 		// here to report errors in-band
 		if (!strcmp(q->key,"text")) wss->txmode = LWS_WRITE_TEXT;
 		if (!strcmp(q->key,"identity")) identity =  q->value;
+		if (!strcmp(q->key,"bind")) share = false;
+		if (!strcmp(q->key,"share") && q->value && !atoi(q->value)) share = false;
 		if (!strcmp(q->key,"type")) {
 		    if (!strcasecmp(q->value,"dealer")) wss->socket_type = ZMQ_DEALER;
 		    if (!strcasecmp(q->value,"sub")) wss->socket_type = ZMQ_SUB;
@@ -71,6 +76,15 @@ int default_policy(wtself_t *self,
 		}
 		q = q->next;
 	    }
+
+	    // a plain subscriber shares the upstream socket with all
+	    // sessions subscribed to the same uri and topic
+	    if ((wss->encode == NULL) && (wss->policy == default_policy))
+		wss->encode = raw_encode;
+	    if (share && (wss->socket_type == ZMQ_SUB) &&
+		(wss->encode != NULL) && self->cfg->share_upstream)
+		return share_subscriptions(self, wss, fd);
+
 	    wss->socket = zsock_new (wss->socket_type);
 	    if (wss->socket == NULL) {
 		lwsl_err("%s %d: cant create ZMQ socket: %s\n",
@@ -107,48 +121,19 @@ int default_policy(wtself_t *self,
 	    int destcount = 0;
 	    while (q != NULL) {
 		if (!strcmp(q->key,"connect")) {
-		    // handle the 'connect=machinekit://<foo>' case
-		    // extract foo, and zeroconf-lookup this subtype
-
-		    if (!strncmp(q->value, MKPREFIX, strlen(MKPREFIX))) {
-			char ipcuri[100];
-			const char *uri;
-
-			const char *service = q->value + strlen(MKPREFIX);
-
-			if (self->netopts.remote) {
-			    lwsl_uri("%s %d: doing zeroconf lookup '%s'\n", __func__, fd,service);
-			    uri = zerconf_dsn(self,service);
-			    if (uri == NULL)
-				return -1;
-			} else {
-			    // assume a local IPC socket
-			    snprintf(ipcuri, sizeof(ipcuri),ZMQIPC_FORMAT,
-				     RUNDIR, 0, service, self->netopts.service_uuid);
-			    uri = ipcuri;
-			}
-
-			lwsl_uri("%s %d: URI= '%s'\n", __func__, fd,uri);
-			if (zsock_connect (wss->socket, uri)) {
-			    lwsl_err("%s %d: cant connect to %s: %s\n",
-				     __func__, fd, uri, strerror(errno));
-			    return -1;
-			} else {
-			    lwsl_uri("%s %d: connect to %s type %d (%s)\n",
-				     __func__, fd, uri, wss->socket_type,
-				     self->netopts.remote ? "zeroconf resolved" : "local IPC");
-			    destcount++;
-			}
-		    } else {
-			lwsl_uri("%s %d: connecting to %s type %d\n",
-				 __func__, fd, q->value, wss->socket_type);
-			if (zsock_connect (wss->socket, q->value)) {
-			    lwsl_err("%s %d: cant connect to %s: %s\n",
-				     __func__, fd, q->value, strerror(errno));
-			    return -1;
-			}
-			destcount++;
+		    char *uri = connect_uri(self, q->value, fd);
+		    if (uri == NULL)
+			return -1;
+		    if (zsock_connect (wss->socket, "%s", uri)) {
+			lwsl_err("%s %d: cant connect to %s: %s\n",
+				 __func__, fd, uri, strerror(errno));
+			free(uri);
+			return -1;
 		    }
+		    lwsl_uri("%s %d: connect to %s type %d\n",
+			     __func__, fd, uri, wss->socket_type);
+		    free(uri);
+		    destcount++;
 		}
 		if (!strcmp(q->key,"bind")) {
 		    if (zsock_bind (wss->socket, q->value) < 0) {
@@ -217,6 +202,10 @@ int default_policy(wtself_t *self,
 	break;
 
     case ZWS_FROM_WS:
+	if (wss->shared) {
+	    lwsl_err("%s: dropping frame sent to a subscribe socket\n", __func__);
+	    return -1;
+	}
 	// ws->zmq: just send as standalone frame.
 	f = zframe_new (wss->buffer, wss->length);
 	lwsl_fromws("%s: %d:'%.*s'\n", __func__, wss->length, wss->length, wss->buffer);
@@ -243,6 +232,76 @@ int default_policy(wtself_t *self,
     return 0;
 }
 
+// zmq->ws for shared upstreams: all frames as they are
+zmsg_t *raw_encode(wtself_t *self, zmsg_t *msg)
+{
+    return zmsg_dup(msg);
+}
+
+// the zmq URI for a connect= argument, resolving the
+// 'connect=machinekit://<foo>' case; the result must be free()'d
+static char *connect_uri(wtself_t *self, const char *value, int fd)
+{
+    if (strncmp(value, MKPREFIX, strlen(MKPREFIX)))
+	return strdup(value);
+
+    // extract foo, and zeroconf-lookup this subtype
+    const char *service = value + strlen(MKPREFIX);
+    char *uri;
+
+    if (self->netopts.remote) {
+	lwsl_uri("%s %d: doing zeroconf lookup '%s'\n", __func__, fd, service);
+	uri = (char *) zerconf_dsn(self, service);
+	if (uri == NULL)
+	    return NULL;
+    } else {
+	// assume a local IPC socket
+	char ipcuri[100];
+	snprintf(ipcuri, sizeof(ipcuri), ZMQIPC_FORMAT,
+		 RUNDIR, 0, service, self->netopts.service_uuid);
+	uri = strdup(ipcuri);
+    }
+    lwsl_uri("%s %d: URI= '%s' (%s)\n", __func__, fd, uri,
+	     self->netopts.remote ? "zeroconf resolved" : "local IPC");
+    return uri;
+}
+
+// a SUB session shares upstreams instead of creating a socket: collect
+// its connect= and subscribe= arguments, register_zmq_poller() attaches
+// it once established
+static int share_subscriptions(wtself_t *self, zws_session_t *wss, int fd)
+{
+    UriQueryListA *q;
+
+    wss->shared = true;
+    wss->connects = zlist_new();
+    zlist_autofree(wss->connects);
+    wss->topics = zlist_new();
+    zlist_autofree(wss->topics);
+
+    for (q = wss->queryList; q != NULL; q = q->next) {
+	if (!strcmp(q->key,"connect")) {
+	    char *uri = connect_uri(self, q->value, fd);
+	    if (uri == NULL)
+		return -1;
+	    zlist_append(wss->connects, uri);
+	    free(uri);
+	}
+	if (!strcmp(q->key,"subscribe")) {
+	    const char *topic = (q->value == NULL) ? "" : q->value;
+	    zlist_append(wss->topics, (void *) topic);
+	    lwsl_uri("%s %d: shared subscribe topic '%s'\n",
+		     __func__, fd, topic);
+	}
+    }
+    if (zlist_size(wss->connects) == 0) {
+	lwsl_err("%s %d: no 'connect' arg given, closing\n",
+		 __func__,fd);
+	return -1;
+    }
+    return 0;
+}
+
 static const char *zerconf_dsn(wtself_t *self, const char *service)
 {
     char subtype[100], match[50];
@@ -11,6 +11,33 @@ using namespace google::protobuf;
 
 #include "webtalk.hh"
 
+static void json_frames(zmsg_t *out, zmsg_t *m, bool skip_topic);
+
+// zmq->ws for shared upstreams: the Containers following the topic
+// frame, as JSON - converted once for all JSON sessions on the upstream
+zmsg_t *json_encode(wtself_t *self, zmsg_t *msg)
+{
+    zmsg_t *out = zmsg_new();
+    json_frames(out, msg, true);
+    if (zmsg_size(out) == 0)
+	zmsg_destroy(&out);
+    return out;
+}
+
+// subscribe/unsubscribe a shared session on all its connect URIs
+static void json_share(wtself_t *self, zws_session_t *wss,
+		       const char *topic, bool subscribe)
+{
+    for (char *uri = (char *) zlist_first(wss->connects);
+	 uri != NULL;
+	 uri = (char *) zlist_next(wss->connects)) {
+	if (subscribe)
+	    wt_upstream_attach(self, wss, uri, topic);
+	else
+	    wt_upstream_detach(self, wss, uri, topic);
+    }
+}
+
 // relay policy to convert to/from JSON as needed
 int
 json_policy(wtself_t *self,
@@ -25,6 +52,8 @@ json_policy(wtself_t *self,
     switch (type) {
 
     case ZWS_CONNECTING:
+	// SUB sessions may share upstreams, converted by json_encode()
+	wss->encode = json_encode;
 	// > 0 indicates: run the default policy ZWS_CONNECTING code
 	return 1;
 	break;
@@ -46,7 +75,7 @@ json_policy(wtself_t *self,
 		// parse from JSON:
 		lwsl_fromws("%s: '%.*s'\n", __func__, wss->length, wss->buffer);
 		try{
-		    json2pb(c, (const char *) wss->buffer, wss->length);
+		    pbjson_decode(c, (const char *) wss->buffer, wss->length);
 
 		    zframe_t *z_pbframe;
 
@@ -77,11 +106,17 @@ json_policy(wtself_t *self,
 			for (int i = 0; i < c.note_size(); i++) {
 				if (c.type() == machinetalk::MT_ZMQ_SUBSCRIBE) {
 				lwsl_fromws("%s: subscribe to '%s'\n", __func__, c.note(i).c_str());
-				zsock_set_subscribe (wss->socket, c.note(i).c_str());
+				if (wss->shared)
+				    json_share(self, wss, c.note(i).c_str(), true);
+				else
+				    zsock_set_subscribe (wss->socket, c.note(i).c_str());
 			    }
 			    if (c.type() == machinetalk::MT_ZMQ_UNSUBSCRIBE) {
 				lwsl_fromws("%s: unsubscribe from '%s'\n", __func__, c.note(i).c_str());
-				zsock_set_unsubscribe (wss->socket, c.note(i).c_str());
+				if (wss->shared)
+				    json_share(self, wss, c.note(i).c_str(), false);
+				else
+				    zsock_set_unsubscribe (wss->socket, c.note(i).c_str());
 			    }
 			}
 			c.Clear();
@@ -93,7 +128,7 @@ json_policy(wtself_t *self,
 				 wss->length, wss->buffer);
 		    }
 		} catch (std::exception &ex) {
-		    lwsl_err("%s from_ws: json2pb exception: %s on '%.*s'\n",
+		    lwsl_err("%s from_ws: pbjson_decode exception: %s on '%.*s'\n",
 			     __func__, ex.what(),wss->length, wss->buffer);
 		}
 
@@ -115,51 +150,15 @@ json_policy(wtself_t *self,
 
     case ZWS_TO_WS:
 	{
+	    zmsg_t *out = zmsg_new();
 	    m = zmsg_recv(wss->socket);
-	    if ((wss->socket_type == ZMQ_SUB) ||
-		(wss->socket_type == ZMQ_XSUB)) {
-
-		// just drop the topic frame
-		f = zmsg_pop (m);
-		zframe_destroy(&f);
-#if 0
-		topic = zmsg_popstr (m);
-		lwsl_tows("%s: { topic = \"%s\"}\n", __func__, topic);
-
-		assert(zstr_sendf(wss->wsq_out, "{ topic = \"%s\"}\n", topic) == 0);
-		free(topic);
-#endif
-	    }
-
-	    while ((f = zmsg_pop (m)) != NULL) {
-		if (!c.ParseFromArray(zframe_data(f), zframe_size(f))) {
-		    char *hex = zframe_strhex(f);
-		    lwsl_err("cant protobuf parse from %s",
-			     hex);
-		    free(hex);
-		    zframe_destroy(&f);
-		    break;
-		}
-		// this breaks - probably needs some MergeFrom* pb method
-		// if (!c.has_topic() && (topic != NULL))
-		//     c.set_topic(topic); // tack on
-
-		try {
-		    std::string json = pb2json(c);
-		    zframe_t *z_jsonframe = zframe_new( json.c_str(), json.size());
-		    lwsl_tows("%s: '%s'\n", __func__, json.c_str());
-		    assert(zframe_send(&z_jsonframe, wss->wsq_out, 0) == 0);
-
-		} catch (std::exception &ex) {
-		    lwsl_err("%s: pb2json exception: %s\n", __func__, ex.what());
-		    std::string text;
-		    if (TextFormat::PrintToString(c, &text))
-			lwsl_err("%s: pb2json exception: %s\n container: %s\n",
-				 __func__, ex.what(), text.c_str());
-		}
-	    }
+	    json_frames(out, m,
+			(wss->socket_type == ZMQ_SUB) ||
+			(wss->socket_type == ZMQ_XSUB));
+	    while ((f = zmsg_pop (out)) != NULL)
+		assert(zframe_send(&f, wss->wsq_out, 0) == 0);
+	    zmsg_destroy(&out);
 	    zmsg_destroy(&m);
-	    c.Clear();
 	}
 	break;
 
@@ -173,3 +172,43 @@ json_policy(wtself_t *self,
 // to make this a proper plug, export plugin descriptor structure here:
 // see webtalk_plugin.cc
 // struct policy policy { "json", json_policy };
+
+// convert the Container frames of m to JSON frames appended to out,
+// optionally dropping the leading topic frame; m is left intact
+static void json_frames(zmsg_t *out, zmsg_t *m, bool skip_topic)
+{
+    machinetalk::Container c;  // once per upstream message, not per session
+    std::string json;          // reused for all frames of m
+    zframe_t *f = zmsg_first(m);
+
+    if (skip_topic && (f != NULL)) {
+	// just drop the topic frame
+	f = zmsg_next(m);
+    }
+
+    for (; f != NULL; f = zmsg_next(m)) {
+	if (!c.ParseFromArray(zframe_data(f), zframe_size(f))) {
+	    char *hex = zframe_strhex(f);
+	    lwsl_err("cant protobuf parse from %s",
+		     hex);
+	    free(hex);
+	    break;
+	}
+	// this breaks - probably needs some MergeFrom* pb method
+	// if (!c.has_topic() && (topic != NULL))
+	//     c.set_topic(topic); // tack on
+
+	try {
+	    pbjson_encode(c, json);
+	    lwsl_tows("%s: '%s'\n", __func__, json.c_str());
+	    zmsg_addmem(out, json.c_str(), json.size());
+
+	} catch (std::exception &ex) {
+	    lwsl_err("%s: pbjson_encode exception: %s\n", __func__, ex.what());
+	    std::string text;
+	    if (TextFormat::PrintToString(c, &text))
+		lwsl_err("%s: pbjson_encode exception: %s\n container: %s\n",
+			 __func__, ex.what(), text.c_str());
+	}
+    }
+}
@@ -98,6 +98,7 @@ mainloop( wtself_t *self)
 #else
     libwebsocket_context_destroy(self->wsctx);
 #endif
+    wt_upstream_shutdown(self);
     syslog_async(LOG_INFO,
 		 "%s: exiting mainloop (%s)\n",
 		 self->cfg->progname,
@@ -216,6 +217,8 @@ read_config(wtconf_t *conf)
     if (flag) conf->info.extensions = libwebsocket_get_internal_extensions();
 #endif
     iniFindInt(inifp, "TIMER", conf->section, &conf->service_timer);
+    iniFindInt(inifp, "SHARE_UPSTREAM", conf->section, &conf->share_upstream);
+    iniFindInt(inifp, "TOWS_HWM", conf->section, &conf->tows_hwm);
 
     str_inidefault(&conf->index_html, inifp, "INDEX_HTML", conf->section);
     str_inidefault(&conf->www_dir, inifp, "WWW_DIR", conf->section);
@@ -313,6 +316,8 @@ int main (int argc, char *argv[])
     conf.info.uid = -1;
     conf.index_html = NULL;
     conf.info.port = PROXY_PORT;
+    conf.share_upstream = 1;
+    conf.tows_hwm = 256;
     // ease debugging with gdb - disable all signal handling
     conf.trap_signals = (getenv("NOSIGHDLR") == NULL);
 
@@ -0,0 +1,303 @@
+// shared upstream subscriptions
+//
+// without sharing, every websocket session with type=sub creates its own
+// SUB socket, so N browsers watching the same haltalk group make haltalk
+// serialize and send every update N times, and webtalk decode it N times.
+//
+// instead, SUB sessions whose policy provides an encoder (see
+// wt_encode_cb in webtalk.hh) attach to an upstream per (uri, topic):
+// one SUB socket, connected and subscribed once, reference counted by
+// the sessions attached to it. Each message received is converted once
+// per encoder and the resulting frames are queued to every attached
+// session's wsq_out pipe.
+//
+// late joiners: attaching to an existing upstream repeats the subscribe
+// on its socket. haltalk sets its XPUB sockets verbose, so it sees the
+// repeated subscription and publishes a full update for the topic -
+// once, to all sessions of that upstream, which is harmless for the
+// ones already in sync. Every attached session holds one subscription
+// on the socket and drops it on detach, so the count libzmq keeps per
+// topic follows the sessions instead of growing with each late joiner.
+//
+// backpressure: a session with tows_hwm frames queued but not yet written
+// to its websocket (a slow client, a choked pipe) drops further messages
+// and is marked for resync. Once it has written everything queued, the
+// subscribe is repeated as for a late joiner and taken back at once, so
+// the full update brings it back to the latest state. The unsubscribe
+// only reaches haltalk when a topic's count drops to zero, so it never
+// does here. A slow client thus sees the latest values
+// instead of a growing backlog, and never holds up the other sessions.
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <unistd.h>
+#include <string.h>
+
+#include "webtalk.hh"
+
+// encoders used for one message - few policies share upstreams
+#define MAX_ENCODERS 4
+
+typedef struct wt_upstream {
+    wtself_t *self;
+    char *key;      // "<uri> <topic>", key in self->upstreams
+    char *uri;
+    char *topic;
+    zsock_t *socket;
+    zlist_t *sessions;  // zws_session_t * attached
+
+    // stats
+    int msgs, bytes;
+    int fanout;     // messages queued to sessions
+    int drops;      // messages dropped by sessions at tows_hwm
+} wt_upstream_t;
+
+static int upstream_readable(zloop_t *loop, zsock_t *socket, void *arg);
+
+static char *upstream_key(const char *uri, const char *topic)
+{
+    size_t len = strlen(uri) + strlen(topic) + 2;
+    char *key = (char *) malloc(len);
+    assert(key != NULL);
+    snprintf(key, len, "%s %s", uri, topic);
+    return key;
+}
+
+static void upstream_destroy(wt_upstream_t **pup)
+{
+    wt_upstream_t *up = *pup;
+
+    lwsl_info("upstream '%s' stats: msgs %d/%d fanout %d drops %d\n",
+	      up->key, up->msgs, up->bytes, up->fanout, up->drops);
+    zloop_reader_end(up->self->netopts.z_loop, up->socket);
+    zsock_destroy(&up->socket);
+    zlist_destroy(&up->sessions);
+    free(up->key);
+    free(up->uri);
+    free(up->topic);
+    free(up);
+    *pup = NULL;
+}
+
+static wt_upstream_t *upstream_new(wtself_t *self, const char *uri,
+				   const char *topic)
+{
+    wt_upstream_t *up = (wt_upstream_t *) zmalloc(sizeof(wt_upstream_t));
+    assert(up != NULL);
+    up->self = self;
+    up->key = upstream_key(uri, topic);
+    up->uri = strdup(uri);
+    up->topic = strdup(topic);
+    up->sessions = zlist_new();
+
+    up->socket = zsock_new(ZMQ_SUB);
+    if (up->socket == NULL) {
+	lwsl_err("%s: cant create ZMQ socket: %s\n",
+		 __func__, strerror(errno));
+	goto fail;
+    }
+    if (self->cfg->ipv6)
+	zsock_set_ipv6 (up->socket, 1);
+    if (zsock_connect(up->socket, "%s", uri)) {
+	lwsl_err("%s: cant connect to %s: %s\n",
+		 __func__, uri, strerror(errno));
+	goto fail;
+    }
+    if (zloop_reader(self->netopts.z_loop, up->socket,
+		     upstream_readable, up)) {
+	lwsl_err("%s: cant watch upstream %s\n", __func__, up->key);
+	goto fail;
+    }
+    lwsl_uri("%s: new upstream '%s'\n", __func__, up->key);
+    return up;
+
+ fail:
+    zsock_destroy(&up->socket);
+    zlist_destroy(&up->sessions);
+    free(up->key);
+    free(up->uri);
+    free(up->topic);
+    free(up);
+    return NULL;
+}
+
+int wt_upstream_attach(wtself_t *self, zws_session_t *wss,
+		       const char *uri, const char *topic)
+{
+    if (self->upstreams == NULL)
+	self->upstreams = zhash_new();
+    if (wss->upstreams == NULL)
+	wss->upstreams = zlist_new();
+
+    char *key = upstream_key(uri, topic);
+    wt_upstream_t *up = (wt_upstream_t *) zhash_lookup(self->upstreams, key);
+    free(key);
+
+    if (up == NULL) {
+	if ((up = upstream_new(self, uri, topic)) == NULL)
+	    return -1;
+	zhash_insert(self->upstreams, up->key, up);
+    } else if (zlist_exists(wss->upstreams, up)) {
+	return 0;
+    }
+    zlist_append(up->sessions, wss);
+    zlist_append(wss->upstreams, up);
+
+    // first subscriber subscribes, later ones ask for a full update
+    zsock_set_subscribe(up->socket, topic);
+    lwsl_uri("%s: session %p on '%s', %d sessions\n",
+	     __func__, wss, up->key, zlist_size(up->sessions));
+    return 0;
+}
+
+static void upstream_release(wtself_t *self, zws_session_t *wss,
+			     wt_upstream_t *up)
+{
+    zlist_remove(up->sessions, wss);
+    zsock_set_unsubscribe(up->socket, up->topic);
+    lwsl_uri("%s: session %p off '%s', %d sessions\n",
+	     __func__, wss, up->key, zlist_size(up->sessions));
+    if (zlist_size(up->sessions) == 0) {
+	zhash_delete(self->upstreams, up->key);
+	upstream_destroy(&up);
+    }
+}
+
+int wt_upstream_detach(wtself_t *self, zws_session_t *wss,
+		       const char *uri, const char *topic)
+{
+    if ((self->upstreams == NULL) || (wss->upstreams == NULL))
+	return -1;
+
+    char *key = upstream_key(uri, topic);
+    wt_upstream_t *up = (wt_upstream_t *) zhash_lookup(self->upstreams, key);
+    free(key);
+
+    if ((up == NULL) || !zlist_exists(wss->upstreams, up))
+	return -1;
+    zlist_remove(wss->upstreams, up);
+    upstream_release(self, wss, up);
+    return 0;
+}
+
+void wt_upstream_detach_all(wtself_t *self, zws_session_t *wss)
+{
+    wt_upstream_t *up;
+
+    if (wss->upstreams == NULL)
+	return;
+    while ((up = (wt_upstream_t *) zlist_pop(wss->upstreams)) != NULL)
+	upstream_release(self, wss, up);
+    zlist_destroy(&wss->upstreams);
+}
+
+// a shared frame was written to the websocket
+void wt_upstream_sent(wtself_t *self, zws_session_t *wss)
+{
+    if (wss->tows_pending > 0)
+	wss->tows_pending--;
+    if ((wss->tows_pending > 0) || !wss->resync)
+	return;
+
+    // drained after dropping updates: have haltalk resend the full state
+    wss->resync = false;
+    for (wt_upstream_t *up = (wt_upstream_t *) zlist_first(wss->upstreams);
+	 up != NULL;
+	 up = (wt_upstream_t *) zlist_next(wss->upstreams)) {
+	lwsl_tows("%s: session %p resync '%s' after %d drops\n",
+		  __func__, wss, up->key, wss->tows_dropped);
+	zsock_set_subscribe(up->socket, up->topic);
+	zsock_set_unsubscribe(up->socket, up->topic);
+    }
+}
+
+// at exit, once the websocket context and with it all sessions are gone
+void wt_upstream_shutdown(wtself_t *self)
+{
+    wt_upstream_t *up;
+
+    if (self->upstreams == NULL)
+	return;
+    while ((up = (wt_upstream_t *) zhash_first(self->upstreams)) != NULL) {
+	zhash_delete(self->upstreams, up->key);
+	upstream_destroy(&up);
+    }
+    zhash_destroy(&self->upstreams);
+}
+
+// queue the encoded frames to one session, or drop them if it is behind
+static int session_push(wtself_t *self, zws_session_t *wss, zmsg_t *out)
+{
+    size_t n = zmsg_size(out);
+
+    if (wss->tows_pending + (int) n > self->cfg->tows_hwm) {
+	wss->tows_dropped++;
+	wss->resync = true;
+	return 0;
+    }
+    for (zframe_t *f = zmsg_first(out); f != NULL; f = zmsg_next(out)) {
+	zframe_t *copy = zframe_dup(f);
+	wss->zmq_bytes += zframe_size(copy);
+	if (zframe_send(&copy, wss->wsq_out, 0)) {
+	    zframe_destroy(&copy);
+	    return -1;
+	}
+	wss->tows_pending++;
+    }
+    wss->zmq_msgs++;
+    return 1;
+}
+
+static int upstream_readable(zloop_t *loop, zsock_t *socket, void *arg)
+{
+    wt_upstream_t *up = (wt_upstream_t *) arg;
+    wtself_t *self = up->self;
+    struct {
+	wt_encode_cb encode;
+	zmsg_t *out;
+    } enc[MAX_ENCODERS];
+    int nenc = 0;
+
+    zmsg_t *m = zmsg_recv(socket);
+    if (m == NULL)
+	return 0;
+    up->msgs++;
+    up->bytes += zmsg_content_size(m);
+
+    for (zws_session_t *wss = (zws_session_t *) zlist_first(up->sessions);
+	 wss != NULL;
+	 wss = (zws_session_t *) zlist_next(up->sessions)) {
+
+	zmsg_t *out = NULL;
+	int i;
+
+	// encode once per encoder, not once per session
+	for (i = 0; i < nenc; i++)
+	    if (enc[i].encode == wss->encode)
+		break;
+	if (i < nenc) {
+	    out = enc[i].out;
+	} else {
+	    out = wss->encode(self, m);
+	    if (nenc < MAX_ENCODERS) {
+		enc[nenc].encode = wss->encode;
+		enc[nenc].out = out;
+		nenc++;
+	    }
+	}
+	if (out != NULL) {
+	    int rc = session_push(self, wss, out);
+	    if (rc > 0)
+		up->fanout++;
+	    else if (rc == 0)
+		up->drops++;
+	}
+	if (i >= MAX_ENCODERS)
+	    zmsg_destroy(&out);
+    }
+
+    for (int i = 0; i < nenc; i++)
+	zmsg_destroy(&enc[i].out);
+    zmsg_destroy(&m);
+    return 0;
+}
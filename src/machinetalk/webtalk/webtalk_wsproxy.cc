@@ -67,15 +67,30 @@ void wt_proxy_exit(wtself_t *self)
 
 int register_zmq_poller(zws_session_t *wss)
 {
-    if (wss->socket == NULL)
-	return -1;
-
-    // start watching the zmq socket
 #ifdef LWS_NEW_API
     wtself_t *self = (wtself_t *) lws_context_user(wss->ctxref);
 #else
     wtself_t *self = (wtself_t *) libwebsocket_context_user(wss->ctxref);
 #endif
+
+    if (wss->shared) {
+	// attach to the upstreams, which are watched instead
+	for (char *topic = (char *) zlist_first(wss->topics);
+	     topic != NULL;
+	     topic = (char *) zlist_next(wss->topics)) {
+	    for (char *uri = (char *) zlist_first(wss->connects);
+		 uri != NULL;
+		 uri = (char *) zlist_next(wss->connects)) {
+		if (wt_upstream_attach(self, wss, uri, topic))
+		    return -1;
+	    }
+	}
+	return 0;
+    }
+    if (wss->socket == NULL)
+	return -1;
+
+    // start watching the zmq socket
     wss->pollitem.socket =  wss->socket;
     wss->pollitem.fd = 0;
     wss->pollitem.events =  ZMQ_POLLIN;
@@ -416,6 +431,8 @@ callback_http(struct libwebsocket_context *context,
 		zframe_destroy(&f);
 		wss->completed++;
 		wss->wsout_bytes += m;
+		if (wss->shared)
+		    wt_upstream_sent(self, wss);
 
 		if (lws_send_pipe_choked(wsi)) {
 
@@ -445,7 +462,8 @@ callback_http(struct libwebsocket_context *context,
 		default_policy(self, wss, ZWS_CLOSE);
 
 	    lwsl_info("Websocket %d stats: in %d/%d out"
-		      " %d/%d zmq %d/%d partial=%d retry=%d complete=%d txbuf=%d\n",
+		      " %d/%d zmq %d/%d partial=%d retry=%d complete=%d txbuf=%d"
+		      " dropped=%d\n",
 #ifdef LWS_NEW_API
 		      lws_get_socket_fd(wsi), wss->wsin_msgs, wss->wsin_bytes,
 #else
@@ -454,7 +472,7 @@ callback_http(struct libwebsocket_context *context,
 		      wss->wsout_msgs, wss->wsout_bytes,
 		      wss->zmq_msgs, wss->zmq_bytes,
 		      wss->partial, wss->partial_retry, wss->completed,
-		      wss->txbufsize);
+		      wss->txbufsize, wss->tows_dropped);
 	    // stop watching and destroy the zmq sockets
 
 	    if (wss->pollitem.socket != NULL)
@@ -463,6 +481,9 @@ callback_http(struct libwebsocket_context *context,
 
 	    if (wss->socket != NULL)
 		zsock_destroy (&wss->socket);
+	    wt_upstream_detach_all(self, wss);
+	    zlist_destroy (&wss->connects);
+	    zlist_destroy (&wss->topics);
 	    zsock_destroy (&wss->wsq_in);
 	    zsock_destroy (&wss->wsq_out);
 
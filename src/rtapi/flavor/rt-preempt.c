@@ -25,13 +25,13 @@
 ********************************************************************/
 
 
+#include "config.h"
 #include "rtapi_flavor.h"
 #include "rt-preempt.h"
 #include "rtapi.h"
 #include "rtapi_common.h"
 #include <libcgroup.h>
 
-#include "config.h"
 #include <sched.h>		// sched_get_priority_*()
 #include <pthread.h>		/* pthread_* */
 
@@ -551,8 +551,10 @@ int posix_wait_hook(const int flags) {
     if (flags & TF_NOWAIT)
 	return 0;
 
+    RTAPI_TRACE1(wait_entry, task_id(task));
     clock_nanosleep(CLOCK_MONOTONIC, TIMER_ABSTIME,
 		    &extra_task_data[task_id(task)].next_time, NULL);
+    RTAPI_TRACE1(wait_wake, task_id(task));
     _rtapi_advance_time(&extra_task_data[task_id(task)].next_time,
 		       task->period + task->pll_correction, 0);
     clock_gettime(CLOCK_MONOTONIC, &ts);
@@ -561,6 +563,10 @@ int posix_wait_hook(const int flags) {
 	    && ts.tv_nsec > extra_task_data[task_id(task)].next_time.tv_nsec)) {
 
 	// timing went wrong:
+	RTAPI_TRACE2(deadline_miss, task_id(task),
+		     (ts.tv_sec - extra_task_data[task_id(task)].next_time.tv_sec)
+		     * 1000000000LL + ts.tv_nsec
+		     - extra_task_data[task_id(task)].next_time.tv_nsec);
 
 	// update stats counters in thread status
 	posix_task_update_stats_hook();
@@ -26,8 +26,8 @@
 * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
 ********************************************************************/
 
-#include "xenomai2.h"
 #include "config.h"
+#include "xenomai2.h"
 
 #include <native/task.h>                // RT_TASK, rt_task_*()
 #include <native/timer.h>               // rt_timer_*()
@@ -288,13 +288,17 @@ int xenomai2_wait_hook(const int flags) {
 	return 0;
 
     unsigned long overruns = 0;
+    RTAPI_TRACE1(wait_entry, -1);	// task id not at hand
     int result =  rt_task_wait_period(&overruns);
+    RTAPI_TRACE1(wait_wake, -1);
 
     if (result) {
 	// something went wrong:
 
 	// update stats counters in thread status
 	int task_id = xenomai2_task_update_stats_hook();
+	if (result == -ETIMEDOUT)
+	    RTAPI_TRACE2(deadline_miss, task_id, -1LL);
 
 
 	// paranoid, but you never know; this index off and
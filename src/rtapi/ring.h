@@ -65,6 +65,7 @@
 #include "rtapi_atomics.h"
 #include "rtapi_string.h"
 #include "rtapi_int.h"
+#include "rtapi_trace.h"
 
 
 #ifndef MAXIMUM // MAX conflicts with definition in hal/drivers/pci_8255.c
@@ -440,6 +441,7 @@ static inline int record_write_end(ringbuffer_t *ring,
 
     rtapi_store_u32(&t->tail, (t->tail + a) % h->size);
     //printf("New head/tail: %zd/%zd\n", h->head, t->tail);
+    RTAPI_TRACE2(ring_commit, h, sz);
     return 0;
 }
 
@@ -637,6 +639,7 @@ static inline int record_shift(ringbuffer_t *ring)
 
     rtapi_inc_u64((uint64_t *)&ring->header->generation);
     rtapi_store_u32(&ring->header->head, off);
+    RTAPI_TRACE2(ring_consume, ring->header, off);
     return 0;
 }
 
@@ -46,6 +46,9 @@
 #include <map>
 #include <vector>
 #include <algorithm>
+#include <thread>
+#include <atomic>
+#include <memory>
 #include <sys/resource.h>
 #include <linux/capability.h>
 #include <stdlib.h>
@@ -111,6 +114,7 @@ static std::map<string, pbstringarray_t> iparms; // default instance params
 
 static std::vector<string> loading_order;
 static void remove_module(std::string name);
+static bool force_exit; // set by MT_RTAPI_APP_EXIT
 
 static struct rusage rusage;
 static unsigned long minflt, majflt;
@@ -732,43 +736,62 @@ static int attach_global_segment()
 }
 
 
-// handle commands from zmq socket
-static int rtapi_request(zloop_t *loop, zsock_t *socket, void *arg)
+// at most this many modules are read ahead at the same time
+#define PRELOAD_THREADS 8
+
+// read the modules named in argv ahead, in parallel, so the loadrt and
+// newinst commands following do not wait for the disk one by one.
+// the reply goes out right away and the readers run in the background,
+// concurrently with those commands - a load reaching a module before
+// its reader does just reads it itself.
+// dlopen() itself is serialized by the dynamic linker, so what runs in
+// parallel is the file I/O and the module info cache fill - the ELF
+// sections the loads read (see rtapi_compat.c).
+// this is a hint only: modules not found are left to fail when loaded.
+static int do_preload_cmd(const pbstringarray_t &args,
+			  machinetalk::Container &pbreply)
 {
-    zmsg_t *r = zmsg_recv(socket);
-    char *origin = zmsg_popstr (r);
-    zframe_t *request_frame  = zmsg_pop (r);
-    static bool force_exit = false;
-    std::shared_ptr<Module> mi;
-    int retval;
-    int (*create_thread)(const hal_threadargs_t*);
-    int (*delete_thread)(const char *);
+    auto paths = std::make_shared<std::vector<std::string>>();
+    char path[PATH_MAX];
 
-    if(request_frame == NULL){
-	rtapi_print_msg(RTAPI_MSG_ERR, "rtapi_request(): NULL zframe_t 'request_frame' passed");
-	return -1;
-	}
+    for (int i = 0; i < args.size(); i++) {
+	if ((modules.count(args.Get(i)) == 0) &&
+	    (rtapi_module_path(path, sizeof(path), args.Get(i).c_str()) == 0) &&
+	    (std::find(paths->begin(), paths->end(), path) == paths->end()))
+	    paths->push_back(path);
+    }
+    if (paths->empty())
+	return 0;
 
-    machinetalk::Container pbreq, pbreply;
+    auto next = std::make_shared<std::atomic<size_t>>(0);
+    size_t n = std::min(paths->size(), (size_t) PRELOAD_THREADS);
 
-    if (!pbreq.ParseFromArray(zframe_data(request_frame),
-			      zframe_size(request_frame))) {
-	rtapi_print_msg(RTAPI_MSG_ERR, "cant decode request from %s (size %zu)",
-			origin ? origin : "NULL",
-			zframe_size(request_frame));
-	zmsg_destroy(&r);
-	return 0;
-    }
-    if (z_debug) {
-	string buffer;
-	if (TextFormat::PrintToString(pbreq, &buffer)) {
-	    fprintf(stderr, "request: %s\n",buffer.c_str());
-	}
-    }
+    for (size_t i = 0; i < n; i++)
+	std::thread([paths, next]() {
+		size_t j;
+		while ((j = (*next)++) < paths->size())
+		    if (rtapi_preload_module((*paths)[j].c_str()))
+			rtapi_print_msg(RTAPI_MSG_DBG, "preload %s failed",
+					(*paths)[j].c_str());
+	    }).detach();
 
-    pbreply.set_type(machinetalk::MT_RTAPI_APP_REPLY);
+    rtapi_print_msg(RTAPI_MSG_DBG, "preloading %zu modules, %zu threads",
+		    paths->size(), n);
+    return 0;
+}
 
-    switch (pbreq.type()) {
+// execute one command, setting retcode and notes in pbreply
+// returns -1 if the command type is unknown
+static int rtapi_command(int type,
+			 const machinetalk::RTAPICommand &cmd,
+			 machinetalk::Container &pbreply)
+{
+    std::shared_ptr<Module> mi;
+    int retval;
+    int (*create_thread)(const hal_threadargs_t*);
+    int (*delete_thread)(const char *);
+
+    switch (type) {
     case machinetalk::MT_RTAPI_APP_PING:
 	char buffer[RTAPI_LINELEN];
 	snprintf(buffer, sizeof(buffer),
@@ -779,84 +802,81 @@ static int rtapi_request(zloop_t *loop, zsock_t *socket, void *arg)
 	break;
 
     case machinetalk::MT_RTAPI_APP_EXIT:
-	assert(pbreq.has_rtapicmd());
-	exit_actions(pbreq.rtapicmd().instance());
+	exit_actions(cmd.instance());
 	force_exit = true;
 	pbreply.set_retcode(0);
 	break;
 
     case machinetalk::MT_RTAPI_APP_CALLFUNC:
 
-	assert(pbreq.has_rtapicmd());
-	assert(pbreq.rtapicmd().has_func());
-	assert(pbreq.rtapicmd().has_instance());
-	pbreply.set_retcode(do_callfunc_cmd(pbreq.rtapicmd().instance(),
-					      pbreq.rtapicmd().func(),
-					      pbreq.rtapicmd().argv(),
+	assert(cmd.has_func());
+	assert(cmd.has_instance());
+	pbreply.set_retcode(do_callfunc_cmd(cmd.instance(),
+					      cmd.func(),
+					      cmd.argv(),
 					      pbreply));
 	break;
 
     case machinetalk::MT_RTAPI_APP_NEWINST:
-	assert(pbreq.has_rtapicmd());
-	assert(pbreq.rtapicmd().has_comp());
-	assert(pbreq.rtapicmd().has_instname());
-	assert(pbreq.rtapicmd().has_instance());
-	pbreply.set_retcode(do_newinst_cmd(pbreq.rtapicmd().instance(),
-					   pbreq.rtapicmd().comp(),
-					   pbreq.rtapicmd().instname(),
-					   pbreq.rtapicmd().argv(),
+	assert(cmd.has_comp());
+	assert(cmd.has_instname());
+	assert(cmd.has_instance());
+	pbreply.set_retcode(do_newinst_cmd(cmd.instance(),
+					   cmd.comp(),
+					   cmd.instname(),
+					   cmd.argv(),
 					   pbreply));
 	break;
 
     case machinetalk::MT_RTAPI_APP_DELINST:
 
-	assert(pbreq.has_rtapicmd());
-	assert(pbreq.rtapicmd().has_instname());
-	assert(pbreq.rtapicmd().has_instance());
-	pbreply.set_retcode(do_delinst_cmd(pbreq.rtapicmd().instance(),
-					   pbreq.rtapicmd().instname(),
+	assert(cmd.has_instname());
+	assert(cmd.has_instance());
+	pbreply.set_retcode(do_delinst_cmd(cmd.instance(),
+					   cmd.instname(),
 					   pbreply));
 	break;
 
 
     case machinetalk::MT_RTAPI_APP_LOADRT:
-	assert(pbreq.has_rtapicmd());
-	assert(pbreq.rtapicmd().has_modname());
-	assert(pbreq.rtapicmd().has_instance());
-	pbreply.set_retcode(do_load_cmd(pbreq.rtapicmd().instance(),
-					pbreq.rtapicmd().modname(),
-					pbreq.rtapicmd().argv(),
+	assert(cmd.has_modname());
+	assert(cmd.has_instance());
+	pbreply.set_retcode(do_load_cmd(cmd.instance(),
+					cmd.modname(),
+					cmd.argv(),
 					pbreply));
 	break;
 
     case machinetalk::MT_RTAPI_APP_UNLOADRT:
-	assert(pbreq.rtapicmd().has_modname());
-	assert(pbreq.rtapicmd().has_instance());
+	assert(cmd.has_modname());
+	assert(cmd.has_instance());
 
-	pbreply.set_retcode(do_unload_cmd(pbreq.rtapicmd().instance(),
-					  pbreq.rtapicmd().modname(),
+	pbreply.set_retcode(do_unload_cmd(cmd.instance(),
+					  cmd.modname(),
 					  pbreply));
 	break;
 
+    case machinetalk::MT_RTAPI_APP_PRELOAD:
+	pbreply.set_retcode(do_preload_cmd(cmd.argv(), pbreply));
+	break;
+
     case machinetalk::MT_RTAPI_APP_LOG:
-	assert(pbreq.has_rtapicmd());
-	if (pbreq.rtapicmd().has_rt_msglevel()) {
-	    global_data->rt_msg_level = pbreq.rtapicmd().rt_msglevel();
+	if (cmd.has_rt_msglevel()) {
+	    global_data->rt_msg_level = cmd.rt_msglevel();
 	}
-	if (pbreq.rtapicmd().has_user_msglevel()) {
-	    global_data->user_msg_level = pbreq.rtapicmd().user_msglevel();
+	if (cmd.has_user_msglevel()) {
+	    global_data->user_msg_level = cmd.user_msglevel();
 	}
 	pbreply.set_retcode(0);
 	break;
 
     case machinetalk::MT_RTAPI_APP_NEWTHREAD:
-	assert(pbreq.has_rtapicmd());
-	assert(pbreq.rtapicmd().has_threadname());
-	assert(pbreq.rtapicmd().has_threadperiod());
-	assert(pbreq.rtapicmd().has_cpu());
-	assert(pbreq.rtapicmd().has_use_fp());
-	assert(pbreq.rtapicmd().has_instance());
-	assert(pbreq.rtapicmd().has_flags());
+	assert(cmd.has_threadname());
+	assert(cmd.has_threadperiod());
+	assert(cmd.has_cpu());
+	assert(cmd.has_use_fp());
+	assert(cmd.has_instance());
+	assert(cmd.has_flags());
 
         if (modules.count(HALMOD)  == 0) {
             pbreply.add_note("hal_lib not loaded");
@@ -872,12 +892,12 @@ static int rtapi_request(zloop_t *loop, zsock_t *socket, void *arg)
             break;
         }
         hal_threadargs_t args;
-        args.name = pbreq.rtapicmd().threadname().c_str();
-        args.period_nsec = pbreq.rtapicmd().threadperiod();
-        args.uses_fp = pbreq.rtapicmd().use_fp();
-        args.cpu_id = pbreq.rtapicmd().cpu();
-        args.flags = (rtapi_thread_flags_t) pbreq.rtapicmd().flags();
-        strncpy(args.cgname, pbreq.rtapicmd().cgname().c_str(), RTAPI_LINELEN-1);
+        args.name = cmd.threadname().c_str();
+        args.period_nsec = cmd.threadperiod();
+        args.uses_fp = cmd.use_fp();
+        args.cpu_id = cmd.cpu();
+        args.flags = (rtapi_thread_flags_t) cmd.flags();
+        strncpy(args.cgname, cmd.cgname().c_str(), RTAPI_LINELEN-1);
 
         retval = create_thread(&args);
         if (retval < 0) {
@@ -887,9 +907,8 @@ static int rtapi_request(zloop_t *loop, zsock_t *socket, void *arg)
 	break;
 
     case machinetalk::MT_RTAPI_APP_DELTHREAD:
-	assert(pbreq.has_rtapicmd());
-	assert(pbreq.rtapicmd().has_threadname());
-	assert(pbreq.rtapicmd().has_instance());
+	assert(cmd.has_threadname());
+	assert(cmd.has_instance());
 
         if (modules.count(HALMOD) == 0) {
             pbreply.add_note("hal_lib not loaded");
@@ -903,18 +922,98 @@ static int rtapi_request(zloop_t *loop, zsock_t *socket, void *arg)
             pbreply.set_retcode(-1);
             break;
         }
-        retval = delete_thread(pbreq.rtapicmd().threadname().c_str());
+        retval = delete_thread(cmd.threadname().c_str());
         pbreply.set_retcode(retval);
 	break;
 
     default:
+	return -1;
+    }
+    return 0;
+}
+
+// a failing member stops a MT_RTAPI_APP_BATCH request
+static bool command_failed(int type, int retcode)
+{
+    // callfunc returns the function's value, which is an error if < 0
+    if (type == machinetalk::MT_RTAPI_APP_CALLFUNC)
+	return retcode < 0;
+    return retcode != 0;
+}
+
+// execute the commands of a MT_RTAPI_APP_BATCH request in order up to the
+// first one failing; the reply has one result per command executed, and
+// the retcode and notes of the failed command
+static void do_batch_cmd(const machinetalk::Container &pbreq,
+			 machinetalk::Container &pbreply)
+{
+    machinetalk::Container sub;
+
+    pbreply.set_retcode(0);
+    for (int i = 0; i < pbreq.rtapi_batch_size(); i++) {
+	const machinetalk::RTAPICommand &cmd = pbreq.rtapi_batch(i);
+	machinetalk::RTAPIResult *result = pbreply.add_rtapi_result();
+
+	sub.Clear();
+	if ((cmd.type() == machinetalk::MT_RTAPI_APP_EXIT) ||
+	    (cmd.type() == machinetalk::MT_RTAPI_APP_BATCH) ||
+	    rtapi_command(cmd.type(), cmd, sub)) {
+	    sub.set_retcode(-EINVAL);
+	    sub.add_note("command type " + std::to_string(cmd.type()) +
+			 " not valid in a batch");
+	}
+	result->set_retcode(sub.retcode());
+	result->mutable_note()->CopyFrom(sub.note());
+
+	if (command_failed(cmd.type(), sub.retcode())) {
+	    pbreply.set_retcode(sub.retcode());
+	    pbreply.mutable_note()->CopyFrom(sub.note());
+	    return;
+	}
+	for (int j = 0; j < sub.note_size(); j++)
+	    rtapi_print_msg(RTAPI_MSG_DBG, "%s", sub.note(j).c_str());
+    }
+}
+
+// handle commands from zmq socket
+static int rtapi_request(zloop_t *loop, zsock_t *socket, void *arg)
+{
+    zmsg_t *r = zmsg_recv(socket);
+    char *origin = zmsg_popstr (r);
+    zframe_t *request_frame  = zmsg_pop (r);
+
+    if(request_frame == NULL){
+	rtapi_print_msg(RTAPI_MSG_ERR, "rtapi_request(): NULL zframe_t 'request_frame' passed");
+	return -1;
+	}
+
+    machinetalk::Container pbreq, pbreply;
+
+    if (!pbreq.ParseFromArray(zframe_data(request_frame),
+			      zframe_size(request_frame))) {
+	rtapi_print_msg(RTAPI_MSG_ERR, "cant decode request from %s (size %zu)",
+			origin ? origin : "NULL",
+			zframe_size(request_frame));
+	zmsg_destroy(&r);
+	return 0;
+    }
+    if (z_debug) {
+	string buffer;
+	if (TextFormat::PrintToString(pbreq, &buffer)) {
+	    fprintf(stderr, "request: %s\n",buffer.c_str());
+	}
+    }
+
+    pbreply.set_type(machinetalk::MT_RTAPI_APP_REPLY);
+
+    if (pbreq.type() == machinetalk::MT_RTAPI_APP_BATCH) {
+	do_batch_cmd(pbreq, pbreply);
+    } else if (rtapi_command(pbreq.type(), pbreq.rtapicmd(), pbreply)) {
 	rtapi_print_msg(RTAPI_MSG_ERR,
 			"unkown command type %d)",
 			(int) pbreq.type());
 	zmsg_destroy(&r);
 	return 0;
-
-
     }
     // log accumulated notes
     for (int i = 0; i < pbreply.note_size(); i++) {
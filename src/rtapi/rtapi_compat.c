@@ -43,6 +43,9 @@
 
 #include <elf.h>                // get_rpath()
 #include <link.h>
+#include <fcntl.h>              // readahead()
+#include <sched.h>              // sched_yield()
+#include <stdint.h>
 
 #ifndef _GNU_SOURCE
 #  define _GNU_SOURCE // Get GNU-specific strerror_r() behavior
@@ -151,36 +154,12 @@ int rtapi_fs_read(char *buf, const size_t maxlen, const char *name, ...)
     }
 }
 
-int get_elf_section(const char *const fname, const char *section_name, void **dest)
+// locate section_name in the mapped ELF image p
+// returns its size and sets *offset, or -1 if not present
+static int elf_find_section(const char *fname, const char *p,
+			    const char *section_name, size_t *offset)
 {
     int size = -1, i;
-    struct stat st;
-    char errmsg[200];
-
-    if (stat(fname, &st) != 0) {
-        rtapi_print_msg(
-            RTAPI_MSG_ERR,
-            "get_elf_section(%s, %s) stat:  %s",
-            fname, section_name, strerror_r(errno, errmsg, 200));
-	return -1;
-    }
-    int fd = open(fname, O_RDONLY);
-    if (fd < 0) {
-        rtapi_print_msg(
-            RTAPI_MSG_ERR,
-            "get_elf_section(%s, %s) open:  %s",
-            fname, section_name, strerror_r(errno, errmsg, 200));
-	return fd;
-    }
-    char *p = mmap(0, st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
-    if (p == NULL) {
-        rtapi_print_msg(
-            RTAPI_MSG_ERR,
-            "get_elf_section(%s, %s) mmap:  %s",
-            fname, section_name, strerror_r(errno, errmsg, 200));
-        close(fd);
-	return -1;
-    }
 
     switch (p[EI_CLASS]) 	{
     case ELFCLASS32:
@@ -196,20 +175,8 @@ int get_elf_section(const char *const fname, const char *section_name, void **de
 		    size  = shdr[i].sh_size;
 		    if (!size)
 			continue;
-		    if (dest) {
-			*dest = malloc(size);
-			if (*dest == NULL) {
-                            rtapi_print_msg(
-                                RTAPI_MSG_ERR,
-                                "get_elf_section(%s, %s) malloc:  %s",
-                                fname, section_name,
-                                strerror_r(errno, errmsg, 200));
-			    size = -1;
-			    break;
-			}
-			memcpy(*dest, p + shdr[i].sh_offset, size);
-			break;
-		    }
+		    *offset = shdr[i].sh_offset;
+		    break;
 		}
 	    }
 	}
@@ -228,20 +195,8 @@ int get_elf_section(const char *const fname, const char *section_name, void **de
 		    size  = shdr[i].sh_size;
 		    if (!size)
 			continue;
-		    if (dest) {
-			*dest = malloc(size);
-			if (*dest == NULL) {
-                            rtapi_print_msg(
-                                RTAPI_MSG_ERR,
-                                "get_elf_section(%s, %s) malloc:  %s",
-                                fname, section_name,
-                                strerror_r(errno, errmsg, 200));
-			    size = -1;
-			    break;
-			}
-			memcpy(*dest, p + shdr[i].sh_offset, size);
-			break;
-		    }
+		    *offset = shdr[i].sh_offset;
+		    break;
 		}
 	    }
 	}
@@ -249,11 +204,388 @@ int get_elf_section(const char *const fname, const char *section_name, void **de
     default:
 	fprintf(stderr, "%s: Unknown ELF class %d\n", fname, p[EI_CLASS]);
     }
+    return size;
+}
+
+// map fname and copy out n sections: sizes[i] is set to the size of
+// names[i] (-1 if not present), dests[i] to a malloc()ed copy if > 0
+static int read_elf_sections(const char *const fname, int n,
+			     const char **names, int *sizes, void **dests)
+{
+    struct stat st;
+    char errmsg[200];
+    size_t offset = 0;
+    int i, retval = 0;
+
+    if (stat(fname, &st) != 0) {
+        rtapi_print_msg(
+            RTAPI_MSG_ERR,
+            "get_elf_section(%s, %s) stat:  %s",
+            fname, names[0], strerror_r(errno, errmsg, 200));
+	return -1;
+    }
+    int fd = open(fname, O_RDONLY);
+    if (fd < 0) {
+        rtapi_print_msg(
+            RTAPI_MSG_ERR,
+            "get_elf_section(%s, %s) open:  %s",
+            fname, names[0], strerror_r(errno, errmsg, 200));
+	return fd;
+    }
+    char *p = mmap(0, st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+    if (p == MAP_FAILED) {
+        rtapi_print_msg(
+            RTAPI_MSG_ERR,
+            "get_elf_section(%s, %s) mmap:  %s",
+            fname, names[0], strerror_r(errno, errmsg, 200));
+        close(fd);
+	return -1;
+    }
+    for (i = 0; i < n; i++) {
+	dests[i] = NULL;
+	sizes[i] = elf_find_section(fname, p, names[i], &offset);
+	if (sizes[i] <= 0)
+	    continue;
+	if ((dests[i] = malloc(sizes[i])) == NULL) {
+	    rtapi_print_msg(
+		RTAPI_MSG_ERR,
+		"get_elf_section(%s, %s) malloc:  %s",
+		fname, names[i],
+		strerror_r(errno, errmsg, 200));
+	    sizes[i] = -1;
+	    retval = -1;
+	    continue;
+	}
+	memcpy(dests[i], p + offset, sizes[i]);
+    }
     munmap(p, st.st_size);
     close(fd);
+    return retval;
+}
+
+/*
+ * module info cache
+ *
+ * The sections rtapi_app and halcmd read from every module - the tags
+ * and the .rtapi_export symbol list - are kept in a cache, in memory for
+ * the life of the process and on disk in one small file per module, so
+ * a start need not map and walk each module's ELF headers again.
+ * Entries are keyed by path and validated against the device, inode,
+ * size and mtime of the module; a missing section is cached as such.
+ *
+ * The cache directory is $MK_MODULE_CACHE, else $XDG_CACHE_HOME/machinekit,
+ * else $HOME/.cache/machinekit; an empty MK_MODULE_CACHE disables the
+ * disk cache.  Failure to read or write it just means a cache miss.
+ */
+#define MODINFO_MAGIC   0x4d4b4d49  // MKMI
+#define MODINFO_VERSION 1
+#define MODINFO_NSECT   2
+
+static const char *modinfo_sections[MODINFO_NSECT] = {
+    RTAPI_TAGS,
+    ".rtapi_export",
+};
+
+typedef struct modinfo {
+    struct modinfo *next;
+    char *path;
+    struct stat st;
+    int sizes[MODINFO_NSECT];   // -1: section not present
+    void *data[MODINFO_NSECT];
+} modinfo_t;
+
+// on-disk header, followed by the path and the section contents
+typedef struct {
+    uint32_t magic;
+    uint32_t version;
+    uint64_t dev;
+    uint64_t ino;
+    int64_t size;
+    int64_t mtime_sec;
+    int64_t mtime_nsec;
+    uint32_t pathlen;
+    int32_t sizes[MODINFO_NSECT];
+} modinfo_hdr_t;
+
+static modinfo_t *modinfo_list;
+static char modinfo_busy;   // preloading may fill the cache in parallel
+
+static void modinfo_lock(void)
+{
+    while (__atomic_test_and_set(&modinfo_busy, __ATOMIC_ACQUIRE))
+	sched_yield();
+}
+
+static void modinfo_unlock(void)
+{
+    __atomic_clear(&modinfo_busy, __ATOMIC_RELEASE);
+}
+
+static int modinfo_current(const modinfo_t *mi, const struct stat *st)
+{
+    return (mi->st.st_dev == st->st_dev) &&
+	(mi->st.st_ino == st->st_ino) &&
+	(mi->st.st_size == st->st_size) &&
+	(mi->st.st_mtim.tv_sec == st->st_mtim.tv_sec) &&
+	(mi->st.st_mtim.tv_nsec == st->st_mtim.tv_nsec);
+}
+
+static void modinfo_free(modinfo_t *mi)
+{
+    int i;
+
+    for (i = 0; i < MODINFO_NSECT; i++)
+	free(mi->data[i]);
+    free(mi->path);
+    free(mi);
+}
+
+// cache file name for module path, 0 if there is no cache directory
+static int modinfo_file(char *buf, size_t n, const char *path)
+{
+    const char *dir = getenv("MK_MODULE_CACHE");
+    const char *base;
+    uint64_t h = 0xcbf29ce484222325ULL;   // FNV-1a
+    const char *s;
+    int len;
+
+    // a setuid process (rtapi_app) must not create root-owned files in,
+    // or trust the contents of, a directory the user controls
+    if ((geteuid() != getuid()) || (getegid() != getgid()))
+	return 0;
+    if (dir != NULL) {
+	if (*dir == '\0')
+	    return 0;
+	len = snprintf(buf, n, "%s", dir);
+    } else if ((base = getenv("XDG_CACHE_HOME")) && *base) {
+	len = snprintf(buf, n, "%s/machinekit", base);
+    } else if ((base = getenv("HOME")) && *base) {
+	len = snprintf(buf, n, "%s/.cache/machinekit", base);
+    } else {
+	return 0;
+    }
+    for (s = path; *s; s++)
+	h = (h ^ (unsigned char) *s) * 0x100000001b3ULL;
+    return (len + 40 < (int) n) &&
+	(snprintf(buf + len, n - len, "/%016llx.mi",
+		  (unsigned long long) h) > 0);
+}
+
+static modinfo_t *modinfo_load(const char *path, const struct stat *st)
+{
+    char fname[PATH_MAX];
+    modinfo_hdr_t hdr;
+    modinfo_t *mi;
+    char *p;
+    int fd, i, ok;
+
+    if (!modinfo_file(fname, sizeof(fname), path))
+	return NULL;
+    if ((fd = open(fname, O_RDONLY|O_NOFOLLOW|O_CLOEXEC)) < 0)
+	return NULL;
+    ok = (read(fd, &hdr, sizeof(hdr)) == sizeof(hdr)) &&
+	(hdr.magic == MODINFO_MAGIC) &&
+	(hdr.version == MODINFO_VERSION) &&
+	(hdr.dev == (uint64_t) st->st_dev) &&
+	(hdr.ino == (uint64_t) st->st_ino) &&
+	(hdr.size == (int64_t) st->st_size) &&
+	(hdr.mtime_sec == (int64_t) st->st_mtim.tv_sec) &&
+	(hdr.mtime_nsec == (int64_t) st->st_mtim.tv_nsec) &&
+	(hdr.pathlen == strlen(path));
+    if (!ok || ((mi = calloc(1, sizeof(modinfo_t))) == NULL)) {
+	close(fd);
+	return NULL;
+    }
+    mi->st = *st;
+    ok = ((p = malloc(hdr.pathlen + 1)) != NULL) &&
+	(read(fd, p, hdr.pathlen) == (ssize_t) hdr.pathlen);
+    mi->path = p;
+    if (ok) {
+	p[hdr.pathlen] = '\0';
+	ok = (strcmp(p, path) == 0);
+    }
+    for (i = 0; ok && (i < MODINFO_NSECT); i++) {
+	mi->sizes[i] = hdr.sizes[i];
+	if (hdr.sizes[i] <= 0)
+	    continue;
+	ok = ((mi->data[i] = malloc(hdr.sizes[i])) != NULL) &&
+	    (read(fd, mi->data[i], hdr.sizes[i]) == hdr.sizes[i]);
+    }
+    close(fd);
+    if (!ok) {
+	modinfo_free(mi);
+	return NULL;
+    }
+    return mi;
+}
+
+static int mkdirs(char *dir)
+{
+    char *s;
+
+    for (s = dir + 1; *s; s++) {
+	if (*s != '/')
+	    continue;
+	*s = '\0';
+	mkdir(dir, 0755);
+	*s = '/';
+    }
+    return mkdir(dir, 0755) && (errno != EEXIST) ? -1 : 0;
+}
+
+static void modinfo_save(const modinfo_t *mi)
+{
+    char fname[PATH_MAX], tmp[PATH_MAX + 32];
+    modinfo_hdr_t hdr;
+    int fd, i, ok;
+
+    if (!modinfo_file(fname, sizeof(fname), mi->path))
+	return;
+    snprintf(tmp, sizeof(tmp), "%s", fname);
+    *strrchr(tmp, '/') = '\0';
+    if (mkdirs(tmp))
+	return;
+
+    memset(&hdr, 0, sizeof(hdr));
+    hdr.magic = MODINFO_MAGIC;
+    hdr.version = MODINFO_VERSION;
+    hdr.dev = mi->st.st_dev;
+    hdr.ino = mi->st.st_ino;
+    hdr.size = mi->st.st_size;
+    hdr.mtime_sec = mi->st.st_mtim.tv_sec;
+    hdr.mtime_nsec = mi->st.st_mtim.tv_nsec;
+    hdr.pathlen = strlen(mi->path);
+    for (i = 0; i < MODINFO_NSECT; i++)
+	hdr.sizes[i] = mi->sizes[i];
+
+    // write a temporary file and rename it, so readers never see a
+    // partial entry
+    snprintf(tmp, sizeof(tmp), "%s.%d", fname, getpid());
+    unlink(tmp);
+    if ((fd = open(tmp, O_WRONLY|O_CREAT|O_EXCL|O_NOFOLLOW|O_CLOEXEC,
+		   0644)) < 0)
+	return;
+    ok = (write(fd, &hdr, sizeof(hdr)) == sizeof(hdr)) &&
+	(write(fd, mi->path, hdr.pathlen) == (ssize_t) hdr.pathlen);
+    for (i = 0; ok && (i < MODINFO_NSECT); i++)
+	if (mi->sizes[i] > 0)
+	    ok = (write(fd, mi->data[i], mi->sizes[i]) == mi->sizes[i]);
+    close(fd);
+    if (!ok || rename(tmp, fname))
+	unlink(tmp);
+}
+
+// the cached sections of path: from memory, the disk cache, or the module
+static modinfo_t *modinfo_get(const char *path, const struct stat *st)
+{
+    modinfo_t *mi, **prev;
+
+    modinfo_lock();
+    for (mi = modinfo_list; mi; mi = mi->next)
+	if (!strcmp(mi->path, path) && modinfo_current(mi, st))
+	    break;
+    modinfo_unlock();
+    if (mi)
+	return mi;
+
+    if ((mi = modinfo_load(path, st)) == NULL) {
+	if ((mi = calloc(1, sizeof(modinfo_t))) == NULL)
+	    return NULL;
+	mi->st = *st;
+	if (((mi->path = strdup(path)) == NULL) ||
+	    read_elf_sections(path, MODINFO_NSECT, modinfo_sections,
+			      mi->sizes, mi->data)) {
+	    modinfo_free(mi);
+	    return NULL;
+	}
+	modinfo_save(mi);
+    }
+
+    // replace an outdated entry - entries are never freed, as another
+    // thread may be copying from one
+    modinfo_lock();
+    for (prev = &modinfo_list; *prev; prev = &(*prev)->next)
+	if (!strcmp((*prev)->path, path)) {
+	    *prev = (*prev)->next;
+	    break;
+	}
+    mi->next = modinfo_list;
+    modinfo_list = mi;
+    modinfo_unlock();
+    return mi;
+}
+
+int get_elf_section(const char *const fname, const char *section_name, void **dest)
+{
+    struct stat st;
+    modinfo_t *mi;
+    int i, size;
+
+    for (i = 0; i < MODINFO_NSECT; i++)
+	if (!strcmp(section_name, modinfo_sections[i]))
+	    break;
+    if ((i == MODINFO_NSECT) || (stat(fname, &st) != 0) ||
+	((mi = modinfo_get(fname, &st)) == NULL)) {
+	// not a cached section, or the cache failed: read it directly
+	void *data;
+	if (read_elf_sections(fname, 1, &section_name, &size, &data))
+	    return -1;
+	if (dest && (size > 0))
+	    *dest = data;
+	else
+	    free(data);
+	return size;
+    }
+    size = mi->sizes[i];
+    if ((size > 0) && dest) {
+	if ((*dest = malloc(size)) == NULL)
+	    return -1;
+	memcpy(*dest, mi->data[i], size);
+    }
     return size;
 }
 
+int rtapi_module_path(char *buf, size_t n, const char *module)
+{
+    static char rtlib_dir[PATH_MAX];
+    const char *dir;
+    struct stat st;
+
+    if (strchr(module, '/')) {
+	// given as a path, sans .so
+	snprintf(buf, n, "%s.so", module);
+	return stat(buf, &st) ? -ENOENT : 0;
+    }
+    // as Module::load() in rtapi_app: $MK_MODULE_DIR first
+    if ((dir = getenv("MK_MODULE_DIR")) != NULL) {
+	snprintf(buf, n, "%s/%s.so", dir, module);
+	if (stat(buf, &st) == 0)
+	    return 0;
+    }
+    if ((rtlib_dir[0] == '\0') &&
+	get_rtapi_config(rtlib_dir, "RTLIB_DIR", PATH_MAX))
+	return -ENOENT;
+    snprintf(buf, n, "%s/modules/%s.so", rtlib_dir, module);
+    return stat(buf, &st) ? -ENOENT : 0;
+}
+
+int rtapi_preload_module(const char *path)
+{
+    struct stat st;
+    int fd;
+
+    if ((fd = open(path, O_RDONLY|O_CLOEXEC)) < 0)
+	return -errno;
+    if (fstat(fd, &st)) {
+	int retval = -errno;
+	close(fd);
+	return retval;
+    }
+    readahead(fd, 0, st.st_size);
+    close(fd);
+    return modinfo_get(path, &st) ? 0 : -EINVAL;
+}
+
 const char **get_caps(const char *const fname)
 {
     void  *dest;
@@ -268,16 +600,21 @@ const char **get_caps(const char *const fname)
     for (s = dest; s < ((char *)dest + csize); s += strlen(s) + 1)
 	n++;
 
-    const char **rv = malloc(sizeof(char*) * (n+1));
+    // the strings go behind the vector, so one free() releases both
+    const char **rv = malloc(sizeof(char*) * (n+1) + csize);
     if (rv == NULL) {
         rtapi_print_msg(
             RTAPI_MSG_ERR, "get_caps(%s) malloc:  %s",
             fname, strerror_r(errno, errmsg, 200));
+	free(dest);
 	return NULL;
     }
+    char *strings = (char *)(rv + n + 1);
+    memcpy(strings, dest, csize);
+    free(dest);
     n = 0;
-    for (s = dest;
-	 s < ((char *)dest+csize);
+    for (s = strings;
+	 s < (strings + csize);
 	 s += strlen(s)+1)
 	rv[n++] = s;
 
@@ -313,17 +650,12 @@ int rtapi_get_tags(const char *mod_name)
     char modpath[PATH_MAX];
     int result = 0, n = 0;
     char *cp1 = "";
-    char errmsg[200];
 
-    if (get_rtapi_config(modpath,"RTLIB_DIR",PATH_MAX) != 0) {
+    if (rtapi_module_path(modpath, sizeof(modpath), mod_name)) {
         rtapi_print_msg(
-            RTAPI_MSG_ERR, "rtapi_compat.c:  Can't get RTLIB_DIR:  %s",
-            strerror_r(errno, errmsg, 200));
+            RTAPI_MSG_ERR, "rtapi_compat.c:  module '%s' not found", mod_name);
         return -1;
     }
-    strcat(modpath,"/modules/");
-    strcat(modpath,mod_name);
-    strcat(modpath, ".so");
 
     const char **caps = get_caps(modpath);
     char **p = (char **)caps;
@@ -66,6 +66,8 @@ extern int get_rtapi_config(char *result, const char *param, int n);
 // returned in *dest on success.
 // caller must free().
 // returns size, or < 0 on failure.
+// the RTAPI_TAGS and .rtapi_export sections of modules are cached,
+// see 'module info cache' in rtapi_compat.c.
 int get_elf_section(const char *const fname, const char *section_name, void **dest);
 
 // split the null-delimited strings in an .rtapi_caps Elf section into an argv.
@@ -81,6 +83,15 @@ const char *get_cap(const char *const fname, const char *cap);
 // given a module name, return the integer capability mask of tags.
 int rtapi_get_tags(const char *mod_name);
 
+// the path of a module's .so: as given if it contains a '/', else in
+// $MK_MODULE_DIR or RTLIB_DIR/modules. Returns 0, or -ENOENT if not found.
+int rtapi_module_path(char *buf, size_t n, const char *module);
+
+// read a module ahead into the page cache and fill the module info
+// cache, so a following load does not wait for the disk.
+// may be called in parallel for different modules.
+int rtapi_preload_module(const char *path);
+
 
 SUPPORT_END_DECLS
 
@@ -64,6 +64,7 @@ using namespace std;
 
 #include <czmq.h>
 #include <mk-service.hh>
+#include <pbutil.hh>
 #include <libwebsockets.h>  // version tags only
 
 #include <google/protobuf/text_format.h>
@@ -557,6 +558,9 @@ s_start_shutdown_cb(zloop_t *loop, int  timer_id, void *args)
     return -1; // exit reactor
 }
 
+// reused across log lines - see send_pbcontainer()
+static machinetalk::Container container;
+
 static int
 message_poll_cb(zloop_t *loop, int  timer_id, void *args)
 {
@@ -564,9 +568,7 @@ message_poll_cb(zloop_t *loop, int  timer_id, void *args)
     size_t payload_length;
     int retval;
     char *cp;
-    machinetalk::Container container;
     machinetalk::LogMessage *logmsg;
-    zframe_t *z_pbframe;
     int current_interval = msg_poll;
 
     if (global_data->error_ring_full > full) {
@@ -613,29 +615,10 @@ message_poll_cb(zloop_t *loop, int  timer_id, void *args)
 	    logmsg->set_tag(msg->tag);
 	    logmsg->set_text(msg->buf, strlen(msg->buf));
 
-/* Needed for supporting older versions of Google Protobuf available
- * in Debian Stretch and Ubuntu Bionic */
-#if GOOGLE_PROTOBUF_VERSION >= 3006001
-	    z_pbframe = zframe_new(NULL, container.ByteSizeLong());
-#else
-	    z_pbframe = zframe_new(NULL, container.ByteSize());
-#endif
-	    assert(z_pbframe != NULL);
-
-	    if (container.SerializeWithCachedSizesToArray(zframe_data(z_pbframe))) {
-		// channel name:
-		if (zstr_sendm(logpub.socket, "log"))
-		    syslog_async(LOG_ERR,"zstr_sendm(): %s", strerror(errno));
-
-		// and the actual pb2-encoded message
-		// zframe_send() deallocates the frame after sending,
-		// and frees pb_buffer through zfree_cb()
-		if (zframe_send(&z_pbframe, logpub.socket, 0))
-		    syslog_async(LOG_ERR,"zframe_send(): %s", strerror(errno));
-
-	    } else {
-		syslog_async(LOG_ERR, "container serialization failed");
-	    }
+	    // channel name, and the actual pb2-encoded message
+	    // send_pbcontainer() Clear()s the container, keeping
+	    // log_message and its strings allocated for the next line
+	    send_pbcontainer("log", container, logpub.socket);
 	}
 	record_shift(&rtapi_msg_buffer);
 	msg_poll = msg_poll_min; // keep going quick
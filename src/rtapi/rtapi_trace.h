@@ -0,0 +1,70 @@
+/********************************************************************
+ * Copyright (C) 2026 Machinekit HAL developers
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+ ********************************************************************/
+
+#ifndef _RTAPI_TRACE_H
+#define _RTAPI_TRACE_H
+
+// static tracepoints on RT hot paths
+//
+// With 'configure --enable-usdt' (defines RTAPI_USDT in config.h) these
+// expand to SystemTap/DTrace style USDT probes from <sys/sdt.h>: a single
+// nop at the probe site plus an ELF note, patched to a breakpoint only
+// while a tracer is attached.  Without it they expand to nothing.
+//
+// All probes use the provider name 'machinekit':
+//
+//   thread_cycle_start(name, act_period)  hal_thread.c thread_task()
+//   thread_cycle_end(name, runtime)
+//   funct_entry(name)
+//   funct_exit(name, runtime)
+//   wait_entry(task_id)                   flavor wait hooks, task_id
+//   wait_wake(task_id)                    is -1 on xenomai2
+//   deadline_miss(task_id, late_ns)       late_ns is -1 if unknown
+//   ring_commit(header, size)             ring.h record_write_end()
+//   ring_consume(header, new_head)        ring.h record_shift()
+//   mutex_contended(mutex)                rtapi_mutex_get() spins
+//   mutex_acquired(mutex)                 ... and finally got it
+//   hm2_eth_send(sockfd, len, result)     hm2_eth socket wrappers
+//   hm2_eth_recv(sockfd, len, result)
+//
+// list them with:  perf list 'sdt_machinekit:*'  or
+//                  bpftrace -l 'usdt:/path/to/rtapi_app*:machinekit:*'
+// (hal_lib probes are in hal_lib.so, hm2_eth's in hm2_eth.so)
+//
+// Like HAVE_CK, RTAPI_USDT comes from config.h, which must be included
+// before rtapi.h for the probes to be compiled in.
+
+#if defined(RTAPI_USDT) && !defined(__KERNEL__)
+
+#include <sys/sdt.h>
+
+#define RTAPI_TRACE0(name)		DTRACE_PROBE(machinekit, name)
+#define RTAPI_TRACE1(name, a)		DTRACE_PROBE1(machinekit, name, a)
+#define RTAPI_TRACE2(name, a, b)	DTRACE_PROBE2(machinekit, name, a, b)
+#define RTAPI_TRACE3(name, a, b, c)	DTRACE_PROBE3(machinekit, name, a, b, c)
+
+#else
+
+#define RTAPI_TRACE0(name)		do { } while (0)
+#define RTAPI_TRACE1(name, a)		do { } while (0)
+#define RTAPI_TRACE2(name, a, b)	do { } while (0)
+#define RTAPI_TRACE3(name, a, b, c)	do { } while (0)
+
+#endif
+
+#endif // _RTAPI_TRACE_H
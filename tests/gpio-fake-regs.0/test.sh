@@ -0,0 +1,31 @@
+#!/bin/bash
+set -e
+
+export RPI_REGS=$PWD/rpi.regs BB_REGS=$PWD/bb.regs
+
+# 32 bit register at byte offset $2 of a fake_regs file $1
+setreg() {
+    printf "$(printf '\\%03o\\%03o\\%03o\\%03o' $(($3 & 255)) \
+        $(($3 >> 8 & 255)) $(($3 >> 16 & 255)) $(($3 >> 24 & 255)))" |
+        dd of=$1 bs=1 seek=$(($2)) conv=notrunc status=none
+}
+getreg() {
+    echo "$1 $(od -A n -t x4 -j $(($3)) -N 4 $2 | tr -d ' ')"
+}
+
+dd if=/dev/zero of=$RPI_REGS bs=4096 count=1 status=none
+dd if=/dev/zero of=$BB_REGS bs=8192 count=5 status=none
+setreg $RPI_REGS 0x34 0x40              # GPLEV0: GPIO6 (pin 31) high
+setreg $BB_REGS 0x6138 0x4              # GPIO2 DATAIN: p8.07 high
+
+realtime stop || true
+halbench -n 1000 -f csv gpio.hal
+
+getreg rpi-gpfsel0 $RPI_REGS 0x00
+getreg rpi-gpset0 $RPI_REGS 0x1c
+getreg rpi-gpclr0 $RPI_REGS 0x28
+getreg bb-gpio1-oe $BB_REGS 0x4134
+getreg bb-gpio1-set $BB_REGS 0x4194
+getreg bb-gpio1-clr $BB_REGS 0x4190
+getreg bb-gpio2-oe $BB_REGS 0x6134
+rm -f $RPI_REGS $BB_REGS
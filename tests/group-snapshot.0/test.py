@@ -0,0 +1,38 @@
+#!/usr/bin/env python3
+from machinekit import hal
+
+x = hal.Signal("snap-x", hal.HAL_FLOAT)
+n = hal.Signal("snap-n", hal.HAL_S32)
+b = hal.Signal("snap-b", hal.HAL_BIT)
+
+g = hal.Group("status", arg2=hal.GROUP_PUBLISH_SNAPSHOT)
+for s in ("snap-x", "snap-n", "snap-b"):
+    g.member_add(s)
+
+x.set(1.5)
+n.set(-3)
+g.publish()
+print("changed", g.snapshot())
+
+s = hal.Snapshot("status")
+print("members", len(s))
+print("handles", s.handles == [x.id, n.id, b.id])
+print("lookup", s.lookup("snap-n"), s.index(b))
+v0, values = s.read()
+print("values", values[0], values[1], int(values[2]))
+
+print("changed", g.snapshot())
+print("version same", s.version == v0)
+
+b.set(1)
+print("changed", g.snapshot())
+v1, value = s.get(s.lookup("snap-b"))
+print("get", int(value), "version advanced", v1 == v0 + 1)
+
+try:
+    hal.Snapshot("nosuchgroup")
+    print("opened missing group")
+except RuntimeError:
+    print("missing group refused")
+
+s.close()
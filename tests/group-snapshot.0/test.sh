@@ -0,0 +1,4 @@
+#!/bin/sh
+realtime start
+./test.py
+realtime stop
@@ -0,0 +1,78 @@
+//
+//   This program is free software; you can redistribute it and/or modify
+//   it under the terms of the GNU General Public License as published by
+//   the Free Software Foundation; either version 2 of the License, or
+//   (at your option) any later version.
+//
+//   This program is distributed in the hope that it will be useful,
+//   but WITHOUT ANY WARRANTY; without even the implied warranty of
+//   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//   GNU General Public License for more details.
+//
+
+//
+// Lays out a hal_pru_generic task list the way the driver does (statics
+// at 0, init task, loop tasks linked into a ring ending in the wait
+// task) and runs it on the host-side PRU model of emulator.c.
+//
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <assert.h>
+
+#include "hal/drivers/hal_pru_generic/emulator.c"
+
+static u32 ram[8192/4];
+
+static void *at(pru_addr_t addr) {
+    return (char *) ram + addr;
+}
+
+int main(void) {
+    hpg_emu_t emu = { .ram = ram };
+    pru_addr_t init_addr = sizeof(PRU_statics_t);
+    pru_addr_t step_addr = init_addr + sizeof(PRU_task_basic_t);
+    pru_addr_t wait_addr = step_addr + sizeof(PRU_task_stepdir_t);
+    PRU_statics_t *stat = at(0);
+    PRU_task_basic_t *init = at(init_addr);
+    PRU_task_stepdir_t *step = at(step_addr);
+    PRU_task_wait_t *wait = at(wait_addr);
+    int i, events;
+
+    stat->task.hdr.addr = init_addr;
+    init->task.hdr.mode = eMODE_INIT_IEP;
+    init->task.hdr.addr = step_addr;
+    step->task.hdr.mode = eMODE_STEP_DIR;
+    step->task.hdr.addr = wait_addr;
+    step->steplen = step->stepspace = step->dirsetup = step->dirhold = 1;
+    wait->task.hdr.mode = eMODE_WAIT;
+    wait->task.hdr.addr = step_addr;
+    wait->event_period = wait->event_count = 10;
+
+    assert(hpg_emu_run(&emu, 100) == 0 && emu.ticks == 0);
+    printf("idle: nothing runs before the task list is ready\n");
+
+    stat->ready = 1;
+    for (events = 0, i = 0; i < 100; i++)
+        events += hpg_emu_run(&emu, 10);
+    assert(emu.ticks == 1000 && wait->event_count == 10);
+    printf("events: %d host events in %u ticks\n", events, emu.ticks);
+
+    // the host only touches the rate between events, as in the driver
+    step->rate = 1 << 24;
+    for (i = 0; i < 80; i++)
+        hpg_emu_run(&emu, 10);
+    assert((s32) step->pos >= 99 && (s32) step->pos <= 100);
+    for (i = 0; (s32) step->pos < 100; i++)
+        hpg_emu_run(&emu, 1);
+    assert(i <= 8);
+    printf("stepgen: %d steps forward at 1/8 step per tick\n", (s32) step->pos);
+
+    step->rate = -(1 << 24);
+    for (i = 0; i < 80; i++)
+        hpg_emu_run(&emu, 10);
+    assert((s32) step->pos >= -1 && (s32) step->pos <= 1);
+    printf("stepgen: back within a step of 0 after a direction change\n");
+
+    return 0;
+}
@@ -0,0 +1,6 @@
+#!/bin/sh
+rm -f emu
+set -e
+gcc -O2 -D_GNU_SOURCE -DRTAPI -I../../src -I../../src/rtapi -I../../src/hal/lib \
+    emu.c -o emu
+./emu
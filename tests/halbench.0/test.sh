@@ -0,0 +1,4 @@
+#!/bin/bash
+set -e
+realtime stop || true
+halbench -n 500 -f csv bench.hal
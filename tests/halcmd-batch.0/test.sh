@@ -0,0 +1,7 @@
+#!/bin/sh
+realtime stop || true
+realtime start
+halcmd -f batch.hal; echo "batch.hal: $?"
+halcmd -f fail.hal; echo "fail.hal: $?"
+halcmd list funct
+realtime stop
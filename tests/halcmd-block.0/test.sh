@@ -0,0 +1,8 @@
+#!/bin/sh
+realtime stop || true
+realtime start
+halcmd -f block.hal; echo "block.hal: $?"
+halcmd -f fail.hal 2>&1; echo "fail.hal: $?"
+halcmd -f open.hal; echo "open.hal: $?"
+halcmd show sig
+realtime stop
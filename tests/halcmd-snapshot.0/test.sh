@@ -0,0 +1,24 @@
+#!/bin/sh
+realtime stop || true
+realtime start
+halcmd -f build.hal || exit 1
+halcmd save > saved.hal
+realtime stop
+
+realtime start
+halcmd restore snapshot.bin; echo "restore: $?"
+halcmd save > restored.hal
+halcmd restore snapshot.bin; echo "restore again: $?"
+halcmd save > again.hal
+realtime stop
+
+# an existing object in the way: nothing may be loaded
+realtime start
+halcmd newsig out bit
+halcmd restore snapshot.bin; echo "conflict: $?"
+halcmd -s show comp | grep -q or2 || echo "nothing loaded"
+realtime stop
+
+cmp -s saved.hal restored.hal && echo "restored matches"
+cmp -s saved.hal again.hal && echo "again matches"
+rm -f snapshot.bin saved.hal restored.hal again.hal
@@ -0,0 +1,14 @@
+#!/bin/bash
+set -e
+for batch in 0 1; do
+    realtime stop || true
+    realtime start
+    halcmd -f record.hal
+    halcmd setp hm2_test.0.encoder.batch $batch
+    halcmd start
+    halrecord rec -o rec.out -n 4000 -c 3000
+    realtime stop
+    echo "batch $batch"
+    halrecord --dump rec.out
+    rm -f rec.out
+done
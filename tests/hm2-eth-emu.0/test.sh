@@ -0,0 +1,11 @@
+#!/bin/bash
+set -e
+realtime stop || true
+hm2_eth_emu -m encoder=2,stepgen=2 -l 20 -r 2 -d 300 2> emu.log &
+EMU=$!
+sleep 1
+halbench -n 300 -f csv bench.hal || { kill $EMU; exit 1; }
+kill -INT $EMU
+wait $EMU
+cat emu.log
+rm -f emu.log
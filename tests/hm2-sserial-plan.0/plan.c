@@ -0,0 +1,272 @@
+//
+//   This program is free software; you can redistribute it and/or modify
+//   it under the terms of the GNU General Public License as published by
+//   the Free Software Foundation; either version 2 of the License, or
+//   (at your option) any later version.
+//
+//   This program is distributed in the hope that it will be useful,
+//   but WITHOUT ANY WARRANTY; without even the implied warranty of
+//   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//   GNU General Public License for more details.
+//
+
+//
+// Exercises the compiled Smart Serial process data plans of
+// sserial_plan.c on remotes built from PTOC descriptor tables, without
+// a board: field positions are checked against the bit-at-a-time
+// reference extraction the driver used before, the write side is looped
+// back into the read side, Fanuc H/L encoder pairs are combined, and the
+// per-cycle cost is printed to stderr.
+//
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdarg.h>
+#include <assert.h>
+#include <time.h>
+#include <math.h>
+
+#include "sserial_plan.c"
+
+void *halg_malloc(const int use_hal_mutex, size_t size) {
+    return calloc(1, size);
+}
+
+void rtapi_print_msg(int level, const char *fmt, ...) {
+    va_list ap;
+    va_start(ap, fmt);
+    vfprintf(stderr, fmt, ap);
+    va_end(ap);
+}
+
+static const hm2_sserial_data_t io_like_params[] = {  // 7i84 style
+    {LBP_DATA,0x20,LBP_BITS,LBP_IN,0,0,0,"none","input"},
+    {LBP_DATA,0x10,LBP_BITS,LBP_OUT,0,0,0,"none","output"},
+    {LBP_DATA,0x08,LBP_UNSIGNED,LBP_IN,0,3.3,0,"volts","analog0"},
+    {LBP_DATA,0x08,LBP_UNSIGNED,LBP_IN,0,36,0,"volts","fieldvoltage"},
+};
+
+static const hm2_sserial_data_t mixed_params[] = {  // straddles every word
+    {LBP_DATA,0x05,LBP_PAD,LBP_IO,0,0,0,"pad","pad"},
+    {LBP_DATA,0x14,LBP_STREAM,LBP_IO,0,0,0,"none","stream"},
+    {LBP_DATA,0x18,LBP_SIGNED,LBP_IO,-10,10,0,"volts","signed"},
+    {LBP_DATA,0x20,LBP_FLOAT,LBP_IO,0,0,0,"none","float"},
+    {LBP_DATA,0x0C,LBP_UNSIGNED,LBP_IO,0,100,0,"none","unsigned"},
+    {LBP_DATA,0x01,LBP_BOOLEAN,LBP_IO,0,0,0,"none","bool"},
+    {LBP_DATA,0x02,LBP_BITS,LBP_IO,0,0,0,"none","bits"},
+};
+
+static const hm2_sserial_data_t fanuc_params[] = {
+    {LBP_DATA,0x05,LBP_PAD,LBP_IN,0,0,0,"pad","pad"},
+    {LBP_DATA,0x0D,LBP_ENCODER_L,LBP_IN,0,0,0,"none","enc-low"},
+    {LBP_DATA,0x03,LBP_PAD,LBP_IN,0,0,0,"pad","pad"},
+    {LBP_DATA,0x10,LBP_ENCODER_H,LBP_IN,0,0,0,"none","enc"},
+};
+
+static hostmot2_t *hm2;
+
+static hm2_sserial_remote_t *make_remote(const char *name,
+                                         const hm2_sserial_data_t *params,
+                                         int n, u8 dir) {
+    hm2_sserial_remote_t *chan = calloc(1, sizeof(*chan));
+    u32 *regs = calloc(7, sizeof(u32));
+    int p, b;
+
+    snprintf(chan->name, sizeof(chan->name), "%s", name);
+    chan->num_confs = n;
+    chan->confs = calloc(n, sizeof(hm2_sserial_data_t));
+    chan->pins = calloc(n, sizeof(hm2_sserial_pins_t));
+    memcpy(chan->confs, params, n * sizeof(hm2_sserial_data_t));
+    chan->reg_cs_read = &regs[0];
+    chan->reg_0_read = &regs[1];
+    chan->reg_1_read = &regs[2];
+    chan->reg_2_read = &regs[3];
+    chan->reg_0_write = &regs[4];
+    chan->reg_1_write = &regs[5];
+    chan->reg_2_write = &regs[6];
+
+    for (p = 0 ; p < n ; p++){
+        hm2_sserial_data_t *conf = &chan->confs[p];
+        hm2_sserial_pins_t *pin = &chan->pins[p];
+        if (conf->DataDir == LBP_IO) conf->DataDir = dir;
+        pin->u32_pin = calloc(1, sizeof(hal_u32_t));
+        pin->s32_pin = calloc(1, sizeof(hal_s32_t));
+        pin->s32_pin2 = calloc(1, sizeof(hal_s32_t));
+        pin->float_pin = calloc(1, sizeof(hal_float_t));
+        pin->boolean = calloc(1, sizeof(hal_bit_t));
+        pin->boolean2 = calloc(1, sizeof(hal_bit_t));
+        pin->invert = calloc(conf->DataLength, sizeof(hal_bit_t));
+        pin->bit_pins = calloc(conf->DataLength, sizeof(hal_bit_t *));
+        pin->bit_pins_not = calloc(conf->DataLength, sizeof(hal_bit_t *));
+        for (b = 0 ; b < conf->DataLength ; b++){
+            pin->bit_pins[b] = calloc(1, sizeof(hal_bit_t));
+            pin->bit_pins_not[b] = calloc(1, sizeof(hal_bit_t));
+        }
+        pin->fullscale = conf->ParmMax;
+        pin->maxlim = conf->ParmMax;
+        pin->minlim = conf->ParmMin;
+    }
+    assert(hm2_sserial_compile_plan(hm2, chan) == 0);
+    return chan;
+}
+
+// the extraction the driver did per field and per cycle before the plans
+static u64 ref_getbits(hm2_sserial_remote_t *chan, int start, int len) {
+    long long user0 = *chan->reg_0_read;
+    long long user1 = *chan->reg_1_read;
+    long long user2 = *chan->reg_2_read;
+    long long mask = (~0ull >> (64 - len));
+
+    if (start + len <= 32){
+        return (user0 >> start) & mask;
+    } else if (start + len <= 64){
+        if (start >= 32) return (user1 >> (start - 32)) & mask;
+        return (((user1 << 32) | user0) >> start) & mask;
+    } else if (start >= 64){
+        return (user2 >> (start - 64)) & mask;
+    } else if (start >= 32){
+        return (((user2 << 32) | user1) >> (start - 32)) & mask;
+    }
+    return ((user2 << (64 - start)) | (user1 << (32 - start))
+            | (user0 >> start)) & mask;
+}
+
+static void check_positions(hm2_sserial_remote_t *chan) {
+    u32 data[5] = {0};
+    int i, o, p, bitcount;
+
+    for (i = 0 ; i < 1000 ; i++){
+        data[0] = *chan->reg_0_read = random() ^ (random() << 16);
+        data[1] = *chan->reg_1_read = random() ^ (random() << 16);
+        data[2] = *chan->reg_2_read = random() ^ (random() << 16);
+        for (p = 0, o = 0, bitcount = 0 ; p < chan->num_confs ; p++){
+            hm2_sserial_data_t *conf = &chan->confs[p];
+            if (conf->DataDir & 0x80) continue;
+            assert(extract(data, &chan->read_ops[o])
+                   == ref_getbits(chan, bitcount, conf->DataLength));
+            bitcount += conf->DataLength;
+            o++;
+        }
+        assert(o == chan->num_read_ops);
+    }
+    printf("%s: %d read fields at the reference positions\n",
+           chan->name, chan->num_read_ops);
+}
+
+static void loopback(hm2_sserial_remote_t *out, hm2_sserial_remote_t *in) {
+    int i, o, b;
+
+    for (i = 0 ; i < 1000 ; i++){
+        for (o = 0 ; o < out->num_write_ops ; o++){
+            hm2_sserial_op_t *op = &out->write_ops[o];
+            hm2_sserial_pins_t *pin = op->pin;
+            for (b = 0 ; b < op->len ; b++) *pin->bit_pins[b] = random() & 1;
+            *pin->boolean = random() & 1;
+            *pin->u32_pin = random();
+            *pin->float_pin = pin->minlim + (pin->maxlim - pin->minlim)
+                              * (random() / (double)RAND_MAX);
+            if (op->type == LBP_FLOAT) *pin->float_pin = random() / 7.0;
+        }
+        hm2_sserial_write_pins(out);
+        *in->reg_0_read = *out->reg_0_write;
+        *in->reg_1_read = *out->reg_1_write;
+        *in->reg_2_read = *out->reg_2_write;
+        hm2_sserial_read_pins(in);
+
+        for (o = 0 ; o < out->num_write_ops ; o++){
+            hm2_sserial_op_t *op = &out->write_ops[o];
+            hm2_sserial_pins_t *wp = op->pin;
+            hm2_sserial_pins_t *rp = in->read_ops[o].pin;
+            double lsb = (wp->maxlim - wp->minlim) / (double)op->mask;
+            switch (op->type){
+            case LBP_BITS:
+                for (b = 0 ; b < op->len ; b++)
+                    assert(*rp->bit_pins[b] == *wp->bit_pins[b]);
+                break;
+            case LBP_BOOLEAN:
+                assert(*rp->boolean == *wp->boolean);
+                break;
+            case LBP_STREAM:
+                assert(*rp->u32_pin == (*wp->u32_pin & op->mask));
+                break;
+            case LBP_UNSIGNED:
+            case LBP_SIGNED:
+                assert(fabs(*rp->float_pin - *wp->float_pin) <= 2 * lsb);
+                break;
+            case LBP_FLOAT:
+                assert(*rp->float_pin == (float)*wp->float_pin);
+                break;
+            }
+        }
+    }
+    printf("%s: %d fields survive a write/read loopback\n",
+           out->name, out->num_write_ops);
+}
+
+static void check_fanuc(hm2_sserial_remote_t *chan) {
+    hm2_sserial_pins_t *pin = &chan->pins[3];
+    s64 pos = 0;
+    int i;
+
+    assert(chan->num_read_ops == 4);
+    assert(chan->read_ops[1].type == HM2_SSERIAL_OP_HOLD);
+    assert(chan->read_ops[3].pin == pin);
+    for (i = 0 ; i < 20000 ; i++){
+        u32 count;
+        pos += (i < 10000 ? 1 : -1) * (random() % 3000);
+        count = pos & ((1 << 29) - 1);
+        *chan->reg_0_read = ((count & 0x1FFF) << 5) | ((count >> 13) << 21);
+        *chan->reg_1_read = count >> 24;
+        hm2_sserial_read_pins(chan);
+        assert(*pin->s32_pin2 == pos);
+    }
+    printf("%s: 29 bit H/L encoder pair tracks through wraps\n", chan->name);
+}
+
+static void bench(hm2_sserial_remote_t *chan, const char *what) {
+    struct timespec t0, t1;
+    int i, n = 200000;
+    double ns;
+
+    clock_gettime(CLOCK_MONOTONIC, &t0);
+    for (i = 0 ; i < n ; i++){
+        *chan->reg_0_read = i;
+        hm2_sserial_read_pins(chan);
+        hm2_sserial_write_pins(chan);
+    }
+    clock_gettime(CLOCK_MONOTONIC, &t1);
+    ns = ((t1.tv_sec - t0.tv_sec) * 1e9 + (t1.tv_nsec - t0.tv_nsec)) / n;
+    fprintf(stderr, "%-12s %3d read %3d write fields: %7.1f ns/cycle\n",
+            what, chan->num_read_ops, chan->num_write_ops, ns);
+}
+
+int main(int argc, char **argv) {
+    hm2_lowlevel_io_t llio = { .name = "plan-test" };
+    hostmot2_t h = { .llio = &llio };
+    hm2_sserial_remote_t *r8i20, *rio, *rout, *rin, *rfanuc;
+
+    hm2 = &h;
+    srandom(1);
+    r8i20 = make_remote("8i20", hm2_8i20_params,
+                        sizeof(hm2_8i20_params) / sizeof(hm2_8i20_params[0]), 0);
+    rio = make_remote("7i84-like", io_like_params,
+                      sizeof(io_like_params) / sizeof(io_like_params[0]), 0);
+    rout = make_remote("mixed", mixed_params,
+                       sizeof(mixed_params) / sizeof(mixed_params[0]), LBP_OUT);
+    rin = make_remote("mixed-in", mixed_params,
+                      sizeof(mixed_params) / sizeof(mixed_params[0]), LBP_IN);
+    rfanuc = make_remote("fanuc", fanuc_params,
+                         sizeof(fanuc_params) / sizeof(fanuc_params[0]), 0);
+
+    check_positions(r8i20);
+    check_positions(rio);
+    check_positions(rin);
+    loopback(rout, rin);
+    check_fanuc(rfanuc);
+
+    bench(r8i20, "8i20");
+    bench(rio, "7i84-like");
+    bench(rin, "mixed");
+    bench(rfanuc, "fanuc");
+    return 0;
+}
@@ -0,0 +1,6 @@
+#!/bin/sh
+rm -f plan
+set -e
+gcc -O2 -D_GNU_SOURCE -DRTAPI -I../../src -I../../src/rtapi -I../../src/hal/lib \
+    -I../../src/hal/drivers/mesa-hostmot2 plan.c -o plan -lm
+./plan
@@ -0,0 +1,9 @@
+#!/bin/bash
+set -e
+realtime stop || true
+realtime start
+halcmd -f record.hal
+halrecord rec -o rec.out -n 1000 -c 200
+realtime stop
+halrecord --dump rec.out
+rm -f rec.out
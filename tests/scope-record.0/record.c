@@ -0,0 +1,122 @@
+//
+//   This program is free software; you can redistribute it and/or modify
+//   it under the terms of the GNU General Public License as published by
+//   the Free Software Foundation; either version 2 of the License, or
+//   (at your option) any later version.
+//
+//   This program is distributed in the hope that it will be useful,
+//   but WITHOUT ANY WARRANTY; without even the implied warranty of
+//   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//   GNU General Public License for more details.
+//
+
+//
+// Writes a halscope record file: the channels are captured into
+// scope_data_t slots the way scope_rt does, slots prefilled with junk
+// so only the bytes of each value are valid, and packed into records
+// at the offsets of scope_rec_offsets().  Channels of every size come
+// in mixed order, with a gap of one channel that is not acquired.
+//
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "rtapi.h"
+#include "hal.h"
+#include "hal/utils/scope_shm.h"
+#include "hal/components/hal_record.h"
+
+#define SAMPLES 5
+
+static const struct {
+    hal_type_t type;
+    const char *name;
+} chan[16] = {
+    { HAL_BIT,   "scope.bit" },
+    { HAL_S32,   "scope.s32" },
+    { HAL_TYPE_UNSPECIFIED, NULL },
+    { HAL_FLOAT, "scope.float" },
+    { HAL_U32,   "scope.u32" },
+    { HAL_S64,   "scope.s64" },
+    { HAL_BIT,   "scope.bit2" },
+};
+
+static void capture(scope_data_t *dest, const char *data_len, int n)
+{
+    int c;
+
+    for (c = 0; c < 16; c++) {
+	if (data_len[c] == 0)
+	    continue;
+	switch (chan[c].type) {
+	case HAL_BIT:   dest->d_u8 = (c == 0) ? (n & 1) : !(n & 1); break;
+	case HAL_S32:   dest->d_s32 = -100 * n; break;
+	case HAL_U32:   dest->d_u32 = 4000000000u + n; break;
+	case HAL_FLOAT: dest->d_real = n * 0.25; break;
+	case HAL_S64:   dest->d_s64 = -(1LL << 40) * n; break;
+	default:	break;
+	}
+	dest++;
+    }
+}
+
+int main(int argc, char **argv)
+{
+    char data_len[16], text[16 * REC_LINE_LEN + 64], *header, *rec;
+    int offset[16], c, n, len, size, count;
+    scope_data_t slot[16], *src;
+    __u64 hdr[2], hsize, records;
+    FILE *fp;
+
+    if (argc != 2) {
+	fprintf(stderr, "usage: %s file.rec\n", argv[0]);
+	return 1;
+    }
+    count = 0;
+    for (c = 0; c < 16; c++) {
+	data_len[c] = rec_value_size(chan[c].type);
+	if (data_len[c])
+	    count++;
+    }
+    size = scope_rec_offsets(data_len, offset);
+
+    len = snprintf(text, sizeof(text), "recorder 1 %d %d\n", size, count);
+    for (c = 0; c < 16; c++) {
+	if (offset[c] >= 0)
+	    len += snprintf(text + len, sizeof(text) - len, "%d %s %s\n",
+			    offset[c], rec_type_name(chan[c].type),
+			    chan[c].name);
+    }
+    hsize = rec_file_header_size(len);
+    records = SAMPLES;
+    header = calloc(1, hsize);
+    rec = calloc(1, size);
+    memcpy(header + REC_FILE_SIZE_OFFSET, &hsize, sizeof(hsize));
+    memcpy(header + REC_FILE_COUNT_OFFSET, &records, sizeof(records));
+    memcpy(header + REC_FILE_TEXT_OFFSET, text, len);
+
+    fp = fopen(argv[1], "w");
+    if (fp == NULL) {
+	perror(argv[1]);
+	return 1;
+    }
+    fwrite(header, hsize, 1, fp);
+    for (n = 0; n < SAMPLES; n++) {
+	memset(slot, 0xa5, sizeof(slot));
+	capture(slot, data_len, n);
+	hdr[0] = n;
+	hdr[1] = n * 1000;
+	memcpy(rec, hdr, sizeof(hdr));
+	src = slot;
+	for (c = 0; c < 16; c++) {
+	    if (offset[c] >= 0)
+		memcpy(rec + offset[c], src++, data_len[c]);
+	}
+	fwrite(rec, size, 1, fp);
+    }
+    fclose(fp);
+    free(header);
+    free(rec);
+    return 0;
+}
@@ -0,0 +1,8 @@
+#!/bin/sh
+rm -f record scope.rec
+set -e
+gcc -D_GNU_SOURCE -DULAPI -I../../src -I../../src/rtapi -I../../src/hal/lib \
+    record.c -o record
+./record scope.rec
+halrecord --dump scope.rec
+rm -f record scope.rec
@@ -0,0 +1,10 @@
+#!/bin/bash
+set -e
+TMPDIR=`mktemp -d /tmp/stepgen-soa.XXXXXX`
+trap "rm -rf $TMPDIR" 0 1 2 3 9 15
+
+SOA=0 halrun -f stepgens.hal > $TMPDIR/scalar
+SOA=1 halrun -f stepgens.hal > $TMPDIR/soa
+
+cmp $TMPDIR/scalar $TMPDIR/soa 1>&2
+cat $TMPDIR/soa
@@ -0,0 +1,14 @@
+#!/bin/bash
+set -e
+for i in $(seq 1 100); do
+    echo "$i.25 $((-i)) $((i * 3)) $((i % 2))"
+done > input.txt
+realtime stop || true
+realtime start
+halcmd -f loop.hal
+halrecord smp -o out.rec -n 1000 -c 100 &
+halstream str -t input.txt
+wait
+realtime stop
+halrecord --dump out.rec
+rm -f input.txt out.rec
@@ -0,0 +1,119 @@
+#!/usr/bin/env python3
+# minimal websocket client, enough for webtalk's binary frames
+import base64
+import os
+import socket
+import struct
+import subprocess
+import sys
+import time
+
+import zmq
+
+TOPIC = b'shared'
+
+
+def free_port():
+    s = socket.socket()
+    s.bind(('127.0.0.1', 0))
+    port = s.getsockname()[1]
+    s.close()
+    return port
+
+
+class Session:
+    def __init__(self, port, uri):
+        self.s = socket.create_connection(('127.0.0.1', port), timeout=5)
+        key = base64.b64encode(os.urandom(16)).decode()
+        self.s.sendall(('GET /?connect=%s&type=sub&subscribe=%s HTTP/1.1\r\n'
+                        'Host: 127.0.0.1:%d\r\n'
+                        'Upgrade: websocket\r\n'
+                        'Connection: Upgrade\r\n'
+                        'Sec-WebSocket-Key: %s\r\n'
+                        'Sec-WebSocket-Protocol: machinekit1.0\r\n'
+                        'Sec-WebSocket-Version: 13\r\n\r\n'
+                        % (uri, TOPIC.decode(), port, key)).encode())
+        reply = b''
+        while b'\r\n\r\n' not in reply:
+            reply += self.s.recv(1)
+        if b' 101 ' not in reply.split(b'\r\n')[0]:
+            raise RuntimeError('handshake failed: %r' % reply)
+
+    def exactly(self, n):
+        data = b''
+        while len(data) < n:
+            chunk = self.s.recv(n - len(data))
+            if not chunk:
+                raise RuntimeError('connection closed')
+            data += chunk
+        return data
+
+    def recv(self):
+        b0, b1 = self.exactly(2)
+        n = b1 & 0x7f
+        if n == 126:
+            n, = struct.unpack('!H', self.exactly(2))
+        elif n == 127:
+            n, = struct.unpack('!Q', self.exactly(8))
+        return self.exactly(n)
+
+    def close(self):
+        # masked close frame, as clients must send
+        self.s.sendall(b'\x88\x80' + os.urandom(4))
+        self.s.close()
+
+
+def upstream(xpub):
+    """ the next (un)subscription seen by the XPUB, if any """
+    if xpub.poll(2000):
+        return xpub.recv()
+    return None
+
+
+def main():
+    ctx = zmq.Context.instance()
+    xpub = ctx.socket(zmq.XPUB)
+    xpub.setsockopt(zmq.XPUB_VERBOSE, 1)
+    xpub.setsockopt(zmq.LINGER, 0)
+    uri = 'tcp://127.0.0.1:%d' % xpub.bind_to_random_port('tcp://127.0.0.1')
+
+    port = free_port()
+    webtalk = subprocess.Popen(['webtalk', '-F', '-p', str(port)],
+                               stdout=subprocess.DEVNULL,
+                               stderr=subprocess.DEVNULL)
+    try:
+        for i in range(50):
+            try:
+                socket.create_connection(('127.0.0.1', port), 1).close()
+                break
+            except OSError:
+                time.sleep(0.1)
+
+        a = Session(port, uri)
+        print('a attached', upstream(xpub))
+        b = Session(port, uri)
+        print('b attached', upstream(xpub))
+
+        xpub.send_multipart([TOPIC, b'one'])
+        print('a', a.recv(), a.recv())
+        print('b', b.recv(), b.recv())
+
+        b.close()
+        print('b detached', upstream(xpub))
+        xpub.send_multipart([TOPIC, b'two'])
+        print('a', a.recv(), a.recv())
+
+        a.close()
+        print('a detached', upstream(xpub))
+        a = Session(port, uri)
+        print('a attached', upstream(xpub))
+        a.close()
+    finally:
+        webtalk.terminate()
+        webtalk.wait()
+        xpub.close()
+    return 0
+
+
+if __name__ == '__main__':
+    sys.exit(main())